@@ -0,0 +1,1005 @@
+/**
+ * @file ArmazenamentoDePaginas.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo das classes que guardam os bytes da árvore (fstream, pread/pwrite,
+ * mmap, io_uring e memória).
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include "templates/tipos.hpp"
+#include "EntradaESaidaAssincrona.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace constantes
+{
+    static const file_ptr_type ptrNuloPagina = -1;
+
+    /** Quantidade de bytes que o arquivo mapeado cresce de cada vez. */
+    static const file_ptr_type tamanhoDoBlocoDeCrescimento = 1 << 20;
+}
+
+/**
+ * @brief Tipos de armazenamento disponíveis para o arquivo da árvore.
+ */
+enum class TipoDeArmazenamento
+{
+    /** Leituras e escritas com seekg/seekp/read/write num fstream. */
+    FSTREAM,
+    /** Leituras e escritas posicionais com pread/pwrite, sem seeks. */
+    PREAD,
+    /** Arquivo mapeado em memória com mmap. */
+    MMAP,
+    /**
+     * Como o PREAD, mas os lotes de leituras e escritas têm várias operações em
+     * andamento ao mesmo tempo, pelo io_uring ou, sem ele, por threads.
+     */
+    ASSINCRONO,
+    /** Tudo fica em um vetor na memória e nada vai para o disco. */
+    MEMORIA
+};
+
+/**
+ * @brief Interface do lugar onde a árvore guarda os seus bytes. Todos os acessos
+ * são posicionais: quem chama informa o endereço e a quantidade de bytes, então
+ * várias threads podem acessar intervalos diferentes ao mesmo tempo (veja
+ * permiteLerDuranteEscritas() para a exceção). Além disso, o armazenamento
+ * decide onde ficam as páginas novas (alocarPagina()) e recebe de volta as que
+ * não são mais usadas (liberarPagina()). Todas as páginas de um mesmo
+ * armazenamento devem ter o mesmo tamanho.
+ *
+ * As páginas liberadas formam uma lista encadeada guardada no próprio
+ * armazenamento: cada página livre tem, nos seus primeiros bytes, o endereço da
+ * próxima, e o endereço da primeira fica no cabeçalho de quem usa o armazenamento
+ * (veja usarListaDePaginasLivres()).
+ */
+class ArmazenamentoDePaginas
+{
+    /** Fim do espaço já entregue por alocarPagina(), tenha ele sido escrito ou não. */
+    file_ptr_type fimAlocado = 0;
+
+    /** Onde fica guardado o endereço da primeira página livre. */
+    file_ptr_type enderecoDaCabecaDaLista = constantes::ptrNuloPagina;
+
+    /** Cópia em memória do endereço da primeira página livre. */
+    file_ptr_type primeiraPaginaLivre = constantes::ptrNuloPagina;
+
+    /** Protege a lista de páginas livres e o fimAlocado. */
+    mutex travaDaLista;
+
+    void trocarPrimeiraPaginaLivre(file_ptr_type endereco)
+    {
+        primeiraPaginaLivre = endereco;
+
+        if (!escrever(enderecoDaCabecaDaLista, (char *) &endereco, sizeof(file_ptr_type)))
+        {
+            falhar("Não foi possível atualizar a lista de páginas livres.");
+        }
+    }
+
+protected:
+    /**
+     * @brief Esquece as páginas alocadas e liberadas. Deve ser chamado quando o
+     * conteúdo do armazenamento é descartado.
+     */
+    void esquecerAlocacoes()
+    {
+        fimAlocado = 0;
+        primeiraPaginaLivre = constantes::ptrNuloPagina;
+    }
+
+    /**
+     * @brief Mostra a mensagem no cerr, junto com a descrição do errno, e lança
+     * uma exceção com ela.
+     */
+    void falhar(string mensagem)
+    {
+        mensagem = "[Armazenamento " + nome() + "] " + mensagem + " (" + strerror(errno) + ")";
+
+        // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+        cerr << mensagem << endl << "Exceção lançada" << endl;
+
+        throw runtime_error(mensagem);
+    }
+
+    /**
+     * @brief Abre (ou cria) o arquivo para leitura e escrita com open().
+     *
+     * @param nomeDoArquivo Nome do arquivo.
+     * @param tamanhoDoArquivo Recebe o tamanho atual do arquivo.
+     *
+     * @return int Descritor do arquivo aberto.
+     */
+    int abrirDescritor(string nomeDoArquivo, file_ptr_type &tamanhoDoArquivo)
+    {
+        int descritor = open(nomeDoArquivo.c_str(), O_RDWR | O_CREAT, 0644);
+
+        if (descritor < 0) falhar("Não foi possível abrir o arquivo " + nomeDoArquivo + ".");
+
+        struct stat informacoes;
+
+        if (fstat(descritor, &informacoes) != 0)
+        {
+            falhar("Não foi possível obter o tamanho do arquivo " + nomeDoArquivo + ".");
+        }
+
+        tamanhoDoArquivo = informacoes.st_size;
+
+        return descritor;
+    }
+
+public:
+    virtual ~ArmazenamentoDePaginas() {}
+
+    /**
+     * @brief Obtém um nome curto do armazenamento, útil para relatórios.
+     */
+    virtual string nome() = 0;
+
+    /**
+     * @brief Copia os bytes do endereço informado para o buffer.
+     *
+     * @return true Caso todos os bytes tenham sido lidos.
+     * @return false Caso o intervalo passe do fim do armazenamento ou haja erro.
+     */
+    virtual bool ler(file_ptr_type endereco, char *buffer, int tamanho) = 0;
+
+    /**
+     * @brief Copia os bytes do buffer para o endereço informado. Escrever depois
+     * do fim aumenta o armazenamento.
+     *
+     * @return true Caso todos os bytes tenham sido escritos.
+     * @return false Caso haja erro.
+     */
+    virtual bool escrever(file_ptr_type endereco, const char *buffer, int tamanho) = 0;
+
+    /**
+     * @brief Obtém um ponteiro para ler os bytes do endereço informado sem
+     * copiá-los. O ponteiro só vale até a próxima escrita no armazenamento.
+     *
+     * @return const char* nullptr caso o armazenamento não permita acesso direto
+     * ou o intervalo passe do fim.
+     */
+    virtual const char *acessarParaLeitura(file_ptr_type /* endereco */, int /* tamanho */)
+    {
+        return nullptr;
+    }
+
+    /**
+     * @brief Obtém um ponteiro para escrever os bytes do endereço informado sem
+     * passar por um buffer intermediário, aumentando o armazenamento se preciso.
+     * O ponteiro só vale até a próxima escrita no armazenamento.
+     *
+     * @return char* nullptr caso o armazenamento não permita acesso direto.
+     */
+    virtual char *acessarParaEscrita(file_ptr_type /* endereco */, int /* tamanho */)
+    {
+        return nullptr;
+    }
+
+    /**
+     * @brief Executa um lote de leituras e escritas. Por padrão, as operações são
+     * feitas uma depois da outra com ler() e escrever(); armazenamentos
+     * assíncronos colocam várias em andamento ao mesmo tempo.
+     *
+     * <p>As operações podem ser executadas em qualquer ordem, então o lote não
+     * deve ter duas operações sobre o mesmo intervalo. O campo descritor das
+     * operações é ignorado.</p>
+     *
+     * @param operacoes Operações do lote. Cada uma recebe em sucesso o seu
+     * resultado.
+     */
+    virtual void executarEmLote(vector<OperacaoDeES> &operacoes)
+    {
+        for (OperacaoDeES &operacao : operacoes)
+        {
+            operacao.sucesso = operacao.escrita ?
+                escrever(operacao.endereco, operacao.buffer, operacao.tamanho) :
+                ler(operacao.endereco, operacao.buffer, operacao.tamanho);
+        }
+    }
+
+    /**
+     * @brief Indica se ler() pode acontecer ao mesmo tempo que escrever() em outra
+     * thread. Nos armazenamentos em que uma escrita pode mudar os bytes de lugar
+     * (ao aumentar o mapeamento ou o vetor), as leituras devem esperar por ela.
+     */
+    virtual bool permiteLerDuranteEscritas()
+    {
+        return true;
+    }
+
+    /**
+     * @brief Avisa que o intervalo informado será lido em breve, para que a
+     * leitura dele comece em segundo plano. É só uma dica: não lê nada, não
+     * falha e pode ser ignorada pelo armazenamento.
+     */
+    virtual void preCarregar(file_ptr_type /* endereco */, int /* tamanho */) {}
+
+    /**
+     * @brief Obtém a quantidade de bytes em uso no armazenamento.
+     */
+    virtual file_ptr_type tamanho() = 0;
+
+    /**
+     * @brief Passa a manter a lista de páginas livres, cujo começo fica guardado
+     * no endereço informado. Sem essa chamada, liberarPagina() não faz nada.
+     *
+     * @param enderecoDaCabeca Endereço onde fica (ou ficará) o endereço da primeira
+     * página livre, normalmente no cabeçalho do arquivo. Ele deve conter
+     * constantes::ptrNuloPagina caso não haja páginas livres.
+     */
+    void usarListaDePaginasLivres(file_ptr_type enderecoDaCabeca)
+    {
+        enderecoDaCabecaDaLista = enderecoDaCabeca;
+
+        if (!ler(enderecoDaCabeca, (char *) &primeiraPaginaLivre, sizeof(file_ptr_type)))
+        {
+            primeiraPaginaLivre = constantes::ptrNuloPagina;
+        }
+    }
+
+    /**
+     * @brief Reserva o espaço de uma página nova. Páginas liberadas são
+     * reaproveitadas antes de o armazenamento crescer. O espaço só passa a contar
+     * em tamanho() quando a página for escrita, mas não é entregue de novo.
+     *
+     * @param tamanhoDaPagina Quantidade de bytes da página.
+     *
+     * @return file_ptr_type Endereço da página reservada.
+     */
+    virtual file_ptr_type alocarPagina(int tamanhoDaPagina)
+    {
+        lock_guard<mutex> travado(travaDaLista);
+
+        file_ptr_type endereco = primeiraPaginaLivre;
+
+        if (endereco != constantes::ptrNuloPagina)
+        {
+            file_ptr_type proxima;
+
+            if (!ler(endereco, (char *) &proxima, sizeof(file_ptr_type)))
+            {
+                falhar("Não foi possível ler a lista de páginas livres.");
+            }
+
+            trocarPrimeiraPaginaLivre(proxima);
+        }
+
+        else
+        {
+            endereco = max(tamanho(), fimAlocado);
+            fimAlocado = endereco + tamanhoDaPagina;
+        }
+
+        return endereco;
+    }
+
+    /**
+     * @brief Coloca a página no começo da lista de páginas livres, para que o
+     * espaço dela seja reaproveitado pelas próximas alocações. Os primeiros bytes
+     * da página passam a guardar o endereço da próxima página livre.
+     *
+     * @param endereco Endereço da página.
+     */
+    virtual void liberarPagina(file_ptr_type endereco)
+    {
+        if (enderecoDaCabecaDaLista == constantes::ptrNuloPagina ||
+            endereco == constantes::ptrNuloPagina) return;
+
+        lock_guard<mutex> travado(travaDaLista);
+
+        if (!escrever(endereco, (char *) &primeiraPaginaLivre, sizeof(file_ptr_type)))
+        {
+            falhar("Não foi possível liberar a página.");
+        }
+
+        trocarPrimeiraPaginaLivre(endereco);
+    }
+
+    /**
+     * @brief Coloca várias páginas no começo da lista de páginas livres. Os
+     * encadeamentos são escritos e sincronizados antes do novo começo da lista,
+     * então uma queda no meio só faz as páginas ficarem fora da lista.
+     *
+     * @param enderecos Endereços das páginas.
+     */
+    void liberarPaginas(vector<file_ptr_type> &enderecos)
+    {
+        if (enderecoDaCabecaDaLista == constantes::ptrNuloPagina ||
+            enderecos.empty()) return;
+
+        lock_guard<mutex> travado(travaDaLista);
+
+        file_ptr_type proxima = primeiraPaginaLivre;
+
+        for (file_ptr_type endereco : enderecos)
+        {
+            if (!escrever(endereco, (char *) &proxima, sizeof(file_ptr_type)))
+            {
+                falhar("Não foi possível liberar a página.");
+            }
+
+            proxima = endereco;
+        }
+
+        sincronizar();
+        trocarPrimeiraPaginaLivre(proxima);
+    }
+
+    /**
+     * @brief Obtém o endereço da primeira página livre, que é o que está (ou
+     * estará, com as escritas pendentes) no começo da lista no armazenamento.
+     */
+    file_ptr_type obterPrimeiraPaginaLivre()
+    {
+        lock_guard<mutex> travado(travaDaLista);
+
+        return primeiraPaginaLivre;
+    }
+
+    /**
+     * @brief Conta as páginas da lista de páginas livres.
+     *
+     * @return int Quantidade de páginas livres.
+     */
+    int quantidadeDePaginasLivres()
+    {
+        int quantidade = 0;
+        file_ptr_type endereco = primeiraPaginaLivre;
+
+        while (endereco != constantes::ptrNuloPagina &&
+            ler(endereco, (char *) &endereco, sizeof(file_ptr_type)))
+        {
+            quantidade++;
+        }
+
+        return quantidade;
+    }
+
+    /**
+     * @brief Descarta todo o conteúdo do armazenamento.
+     */
+    virtual void limpar() = 0;
+
+    /**
+     * @brief Garante que tudo o que foi escrito chegou ao disco.
+     */
+    virtual void sincronizar() = 0;
+};
+
+/**
+ * @brief Armazenamento em um fstream binário. Cada acesso faz um seek seguido de
+ * um read ou write.
+ */
+class ArmazenamentoEmFstream : public ArmazenamentoDePaginas
+{
+    string nomeDoArquivo;
+    fstream arquivo;
+
+    /**
+     * O fstream não expõe o seu descritor, então os avisos de pré-carregamento
+     * usam um descritor à parte, aberto apenas para leitura. O cache de páginas
+     * do sistema é o mesmo para os dois.
+     */
+    int descritorDeAvisos;
+
+    /** O fstream guarda a posição atual, então só uma thread pode usá-lo por vez. */
+    mutex trava;
+
+    void abrir()
+    {
+        arquivo = fstream(nomeDoArquivo, fstream::binary | fstream::in | fstream::out);
+
+        if (!arquivo) // Checa se o arquivo não existe ou não está acessível
+        {
+            // Caso não, cria um arquivo e o fecha
+            fstream(nomeDoArquivo, fstream::binary | fstream::out).close();
+            // Agora sim reabre o arquivo nos modos de leitura e escrita
+            arquivo = fstream(nomeDoArquivo, fstream::binary | fstream::in | fstream::out);
+        }
+    }
+
+public:
+    ArmazenamentoEmFstream(string nomeDoArquivo) :
+        nomeDoArquivo(nomeDoArquivo)
+    {
+        abrir();
+        descritorDeAvisos = open(nomeDoArquivo.c_str(), O_RDONLY);
+    }
+
+    ~ArmazenamentoEmFstream()
+    {
+        if (descritorDeAvisos >= 0) close(descritorDeAvisos);
+    }
+
+    string nome() override
+    {
+        return "fstream";
+    }
+
+    bool ler(file_ptr_type endereco, char *buffer, int tamanho) override
+    {
+        lock_guard<mutex> travado(trava);
+
+        arquivo.seekg(endereco);
+        arquivo.read(buffer, tamanho);
+
+        bool sucesso = !arquivo.fail();
+
+        // Uma leitura que falhou não pode travar as próximas
+        if (!sucesso) arquivo.clear();
+
+        return sucesso;
+    }
+
+    bool escrever(file_ptr_type endereco, const char *buffer, int tamanho) override
+    {
+        lock_guard<mutex> travado(trava);
+
+        arquivo.seekp(endereco);
+        arquivo.write(buffer, tamanho);
+
+        bool sucesso = !arquivo.fail();
+
+        if (!sucesso) arquivo.clear();
+
+        return sucesso;
+    }
+
+    void preCarregar(file_ptr_type endereco, int tamanho) override
+    {
+        if (descritorDeAvisos >= 0)
+        {
+            posix_fadvise(descritorDeAvisos, endereco, tamanho, POSIX_FADV_WILLNEED);
+        }
+    }
+
+    file_ptr_type tamanho() override
+    {
+        lock_guard<mutex> travado(trava);
+
+        arquivo.seekg(0, fstream::end);
+
+        return arquivo.tellg();
+    }
+
+    void limpar() override
+    {
+        // Limpa o arquivo e o reabre
+        arquivo = fstream(nomeDoArquivo, fstream::binary | fstream::trunc | fstream::out);
+        abrir();
+        esquecerAlocacoes();
+    }
+
+    void sincronizar() override
+    {
+        arquivo.flush();
+    }
+};
+
+/**
+ * @brief Armazenamento em um descritor de arquivo acessado com pread/pwrite. Cada
+ * acesso é uma única chamada de sistema que já informa o endereço, sem seeks e
+ * sem a bufferização do iostream.
+ */
+class ArmazenamentoPosicional : public ArmazenamentoDePaginas
+{
+protected:
+    string nomeDoArquivo;
+    int descritor;
+
+    /** É lido pelas leituras enquanto as escritas de outras threads o aumentam. */
+    atomic<file_ptr_type> tamanhoEmUso;
+
+public:
+    ArmazenamentoPosicional(string nomeDoArquivo) :
+        nomeDoArquivo(nomeDoArquivo),
+        descritor(-1),
+        tamanhoEmUso(0)
+    {
+        file_ptr_type tamanhoDoArquivo;
+
+        descritor = abrirDescritor(nomeDoArquivo, tamanhoDoArquivo);
+        tamanhoEmUso = tamanhoDoArquivo;
+    }
+
+    ~ArmazenamentoPosicional()
+    {
+        close(descritor);
+    }
+
+    string nome() override
+    {
+        return "pread";
+    }
+
+    bool ler(file_ptr_type endereco, char *buffer, int tamanho) override
+    {
+        if (endereco < 0 || endereco + tamanho > tamanhoEmUso) return false;
+
+        // pread pode ler menos bytes do que o pedido, então repete até terminar
+        while (tamanho > 0)
+        {
+            ssize_t lidos = pread(descritor, buffer, tamanho, endereco);
+
+            if (lidos <= 0) return false;
+
+            buffer += lidos;
+            endereco += lidos;
+            tamanho -= lidos;
+        }
+
+        return true;
+    }
+
+    bool escrever(file_ptr_type endereco, const char *buffer, int tamanho) override
+    {
+        if (endereco < 0) return false;
+
+        file_ptr_type fim = endereco + tamanho;
+
+        while (tamanho > 0)
+        {
+            ssize_t escritos = pwrite(descritor, buffer, tamanho, endereco);
+
+            if (escritos <= 0) return false;
+
+            buffer += escritos;
+            endereco += escritos;
+            tamanho -= escritos;
+        }
+
+        if (fim > tamanhoEmUso) tamanhoEmUso = fim;
+
+        return true;
+    }
+
+    void preCarregar(file_ptr_type endereco, int tamanho) override
+    {
+        // O kernel começa a leitura e retorna logo, sem esperar por ela
+        posix_fadvise(descritor, endereco, tamanho, POSIX_FADV_WILLNEED);
+    }
+
+    file_ptr_type tamanho() override
+    {
+        return tamanhoEmUso;
+    }
+
+    void limpar() override
+    {
+        if (ftruncate(descritor, 0) != 0)
+        {
+            falhar("Não foi possível limpar o arquivo " + nomeDoArquivo + ".");
+        }
+
+        tamanhoEmUso = 0;
+        esquecerAlocacoes();
+    }
+
+    void sincronizar() override
+    {
+        if (fdatasync(descritor) != 0)
+        {
+            falhar("Não foi possível sincronizar o arquivo " + nomeDoArquivo + ".");
+        }
+    }
+};
+
+/**
+ * @brief Armazenamento em um arquivo mapeado em memória com mmap. O mapeamento
+ * cresce em blocos de constantes::tamanhoDoBlocoDeCrescimento bytes, então as
+ * páginas são lidas e escritas direto na memória, sem chamadas de sistema. Os
+ * dados só têm garantia de estar no disco após sincronizar().
+ *
+ * Enquanto o arquivo está aberto, o tamanho dele no disco é o do mapeamento. Ele
+ * volta ao tamanho em uso ao ser fechado.
+ */
+class ArmazenamentoMapeado : public ArmazenamentoDePaginas
+{
+    string nomeDoArquivo;
+    int descritor;
+    char *mapa;
+    file_ptr_type capacidade;
+    atomic<file_ptr_type> tamanhoEmUso;
+
+    /**
+     * Impede que o mapeamento troque de lugar enquanto alguém o usa. ler() e
+     * escrever() também são chamados fora da cache (cabeçalho e lista de
+     * páginas livres), ao mesmo tempo que ela escreve páginas depois do fim.
+     */
+    shared_mutex travaDoMapa;
+
+    void desmapear()
+    {
+        if (mapa != nullptr)
+        {
+            munmap(mapa, capacidade);
+            mapa = nullptr;
+            capacidade = 0;
+        }
+    }
+
+    /**
+     * @brief Aumenta o arquivo e o mapeamento, em blocos inteiros, para que caibam
+     * pelo menos @p necessario bytes. Ponteiros antigos para o mapa deixam de valer.
+     */
+    void garantirCapacidade(file_ptr_type necessario)
+    {
+        if (necessario <= capacidade) return;
+
+        const file_ptr_type bloco = constantes::tamanhoDoBlocoDeCrescimento;
+        file_ptr_type novaCapacidade = (necessario + bloco - 1) / bloco * bloco;
+
+        desmapear();
+
+        if (ftruncate(descritor, novaCapacidade) != 0)
+        {
+            falhar("Não foi possível aumentar o arquivo " + nomeDoArquivo + ".");
+        }
+
+        void *novoMapa = mmap(
+            nullptr, novaCapacidade, PROT_READ | PROT_WRITE, MAP_SHARED, descritor, 0);
+
+        if (novoMapa == MAP_FAILED)
+        {
+            falhar("Não foi possível mapear o arquivo " + nomeDoArquivo + ".");
+        }
+
+        mapa = (char *) novoMapa;
+        capacidade = novaCapacidade;
+    }
+
+    /**
+     * @brief Garante que o intervalo exista no mapeamento e no tamanho em uso. Deve
+     * ser chamado com a trava do mapa exclusiva.
+     */
+    char *prepararEscrita(file_ptr_type endereco, int tamanho)
+    {
+        if (endereco < 0) return nullptr;
+
+        garantirCapacidade(endereco + tamanho);
+
+        if (endereco + tamanho > tamanhoEmUso) tamanhoEmUso = endereco + tamanho;
+
+        return mapa + endereco;
+    }
+
+public:
+    ArmazenamentoMapeado(string nomeDoArquivo) :
+        nomeDoArquivo(nomeDoArquivo),
+        descritor(-1),
+        mapa(nullptr),
+        capacidade(0),
+        tamanhoEmUso(0)
+    {
+        file_ptr_type tamanhoDoArquivo;
+
+        descritor = abrirDescritor(nomeDoArquivo, tamanhoDoArquivo);
+        tamanhoEmUso = tamanhoDoArquivo;
+        garantirCapacidade(tamanhoDoArquivo);
+    }
+
+    ~ArmazenamentoMapeado()
+    {
+        // Destrutores não devem lançar exceções, então o msync é feito aqui mesmo
+        if (mapa != nullptr) msync(mapa, capacidade, MS_SYNC);
+
+        desmapear();
+
+        // Devolve ao arquivo o tamanho realmente usado
+        if (ftruncate(descritor, tamanhoEmUso) != 0)
+        {
+            cerr << "[Armazenamento mmap] Não foi possível ajustar o tamanho do arquivo "
+                 << nomeDoArquivo << "." << endl;
+        }
+
+        close(descritor);
+    }
+
+    string nome() override
+    {
+        return "mmap";
+    }
+
+    bool permiteLerDuranteEscritas() override
+    {
+        // Uma escrita depois do fim pode trocar o mapeamento de lugar
+        return false;
+    }
+
+    bool ler(file_ptr_type endereco, char *buffer, int tamanho) override
+    {
+        shared_lock<shared_mutex> travado(travaDoMapa);
+        const char *origem = acessarParaLeitura(endereco, tamanho);
+
+        if (origem != nullptr) memcpy(buffer, origem, tamanho);
+
+        return origem != nullptr;
+    }
+
+    bool escrever(file_ptr_type endereco, const char *buffer, int tamanho) override
+    {
+        if (endereco >= 0 && endereco + tamanho <= tamanhoEmUso)
+        {
+            // Dentro do tamanho em uso o mapeamento não muda, então outras
+            // escritas como esta podem acontecer ao mesmo tempo
+            shared_lock<shared_mutex> travado(travaDoMapa);
+            memcpy(mapa + endereco, buffer, tamanho);
+
+            return true;
+        }
+
+        unique_lock<shared_mutex> travado(travaDoMapa);
+        char *destino = prepararEscrita(endereco, tamanho);
+
+        if (destino != nullptr) memcpy(destino, buffer, tamanho);
+
+        return destino != nullptr;
+    }
+
+    const char *acessarParaLeitura(file_ptr_type endereco, int tamanho) override
+    {
+        if (endereco < 0 || endereco + tamanho > tamanhoEmUso) return nullptr;
+
+        return mapa + endereco;
+    }
+
+    char *acessarParaEscrita(file_ptr_type endereco, int tamanho) override
+    {
+        unique_lock<shared_mutex> travado(travaDoMapa);
+
+        return prepararEscrita(endereco, tamanho);
+    }
+
+    void preCarregar(file_ptr_type endereco, int tamanho) override
+    {
+        if (endereco < 0 || endereco + tamanho > tamanhoEmUso) return;
+
+        shared_lock<shared_mutex> travado(travaDoMapa);
+
+        // O madvise exige um endereço alinhado ao tamanho das páginas de memória
+        file_ptr_type paginaDeMemoria = sysconf(_SC_PAGESIZE);
+        file_ptr_type inicio = endereco / paginaDeMemoria * paginaDeMemoria;
+
+        madvise(mapa + inicio, endereco + tamanho - inicio, MADV_WILLNEED);
+    }
+
+    file_ptr_type tamanho() override
+    {
+        return tamanhoEmUso;
+    }
+
+    void limpar() override
+    {
+        // O mapeamento continua do mesmo tamanho e será sobrescrito
+        tamanhoEmUso = 0;
+        esquecerAlocacoes();
+    }
+
+    void sincronizar() override
+    {
+        shared_lock<shared_mutex> travado(travaDoMapa);
+
+        if (mapa != nullptr && msync(mapa, capacidade, MS_SYNC) != 0)
+        {
+            falhar("Não foi possível sincronizar o arquivo " + nomeDoArquivo + ".");
+        }
+    }
+};
+
+/**
+ * @brief Armazenamento com pread/pwrite cujos lotes de leituras e escritas (veja
+ * executarEmLote()) são entregues a um MotorDeES, que mantém várias operações em
+ * andamento ao mesmo tempo. As demais operações são as do ArmazenamentoPosicional.
+ */
+class ArmazenamentoAssincrono : public ArmazenamentoPosicional
+{
+    MotorDeES *motor;
+
+    /** O motor atende um lote por vez. */
+    mutex trava;
+
+public:
+    ArmazenamentoAssincrono(string nomeDoArquivo) :
+        ArmazenamentoPosicional(nomeDoArquivo),
+        motor( criarMotorDeES() ) {}
+
+    ~ArmazenamentoAssincrono()
+    {
+        delete motor;
+    }
+
+    string nome() override
+    {
+        return motor->nome();
+    }
+
+    void executarEmLote(vector<OperacaoDeES> &operacoes) override
+    {
+        // Só as operações válidas vão para o motor. As leituras depois do fim
+        // falham sem chegar a ele.
+        vector<OperacaoDeES> validas;
+        vector<size_t> indices;
+
+        for (size_t i = 0; i < operacoes.size(); i++)
+        {
+            OperacaoDeES &operacao = operacoes[i];
+            bool valida = operacao.endereco >= 0 && (operacao.escrita ||
+                operacao.endereco + operacao.tamanho <= tamanhoEmUso);
+
+            operacao.sucesso = false;
+
+            if (valida)
+            {
+                operacao.descritor = descritor;
+                validas.push_back(operacao);
+                indices.push_back(i);
+            }
+        }
+
+        {
+            lock_guard<mutex> travado(trava);
+            motor->executar(validas);
+        }
+
+        for (size_t i = 0; i < validas.size(); i++)
+        {
+            OperacaoDeES &operacao = validas[i];
+            file_ptr_type fim = operacao.endereco + operacao.tamanho;
+
+            operacoes[indices[i]].sucesso = operacao.sucesso;
+
+            if (operacao.escrita && operacao.sucesso && fim > tamanhoEmUso)
+            {
+                tamanhoEmUso = fim;
+            }
+        }
+    }
+};
+
+/**
+ * @brief Armazenamento em um vetor na memória. Nada é escrito em disco, então a
+ * árvore funciona como um mapa ordenado que dura apenas enquanto estiver aberta.
+ * Útil para caches e para medir os algoritmos da árvore sem o custo de E/S.
+ */
+class ArmazenamentoEmMemoria : public ArmazenamentoDePaginas
+{
+    vector<char> bytes;
+
+    /**
+     * Impede que o vetor seja realocado enquanto alguém o usa. ler() e escrever()
+     * também são chamados fora da cache (cabeçalho e lista de páginas livres).
+     */
+    shared_mutex travaDosBytes;
+
+    /**
+     * @brief Aumenta o vetor caso o intervalo passe do fim. Deve ser chamado com a
+     * trava dos bytes exclusiva.
+     */
+    char *prepararEscrita(file_ptr_type endereco, int tamanho)
+    {
+        if (endereco < 0) return nullptr;
+
+        if (endereco + tamanho > (file_ptr_type) bytes.size())
+        {
+            bytes.resize(endereco + tamanho);
+        }
+
+        return bytes.data() + endereco;
+    }
+
+public:
+    string nome() override
+    {
+        return "memória";
+    }
+
+    bool permiteLerDuranteEscritas() override
+    {
+        // Uma escrita depois do fim pode realocar o vetor
+        return false;
+    }
+
+    bool ler(file_ptr_type endereco, char *buffer, int tamanho) override
+    {
+        shared_lock<shared_mutex> travado(travaDosBytes);
+        const char *origem = acessarParaLeitura(endereco, tamanho);
+
+        if (origem != nullptr) memcpy(buffer, origem, tamanho);
+
+        return origem != nullptr;
+    }
+
+    bool escrever(file_ptr_type endereco, const char *buffer, int tamanho) override
+    {
+        {
+            // Dentro do tamanho atual o vetor não é realocado
+            shared_lock<shared_mutex> travado(travaDosBytes);
+
+            if (endereco >= 0 && endereco + tamanho <= (file_ptr_type) bytes.size())
+            {
+                memcpy(bytes.data() + endereco, buffer, tamanho);
+
+                return true;
+            }
+        }
+
+        unique_lock<shared_mutex> travado(travaDosBytes);
+        char *destino = prepararEscrita(endereco, tamanho);
+
+        if (destino != nullptr) memcpy(destino, buffer, tamanho);
+
+        return destino != nullptr;
+    }
+
+    const char *acessarParaLeitura(file_ptr_type endereco, int tamanho) override
+    {
+        if (endereco < 0 || endereco + tamanho > (file_ptr_type) bytes.size()) return nullptr;
+
+        return bytes.data() + endereco;
+    }
+
+    char *acessarParaEscrita(file_ptr_type endereco, int tamanho) override
+    {
+        unique_lock<shared_mutex> travado(travaDosBytes);
+
+        return prepararEscrita(endereco, tamanho);
+    }
+
+    file_ptr_type tamanho() override
+    {
+        shared_lock<shared_mutex> travado(travaDosBytes);
+
+        return bytes.size();
+    }
+
+    void limpar() override
+    {
+        bytes.clear();
+        esquecerAlocacoes();
+    }
+
+    void sincronizar() override {}
+};
+
+/**
+ * @brief Cria o armazenamento do tipo informado para o arquivo.
+ *
+ * @param tipo Tipo do armazenamento.
+ * @param nomeDoArquivo Nome do arquivo, que é criado caso não exista. É ignorado
+ * no armazenamento em memória.
+ *
+ * @return ArmazenamentoDePaginas* Armazenamento alocado com new.
+ */
+ArmazenamentoDePaginas *criarArmazenamento(TipoDeArmazenamento tipo, string nomeDoArquivo)
+{
+    switch (tipo)
+    {
+        case TipoDeArmazenamento::PREAD: return new ArmazenamentoPosicional(nomeDoArquivo);
+        case TipoDeArmazenamento::MMAP: return new ArmazenamentoMapeado(nomeDoArquivo);
+        case TipoDeArmazenamento::ASSINCRONO: return new ArmazenamentoAssincrono(nomeDoArquivo);
+        case TipoDeArmazenamento::MEMORIA: return new ArmazenamentoEmMemoria();
+        default: return new ArmazenamentoEmFstream(nomeDoArquivo);
+    }
+}
@@ -29,13 +29,67 @@
 #include "templates/tipos.hpp"
 #include "helpersArvore.hpp"
 #include "PaginaB.hpp"
+#include "CacheDePaginas.hpp"
+#include "ArmazenamentoDePaginas.hpp"
+#include "OrdenacaoExterna.hpp"
+#include "TravasDePaginas.hpp"
+#include "DiarioDeEscritas.hpp"
 
 #include <iostream>
 #include <fstream>
 #include <list>
+#include <cstdio>
+#include <cmath>
+#include <tuple>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <map>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
+namespace constantes
+{
+    /**
+     * Quantidade de inserções e exclusões, na cópia na escrita, depois da qual a
+     * árvore grava a versão atual no cabeçalho, como em ArvoreB::descarregar().
+     */
+    static const int operacoesPorVersaoGravada = 256;
+
+    /**
+     * Quantidade de imagens antigas de páginas (veja ArvoreB::obterInstantaneo())
+     * que ficam na memória. As demais vão para um arquivo ao lado do da árvore.
+     */
+    static const int imagensAntigasNaMemoria = 1024;
+
+    /** Quantidade de partes, cada uma com a sua trava, das imagens antigas. */
+    static const int partesDasImagensAntigas = 16;
+
+    /** Primeiros bytes do arquivo de toda árvore ("ArvB" em little-endian). */
+    static const uint32_t assinaturaDoArquivo = 0x42767241;
+
+    /**
+     * Versão do formato do cabeçalho e das páginas. Deve mudar sempre que um dos
+     * dois mudar, para que os arquivos antigos sejam recusados ao serem abertos.
+     */
+    static const uint32_t versaoDoFormatoDoArquivo = 1;
+}
+
+/**
+ * @brief Como as inserções e exclusões mudam as páginas no arquivo.
+ */
+enum class ModoDeEscrita
+{
+    /** Cada página é reescrita no seu próprio endereço. */
+    NO_LUGAR,
+    /** As páginas mudadas por uma operação vão para endereços novos, junto com
+     * as de cima até a raiz, e a raiz nova só vale depois que o cabeçalho for
+     * regravado. Uma queda volta a árvore para a última versão gravada. */
+    COPIA_NA_ESCRITA
+};
+
 /**
  * @brief Classe da árvore B, uma estrutura eficiente para indexamento de registros
  * em disco.
@@ -48,6 +102,40 @@ using namespace std;
  * tenha um construtor sem parâmetros.</b>
  * @tparam Pagina Tipo das páginas da árvore B. <b>É necessário que esse tipo seja
  * serializável.</b>
+ * 
+ * <p>Várias threads podem pesquisar, inserir e excluir ao mesmo tempo na mesma
+ * árvore. Cada página tem uma trava de leitura e escrita (veja TabelaDeTravas) e
+ * as descidas travam a filha antes de soltar a pai. As inserções e exclusões
+ * soltam as travas das páginas de cima assim que chegam a uma página que não
+ * será dividida nem fundida, pois nada acima dela vai mudar. As demais operações
+ * (construirAPartirDe(), compactar(), mostrar() e as das classes filhas que
+ * reconstroem a árvore) ainda precisam ser feitas sem nenhuma outra operação em
+ * andamento.</p>
+ * 
+ * <p>Com um DiarioDeEscritas (veja PoliticaDoDiario), as páginas salvas por uma
+ * inserção ou exclusão ficam retidas no cache e vão juntas para o diário ao fim
+ * dela, antes de as travas serem soltas. Só então elas podem ir para o arquivo,
+ * quando saírem do cache ou num ponto de verificação. Ao abrir a árvore, as
+ * confirmações que ficaram no diário são refeitas, então uma queda no meio de
+ * uma divisão não deixa a árvore pela metade.</p>
+ *
+ * <p>Com ModoDeEscrita::COPIA_NA_ESCRITA, não há diário: as páginas publicadas
+ * nunca são reescritas. Uma inserção ou exclusão por vez copia as páginas que
+ * muda e as de cima delas, e a raiz nova é publicada ao fim dela. O cabeçalho
+ * tem duas versões, gravadas alternadamente por descarregar() depois de as
+ * páginas chegarem ao disco. As pesquisas não esperam pela escrita, e um
+ * Instantaneo guarda uma versão da árvore pelo tempo que for preciso.</p>
+ *
+ * <p>Sem a cópia na escrita, um Instantaneo também pode ser obtido. Enquanto
+ * ele existir, a primeira escrita de cada página guarda antes a imagem que o
+ * instantâneo vê, e as imagens que nenhum instantâneo vê mais são descartadas
+ * quando eles são destruídos. Até constantes::imagensAntigasNaMemoria imagens
+ * ficam na memória; as outras vão para o arquivo de nome igual ao da árvore
+ * seguido de ".imagens".</p>
+ *
+ * <p>O cabeçalho começa com a assinatura das árvores, a versão do formato (veja
+ * constantes::versaoDoFormatoDoArquivo), a ordem, o tamanho das páginas e o
+ * modo de escrita. Um arquivo que não confere com a árvore que o abre é recusado.</p>
  */
 template<
     typename TIPO_DAS_CHAVES,
@@ -55,117 +143,1888 @@ template<
     typename Pagina = PaginaB<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> >
 class ArvoreB
 {
+    /**
+     * @brief Uma das duas versões do cabeçalho na cópia na escrita. Elas são
+     * gravadas alternadamente, conforme o número, e vale a de maior número cuja
+     * soma confere, então uma queda durante a gravação de uma deixa a outra.
+     */
+    struct VersaoDoCabecalho
+    {
+        uint64_t numero;
+        file_ptr_type raiz;
+        // Só o fechamento da árvore deixa páginas livres encadeadas no arquivo
+        file_ptr_type primeiraPaginaLivre;
+        uint64_t soma;
+    };
+
+    /**
+     * @brief Começo do cabeçalho, igual nos dois modos de escrita. Identifica o
+     * formato do arquivo, que é conferido ao abri-lo.
+     */
+    struct IdentificacaoDoArquivo
+    {
+        uint32_t assinatura;
+        uint32_t versaoDoFormato;
+        uint32_t ordemDaArvore;
+        // Muda também com o tipo da página e os tamanhos das chaves e dos dados
+        uint32_t tamanhoDaPagina;
+        uint32_t copiaNaEscrita;
+    };
+
+    /**
+     * @brief Na cópia na escrita, guarda a versão atual enquanto existir, para
+     * que as páginas lidas por uma pesquisa não sejam reaproveitadas até o fim
+     * dela. Sem a cópia na escrita, não faz nada, já que as pesquisas usam travas.
+     */
+    struct VersaoFixada
+    {
+        // nullptr caso a árvore não use a cópia na escrita
+        ArvoreB *arvore;
+        uint64_t versao = 0;
+        file_ptr_type raiz = constantes::ptrNuloPagina;
+
+        VersaoFixada(ArvoreB *arvore) :
+            arvore(arvore->copiaNaEscrita ? arvore : nullptr)
+        {
+            if (this->arvore != nullptr) arvore->fixarVersao(versao, raiz);
+        }
+
+        ~VersaoFixada()
+        {
+            if (arvore != nullptr) arvore->soltarVersao(versao);
+        }
+    };
+
     // ------------------------- Campos
 
-    const int tamanhoCabecalhoAntesDoEnderecoDaRaiz = 0;
-    const int tamanhoCabecalho =
+    // Vem antes dos campos do cabeçalho, que dependem dele
+    const bool copiaNaEscrita;
+
+    // Na cópia na escrita, as duas versões do cabeçalho ficam no lugar do
+    // endereço da raiz
+    const int tamanhoCabecalhoAntesDoEnderecoDaRaiz = sizeof(IdentificacaoDoArquivo);
+    // O endereço da primeira página livre fica logo após o endereço da raiz
+    const int enderecoDaListaDePaginasLivres =
         tamanhoCabecalhoAntesDoEnderecoDaRaiz + sizeof(file_ptr_type);
+    const int tamanhoCabecalho = copiaNaEscrita ?
+        tamanhoCabecalhoAntesDoEnderecoDaRaiz + 2 * sizeof(VersaoDoCabecalho) :
+        enderecoDaListaDePaginasLivres + sizeof(file_ptr_type);
+
+    /**
+     * @brief Páginas de trabalho e travas de escrita de uma thread. As inserções e
+     * exclusões passam as páginas de uma para a outra por esses ponteiros, então
+     * cada thread precisa dos seus.
+     */
+    struct EstadoDaThread
+    {
+        Pagina *pai = nullptr;
+        Pagina *irmaPai = nullptr;
+        Pagina *filha = nullptr;
+        Pagina *irma = nullptr;
+
+        /** Endereços das páginas cujas travas de escrita a thread tem. */
+        list<file_ptr_type> travadas;
+
+        // Escritas da operação atual que ainda não foram para o diário
+
+        list<file_ptr_type> paginasRetidas;
+        file_ptr_type raizNova = constantes::ptrNuloPagina;
+        vector<file_ptr_type> paginasLiberadas;
+
+        /** Última confirmação anotada pela thread e ainda não esperada. */
+        uint64_t confirmacaoPendente = 0;
+
+        // Na cópia na escrita, o endereço da cópia de cada página mudada pela
+        // operação atual e as páginas criadas por ela, que ainda podem mudar no
+        // lugar. As páginas substituídas ficam em paginasLiberadas. Sem ela, as
+        // páginas criadas são as que nenhum instantâneo pode ver.
+
+        map<file_ptr_type, file_ptr_type> copias;
+        vector<file_ptr_type> paginasNovas;
+
+        /** Indica se a thread tem a trava compartilhada das operações ou, na
+         * cópia na escrita, a trava do escritor. */
+        bool emOperacao = false;
+    };
+
+    map<thread::id, EstadoDaThread> estadosDasThreads;
+    mutex travaDosEstados;
+    // Identifica a árvore nos estados guardados pelas threads. Diferente do
+    // endereço do objeto, não se repete depois que a árvore é destruída.
+    const unsigned long identificador;
+
+    // ------------------------- Métodos
+
+    static unsigned long gerarIdentificador()
+    {
+        static atomic<unsigned long> proximo(1);
+
+        return proximo++;
+    }
+
+    /**
+     * @brief Obtém o estado da thread atual, criando-o no primeiro uso.
+     */
+    EstadoDaThread &estadoDaThread()
+    {
+        // Cada thread lembra o último estado que usou, então o mapa só é
+        // consultado quando ela troca de árvore
+        static thread_local unsigned long arvoreDoUltimoEstado = 0;
+        static thread_local EstadoDaThread *ultimoEstado = nullptr;
+
+        if (arvoreDoUltimoEstado != identificador)
+        {
+            lock_guard<mutex> travado(travaDosEstados);
+            EstadoDaThread &estado = estadosDasThreads[this_thread::get_id()];
+
+            if (estado.pai == nullptr)
+            {
+                estado.pai = new Pagina(ordemDaArvore);
+                estado.irmaPai = new Pagina(ordemDaArvore);
+                estado.filha = new Pagina(ordemDaArvore);
+                estado.irma = new Pagina(ordemDaArvore);
+            }
+
+            arvoreDoUltimoEstado = identificador;
+            ultimoEstado = &estado;
+        }
+
+        return *ultimoEstado;
+    }
 
 protected:
     // ------------------------- Campos
 
+    // O endereço da raiz tem a sua própria trava, identificada pela posição dele
+    // no cabeçalho, onde nenhuma página pode estar
+    const file_ptr_type enderecoDaTravaDaRaiz = tamanhoCabecalhoAntesDoEnderecoDaRaiz;
+
     string msgErro;
+    // As pesquisas atribuem o erro, então ele é protegido para as pesquisas
+    // simultâneas
+    mutex travaDoErro;
     string nomeDoArquivo;
-    fstream arquivo;
+    ArmazenamentoDePaginas *arquivo;
+    // Cópia do endereço da raiz que está no cabeçalho, para que cada operação
+    // não precise lê-lo do arquivo. As leituras sem travas a leem enquanto ela
+    // pode ser trocada, por isso ela é atômica.
+    atomic<file_ptr_type> enderecoDaRaiz;
 
     int maximoDeBytesParaAChave;
     int maximoDeBytesParaODado;
     int numeroDeChavesPorPagina;
     int ordemDaArvore;
 
-    Pagina *paginaPai;
-    Pagina *paginaIrmaPai;
-    Pagina *paginaFilha;
-    Pagina *paginaIrma;
+    CacheDePaginas<Pagina> *cache;
+    int capacidadeDoCache;
+    TipoDePolitica politicaDoCache;
+    TipoDeArmazenamento tipoDeArmazenamento;
+
+    TabelaDeTravas travas;
+
+    // nullptr caso a árvore não use o diário
+    DiarioDeEscritas *diario;
+    // As inserções e exclusões a pegam compartilhada do começo ao fim, e os pontos
+    // de verificação e os instantâneos novos, exclusiva. Assim, nenhuma página
+    // retida (ainda não confirmada) tomou o lugar da confirmada no cache durante
+    // um ponto de verificação, e um instantâneo não começa no meio de uma
+    // operação.
+    shared_mutex travaDoPontoDeVerificacao;
+    // Deixa as confirmações no diário na ordem em que o começo da lista de
+    // páginas livres foi lido
+    mutex travaDasConfirmacoes;
+    // Páginas liberadas por operações confirmadas, que só voltam para a lista de
+    // páginas livres no próximo ponto de verificação
+    vector<file_ptr_type> paginasLiberadasConfirmadas;
+
+    // Na cópia na escrita, só uma inserção ou exclusão anda por vez, do começo
+    // até a raiz nova ser publicada
+    mutex travaDoEscritor;
+    // Protege as versões, os leitores e as páginas substituídas abaixo
+    mutex travaDasVersoes;
+    // Cada raiz publicada é uma versão nova. Sem a cópia na escrita, só os
+    // instantâneos criam versões.
+    uint64_t versaoAtual = 0;
+    // Versão cuja raiz está no cabeçalho
+    uint64_t versaoGravada = 0;
+    // Número da última versão do cabeçalho (veja VersaoDoCabecalho)
+    uint64_t numeroDoCabecalho = 0;
+    // Quantidade de instantâneos de cada versão
+    map<uint64_t, int> leitoresPorVersao;
+    // Páginas tiradas da árvore, junto com a versão que deixou de usá-las. Elas
+    // só são reaproveitadas quando nenhum instantâneo nem o cabeçalho as usa.
+    list< pair< uint64_t, vector<file_ptr_type> > > paginasSubstituidas;
+    // Páginas que as próximas cópias podem usar, só mexidas pelo escritor
+    vector<file_ptr_type> paginasLivres;
+    int operacoesSemGravar = 0;
+
+    // Sem a cópia na escrita, indica se há leitores, para que as escritas não
+    // peguem a trava das versões à toa
+    atomic<bool> existemInstantaneos{false};
+
+    // Imagem antiga de uma página: os bytes dela, na memória, ou o endereço deles
+    // no arquivo de imagens
+    struct ImagemAntiga
+    {
+        vector<char> bytes;
+        file_ptr_type enderecoNoArquivo = constantes::ptrNuloPagina;
+    };
+
+    // Imagens das páginas escritas desde que os instantâneos foram obtidos,
+    // divididas pelo endereço da página. Cada imagem é vista pelos instantâneos
+    // com versão até a dela, a partir da imagem anterior da mesma página. A trava
+    // da parte vem antes da trava das versões.
+    struct alignas(64) ParteDasImagens
+    {
+        mutex trava;
+        map< file_ptr_type, map<uint64_t, ImagemAntiga> > imagens;
+    };
+
+    ParteDasImagens partesDasImagens[constantes::partesDasImagensAntigas];
+    // Quantidade de imagens com os bytes na memória
+    atomic<int> imagensNaMemoria{0};
+    // Arquivo das imagens que não couberam na memória, criado só quando for
+    // preciso, e os espaços dele liberados pelas imagens descartadas
+    ArmazenamentoDePaginas *arquivoDeImagens = nullptr;
+    vector<file_ptr_type> espacosLivresDasImagens;
+    file_ptr_type fimDoArquivoDeImagens = 0;
+    mutex travaDoArquivoDeImagens;
 
     // ------------------------- Métodos
 
+    // Páginas de trabalho das inserções e exclusões, que são da thread atual
+
+    Pagina *&paginaPai() { return estadoDaThread().pai; }
+    Pagina *&paginaIrmaPai() { return estadoDaThread().irmaPai; }
+    Pagina *&paginaFilha() { return estadoDaThread().filha; }
+    Pagina *&paginaIrma() { return estadoDaThread().irma; }
+
     void atribuirErro(string msgErro)
     {
+        lock_guard<mutex> travado(travaDoErro);
+
         this->msgErro = "[ArvoreB]: ";
         this->msgErro.append(msgErro);
     }
 
     void limparErro()
     {
+        lock_guard<mutex> travado(travaDoErro);
+
         msgErro = "";
     }
 
     void mostrarErro()
     {
+        lock_guard<mutex> travado(travaDoErro);
+
         cout << msgErro << endl;
     }
 
     bool erro()
     {
+        lock_guard<mutex> travado(travaDoErro);
+
         return msgErro.empty();
     }
 
-    void abrirArquivo(string nome)
+    void abrirArquivo(string nome, TipoDeArmazenamento tipoDeArmazenamento)
+    {
+        // Cria o arquivo caso ele não exista
+        arquivo = criarArmazenamento(tipoDeArmazenamento, nome);
+    }
+
+    /**
+     * @brief Abre o diário da árvore, caso ela use um, e refaz no arquivo as
+     * confirmações que ficaram nele.
+     */
+    void abrirDiario(PoliticaDoDiario politicaDoDiario)
+    {
+        diario = nullptr;
+
+        // Na memória, nada sobrevive a uma queda, então não há o que refazer
+        if (politicaDoDiario == PoliticaDoDiario::NENHUM ||
+            tipoDeArmazenamento == TipoDeArmazenamento::MEMORIA) return;
+
+        diario = new DiarioDeEscritas(nomeDoArquivo + ".diario", politicaDoDiario);
+
+        // O diário só pode ser esvaziado depois que as escritas refeitas estiverem
+        // no disco
+        if (diario->refazer(*arquivo) > 0) arquivo->sincronizar();
+
+        diario->esvaziar();
+    }
+
+    /**
+     * @brief Cria o cache de páginas do armazenamento atual. Com o diário,
+     * nenhuma página vai para o arquivo antes de a confirmação dela estar nele.
+     */
+    void criarCache()
+    {
+        cache = new CacheDePaginas<Pagina>(
+            *arquivo, ordemDaArvore, capacidadeDoCache, politicaDoCache);
+
+        if (diario != nullptr)
+        {
+            cache->usarAntesDeEscrever(
+                [this](uint64_t confirmacao) { diario->tornarDuravel(confirmacao); });
+        }
+    }
+
+    /**
+     * @brief Pega a trava de leitura da página.
+     * 
+     * @param endereco Endereço da página.
+     * @param semEsperar Caso seja true, desiste em vez de esperar por quem tem a
+     * trava de escrita.
+     * 
+     * @return true Caso a trava tenha sido pega.
+     */
+    bool travarParaLeitura(file_ptr_type endereco, bool semEsperar = false)
+    {
+        if (semEsperar) return travas.tentarTravar(endereco, false);
+
+        travas.travar(endereco, false);
+
+        return true;
+    }
+
+    void destravarParaLeitura(file_ptr_type endereco)
+    {
+        travas.destravar(endereco, false);
+    }
+
+    /**
+     * @brief Pega a trava de leitura da raiz. O endereço dela é lido com a trava
+     * do endereço da raiz, que é solta logo depois, para que a raiz não seja
+     * trocada entre a leitura do endereço e a trava.
+     * 
+     * @param raiz Recebe o endereço da raiz, cuja trava fica com quem chamou.
+     * @param semEsperar Caso seja true, desiste em vez de esperar pelas travas.
+     * 
+     * @return true Caso a trava tenha sido pega.
+     */
+    bool travarARaizParaLeitura(file_ptr_type &raiz, bool semEsperar = false)
+    {
+        if (!travarParaLeitura(enderecoDaTravaDaRaiz, semEsperar)) return false;
+
+        raiz = lerEnderecoDaRaiz();
+        bool travou = travarParaLeitura(raiz, semEsperar);
+
+        destravarParaLeitura(enderecoDaTravaDaRaiz);
+
+        return travou;
+    }
+
+    /**
+     * @brief Pega a trava de escrita da página e a guarda no estado da thread até
+     * destravarTudo(). Não faz nada caso a thread já tenha a trava. Na cópia na
+     * escrita, o escritor é um só e as páginas publicadas não mudam, então só o
+     * endereço é guardado, como parte do caminho a ser copiado.
+     * 
+     * @param endereco Endereço da página.
+     * 
+     * @return true Caso a trava tenha sido pega agora.
+     */
+    bool travarParaEscrita(file_ptr_type endereco)
+    {
+        list<file_ptr_type> &travadas = estadoDaThread().travadas;
+
+        if (find(travadas.begin(), travadas.end(), endereco) != travadas.end())
+        {
+            return false;
+        }
+
+        entrarNaOperacao();
+
+        if (!copiaNaEscrita) travas.travar(endereco, true);
+
+        travadas.push_back(endereco);
+
+        return true;
+    }
+
+    /**
+     * @brief Como travarParaEscrita(), mas desiste caso alguém tenha a trava.
+     * 
+     * @return true Caso a thread tenha a trava ao final.
+     */
+    bool tentarTravarParaEscrita(file_ptr_type endereco)
+    {
+        list<file_ptr_type> &travadas = estadoDaThread().travadas;
+
+        if (find(travadas.begin(), travadas.end(), endereco) != travadas.end())
+        {
+            return true;
+        }
+
+        entrarNaOperacao();
+
+        if (!copiaNaEscrita && !travas.tentarTravar(endereco, true)) return false;
+
+        travadas.push_back(endereco);
+
+        return true;
+    }
+
+    /**
+     * @brief Pega a trava de escrita de uma irmã da página atual. A irmã da
+     * esquerda vem antes na ordem das travas (veja TabelaDeTravas), então só é
+     * travada caso isso possa ser feito sem esperar.
+     * 
+     * @return true Caso a thread tenha a trava da irmã.
+     */
+    bool travarIrma(file_ptr_type endereco, bool irmaDaEsquerda)
+    {
+        if (irmaDaEsquerda) return tentarTravarParaEscrita(endereco);
+
+        travarParaEscrita(endereco);
+
+        return true;
+    }
+
+    /**
+     * @brief Solta a trava de escrita da página antes de destravarTudo(), caso a
+     * thread a tenha.
+     * 
+     * <p>Com o diário, uma página mudada pela operação não pode ser vista pelas
+     * outras threads antes de a mudança ir para ele. Nesse caso, a trava fica
+     * até destravarTudo() ou, caso confirmarAoSoltarCadaTrava(), as escritas
+     * pendentes são anotadas no diário antes de ela ser solta.</p>
+     */
+    void soltarTrava(file_ptr_type endereco)
+    {
+        EstadoDaThread &estado = estadoDaThread();
+        list<file_ptr_type> &travadas = estado.travadas;
+        auto iterador = find(travadas.begin(), travadas.end(), endereco);
+
+        if (iterador == travadas.end()) return;
+
+        bool mudou = endereco == enderecoDaTravaDaRaiz ?
+            estado.raizNova != constantes::ptrNuloPagina :
+            find(estado.paginasRetidas.begin(), estado.paginasRetidas.end(), endereco) !=
+                estado.paginasRetidas.end();
+
+        if (mudou)
+        {
+            if (!confirmarAoSoltarCadaTrava()) return;
+
+            anotarEscritas();
+        }
+
+        travas.destravar(endereco, true);
+        travadas.erase(iterador);
+    }
+
+    /**
+     * @brief Solta todas as travas de escrita da thread. Deve ser chamado ao fim
+     * de cada inserção e exclusão. Com o diário, as escritas da operação são
+     * anotadas nele antes, e a espera pela confirmação acontece depois de as
+     * travas serem soltas. Na cópia na escrita, a raiz nova é publicada.
+     */
+    void destravarTudo()
+    {
+        list<file_ptr_type> &travadas = estadoDaThread().travadas;
+
+        if (copiaNaEscrita) publicarCopias();
+
+        else
+        {
+            anotarEscritas();
+
+            for (file_ptr_type endereco : travadas) travas.destravar(endereco, true);
+        }
+
+        travadas.clear();
+
+        sairDaOperacao();
+    }
+
+    /**
+     * @brief Indica se soltarTrava() deve anotar as escritas pendentes no diário
+     * em vez de manter a trava até destravarTudo(). Classes filhas cujas
+     * operações soltam as travas uma por uma, deixando a árvore válida a cada
+     * vez, devem retornar true.
+     */
+    virtual bool confirmarAoSoltarCadaTrava()
+    {
+        return false;
+    }
+
+    /**
+     * @brief Pega a trava compartilhada das operações caso a thread ainda não a
+     * tenha. É chamado antes de cada trava de escrita, então a thread nunca
+     * espera por ela tendo a trava de uma página. Na cópia na escrita, pega a
+     * trava do escritor.
+     */
+    void entrarNaOperacao()
+    {
+        EstadoDaThread &estado = estadoDaThread();
+
+        if (estado.emOperacao) return;
+
+        if (copiaNaEscrita)
+        {
+            travaDoEscritor.lock();
+            estado.emOperacao = true;
+        }
+
+        else
+        {
+            travaDoPontoDeVerificacao.lock_shared();
+            estado.emOperacao = true;
+        }
+    }
+
+    /**
+     * @brief Solta a trava compartilhada das operações e, com o diário, espera
+     * pela última confirmação da thread conforme a PoliticaDoDiario e faz um
+     * ponto de verificação caso ele tenha ficado grande demais. Na cópia na escrita,
+     * grava a versão atual no cabeçalho a cada
+     * constantes::operacoesPorVersaoGravada operações e solta a trava do escritor.
+     */
+    void sairDaOperacao()
+    {
+        EstadoDaThread &estado = estadoDaThread();
+
+        if (!estado.emOperacao) return;
+
+        estado.emOperacao = false;
+
+        if (copiaNaEscrita)
+        {
+            if (operacoesSemGravar >= constantes::operacoesPorVersaoGravada)
+            {
+                gravarVersao();
+            }
+
+            travaDoEscritor.unlock();
+
+            return;
+        }
+
+        estado.paginasNovas.clear();
+        travaDoPontoDeVerificacao.unlock_shared();
+
+        if (diario == nullptr) return;
+
+        if (estado.confirmacaoPendente != 0)
+        {
+            diario->esperar(estado.confirmacaoPendente);
+            estado.confirmacaoPendente = 0;
+        }
+
+        if (diario->tamanho() >= constantes::tamanhoMaximoDoDiario)
+        {
+            fazerPontoDeVerificacao(constantes::tamanhoMaximoDoDiario);
+        }
+    }
+
+    /**
+     * @brief Cria a escrita do diário que coloca um endereço no cabeçalho.
+     */
+    EscritaDoDiario escritaNoCabecalho(file_ptr_type posicao, file_ptr_type endereco)
+    {
+        const char *bytes = (const char *) &endereco;
+
+        return EscritaDoDiario{ posicao, vector<char>(bytes, bytes + sizeof(file_ptr_type)) };
+    }
+
+    /**
+     * @brief Anota no diário, numa única confirmação, as páginas retidas, a raiz
+     * nova e as páginas liberadas pela operação da thread. As páginas retidas
+     * passam a poder ir para o arquivo. Não faz nada sem o diário ou caso não
+     * haja escritas pendentes.
+     */
+    void anotarEscritas()
     {
-        arquivo = fstream(nome, fstream::binary | fstream::in | fstream::out);
+        EstadoDaThread &estado = estadoDaThread();
+
+        if (diario == nullptr ||
+            (estado.paginasRetidas.empty() && estado.paginasLiberadas.empty() &&
+                estado.raizNova == constantes::ptrNuloPagina)) return;
 
-        if (!arquivo) // Checa se o arquivo não existe ou não está acessível
+        vector<EscritaDoDiario> escritas;
+
+        for (file_ptr_type endereco : estado.paginasRetidas)
+        {
+            escritas.push_back( EscritaDoDiario{ endereco, cache->obterBytesDaRetida(endereco) } );
+        }
+
+        if (estado.raizNova != constantes::ptrNuloPagina)
         {
-            // Caso não, cria um arquivo e o fecha
-            fstream(nome, fstream::binary | fstream::out).close();
-            // Agora sim reabre o arquivo nos modos de leitura e escrita
-            arquivo = fstream(nome, fstream::binary | fstream::in | fstream::out);
+            escritas.push_back(
+                escritaNoCabecalho(tamanhoCabecalhoAntesDoEnderecoDaRaiz, estado.raizNova) );
+        }
+
+        {
+            lock_guard<mutex> travado(travaDasConfirmacoes);
+
+            // As páginas novas podem ter saído da lista de páginas livres, que até
+            // o próximo ponto de verificação só anda para frente. O começo dela
+            // lido agora vale para esta confirmação e para todas as anteriores.
+            escritas.push_back( escritaNoCabecalho(
+                enderecoDaListaDePaginasLivres, arquivo->obterPrimeiraPaginaLivre()) );
+
+            estado.confirmacaoPendente = diario->anotar(escritas);
+
+            paginasLiberadasConfirmadas.insert(paginasLiberadasConfirmadas.end(),
+                estado.paginasLiberadas.begin(), estado.paginasLiberadas.end());
         }
+
+        cache->soltarRetidas(estado.paginasRetidas, estado.confirmacaoPendente);
+
+        estado.paginasRetidas.clear();
+        estado.paginasLiberadas.clear();
+        estado.raizNova = constantes::ptrNuloPagina;
+    }
+
+    /**
+     * @brief Leva para o arquivo tudo o que foi confirmado no diário e o esvazia:
+     * escreve a raiz no cabeçalho e as páginas sujas do cache, sincroniza o
+     * arquivo e só então devolve à lista de páginas livres as páginas liberadas.
+     * Espera as inserções e exclusões em andamento terminarem.
+     * 
+     * @param tamanhoMinimo Não faz nada caso o diário tenha menos bytes que isso.
+     */
+    void fazerPontoDeVerificacao(file_ptr_type tamanhoMinimo = 0)
+    {
+        unique_lock<shared_mutex> travado(travaDoPontoDeVerificacao);
+
+        if (diario->tamanho() < tamanhoMinimo) return;
+
+        file_ptr_type raiz = enderecoDaRaiz;
+
+        diario->tornarDuravel();
+
+        arquivo->escrever(tamanhoCabecalhoAntesDoEnderecoDaRaiz,
+            (char *) &raiz, sizeof(file_ptr_type));
+
+        cache->descarregar();
+        diario->esvaziar();
+
+        // As páginas só voltam para a lista depois de o diário ser esvaziado, pois
+        // refazer uma confirmação antiga poderia tirá-las da lista de novo
+        vector<file_ptr_type> liberadas;
+
+        {
+            lock_guard<mutex> travadoAsConfirmacoes(travaDasConfirmacoes);
+
+            liberadas.swap(paginasLiberadasConfirmadas);
+        }
+
+        arquivo->liberarPaginas(liberadas);
+    }
+
+    /**
+     * @brief Na cópia na escrita, obtém o endereço onde está a página durante a
+     * operação da thread: o da cópia dela, caso a operação já a tenha mudado, ou
+     * o próprio endereço.
+     */
+    file_ptr_type traduzir(file_ptr_type endereco)
+    {
+        map<file_ptr_type, file_ptr_type> &copias = estadoDaThread().copias;
+
+        if (copias.empty()) return endereco;
+
+        auto iterador = copias.find(endereco);
+
+        return iterador == copias.end() ? endereco : iterador->second;
+    }
+
+    /**
+     * @brief Devolve às páginas livres as páginas substituídas que nenhum
+     * instantâneo e nem a versão gravada no cabeçalho usam mais. As cópias delas
+     * no cache são descartadas, pois não valem mais nada.
+     */
+    void reaproveitarPaginasSubstituidas()
+    {
+        lock_guard<mutex> travado(travaDasVersoes);
+
+        // Uma página substituída na versão v ainda é usada pelas versões anteriores
+        uint64_t limite = versaoGravada;
+
+        if (!leitoresPorVersao.empty())
+        {
+            limite = min(limite, leitoresPorVersao.begin()->first);
+        }
+
+        while (!paginasSubstituidas.empty() && paginasSubstituidas.front().first <= limite)
+        {
+            for (file_ptr_type endereco : paginasSubstituidas.front().second)
+            {
+                cache->descartar(endereco);
+                paginasLivres.push_back(endereco);
+            }
+
+            paginasSubstituidas.pop_front();
+        }
+    }
+
+    /**
+     * @brief Escolhe o endereço de uma página nova na cópia na escrita: uma página
+     * livre ou, caso não haja, uma no fim do arquivo.
+     */
+    file_ptr_type alocarPaginaDaCopia()
+    {
+        if (paginasLivres.empty()) reaproveitarPaginasSubstituidas();
+
+        if (paginasLivres.empty()) return alocarPagina();
+
+        file_ptr_type endereco = paginasLivres.back();
+
+        paginasLivres.pop_back();
+
+        return endereco;
+    }
+
+    /**
+     * @brief Salva a página na cópia na escrita. Os ponteiros dela passam a
+     * apontar para as cópias das filhas. Uma página criada pela operação atual é
+     * reescrita no lugar. As demais ainda podem estar sendo lidas, então vão
+     * para um endereço novo, que a página recebe.
+     * 
+     * @return file_ptr_type Endereço no qual a página foi colocada.
+     */
+    file_ptr_type salvarCopia(Pagina *pagina)
+    {
+        EstadoDaThread &estado = estadoDaThread();
+        vector<file_ptr_type> &novas = estado.paginasNovas;
+        file_ptr_type endereco = pagina->obterEndereco();
+
+        for (auto &&ponteiro : pagina->ponteiros) ponteiro = traduzir(ponteiro);
+
+        if (endereco != constantes::ptrNuloPagina) endereco = traduzir(endereco);
+
+        if (find(novas.begin(), novas.end(), endereco) == novas.end())
+        {
+            file_ptr_type copia = alocarPaginaDaCopia();
+
+            if (endereco != constantes::ptrNuloPagina)
+            {
+                estado.copias[endereco] = copia;
+                estado.paginasLiberadas.push_back(endereco);
+            }
+
+            novas.push_back(copia);
+            endereco = copia;
+        }
+
+        pagina->setEndereco(endereco);
+
+        return cache->colocar(pagina);
+    }
+
+    /**
+     * @brief Termina a operação da thread na cópia na escrita. As páginas do
+     * caminho e as criadas pela operação que ainda apontam para páginas copiadas
+     * são copiadas também, até a raiz. Então, a raiz nova e as páginas
+     * substituídas passam a valer para a próxima versão.
+     */
+    void publicarCopias()
+    {
+        EstadoDaThread &estado = estadoDaThread();
+        Pagina pagina(ordemDaArvore);
+        bool mudou = !estado.copias.empty();
+
+        // Copiar uma página pode deixar a pai dela para trás, então as páginas
+        // são revistas até nenhuma mudar
+        while (mudou)
+        {
+            list<file_ptr_type> enderecos(estado.travadas);
+
+            enderecos.insert(enderecos.end(),
+                estado.paginasNovas.begin(), estado.paginasNovas.end());
+
+            mudou = false;
+
+            for (file_ptr_type endereco : enderecos)
+            {
+                if (endereco == enderecoDaTravaDaRaiz) continue;
+
+                bool desatualizada = false;
+
+                carregar(&pagina, endereco);
+
+                for (file_ptr_type ponteiro : pagina.ponteiros)
+                {
+                    if (traduzir(ponteiro) != ponteiro) desatualizada = true;
+                }
+
+                if (desatualizada)
+                {
+                    salvar(&pagina);
+                    mudou = true;
+                }
+            }
+        }
+
+        if (estado.copias.empty() && estado.paginasLiberadas.empty() &&
+            estado.raizNova == constantes::ptrNuloPagina) return;
+
+        file_ptr_type raiz = traduzir(estado.raizNova != constantes::ptrNuloPagina ?
+            estado.raizNova : lerEnderecoDaRaiz());
+
+        {
+            lock_guard<mutex> travado(travaDasVersoes);
+
+            enderecoDaRaiz = raiz;
+            versaoAtual++;
+
+            if (!estado.paginasLiberadas.empty())
+            {
+                paginasSubstituidas.push_back(
+                    make_pair(versaoAtual, move(estado.paginasLiberadas)) );
+            }
+        }
+
+        estado.copias.clear();
+        estado.paginasNovas.clear();
+        estado.paginasLiberadas.clear();
+        estado.raizNova = constantes::ptrNuloPagina;
+        operacoesSemGravar++;
+    }
+
+    /**
+     * @brief Grava, no lugar da versão mais antiga do cabeçalho, uma versão nova
+     * com a raiz atual e sincroniza o armazenamento. As páginas dela já devem
+     * estar no disco.
+     * 
+     * @param primeiraPaginaLivre Começo da lista de páginas livres encadeadas no
+     * arquivo, caso haja uma.
+     */
+    void gravarCabecalho(file_ptr_type primeiraPaginaLivre = constantes::ptrNuloPagina)
+    {
+        VersaoDoCabecalho versao{
+            numeroDoCabecalho + 1, enderecoDaRaiz, primeiraPaginaLivre, 0 };
+
+        escreverVersaoDoCabecalho(*arquivo, versao);
+        arquivo->sincronizar();
+
+        numeroDoCabecalho = versao.numero;
+    }
+
+    /**
+     * @brief Leva para o disco as páginas da versão atual e a grava no cabeçalho.
+     * Depois disso, as páginas substituídas até ela podem ser reaproveitadas.
+     * Deve ser chamado sem nenhuma operação em andamento ou pelo próprio escritor.
+     */
+    void gravarVersao()
+    {
+        cache->descarregar();
+        gravarCabecalho();
+
+        {
+            lock_guard<mutex> travado(travaDasVersoes);
+
+            versaoGravada = versaoAtual;
+        }
+
+        operacoesSemGravar = 0;
+    }
+
+    /**
+     * @brief Encadeia no arquivo as páginas livres da cópia na escrita e grava uma
+     * versão do cabeçalho que aponta para a primeira, para que elas sejam
+     * reaproveitadas quando a árvore for aberta de novo. Deve ser chamado ao
+     * fechar a árvore, depois de a versão atual ser gravada.
+     */
+    void guardarPaginasLivres()
+    {
+        reaproveitarPaginasSubstituidas();
+
+        if (paginasLivres.empty()) return;
+
+        for (size_t i = 0; i < paginasLivres.size(); i++)
+        {
+            file_ptr_type proxima = i + 1 < paginasLivres.size() ?
+                paginasLivres[i + 1] : constantes::ptrNuloPagina;
+
+            arquivo->escrever(paginasLivres[i], (char *) &proxima, sizeof(file_ptr_type));
+        }
+
+        // A lista precisa estar inteira no disco antes de o cabeçalho apontar para ela
+        arquivo->sincronizar();
+        gravarCabecalho(paginasLivres.front());
+    }
+
+    /**
+     * @brief Guarda um leitor da versão atual, cujas páginas não serão
+     * reaproveitadas enquanto ele não for solto com soltarVersao(). Sem a cópia
+     * na escrita, a versão é nova, começa entre duas operações e as páginas dela
+     * passam a ser guardadas antes de cada escrita (veja guardarImagemAntiga()).
+     * 
+     * @param versao Recebe a versão.
+     * @param raiz Recebe o endereço da raiz da versão.
+     */
+    void fixarVersao(uint64_t &versao, file_ptr_type &raiz)
+    {
+        unique_lock<shared_mutex> semOperacoes(travaDoPontoDeVerificacao, defer_lock);
+
+        if (!copiaNaEscrita) semOperacoes.lock();
+
+        lock_guard<mutex> travado(travaDasVersoes);
+
+        if (!copiaNaEscrita)
+        {
+            versaoAtual++;
+            existemInstantaneos = true;
+        }
+
+        versao = versaoAtual;
+        raiz = enderecoDaRaiz;
+        leitoresPorVersao[versao]++;
+    }
+
+    /**
+     * @brief Guarda mais um leitor de uma versão que já tem leitores.
+     */
+    void fixarVersao(uint64_t versao)
+    {
+        lock_guard<mutex> travado(travaDasVersoes);
+
+        leitoresPorVersao[versao]++;
+    }
+
+    void soltarVersao(uint64_t versao)
+    {
+        {
+            lock_guard<mutex> travado(travaDasVersoes);
+
+            if (--leitoresPorVersao[versao] != 0) return;
+
+            leitoresPorVersao.erase(versao);
+
+            if (leitoresPorVersao.empty()) existemInstantaneos = false;
+        }
+
+        // Uma imagem só é mantida caso algum leitor tenha versão entre a da
+        // imagem anterior da página e a dela. Os leitores são consultados com a
+        // trava de cada parte, pois um instantâneo novo pode ter guardado imagens
+        // nas partes ainda não vistas.
+        for (ParteDasImagens &parte : partesDasImagens)
+        {
+            lock_guard<mutex> travadaAParte(parte.trava);
+            lock_guard<mutex> travado(travaDasVersoes);
+
+            for (auto pagina = parte.imagens.begin(); pagina != parte.imagens.end(); )
+            {
+                map<uint64_t, ImagemAntiga> &imagens = pagina->second;
+                uint64_t versaoAnterior = 0;
+
+                for (auto imagem = imagens.begin(); imagem != imagens.end(); )
+                {
+                    auto leitor = leitoresPorVersao.upper_bound(versaoAnterior);
+
+                    versaoAnterior = imagem->first;
+
+                    if (leitor == leitoresPorVersao.end() || leitor->first > imagem->first)
+                    {
+                        descartarImagemAntiga(imagem->second);
+                        imagem = imagens.erase(imagem);
+                    }
+
+                    else imagem++;
+                }
+
+                if (imagens.empty()) pagina = parte.imagens.erase(pagina);
+
+                else pagina++;
+            }
+        }
+    }
+
+    /**
+     * @brief Obtém a parte das imagens antigas onde ficam as da página.
+     */
+    ParteDasImagens &parteDasImagens(file_ptr_type endereco)
+    {
+        // Os endereços são múltiplos do tamanho da página, então eles são
+        // espalhados por uma multiplicação antes de serem reduzidos
+        return partesDasImagens[((uint64_t) endereco * 11400714819323198485ull >> 32) %
+            constantes::partesDasImagensAntigas];
+    }
+
+    /**
+     * @brief Cria a imagem antiga da página. Os bytes dela ficam na memória
+     * enquanto houver menos de constantes::imagensAntigasNaMemoria imagens lá e,
+     * depois disso, vão para o arquivo de imagens. Na árvore em memória, eles
+     * sempre ficam na memória.
+     */
+    ImagemAntiga criarImagemAntiga(Pagina &pagina)
+    {
+        ImagemAntiga imagem;
+        int tamanho = pagina.obterTamanhoMaximoEmBytes();
+        vector<char> bytes(tamanho);
+
+        pagina.escreverBytes(bytes.data(), tamanho);
+
+        if (tipoDeArmazenamento == TipoDeArmazenamento::MEMORIA ||
+            imagensNaMemoria.fetch_add(1) < constantes::imagensAntigasNaMemoria)
+        {
+            imagem.bytes = move(bytes);
+
+            return imagem;
+        }
+
+        imagensNaMemoria--;
+
+        lock_guard<mutex> travado(travaDoArquivoDeImagens);
+
+        if (arquivoDeImagens == nullptr)
+        {
+            arquivoDeImagens = criarArmazenamento(
+                TipoDeArmazenamento::PREAD, nomeDoArquivo + ".imagens");
+            arquivoDeImagens->limpar();
+        }
+
+        if (espacosLivresDasImagens.empty())
+        {
+            imagem.enderecoNoArquivo = fimDoArquivoDeImagens;
+            fimDoArquivoDeImagens += tamanho;
+        }
+
+        else
+        {
+            imagem.enderecoNoArquivo = espacosLivresDasImagens.back();
+            espacosLivresDasImagens.pop_back();
+        }
+
+        if (!arquivoDeImagens->escrever(imagem.enderecoNoArquivo, bytes.data(), tamanho))
+        {
+            espacosLivresDasImagens.push_back(imagem.enderecoNoArquivo);
+
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[ArvoreB] Não foi possível guardar a imagem antiga de uma página."
+                 << endl << "Exceção lançada" << endl;
+
+            throw runtime_error("[ArvoreB] Não foi possível guardar a imagem antiga de uma página.");
+        }
+
+        return imagem;
+    }
+
+    /**
+     * @brief Devolve o espaço ocupado pelos bytes da imagem, que está saindo das
+     * imagens antigas.
+     */
+    void descartarImagemAntiga(ImagemAntiga &imagem)
+    {
+        if (imagem.enderecoNoArquivo == constantes::ptrNuloPagina)
+        {
+            if (tipoDeArmazenamento != TipoDeArmazenamento::MEMORIA) imagensNaMemoria--;
+
+            return;
+        }
+
+        lock_guard<mutex> travado(travaDoArquivoDeImagens);
+
+        espacosLivresDasImagens.push_back(imagem.enderecoNoArquivo);
+    }
+
+    /**
+     * @brief Carrega a página da imagem antiga. Quem chama deve ter a trava da
+     * parte da imagem, para que o espaço dela no arquivo não seja reaproveitado.
+     */
+    void lerImagemAntiga(ImagemAntiga &imagem, Pagina *pagina, file_ptr_type endereco)
+    {
+        const char *bytes = imagem.bytes.data();
+        static thread_local vector<char> buffer;
+
+        if (imagem.enderecoNoArquivo != constantes::ptrNuloPagina)
+        {
+            buffer.resize(pagina->obterTamanhoMaximoEmBytes());
+
+            if (!arquivoDeImagens->ler(imagem.enderecoNoArquivo, buffer.data(), buffer.size()))
+            {
+                // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+                cerr << "[ArvoreB] Não foi possível ler a imagem antiga de uma página."
+                     << endl << "Exceção lançada" << endl;
+
+                throw runtime_error("[ArvoreB] Não foi possível ler a imagem antiga de uma página.");
+            }
+
+            bytes = buffer.data();
+        }
+
+        pagina->limpar();
+        pagina->setEndereco(endereco);
+        pagina->lerBytesDiretamente(reinterpret_cast<const tipo_byte *>(bytes));
+    }
+
+    /**
+     * @brief Sem a cópia na escrita, guarda a imagem atual da página antes de ela
+     * ser escrita ou liberada pela primeira vez desde o último instantâneo. A
+     * thread deve ter a trava de escrita da página.
+     * 
+     * @param endereco Endereço da página, que pode ser constantes::ptrNuloPagina
+     * caso ela seja nova.
+     */
+    void guardarImagemAntiga(file_ptr_type endereco)
+    {
+        if (!existemInstantaneos || endereco == constantes::ptrNuloPagina) return;
+
+        // As páginas criadas pela operação ainda não estão em nenhuma versão
+        vector<file_ptr_type> &novas = estadoDaThread().paginasNovas;
+
+        if (find(novas.begin(), novas.end(), endereco) != novas.end()) return;
+
+        ParteDasImagens &parte = parteDasImagens(endereco);
+        lock_guard<mutex> travado(parte.trava);
+        uint64_t ultimaVersao;
+
+        {
+            lock_guard<mutex> travadasAsVersoes(travaDasVersoes);
+
+            if (leitoresPorVersao.empty()) return;
+
+            ultimaVersao = leitoresPorVersao.rbegin()->first;
+        }
+
+        map<uint64_t, ImagemAntiga> &imagens = parte.imagens[endereco];
+
+        if (!imagens.empty() && imagens.rbegin()->first >= ultimaVersao) return;
+
+        Pagina pagina(ordemDaArvore);
+
+        cache->copiarPagina(endereco, &pagina);
+        imagens.emplace(ultimaVersao, criarImagemAntiga(pagina));
+    }
+
+    /**
+     * @brief Carrega a página como ela estava na versão informada, que deve ter
+     * um leitor. Não precisa de travas.
+     */
+    void carregarDaVersao(Pagina *pagina, file_ptr_type endereco, uint64_t versao)
+    {
+        // Com a trava da parte, nenhuma escrita muda a página entre a procura da
+        // imagem e a cópia da página atual
+        ParteDasImagens &parte = parteDasImagens(endereco);
+        lock_guard<mutex> travado(parte.trava);
+        auto imagens = parte.imagens.find(endereco);
+
+        if (imagens != parte.imagens.end())
+        {
+            auto imagem = imagens->second.lower_bound(versao);
+
+            if (imagem != imagens->second.end())
+            {
+                lerImagemAntiga(imagem->second, pagina, endereco);
+
+                return;
+            }
+        }
+
+        cache->copiarPagina(endereco, pagina);
+    }
+
+    /**
+     * @brief Checa se a página não será dividida (na inserção) nem fundida ou
+     * esvaziada (na exclusão) ao receber ou perder um elemento. Nesse caso, as
+     * páginas acima dela não mudam.
+     */
+    bool paginaSegura(Pagina *pagina, bool paraInserir)
+    {
+        if (paraInserir) return !pagina->cheia();
+
+        return pagina->tamanho() > max(1, numeroDeChavesPorPagina / 2);
+    }
+
+    /**
+     * @brief Indica se as páginas podem ser lidas sem travas (veja
+     * localizarSemTravas()). Cada cópia de uma página precisa ser feita por
+     * inteiro entre duas escritas dela, o que o cache garante copiando-a de um
+     * quadro dele ou com a trava dele (veja CacheDePaginas::copiarSemTravas()).
+     * Com o cache desabilitado, todas as cópias viriam do arquivo com a trava,
+     * então elas só compensam quando o armazenamento não permite ler durante as
+     * escritas, como na memória e no arquivo mapeado.
+     */
+    bool permiteLeiturasOtimistas()
+    {
+        return cache->habilitado() || !arquivo->permiteLerDuranteEscritas();
+    }
+
+    /**
+     * @brief Solta as travas de todas as páginas acima da última travada e as
+     * tira do caminho, que passa a começar por ela.
+     * 
+     * @param parDoCaminho Caminho da descida, como em obterCaminhoDeDescida().
+     */
+    void soltarAncestrais(pair< list<file_ptr_type>, list<int> > &parDoCaminho)
+    {
+        list<file_ptr_type> &travadas = estadoDaThread().travadas;
+
+        // Na cópia na escrita, não há travas a soltar, e as páginas de cima ainda
+        // serão copiadas por publicarCopias()
+        if (copiaNaEscrita) return;
+
+        while (travadas.size() > 1)
+        {
+            travas.destravar(travadas.front(), true);
+            travadas.pop_front();
+        }
+
+        while (parDoCaminho.first.size() > 1)
+        {
+            parDoCaminho.first.pop_front();
+            parDoCaminho.second.pop_front();
+        }
+    }
+
+    /**
+     * @brief Tenta carregar a página do endereço informado. Caso ela esteja no
+     * cache, é copiada de lá sem acessar o arquivo. A thread deve ter a trava de
+     * leitura ou de escrita da página.
+     * 
+     * @param pagina Página a ser carregada.
+     * @param endereco Endereço da página.
+     * @param sequencial Indica que a página faz parte de uma varredura, para que
+     * ela não tire as páginas mais usadas do cache.
+     * 
+     * @return true Caso não haja erros.
+     * @return false Caso haja erros.
+     */
+    bool carregar(Pagina *pagina, file_ptr_type endereco, bool sequencial = false)
+    {
+        // Na cópia na escrita, a operação da thread vê as cópias que ela fez
+        if (copiaNaEscrita) endereco = traduzir(endereco);
+
+        // Lança uma exceção caso não consiga ler a página
+        cache->copiarPagina(endereco, pagina, sequencial);
+
+        return true;
+    }
+
+    /**
+     * @brief Como carregar(), mas para localizarSemTravas(), que não tem a trava
+     * da página (veja CacheDePaginas::copiarSemTravas()).
+     * 
+     * @return true Caso a página tenha sido copiada.
+     * @return false Caso a cópia precise da trava da página.
+     */
+    bool carregarSemTravas(Pagina *pagina, file_ptr_type endereco)
+    {
+        if (copiaNaEscrita) endereco = traduzir(endereco);
+
+        return cache->copiarSemTravas(endereco, pagina);
+    }
+
+    /**
+     * @brief Atualiza a página no arquivo, passando pelo cache. Caso ela ainda não
+     * tenha um endereço, adiciona-a ao final do arquivo.
+     * 
+     * @param pagina Página a ser salva.
+     * 
+     * @return file_ptr_type Endereço no qual a página foi colocada.
+     */
+    file_ptr_type salvar(Pagina *pagina)
+    {
+        // A página vai para o cache pronta para as pesquisas
+        pagina->organizarOrdemEytzinger();
+
+        if (copiaNaEscrita) return salvarCopia(pagina);
+
+        bool nova = pagina->obterEndereco() == constantes::ptrNuloPagina;
+
+        guardarImagemAntiga(pagina->obterEndereco());
+
+        // Com o diário, a página fica retida no cache até a operação ser confirmada
+        file_ptr_type endereco =
+            diario == nullptr ? cache->colocar(pagina) : cache->reter(pagina);
+
+        if (nova && existemInstantaneos) estadoDaThread().paginasNovas.push_back(endereco);
+
+        if (diario == nullptr) return endereco;
+
+        list<file_ptr_type> &retidas = estadoDaThread().paginasRetidas;
+
+        if (find(retidas.begin(), retidas.end(), endereco) == retidas.end())
+        {
+            retidas.push_back(endereco);
+        }
+
+        return endereco;
+    }
+
+    /**
+     * @brief Reserva no armazenamento o espaço de uma página nova.
+     * 
+     * @return file_ptr_type Endereço da página reservada.
+     */
+    file_ptr_type alocarPagina()
+    {
+        file_ptr_type endereco =
+            arquivo->alocarPagina(paginaPai()->obterTamanhoMaximoEmBytes());
+
+        // Não há o que guardar da página antes da primeira escrita dela
+        if (existemInstantaneos) estadoDaThread().paginasNovas.push_back(endereco);
+
+        return endereco;
+    }
+
+    /**
+     * @brief Tira a página da árvore e coloca o espaço dela na lista de páginas
+     * livres do arquivo, para que seja reaproveitado pelas próximas páginas
+     * criadas. A página é limpa e perde o endereço.
+     * 
+     * @param pagina Página que não faz mais parte da árvore.
+     */
+    void liberarPagina(Pagina *pagina)
+    {
+        file_ptr_type endereco = pagina->obterEndereco();
+
+        if (copiaNaEscrita && endereco != constantes::ptrNuloPagina)
+        {
+            // As versões anteriores ainda podem usar a página, que é reaproveitada
+            // como as substituídas. Ela sai do caminho que será copiado.
+            EstadoDaThread &estado = estadoDaThread();
+            vector<file_ptr_type> &novas = estado.paginasNovas;
+            vector<file_ptr_type> &liberadas = estado.paginasLiberadas;
+
+            endereco = traduzir(endereco);
+
+            for (auto &&par : estado.copias)
+            {
+                if (par.second == endereco) estado.travadas.remove(par.first);
+            }
+
+            estado.travadas.remove(endereco);
+
+            if (find(liberadas.begin(), liberadas.end(), endereco) == liberadas.end())
+            {
+                liberadas.push_back(endereco);
+            }
+
+            novas.erase(remove(novas.begin(), novas.end(), endereco), novas.end());
+        }
+
+        else if (endereco != constantes::ptrNuloPagina)
+        {
+            // A lista de páginas livres vai escrever na página
+            guardarImagemAntiga(endereco);
+
+            // Uma cópia suja no cache não pode sobrescrever a lista depois
+            cache->descartar(endereco);
+
+            if (diario == nullptr) arquivo->liberarPagina(endereco);
+
+            else
+            {
+                // Até o próximo ponto de verificação, o diário pode refazer escritas
+                // antigas na página, que estragariam a lista
+                EstadoDaThread &estado = estadoDaThread();
+
+                estado.paginasRetidas.remove(endereco);
+                estado.paginasLiberadas.push_back(endereco);
+            }
+
+            // Ninguém mais chega à página pela árvore, e ela pode ser reaproveitada
+            // por outra thread em qualquer lugar, então a trava dela não fica presa
+            soltarTrava(endereco);
+        }
+
+        pagina->limpar();
+    }
+
+    /**
+     * @brief Escreve um cabeçalho novo, sem páginas livres, no armazenamento.
+     * 
+     * @param destino Armazenamento que receberá o cabeçalho.
+     * @param enderecoDaRaiz Endereço da raiz da árvore.
+     */
+    void escreverCabecalho(ArmazenamentoDePaginas &destino, file_ptr_type enderecoDaRaiz)
+    {
+        file_ptr_type semPaginasLivres = constantes::ptrNuloPagina;
+        IdentificacaoDoArquivo identificacao = identificacaoEsperada();
+
+        destino.escrever(0, (char *) &identificacao, sizeof(identificacao));
+
+        if (copiaNaEscrita)
+        {
+            // A outra versão fica zerada, e a soma dela não confere
+            vector<char> zeros(2 * sizeof(VersaoDoCabecalho), 0);
+            VersaoDoCabecalho versao{ 1, enderecoDaRaiz, semPaginasLivres, 0 };
+
+            destino.escrever(tamanhoCabecalhoAntesDoEnderecoDaRaiz, zeros.data(), zeros.size());
+            escreverVersaoDoCabecalho(destino, versao);
+
+            return;
+        }
+
+        destino.escrever(tamanhoCabecalhoAntesDoEnderecoDaRaiz,
+            (char *) &enderecoDaRaiz, sizeof(file_ptr_type));
+
+        destino.escrever(enderecoDaListaDePaginasLivres,
+            (char *) &semPaginasLivres, sizeof(file_ptr_type));
+    }
+
+    /**
+     * @brief Escreve a versão do cabeçalho no lugar dela, conforme o número,
+     * calculando antes a soma.
+     */
+    void escreverVersaoDoCabecalho(ArmazenamentoDePaginas &destino, VersaoDoCabecalho &versao)
+    {
+        versao.soma = somarBytes((char *) &versao, sizeof(versao) - sizeof(versao.soma));
+
+        destino.escrever(tamanhoCabecalhoAntesDoEnderecoDaRaiz +
+            (versao.numero % 2) * sizeof(VersaoDoCabecalho),
+            (char *) &versao, sizeof(versao));
+    }
+
+    /**
+     * @brief Lê as duas versões do cabeçalho e obtém a de maior número entre as
+     * que estão inteiras.
+     */
+    VersaoDoCabecalho lerVersaoDoCabecalho()
+    {
+        VersaoDoCabecalho versoes[2];
+        VersaoDoCabecalho *escolhida = nullptr;
+
+        if (arquivo->ler(tamanhoCabecalhoAntesDoEnderecoDaRaiz, (char *) versoes, sizeof(versoes)))
+        {
+            for (VersaoDoCabecalho &versao : versoes)
+            {
+                bool inteira = versao.soma ==
+                    somarBytes((char *) &versao, sizeof(versao) - sizeof(versao.soma));
+
+                if (inteira && (escolhida == nullptr || versao.numero > escolhida->numero))
+                {
+                    escolhida = &versao;
+                }
+            }
+        }
+
+        if (escolhida == nullptr)
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[ArvoreB] Nenhuma versão do cabeçalho do arquivo está inteira."
+                 << endl
+                 << "Exceção lançada" << endl;
+
+            throw length_error(
+                "[ArvoreB] Nenhuma versão do cabeçalho do arquivo está inteira.");
+        }
+
+        return *escolhida;
+    }
+
+    /**
+     * @brief Obtém a identificação que o arquivo desta árvore deve ter.
+     */
+    IdentificacaoDoArquivo identificacaoEsperada()
+    {
+        return IdentificacaoDoArquivo{
+            constantes::assinaturaDoArquivo,
+            constantes::versaoDoFormatoDoArquivo,
+            (uint32_t) ordemDaArvore,
+            (uint32_t) paginaPai()->obterTamanhoMaximoEmBytes(),
+            copiaNaEscrita
+        };
+    }
+
+    /**
+     * @brief Confere se o arquivo atual tem o formato que esta árvore usa. Caso
+     * não, lança uma exceção dizendo o que é diferente.
+     */
+    void conferirIdentificacao()
+    {
+        IdentificacaoDoArquivo esperada = identificacaoEsperada();
+        IdentificacaoDoArquivo lida;
+        string diferenca;
+
+        if (!arquivo->ler(0, (char *) &lida, sizeof(lida)) ||
+            lida.assinatura != esperada.assinatura)
+        {
+            diferenca = "ele não é de uma árvore ou foi criado antes de os arquivos "
+                "terem a versão do formato";
+        }
+
+        else if (lida.versaoDoFormato != esperada.versaoDoFormato)
+        {
+            diferenca = "ele usa a versão " + to_string(lida.versaoDoFormato) +
+                " do formato, e a árvore usa a versão " +
+                to_string(esperada.versaoDoFormato);
+        }
+
+        else if (lida.ordemDaArvore != esperada.ordemDaArvore)
+        {
+            diferenca = "ele é de uma árvore de ordem " + to_string(lida.ordemDaArvore) +
+                ", e a árvore tem ordem " + to_string(esperada.ordemDaArvore);
+        }
+
+        else if (lida.tamanhoDaPagina != esperada.tamanhoDaPagina)
+        {
+            diferenca = "as páginas dele têm " + to_string(lida.tamanhoDaPagina) +
+                " bytes, e as da árvore têm " + to_string(esperada.tamanhoDaPagina) +
+                " (o tipo da árvore ou os tipos das chaves e dos dados são outros)";
+        }
+
+        else if (lida.copiaNaEscrita != esperada.copiaNaEscrita)
+        {
+            diferenca = string("ele foi criado ") +
+                (lida.copiaNaEscrita ? "com" : "sem") + " a cópia na escrita";
+        }
+
+        if (!diferenca.empty())
+        {
+            string mensagem = "[ArvoreB] O arquivo " + nomeDoArquivo +
+                " tem um formato incompatível: " + diferenca + ".";
+
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << mensagem << endl
+                 << "Exceção lançada" << endl;
+
+            throw runtime_error(mensagem);
+        }
+    }
+
+    /**
+     * @brief Lê o cabeçalho do arquivo atual: a raiz e as páginas livres. Na
+     * cópia na escrita, as versões recomeçam da que está no cabeçalho, e as
+     * páginas livres deixadas pelo último fechamento vão para a memória.
+     */
+    void lerCabecalho()
+    {
+        if (!copiaNaEscrita)
+        {
+            arquivo->usarListaDePaginasLivres(enderecoDaListaDePaginasLivres);
+            enderecoDaRaiz = lerEnderecoDaRaizDoArquivo();
+
+            return;
+        }
+
+        VersaoDoCabecalho versao = lerVersaoDoCabecalho();
+
+        enderecoDaRaiz = versao.raiz;
+        numeroDoCabecalho = versao.numero;
+        versaoAtual = versaoGravada = 0;
+        operacoesSemGravar = 0;
+        paginasLivres.clear();
+        paginasSubstituidas.clear();
+
+        for (file_ptr_type endereco = versao.primeiraPaginaLivre;
+            endereco != constantes::ptrNuloPagina; )
+        {
+            paginasLivres.push_back(endereco);
+            arquivo->ler(endereco, (char *) &endereco, sizeof(file_ptr_type));
+        }
+
+        // As páginas livres serão reescritas, então o cabeçalho deixa de apontar
+        // para a lista antes disso
+        if (versao.primeiraPaginaLivre != constantes::ptrNuloPagina) gravarCabecalho();
+    }
+
+    /**
+     * @brief Checa se o arquivo tem tamanho suficiente para ter o cabeçalho
+     * da árvore e pelo menos uma página. Caso não, cria um cabeçalho e a raiz
+     * da árvore. Caso sim, confere o formato dele (veja conferirIdentificacao()).
+     * Depois, passa a usar a lista de páginas livres do cabeçalho.
+     */
+    void iniciarArquivoCasoNecessario()
+    {
+        auto tamanho = arquivo->tamanho();
+        
+        // O arquivo precisa ter pelo menos o cabeçalho da árvore e uma página
+        if (tamanho < tamanhoCabecalho + paginaPai()->obterTamanhoMaximoEmBytes())
+        {
+            arquivo->limpar();
+
+            // A raiz ficará logo após o cabeçalho. No começo, não há páginas livres.
+            escreverCabecalho(*arquivo, tamanhoCabecalho);
+
+            // Escreve a raiz, que começa vazia
+            Pagina raiz(ordemDaArvore);
+            vector<char> buffer( raiz.obterTamanhoMaximoEmBytes() );
+            raiz.colocarNoArquivo(*arquivo, buffer.data());
+        }
+
+        else conferirIdentificacao();
+
+        lerCabecalho();
+    }
+
+    /**
+     * @brief Ajusta uma página que está sendo copiada para o arquivo compactado.
+     * Os ponteiros para as filhas já estão com os endereços novos. Classes filhas
+     * podem sobrescrever este método para ajustar os seus próprios campos.
+     * 
+     * @param pagina Página que será escrita no arquivo compactado.
+     * @param paginaAnteriorNoNivel Endereço, no arquivo compactado, da página à
+     * esquerda desta no mesmo nível ou constantes::ptrNuloPagina caso esta seja
+     * a primeira do nível.
+     * @param proximaPaginaNoNivel Endereço, no arquivo compactado, da página à
+     * direita desta no mesmo nível ou constantes::ptrNuloPagina caso esta seja
+     * a última do nível.
+     */
+    virtual void prepararPaginaCompactada(Pagina * /* pagina */,
+        file_ptr_type /* paginaAnteriorNoNivel */, file_ptr_type /* proximaPaginaNoNivel */) {}
+
+    /**
+     * @brief Lança uma exceção caso haja instantâneos. Chamado pelas operações que
+     * reconstroem a árvore, pois as páginas e as imagens que os instantâneos
+     * veem deixariam de valer.
+     */
+    void exigirQueNaoHajaInstantaneos()
+    {
+        lock_guard<mutex> travado(travaDasVersoes);
+
+        if (leitoresPorVersao.empty()) return;
+
+        // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+        cerr << "[ArvoreB] A árvore não pode ser reconstruída enquanto houver instantâneos."
+             << endl << "Exceção lançada" << endl;
+
+        throw logic_error(
+            "[ArvoreB] A árvore não pode ser reconstruída enquanto houver instantâneos.");
+    }
+
+    /**
+     * @brief Passa a usar o armazenamento recebido, que tem a árvore compactada,
+     * no lugar do atual. Em arquivos, o compactado substitui o original.
+     * 
+     * @param novoArquivo Armazenamento com a árvore compactada.
+     * @param nomeTemporario Nome do arquivo do novoArquivo.
+     */
+    void trocarArquivoPor(ArmazenamentoDePaginas *novoArquivo, string nomeTemporario)
+    {
+        exigirQueNaoHajaInstantaneos();
+
+        delete cache;
+        delete arquivo;
+
+        if (tipoDeArmazenamento == TipoDeArmazenamento::MEMORIA)
+        {
+            arquivo = novoArquivo;
+        }
+
+        else
+        {
+            delete novoArquivo; // Fecha o arquivo compactado
+
+            if (rename(nomeTemporario.c_str(), nomeDoArquivo.c_str()) != 0)
+            {
+                // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+                cerr << "[ArvoreB] Não foi possível substituir o arquivo pelo compactado."
+                     << endl << "Exceção lançada" << endl;
+
+                throw runtime_error(
+                    "[ArvoreB] Não foi possível substituir o arquivo pelo compactado.");
+            }
+
+            arquivo = criarArmazenamento(tipoDeArmazenamento, nomeDoArquivo);
+        }
+
+        lerCabecalho();
+
+        criarCache();
+    }
+
+    /**
+     * @brief Descarta todas as páginas da árvore, inclusive as que estão no cache,
+     * e deixa no armazenamento apenas o cabeçalho e uma raiz vazia.
+     */
+    void esvaziarArquivo()
+    {
+        exigirQueNaoHajaInstantaneos();
+
+        // O cache é descartado sem ser descarregado, pois nada dele vale mais
+        delete cache;
+
+        // O diário é esvaziado antes, para que nada seja refeito no arquivo vazio
+        if (diario != nullptr)
+        {
+            diario->esvaziar();
+            paginasLiberadasConfirmadas.clear();
+        }
+
+        arquivo->limpar();
+        iniciarArquivoCasoNecessario();
+
+        criarCache();
+    }
+
+    /**
+     * @brief Deixa a página vazia e com o endereço informado, pronta para ser
+     * preenchida pela carga em lote.
+     */
+    void recomecarPagina(Pagina *pagina, file_ptr_type endereco)
+    {
+        pagina->limpar();
+
+        // limpar() tira também o ponteiro da esquerda, que toda página tem
+        pagina->ponteiros.push_back(constantes::ptrNuloPagina);
+        pagina->setEndereco(endereco);
+    }
+
+    /**
+     * @brief Divide @p total itens entre @p partes grupos, cujos tamanhos
+     * diferem em no máximo um.
+     */
+    static vector<int> dividirIgualmente(int total, int partes)
+    {
+        vector<int> tamanhos(partes, total / partes);
+
+        for (int i = 0; i < total % partes; i++) tamanhos[i]++;
+
+        return tamanhos;
+    }
+
+    /**
+     * @brief Calcula o formato da árvore que construirPorNiveis() monta com a
+     * quantidade de registros informada. Todas as folhas ficam no mesmo nível e
+     * as páginas de cada nível têm tamanhos que diferem em no máximo um.
+     * 
+     * @param quantidade Quantidade de registros, maior que zero.
+     * @param chavesPorFolha Quantidade desejada de chaves em cada folha.
+     * @param filhasPorPagina Quantidade desejada de filhas em cada página interna.
+     * 
+     * @return vector< vector<int> > Um vetor por nível, das folhas até a raiz.
+     * O das folhas tem a quantidade de chaves de cada folha e os outros, a
+     * quantidade de filhas de cada página.
+     */
+    vector< vector<int> > planejarNiveis(
+        size_t quantidade, int chavesPorFolha, int filhasPorPagina)
+    {
+        // Numa árvore B com F folhas, as páginas internas guardam F - 1 chaves ao
+        // todo, uma entre cada par de folhas vizinhas. Cada folha deve ficar com
+        // pelo menos uma chave.
+        size_t folhas = (quantidade + 1 + chavesPorFolha) / (chavesPorFolha + 1);
+
+        folhas = max((size_t) 1, min(folhas, (quantidade + 1) / 2));
+
+        vector< vector<int> > niveis;
+
+        niveis.push_back( dividirIgualmente(quantidade - (folhas - 1), folhas) );
+
+        while (niveis.back().size() > 1)
+        {
+            int paginasAbaixo = niveis.back().size();
+            int paginas = (paginasAbaixo + filhasPorPagina - 1) / filhasPorPagina;
+
+            // Cada página interna precisa de pelo menos duas filhas
+            paginas = max(1, min(paginas, paginasAbaixo / 2));
+
+            niveis.push_back( dividirIgualmente(paginasAbaixo, paginas) );
+        }
+
+        return niveis;
     }
 
     /**
-     * @brief Vai para o endereço informado e tenta carregar a página.
+     * @brief Preenche a árvore vazia com os registros ordenados do intervalo, no
+     * formato calculado por planejarNiveis(). Os registros chegam na ordem de
+     * uma travessia em ordem da árvore, então só uma página por nível fica
+     * aberta: a folha recebe registros até completar o seu tamanho, e o registro
+     * seguinte vira o separador dela na primeira página acima que ainda espera
+     * filhas. Cada página é escrita uma única vez, sem passar pelo cache.
      * 
-     * @param pagina Página a ser carregada.
-     * @param endereco Endereço da página.
-     * 
-     * @return true Caso não haja erros.
-     * @return false Caso haja erros.
+     * @param inicio Iterador para o primeiro par, cujos campos são first (chave)
+     * e second (dado).
+     * @param fim Iterador para depois do último par.
+     * @param niveis Formato da árvore, que deve comportar exatamente os
+     * registros do intervalo.
      */
-    bool carregar(Pagina *pagina, file_ptr_type endereco)
+    template <typename Iterador>
+    void construirPorNiveis(Iterador inicio, Iterador fim, vector< vector<int> > &niveis)
     {
-        bool sucesso = true;
+        int altura = niveis.size();
+        vector<char> buffer( paginaFilha()->obterTamanhoMaximoEmBytes() );
+        vector<Pagina> abertas(altura, Pagina(ordemDaArvore));
+        // Posição, dentro do nível, da página aberta e quantidade de filhas dela
+        // que já foram escritas
+        vector<int> indices(altura, 0);
+        vector<int> filhasEscritas(altura, 0);
+        // Nível que recebe o próximo registro. Igual à altura quando todas as
+        // páginas já foram escritas.
+        int nivelDoProximo = 0;
+
+        // A primeira folha ocupa o lugar da raiz vazia
+        recomecarPagina(&abertas[0], lerEnderecoDaRaiz());
+
+        for (int nivel = 1; nivel < altura; nivel++)
+        {
+            recomecarPagina(&abertas[nivel], alocarPagina());
+            abertas[nivel].ponteiros[0] = abertas[nivel - 1].obterEndereco();
+        }
+
+        for (; inicio != fim && nivelDoProximo < altura; ++inicio)
+        {
+            TIPO_DAS_CHAVES chave = inicio->first;
+            TIPO_DOS_DADOS dado = inicio->second;
+            Pagina &pagina = abertas[nivelDoProximo];
+
+            if (nivelDoProximo > 0)
+            {
+                // O separador aponta, à direita, para a próxima página do nível de
+                // baixo, que começa junto com as primeiras dos níveis abaixo dela
+                file_ptr_type filha = alocarPagina();
+
+                pagina.inserir(chave, dado, pagina.tamanho(), filha);
+
+                for (int nivel = nivelDoProximo - 1; nivel >= 0; nivel--)
+                {
+                    recomecarPagina(&abertas[nivel], filha);
+                    indices[nivel]++;
+                    filhasEscritas[nivel] = 0;
+
+                    if (nivel > 0)
+                    {
+                        filha = alocarPagina();
+                        abertas[nivel].ponteiros[0] = filha;
+                    }
+                }
+
+                nivelDoProximo = 0;
+
+                continue;
+            }
+
+            pagina.inserir(chave, dado, pagina.tamanho());
+
+            if (pagina.tamanho() < niveis[0][indices[0]]) continue;
+
+            // A folha está completa. Ela é escrita junto com as páginas acima
+            // dela que acabaram de receber a última filha.
+            int nivel = 0;
 
-        arquivo.seekg(endereco);
-        arquivo >> pagina; // Carrega a página
+            abertas[0].colocarNoArquivo(*arquivo, buffer.data());
 
-        if (arquivo.fail())
+            while (nivel + 1 < altura &&
+                ++filhasEscritas[nivel + 1] == niveis[nivel + 1][indices[nivel + 1]])
+            {
+                nivel++;
+                abertas[nivel].colocarNoArquivo(*arquivo, buffer.data());
+            }
+
+            nivelDoProximo = nivel + 1;
+        }
+
+        if (inicio != fim || nivelDoProximo < altura)
         {
-            sucesso = false;
+            // Não deixa uma árvore pela metade no arquivo
+            esvaziarArquivo();
 
             // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
-            cerr << "[ArvoreB] Não foi possível ler a página do arquivo."
+            cerr << "[ArvoreB] A quantidade de registros não é a planejada."
                  << endl << "Exceção lançada" << endl;
 
-            throw length_error("[ArvoreB] Não foi possível ler a página do arquivo.");
+            throw logic_error("[ArvoreB] A quantidade de registros não é a planejada.");
         }
 
-        return sucesso;
-    }
+        // As páginas precisam estar no disco antes de o cabeçalho apontar para elas
+        arquivo->sincronizar();
 
-    /**
-     * @brief Checa se o arquivo tem tamanho suficiente para ter o cabeçalho
-     * da árvore e pelo menos uma página. Caso não, cria um cabeçalho e a raiz
-     * da árvore.
-     */
-    void iniciarArquivoCasoNecessario()
-    {
-        auto tamanho = obterTamanhoEmBytes(arquivo);
-        
-        // O arquivo precisa ter pelo menos o cabeçalho da árvore e uma página
-        if (tamanho < tamanhoCabecalho + paginaPai->obterTamanhoMaximoEmBytes())
-        {
-            // Limpa o arquivo e o reabre
-            arquivo = fstream(nomeDoArquivo, fstream::binary | fstream::trunc);
-            arquivo = fstream(nomeDoArquivo, fstream::binary | fstream::in | fstream::out);
-            
-            arquivo.seekp(0); // Coloca o ponteiro de put no início
+        if (altura == 1) return;
 
-            // Escreve o endereço da raiz. Ela ficará logo após o endereço dela.
-            arquivo << (file_ptr_type)(sizeof(file_ptr_type));
-            arquivo << paginaPai; // A página pai está vazia no momento
+        // Na cópia na escrita, nenhuma operação publica a raiz nova, então ela vai
+        // direto para uma versão nova do cabeçalho
+        if (copiaNaEscrita)
+        {
+            enderecoDaRaiz = abertas[altura - 1].obterEndereco();
+            gravarCabecalho();
         }
+
+        else trocarRaizPor(abertas[altura - 1].obterEndereco());
     }
 
     /**
@@ -177,16 +2036,23 @@ protected:
      * @param parDoCaminho Par onde o primeiro elemento será uma lista com todos os
      * endereços de todas as páginas pelas quais a recursividade passar e o segundo
      * elemento será uma lista com todos os índices dos ponteiros que a recursividade
-     * acessar para descer de uma página para a outra.
+     * acessar para descer de uma página para a outra. Quando uma página segura
+     * (veja paginaSegura()) é alcançada, as de cima saem do caminho.
+     * @param paraInserir Indica se a descida é de uma inserção ou de uma exclusão.
      * @param irAteUmaFolha Indica se a pesquisa não deve parar caso a chave seja
      * encontrada em páginas que não sejam folhas.
+     * @param limiteSuperior Caso não seja nullptr, recebe a menor chave que
+     * limitou a descida pela direita, se houver. Uma chave maior que ela já
+     * desceria por outro caminho em algum nível.
      */
     virtual void obterCaminhoDeDescida(
         TIPO_DAS_CHAVES &chave,
         int indiceDeDescida,
         file_ptr_type enderecoPaginaFilha,
         pair< list<file_ptr_type>, list<int> > &parDoCaminho,
-        bool irAteUmaFolha = false)
+        bool paraInserir,
+        bool irAteUmaFolha = false,
+        pair<bool, TIPO_DAS_CHAVES> *limiteSuperior = nullptr)
     {
         list<file_ptr_type> &caminho = parDoCaminho.first;
         list<int> &indices = parDoCaminho.second;
@@ -196,55 +2062,81 @@ protected:
         caminho.push_back(enderecoPaginaFilha);
         indices.push_back(indiceDeDescida);
 
+        // A página é travada antes de ser lida, enquanto a pai ainda está travada
+        travarParaEscrita(enderecoPaginaFilha);
+
         // Checa se a página foi carregada
-        if (carregar(paginaFilha, enderecoPaginaFilha))
+        if (carregar(paginaFilha(), enderecoPaginaFilha))
         {
-            int indiceDeDescida = paginaFilha->obterIndiceDeDescida(chave);
-            int indiceDaChave = indiceDeDescida == 0 ? 0 : indiceDeDescida - 1;
-            file_ptr_type ponteiroDeDescida = paginaFilha->ponteiros[indiceDeDescida];
+            // Uma página que não vai ser dividida nem fundida segura as mudanças
+            // da operação, então as páginas acima dela não precisam mais de travas
+            if (paginaSegura(paginaFilha(), paraInserir)) soltarAncestrais(parDoCaminho);
+
+            int indiceDeDescida = paginaFilha()->obterIndiceDeDescida(chave);
+            file_ptr_type ponteiroDeDescida = paginaFilha()->ponteiros[indiceDeDescida];
+
+            // O índice de descida é o da primeira chave que não é menor que a
+            // procurada, então é nele que ela estaria nesta página
+            bool estaNaPagina = indiceDeDescida < paginaFilha()->tamanho() &&
+                paginaFilha()->chaves[indiceDeDescida] == chave;
 
             // Checa se há ponteiro de descida e se a pesquisa deve ir
             // obrigatoriamente até uma folha ou se a chave não foi encontrada.
             if (ponteiroDeDescida != constantes::ptrNuloPagina &&
-                (irAteUmaFolha || paginaFilha->chaves[indiceDaChave] != chave))
+                (irAteUmaFolha || !estaNaPagina))
             {
                 // A página filha passa a ser pai. O swap é necessário pois cada
                 // um desses ponteiros aponta para um objeto página concreto e a
                 // referência para este objeto não pode ser perdida.
-                swap(paginaFilha, paginaPai);
+                swap(paginaFilha(), paginaPai());
+
+                if (limiteSuperior != nullptr && indiceDeDescida < paginaPai()->tamanho() &&
+                    (!limiteSuperior->first ||
+                        paginaPai()->chaves[indiceDeDescida] < limiteSuperior->second))
+                {
+                    *limiteSuperior = make_pair(true, paginaPai()->chaves[indiceDeDescida]);
+                }
 
                 obterCaminhoDeDescida(
                     chave, indiceDeDescida, ponteiroDeDescida,
-                    parDoCaminho, irAteUmaFolha);
+                    parDoCaminho, paraInserir, irAteUmaFolha, limiteSuperior);
             }
         }
     }
 
     /**
-     * @brief Procura o primeiro registro com a chave informada.
+     * @brief Procura, a partir da raiz, o primeiro registro com a chave informada.
+     * As páginas do caminho ficam com as travas de escrita da thread até
+     * destravarTudo().
      * 
      * @param chave Chave a ser procurada.
-     * @param indiceDeDescida Índice do ponteiro na página pai que levou a esta página.
-     * @param enderecoPaginaFilha Endereço da página a ser carregada.
+     * @param paraInserir Indica se a descida é de uma inserção ou de uma exclusão.
      * @param irAteUmaFolha Indica se a pesquisa não deve parar caso a chave seja
      * encontrada em páginas que não sejam folhas.
+     * @param limiteSuperior Caso não seja nullptr, recebe a menor chave que
+     * limitou a descida pela direita, se houver.
      * 
      * @return pair< list<file_ptr_type>, list<int> > Um par onde o primeiro
      * elemento será uma lista com todos os endereços de todas as páginas pelas quais
      * a recursividade passar e o segundo elemento será uma lista com todos os índices
      * dos ponteiros que a recursividade acessar para descer de uma página para a
-     * outra.
+     * outra. O caminho começa pela última página segura, ou pela raiz.
      */
     pair< list<file_ptr_type>, list<int> > obterCaminhoDeDescida(
         TIPO_DAS_CHAVES &chave,
-        int indiceDeDescida,
-        file_ptr_type enderecoPaginaFilha,
-        bool irAteUmaFolha = false)
+        bool paraInserir,
+        bool irAteUmaFolha = false,
+        pair<bool, TIPO_DAS_CHAVES> *limiteSuperior = nullptr)
     {
         pair< list<file_ptr_type>, list<int> > parDoCaminho;
 
+        // A raiz só pode ser trocada por quem tem a trava do endereço dela, que é
+        // solta junto com as das páginas de cima quando a descida fica segura
+        travarParaEscrita(enderecoDaTravaDaRaiz);
+
         obterCaminhoDeDescida(
-            chave, indiceDeDescida, enderecoPaginaFilha, parDoCaminho, irAteUmaFolha);
+            chave, 0, lerEnderecoDaRaiz(), parDoCaminho,
+            paraInserir, irAteUmaFolha, limiteSuperior);
 
         return parDoCaminho;
     }
@@ -259,8 +2151,38 @@ protected:
     {
         if (novaRaiz->obterEndereco() != constantes::ptrNuloPagina)
         {
-            arquivo.seekp(tamanhoCabecalhoAntesDoEnderecoDaRaiz);
-            arquivo << novaRaiz->obterEndereco();
+            trocarRaizPor(novaRaiz->obterEndereco());
+        }
+    }
+
+    /**
+     * @brief Escreve o endereço recebido no cabeçalho da árvore como o endereço
+     * da nova raiz. Com o diário, durante uma inserção ou exclusão, ele vai para
+     * o diário junto com as páginas da operação e só chega ao cabeçalho no
+     * próximo ponto de verificação. Na cópia na escrita, ele só é publicado ao
+     * fim da operação (veja publicarCopias()).
+     * 
+     * @param enderecoDaRaiz Endereço da nova raiz.
+     */
+    void trocarRaizPor(file_ptr_type enderecoDaRaiz)
+    {
+        EstadoDaThread &estado = estadoDaThread();
+
+        if (copiaNaEscrita)
+        {
+            estado.raizNova = enderecoDaRaiz;
+
+            return;
+        }
+
+        this->enderecoDaRaiz = enderecoDaRaiz;
+
+        if (diario != nullptr && estado.emOperacao) estado.raizNova = enderecoDaRaiz;
+
+        else
+        {
+            arquivo->escrever(tamanhoCabecalhoAntesDoEnderecoDaRaiz,
+                (char *) &enderecoDaRaiz, sizeof(file_ptr_type));
         }
     }
 
@@ -286,52 +2208,455 @@ protected:
     }
 
     /**
-     * @brief Procura o primeiro registro com a chave informada e pega o dado
-     * correspondente a ela.
+     * @brief Faz o percurso de localizar() sem pegar trava nenhuma. A versão de
+     * cada página é lida antes da cópia dela e conferida depois, e a da página
+     * pai só é conferida depois que a da filha foi lida, então o ponteiro que
+     * levou à filha ainda valia quando ela começou a ser lida.
+     * 
+     * @param versao Recebe a versão da última página, com a qual ela foi lida.
+     * 
+     * @return true Caso a descida tenha chegado ao fim sem cruzar com escritas.
+     * @return false Caso alguma página tenha mudado. A descida deve ser refeita.
+     */
+    bool localizarSemTravas(TIPO_DAS_CHAVES &chave, Pagina &pagina, bool irAteUmaFolha,
+        Pagina *pai, int *indiceNoPai, uint64_t &versao)
+    {
+        uint64_t versaoDaRaiz;
+
+        if (indiceNoPai != nullptr) *indiceNoPai = -1;
+
+        if (!travas.lerVersao(enderecoDaTravaDaRaiz, versaoDaRaiz)) return false;
+
+        file_ptr_type endereco = lerEnderecoDaRaiz();
+
+        if (!travas.lerVersao(endereco, versao) ||
+            !travas.validarVersao(enderecoDaTravaDaRaiz, versaoDaRaiz))
+        {
+            return false;
+        }
+
+        while (true)
+        {
+            // A cópia só é usada depois de se saber que ninguém escreveu na página
+            if (!carregarSemTravas(&pagina, endereco) ||
+                !travas.validarVersao(endereco, versao))
+            {
+                return false;
+            }
+
+            int indiceDeDescida = pagina.obterIndiceDeDescida(chave);
+            file_ptr_type ponteiroDeDescida = pagina.ponteiros[indiceDeDescida];
+            bool estaNaPagina = indiceDeDescida < pagina.tamanho() &&
+                pagina.chaves[indiceDeDescida] == chave;
+
+            // Mesmas condições de parada de obterCaminhoDeDescida()
+            if (ponteiroDeDescida == constantes::ptrNuloPagina ||
+                (!irAteUmaFolha && estaNaPagina))
+            {
+                return true;
+            }
+
+            if (pai != nullptr) *pai = pagina;
+            if (indiceNoPai != nullptr) *indiceNoPai = indiceDeDescida;
+
+            uint64_t versaoDaFilha;
+
+            if (!travas.lerVersao(ponteiroDeDescida, versaoDaFilha) ||
+                !travas.validarVersao(endereco, versao))
+            {
+                return false;
+            }
+
+            endereco = ponteiroDeDescida;
+            versao = versaoDaFilha;
+        }
+    }
+
+    /**
+     * @brief Desce da raiz até a página onde a chave está ou deveria estar, pelo
+     * mesmo percurso de obterCaminhoDeDescida(), mas usando apenas as páginas
+     * recebidas. Cada página é travada para leitura antes que a trava da anterior
+     * seja solta, então várias threads podem chamá-lo ao mesmo tempo, inclusive
+     * durante inserções e exclusões.
+     * 
+     * @param chave Chave a ser procurada.
+     * @param pagina Recebe a última página do percurso.
+     * @param irAteUmaFolha Indica se a descida não deve parar caso a chave seja
+     * encontrada em páginas que não sejam folhas.
+     * @param pai Caso não seja nullptr, recebe a penúltima página do percurso.
+     * @param indiceNoPai Caso não seja nullptr, recebe o índice do ponteiro do pai
+     * que levou à última página, ou -1 caso o percurso tenha só a raiz.
+     * @param manterTravada Caso seja true, a trava de leitura da última página
+     * fica com quem chamou.
+     * @param semEsperar Caso seja true, a descida desiste em vez de esperar por
+     * uma trava. Serve para quem já tem a trava de alguma página.
+     * 
+     * <p>Quando o armazenamento permite (veja permiteLeiturasOtimistas()), a
+     * descida é tentada antes sem travas, com localizarSemTravas(), e as travas
+     * de leitura só são usadas caso ela cruze com escritas várias vezes.</p>
+     * 
+     * @return true Caso a descida tenha chegado ao fim.
+     * @return false Caso a descida tenha desistido. Nenhuma trava fica pega.
+     */
+    virtual bool localizar(TIPO_DAS_CHAVES &chave, Pagina &pagina, bool irAteUmaFolha,
+        Pagina *pai = nullptr, int *indiceNoPai = nullptr,
+        bool manterTravada = false, bool semEsperar = false)
+    {
+        file_ptr_type endereco;
+        uint64_t versao;
+
+        for (int tentativa = 0;
+            permiteLeiturasOtimistas() && tentativa < constantes::tentativasOtimistas;
+            tentativa++)
+        {
+            if (localizarSemTravas(chave, pagina, irAteUmaFolha, pai, indiceNoPai, versao))
+            {
+                if (!manterTravada) return true;
+
+                // Com a trava de leitura, a página não muda mais, então basta
+                // conferir que ela não mudou antes disso
+                endereco = pagina.obterEndereco();
+
+                if (!travarParaLeitura(endereco, semEsperar)) return false;
+
+                if (travas.validarVersao(endereco, versao)) return true;
+
+                destravarParaLeitura(endereco);
+            }
+
+            this_thread::yield();
+        }
+
+        if (indiceNoPai != nullptr) *indiceNoPai = -1;
+
+        if (!travarARaizParaLeitura(endereco, semEsperar)) return false;
+
+        carregar(&pagina, endereco);
+
+        while (true)
+        {
+            int indiceDeDescida = pagina.obterIndiceDeDescida(chave);
+            file_ptr_type ponteiroDeDescida = pagina.ponteiros[indiceDeDescida];
+            bool estaNaPagina = indiceDeDescida < pagina.tamanho() &&
+                pagina.chaves[indiceDeDescida] == chave;
+
+            // Mesmas condições de parada de obterCaminhoDeDescida()
+            if (ponteiroDeDescida == constantes::ptrNuloPagina ||
+                (!irAteUmaFolha && estaNaPagina))
+            {
+                if (!manterTravada) destravarParaLeitura(endereco);
+
+                return true;
+            }
+
+            if (pai != nullptr) *pai = pagina;
+            if (indiceNoPai != nullptr) *indiceNoPai = indiceDeDescida;
+
+            bool travou = travarParaLeitura(ponteiroDeDescida, semEsperar);
+
+            destravarParaLeitura(endereco);
+
+            if (!travou) return false;
+
+            endereco = ponteiroDeDescida;
+            carregar(&pagina, endereco);
+        }
+    }
+
+    /**
+     * @brief Leva à paginaFilha() a folha da chave com uma descida sem travas e
+     * pega a trava de escrita só dela, que é a única página que muda quando ela
+     * é segura (veja paginaSegura()). A trava fica com a thread até
+     * destravarTudo().
+     * 
+     * @param chave Chave a ser inserida ou excluída.
+     * @param paraInserir Indica se a descida é de uma inserção ou de uma exclusão.
+     * @param irAteUmaFolha Como em obterCaminhoDeDescida().
+     * 
+     * @return true Caso a folha esteja travada e seja segura.
+     * @return false Caso a descida deva ser feita com obterCaminhoDeDescida():
+     * as leituras sem travas não são possíveis, a descida parou numa página que
+     * não é folha, a folha não é segura ou as escritas dos outros atrapalharam
+     * todas as tentativas. Nenhuma trava fica pega. Na cópia na escrita, a
+     * descida sempre é feita com obterCaminhoDeDescida(), que guarda o caminho
+     * a ser copiado.
+     */
+    bool travarFolhaSegura(TIPO_DAS_CHAVES &chave, bool paraInserir, bool irAteUmaFolha)
+    {
+        uint64_t versao;
+
+        if (copiaNaEscrita) return false;
+
+        for (int tentativa = 0;
+            permiteLeiturasOtimistas() && tentativa < constantes::tentativasOtimistas;
+            tentativa++)
+        {
+            if (localizarSemTravas(chave, *paginaFilha(), irAteUmaFolha,
+                nullptr, nullptr, versao))
+            {
+                file_ptr_type endereco = paginaFilha()->obterEndereco();
+
+                if (!paginaFilha()->eUmaFolha() ||
+                    !paginaSegura(paginaFilha(), paraInserir))
+                {
+                    return false;
+                }
+
+                travarParaEscrita(endereco);
+
+                // A cópia da folha só serve caso ela não tenha mudado desde a descida
+                if (travas.validarVersaoTravada(endereco, versao)) return true;
+
+                destravarTudo();
+            }
+
+            this_thread::yield();
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Tenta inserir o par (chave, dado) travando só a folha dele, o que
+     * basta quando ela não está cheia.
+     * 
+     * @return true Caso o par tenha sido inserido. Caso contrário, nada muda e a
+     * inserção deve ser feita com obterCaminhoDeDescida().
+     */
+    bool inserirSemDividir(TIPO_DAS_CHAVES &chave, TIPO_DOS_DADOS &dado)
+    {
+        if (!travarFolhaSegura(chave, true, true)) return false;
+
+        paginaFilha()->inserir(chave, dado, paginaFilha()->obterIndiceDeDescida(chave));
+        salvar(paginaFilha());
+        destravarTudo();
+
+        return true;
+    }
+
+    /**
+     * @brief Tenta excluir o primeiro registro com a chave travando só a folha
+     * dele, o que basta quando ela continua com pelo menos metade das chaves.
+     * 
+     * @param irAteUmaFolha Como em obterCaminhoDeDescida().
+     * @param dadoExcluido Recebe o dado do registro excluído.
+     * 
+     * @return true Caso a exclusão tenha terminado, tendo a chave sido encontrada
+     * ou não. Caso contrário, nada muda e a exclusão deve ser feita com
+     * obterCaminhoDeDescida().
+     */
+    bool excluirSemFundir(TIPO_DAS_CHAVES &chave, bool irAteUmaFolha,
+        TIPO_DOS_DADOS &dadoExcluido)
+    {
+        if (!travarFolhaSegura(chave, false, irAteUmaFolha)) return false;
+
+        int indiceDaChave = paginaFilha()->obterIndiceDeDescida(chave);
+
+        if (indiceDaChave < paginaFilha()->tamanho() &&
+            paginaFilha()->chaves[indiceDaChave] == chave)
+        {
+            dadoExcluido = paginaFilha()->dados[indiceDaChave];
+            limparErro();
+
+            paginaFilha()->excluir(indiceDaChave, false, true);
+            salvar(paginaFilha());
+        }
+
+        else atribuirErro("A chave não foi encontrada");
+
+        destravarTudo();
+
+        return true;
+    }
+
+    /**
+     * @brief Procura o primeiro registro com a chave informada e pega o dado
+     * correspondente a ela.
+     * 
+     * @param chave Chave a ser procurada.
+     * @param irAteUmaFolha Indica se a pesquisa não deve parar caso a chave seja
+     * encontrada em páginas que não sejam folhas.
+     * 
+     * @return TIPO_DOS_DADOS Caso tudo corra bem, retorna o dado correspondente
+     * à chave. Caso contrário, retorna
+     * 
+     * @code{.cpp}
+     * TIPO_DOS_DADOS() // Ex.: se os dados são inteiros, retorna int(), que é 0.
+     * @endcode
+     * 
+     * Em casos onde a chave não é encontrada, uma flag interna é ativada. Dessa
+     * forma, você pode usar qualquer um dos dois ifs abaixo para checar erros:
+     * 
+     * @code{.cpp}
+     * if (ArvoreB.pesquisar(chave) == TIPO_DOS_DADOS()) ArvoreB.mostrarErro();
+     * if (ArvoreB.erro()) ArvoreB.mostrarErro();
+     * @endcode
+     */
+    TIPO_DOS_DADOS pesquisar(TIPO_DAS_CHAVES& chave, bool irAteUmaFolha)
+    {
+        TIPO_DOS_DADOS dado = TIPO_DOS_DADOS();
+        Pagina pagina(ordemDaArvore);
+        VersaoFixada versaoLida(this);
+
+        // Faz todo o percurso de descida na árvore
+        localizar(chave, pagina, irAteUmaFolha);
+
+        // Obtém o índice onde a chave deveria estar na página.
+        // pagina é a última página do percurso.
+        int indiceDaChave = pagina.obterIndiceDeDescida(chave);
+
+        if (indiceDaChave == pagina.tamanho() ||
+            pagina.chaves[indiceDaChave] != chave)
+        {
+            atribuirErro("A chave não foi encontrada");
+        }
+
+        else
+        {
+            limparErro();
+            dado = pagina.dados[indiceDaChave];
+        }
+
+        return dado;
+    }
+
+    /**
+     * @brief Resolve, a partir da página informada, as chaves de índices
+     * ordem[inicio] até ordem[fim - 1], que estão ordenadas. A página é carregada
+     * uma única vez e as chaves que descem pelo mesmo ponteiro seguem juntas
+     * para a página filha.
+     * 
+     * @param endereco Endereço da página.
+     * @param chaves Chaves procuradas, na ordem em que foram recebidas.
+     * @param ordem Índices das chaves em ordem crescente das chaves.
+     * @param inicio Primeira posição de ordem resolvida por esta página.
+     * @param fim Posição após a última de ordem resolvida por esta página.
+     * @param dados Recebe, no índice de cada chave, o dado encontrado.
+     * @param encontradas Recebe, no índice de cada chave, se ela foi encontrada.
+     * @param irAteUmaFolha Indica se a pesquisa não deve parar caso a chave seja
+     * encontrada em páginas que não sejam folhas.
+     * 
+     * <p>A página deve chegar com a trava de leitura de quem chamou, que é solta
+     * aqui.</p>
+     */
+    virtual void pesquisarVarios(
+        file_ptr_type endereco,
+        vector<TIPO_DAS_CHAVES> &chaves,
+        vector<int> &ordem, int inicio, int fim,
+        vector<TIPO_DOS_DADOS> &dados,
+        vector<bool> &encontradas,
+        bool irAteUmaFolha)
+    {
+        // Cada descida é (ponteiro, início, fim) das chaves que vão para a filha.
+        // Elas são reunidas antes da recursividade para que as filhas possam ser
+        // lidas juntas.
+        vector< tuple<file_ptr_type, int, int> > descidas;
+        int indiceDeDescida = 0;
+        Pagina pagina(ordemDaArvore);
+
+        carregar(&pagina, endereco);
+
+        for (int i = inicio; i < fim; i++)
+        {
+            TIPO_DAS_CHAVES &chave = chaves[ordem[i]];
+
+            // Como as chaves estão ordenadas, a pesquisa binária continua de onde
+            // a da chave anterior parou
+            indiceDeDescida = pagina.obterIndiceDeDescida(chave, indiceDeDescida);
+
+            file_ptr_type ponteiroDeDescida = pagina.ponteiros[indiceDeDescida];
+            bool estaNaPagina = indiceDeDescida < pagina.tamanho() &&
+                pagina.chaves[indiceDeDescida] == chave;
+
+            if (estaNaPagina &&
+                (!irAteUmaFolha || ponteiroDeDescida == constantes::ptrNuloPagina))
+            {
+                dados[ordem[i]] = pagina.dados[indiceDeDescida];
+                encontradas[ordem[i]] = true;
+            }
+
+            else if (ponteiroDeDescida != constantes::ptrNuloPagina)
+            {
+                if (!descidas.empty() && get<0>(descidas.back()) == ponteiroDeDescida)
+                {
+                    get<2>(descidas.back()) = i + 1;
+                }
+
+                else descidas.push_back( make_tuple(ponteiroDeDescida, i, i + 1) );
+            }
+        }
+
+        // As filhas são travadas, da esquerda para a direita, antes que a página
+        // seja solta. Cada uma é solta pela própria recursividade.
+        for (auto &&descida : descidas) travarParaLeitura(get<0>(descida));
+
+        destravarParaLeitura(endereco);
+
+        // As filhas são lidas juntas, num único lote, antes da recursividade
+        if (descidas.size() > 1)
+        {
+            vector<file_ptr_type> filhas;
+
+            for (auto &&descida : descidas) filhas.push_back(get<0>(descida));
+
+            cache->carregarVarias(filhas);
+        }
+
+        for (auto &&descida : descidas)
+        {
+            pesquisarVarios(
+                get<0>(descida), chaves, ordem, get<1>(descida), get<2>(descida),
+                dados, encontradas, irAteUmaFolha);
+        }
+    }
+
+    /**
+     * @brief Procura várias chaves de uma vez, numa única descida compartilhada.
      * 
-     * @param chave Chave a ser procurada.
+     * @param chaves Chaves a serem procuradas, em qualquer ordem.
+     * @param encontradas Recebe, para cada chave, se ela foi encontrada.
      * @param irAteUmaFolha Indica se a pesquisa não deve parar caso a chave seja
      * encontrada em páginas que não sejam folhas.
      * 
-     * @return TIPO_DOS_DADOS Caso tudo corra bem, retorna o dado correspondente
-     * à chave. Caso contrário, retorna
-     * 
-     * @code{.cpp}
-     * TIPO_DOS_DADOS() // Ex.: se os dados são inteiros, retorna int(), que é 0.
-     * @endcode
-     * 
-     * Em casos onde a chave não é encontrada, uma flag interna é ativada. Dessa
-     * forma, você pode usar qualquer um dos dois ifs abaixo para checar erros:
-     * 
-     * @code{.cpp}
-     * if (ArvoreB.pesquisar(chave) == TIPO_DOS_DADOS()) ArvoreB.mostrarErro();
-     * if (ArvoreB.erro()) ArvoreB.mostrarErro();
-     * @endcode
+     * @return vector<TIPO_DOS_DADOS> Dado de cada chave, na ordem das chaves
+     * recebidas, ou TIPO_DOS_DADOS() caso ela não tenha sido encontrada.
      */
-    TIPO_DOS_DADOS pesquisar(TIPO_DAS_CHAVES& chave, bool irAteUmaFolha)
+    vector<TIPO_DOS_DADOS> pesquisarVarios(
+        vector<TIPO_DAS_CHAVES> &chaves, vector<bool> &encontradas, bool irAteUmaFolha)
     {
-        TIPO_DOS_DADOS dado;
+        int quantidade = chaves.size();
+        vector<TIPO_DOS_DADOS> dados(quantidade);
+        vector<int> ordem(quantidade);
 
-        // Faz todo o percurso de descida na árvore
-        obterCaminhoDeDescida(chave, 0, lerEnderecoDaRaiz(), irAteUmaFolha);
+        encontradas.assign(quantidade, false);
 
-        // Obtém o índice onde a chave deveria estar na página.
-        // paginaFilha é a última página do percurso.
-        int indiceDaChave = paginaFilha->obterIndiceDeDescida(chave);
+        for (int i = 0; i < quantidade; i++) ordem[i] = i;
 
-        if (indiceDaChave == paginaFilha->tamanho() ||
-            paginaFilha->chaves[indiceDaChave] != chave)
+        sort(ordem.begin(), ordem.end(),
+            [&chaves](int a, int b) { return chaves[a] < chaves[b]; });
+
+        if (quantidade > 0)
         {
-            atribuirErro("A chave não foi encontrada");
+            file_ptr_type raiz = constantes::ptrNuloPagina;
+            VersaoFixada versaoLida(this);
+
+            // Sem a trava da raiz nenhuma chave é encontrada e o erro é atribuído
+            // logo abaixo
+            if (travarARaizParaLeitura(raiz))
+            {
+                pesquisarVarios(raiz, chaves, ordem, 0, quantidade,
+                    dados, encontradas, irAteUmaFolha);
+            }
         }
 
-        else
+        if (find(encontradas.begin(), encontradas.end(), false) != encontradas.end())
         {
-            limparErro();
-            dado = paginaFilha->dados[indiceDaChave];
+            atribuirErro("Alguma das chaves não foi encontrada");
         }
 
-        return dado;
+        else limparErro();
+
+        return dados;
     }
 
     /**
@@ -347,29 +2672,45 @@ protected:
      * @return true Caso a chave seja transferida com sucesso.
      * @return false Caso a chave não seja transferida.
      */
-    bool pegarChaveDaPagina(
+    virtual bool pegarChaveDaPagina(
         file_ptr_type enderecoDaPagina, int indiceDeDescida, bool pegarChaveDoFim)
     {
         bool sucesso = false;
 
-        if (carregar(paginaIrma, enderecoDaPagina) &&
-            paginaIrma->tamanho() > numeroDeChavesPorPagina / 2)
+        // A chave do fim vem da irmã da esquerda
+        if (travarIrma(enderecoDaPagina, pegarChaveDoFim) &&
+            carregar(paginaIrma(), enderecoDaPagina) &&
+            paginaIrma()->tamanho() > numeroDeChavesPorPagina / 2)
         {
             int indiceDaChavePai =
                 pegarChaveDoFim ? indiceDeDescida - 1 : indiceDeDescida;
 
-            int indiceNaPaginaIrma = pegarChaveDoFim ? paginaIrma->tamanho() - 1 : 0;
-            int indiceNaPaginaFilha = pegarChaveDoFim ? 0 : paginaFilha->tamanho();
+            int indiceNaPaginaIrma = pegarChaveDoFim ? paginaIrma()->tamanho() - 1 : 0;
+            int indiceNaPaginaFilha = pegarChaveDoFim ? 0 : paginaFilha()->tamanho();
 
-            paginaPai->transferirElementoPara(
-                paginaFilha, indiceNaPaginaFilha, indiceDaChavePai);
+            // Nas páginas internas, a subárvore da irmã que fica junto da filha
+            // passa para ela junto com a chave que desce da pai
+            file_ptr_type ponteiroDaIrma = pegarChaveDoFim ?
+                paginaIrma()->ponteiros[paginaIrma()->tamanho()] :
+                paginaIrma()->ponteiros[0];
 
-            paginaIrma->transferirElementoPara(
-                paginaPai, indiceDaChavePai, indiceNaPaginaIrma,
+            paginaPai()->transferirElementoPara(
+                paginaFilha(), indiceNaPaginaFilha, indiceDaChavePai);
+
+            paginaIrma()->transferirElementoPara(
+                paginaPai(), indiceDaChavePai, indiceNaPaginaIrma,
                 !pegarChaveDoFim, pegarChaveDoFim, false);
 
-            paginaPai->colocarNoArquivo(arquivo);
-            paginaIrma->colocarNoArquivo(arquivo);
+            if (pegarChaveDoFim)
+            {
+                paginaFilha()->ponteiros[1] = paginaFilha()->ponteiros[0];
+                paginaFilha()->ponteiros[0] = ponteiroDaIrma;
+            }
+
+            else paginaFilha()->ponteiros[paginaFilha()->tamanho()] = ponteiroDaIrma;
+
+            salvar(paginaPai());
+            salvar(paginaIrma());
 
             sucesso = true;
         }
@@ -389,12 +2730,12 @@ protected:
     bool pegarChaveEmprestada(int indiceDeDescida)
     {
         bool pegouEmprestado = indiceDeDescida > 0 &&
-            pegarChaveDaPagina(paginaPai->ponteiros[indiceDeDescida - 1],
+            pegarChaveDaPagina(paginaPai()->ponteiros[indiceDeDescida - 1],
                 indiceDeDescida, true);
         
         pegouEmprestado = pegouEmprestado ||
-            indiceDeDescida < paginaPai->tamanho() &&
-            pegarChaveDaPagina(paginaPai->ponteiros[indiceDeDescida + 1],
+            indiceDeDescida < paginaPai()->tamanho() &&
+            pegarChaveDaPagina(paginaPai()->ponteiros[indiceDeDescida + 1],
                 indiceDeDescida, false);
 
         return pegouEmprestado;
@@ -402,7 +2743,8 @@ protected:
 
     /**
      * @brief Funde a paginaFilha com uma de suas irmãs e também com a chave na
-     * página pai.
+     * página pai. Ao final, a paginaFilha tem o resultado da fusão e a página
+     * que ficou vazia é liberada.
      * 
      * @param enderecoDaPagina Endereço da página a ser fundida com a paginaFilha.
      * @param indiceDeDescida Índice do ponteiro na página pai que foi usado para
@@ -418,28 +2760,35 @@ protected:
     {
         bool sucesso = false;
 
-        if (carregar(paginaIrma, enderecoDaPagina))
+        if (travarIrma(enderecoDaPagina, !fundirDireita) &&
+            carregar(paginaIrma(), enderecoDaPagina))
         {
             if (fundirDireita)
             {
-                paginaPai->transferirElementoPara(
-                    paginaFilha, paginaFilha->tamanho(), indiceDeDescida,
+                paginaPai()->transferirElementoPara(
+                    paginaFilha(), paginaFilha()->tamanho(), indiceDeDescida,
                     false, true, false);
                     
-                paginaIrma->transferirTudoPara(paginaFilha);
+                paginaIrma()->transferirTudoPara(paginaFilha());
             }
 
             else
             {
-                paginaPai->transferirElementoPara(
-                    paginaIrma, paginaIrma->tamanho(), indiceDeDescida - 1,
+                paginaPai()->transferirElementoPara(
+                    paginaIrma(), paginaIrma()->tamanho(), indiceDeDescida - 1,
                     false, true, false);
                     
-                paginaFilha->transferirTudoPara(paginaIrma);
+                paginaFilha()->transferirTudoPara(paginaIrma());
+
+                // A paginaFilha sempre fica com o resultado da fusão
+                swap(paginaFilha(), paginaIrma());
             }
 
-            paginaPai->colocarNoArquivo(arquivo);
-            paginaIrma->colocarNoArquivo(arquivo);
+            salvar(paginaPai());
+            salvar(paginaFilha());
+
+            // A página que ficou vazia volta para a lista de páginas livres
+            liberarPagina(paginaIrma());
 
             sucesso = true;
         }
@@ -452,17 +2801,23 @@ protected:
      * 
      * @param indiceDeDescida Índice do ponteiro na página pai que foi usado para
      * chegar na paginaFilha.
+     * 
+     * @return true Caso a fusão tenha acontecido.
+     * @return false Caso a paginaFilha não tenha irmãs ou a única irmã dela
+     * esteja em uso por outra thread.
      */
-    void fundirPaginas(int indiceDeDescida)
+    bool fundirPaginas(int indiceDeDescida)
     {
-        bool fundiu = indiceDeDescida < paginaPai->tamanho() &&
-            fundirCom(paginaPai->ponteiros[indiceDeDescida + 1],
+        bool fundiu = indiceDeDescida < paginaPai()->tamanho() &&
+            fundirCom(paginaPai()->ponteiros[indiceDeDescida + 1],
                 indiceDeDescida, true);
         
         fundiu = fundiu ||
             indiceDeDescida > 0 &&
-            fundirCom(paginaPai->ponteiros[indiceDeDescida - 1],
+            fundirCom(paginaPai()->ponteiros[indiceDeDescida - 1],
                 indiceDeDescida, false);
+
+        return fundiu;
     }
 
     /**
@@ -477,30 +2832,38 @@ protected:
     void trocarChavePorAntecessora(int indiceDaChave,
         list<file_ptr_type>& pilhaDeEnderecos, list<int>& pilhaDeIndices)
     {
-        file_ptr_type enderecoFilha = paginaFilha->ponteiros[indiceDaChave];
+        file_ptr_type enderecoFilha = paginaFilha()->ponteiros[indiceDaChave];
 
-        swap(paginaPai, paginaFilha); // Guarda a página filha na página pai
-        carregar(paginaFilha, enderecoFilha);
+        // As páginas até a folha entram no caminho, então as travas delas ficam
+        // até o fim da exclusão
+        swap(paginaPai(), paginaFilha()); // Guarda a página filha na página pai
+        travarParaEscrita(enderecoFilha);
+        carregar(paginaFilha(), enderecoFilha);
 
         pilhaDeEnderecos.push_back(enderecoFilha);
         pilhaDeIndices.push_back(indiceDaChave);
 
-        while (!paginaFilha->eUmaFolha())
+        while (!paginaFilha()->eUmaFolha())
         {
-            enderecoFilha = paginaFilha->ponteiros[paginaFilha->tamanho() + 1];
-            carregar(paginaFilha, enderecoFilha);
+            // A antecessora está no fim da subárvore, então a descida segue sempre
+            // pelo último ponteiro
+            int indiceDeDescida = paginaFilha()->tamanho();
+
+            enderecoFilha = paginaFilha()->ponteiros[indiceDeDescida];
+            travarParaEscrita(enderecoFilha);
+            carregar(paginaFilha(), enderecoFilha);
 
             pilhaDeEnderecos.push_back(enderecoFilha);
-            pilhaDeIndices.push_back(paginaFilha->tamanho() + 1);
+            pilhaDeIndices.push_back(indiceDeDescida);
         }
 
-        paginaFilha->swap(paginaFilha->tamanho() - 1, paginaPai, indiceDaChave);
+        paginaFilha()->swap(paginaFilha()->tamanho() - 1, paginaPai(), indiceDaChave);
         // Salva as páginas cuja chaves foram trocadas
-        paginaPai->colocarNoArquivo(arquivo);
-        paginaFilha->colocarNoArquivo(arquivo);
+        salvar(paginaPai());
+        salvar(paginaFilha());
 
         pilhaDeEnderecos.pop_back(); // Retira o endereço da filha para recuperar a pai
-        carregar(paginaPai, pilhaDeEnderecos.back()); // Carrega a pai
+        carregar(paginaPai(), pilhaDeEnderecos.back()); // Carrega a pai
         pilhaDeEnderecos.push_back(enderecoFilha); // Volta com o endereço da filha
     }
     
@@ -534,46 +2897,55 @@ protected:
         TIPO_DOS_DADOS dadoExcluido;
         // paginaFilha aponta para a última página carregada na descida da árvore
         // (a página onde a chave foi encontrada ou alguma folha).
-        int indiceDaChave = paginaFilha->obterIndiceDeDescida(chave);
+        int indiceDaChave = paginaFilha()->obterIndiceDeDescida(chave);
 
         // Checa se a chave realmente foi encontrada
-        if (paginaFilha->chaves[indiceDaChave] == chave)
+        if (indiceDaChave < paginaFilha()->tamanho() &&
+            paginaFilha()->chaves[indiceDaChave] == chave)
         {
-            dadoExcluido = paginaFilha->dados[indiceDaChave];
+            dadoExcluido = paginaFilha()->dados[indiceDaChave];
             limparErro();
 
-            if (paginaFilha->eUmaFolha())
+            if (paginaFilha()->eUmaFolha())
             {
-                paginaFilha->excluir(indiceDaChave, false, true);
+                paginaFilha()->excluir(indiceDaChave, false, true);
 
                 // Checa se o tamanho da paginaFilha antes da remoção era <= a 50%
-                if (paginaFilha->tamanho() + 1 <= numeroDeChavesPorPagina / 2)
+                if (paginaFilha()->tamanho() + 1 <= numeroDeChavesPorPagina / 2)
                 {
                     // Obtém o índice do ponteiro na página pai que foi usado para
                     // chegar na paginaFilha
                     int indiceDeDescida = pilhaDeIndices.back();
 
-                    if (!pegarChaveEmprestada(indiceDeDescida))
+                    // Sem empréstimo nem fusão, a folha só fica com menos chaves
+                    if (!pegarChaveEmprestada(indiceDeDescida) &&
+                        fundirPaginas(indiceDeDescida))
                     {
-                        fundirPaginas(indiceDeDescida);
                         pilhaDeEnderecos.pop_back();
                         
-                        while (paginaPai->tamanho() < numeroDeChavesPorPagina / 2
+                        while (paginaPai()->tamanho() < numeroDeChavesPorPagina / 2
                             && pilhaDeEnderecos.size() > 1)
                         {
-                            swap(paginaPai, paginaFilha);
+                            swap(paginaPai(), paginaFilha());
                             pilhaDeIndices.pop_back();
                             pilhaDeEnderecos.pop_back();
-                            carregar(paginaPai, pilhaDeEnderecos.back());
-                            fundirPaginas(pilhaDeIndices.back());
+                            carregar(paginaPai(), pilhaDeEnderecos.back());
+
+                            // Uma página interna também só é fundida quando as
+                            // irmãs não podem emprestar, senão a fusão estoura
+                            if (pegarChaveEmprestada(pilhaDeIndices.back()) ||
+                                !fundirPaginas(pilhaDeIndices.back())) break;
                         }
 
-                        if (pilhaDeEnderecos.size() == 1 && paginaPai->vazia())
-                            trocarRaizPor(paginaFilha);
+                        if (pilhaDeEnderecos.size() == 1 && paginaPai()->vazia())
+                        {
+                            trocarRaizPor(paginaFilha());
+                            liberarPagina(paginaPai()); // A raiz antiga está vazia
+                        }
                     }
                 }
 
-                paginaFilha->colocarNoArquivo(arquivo);
+                salvar(paginaFilha());
             }
 
             else
@@ -633,17 +3005,17 @@ protected:
         int indiceDePromocao, Pagina *paginaDeInsercao,
         bool inseriuNaPaginaFilha, pair<Pagina *, bool> &infoPai)
     {
-        Pagina *paginaDestino = paginaPai;
+        Pagina *paginaDestino = paginaPai();
         int indice = indiceDePromocao;
 
         // Checa se é necessário dividir a página pai antes de promover o par.
-        if (paginaPai->cheia())
+        if (paginaPai()->cheia())
         {
             // Pega a chave do par que será promovido
             TIPO_DAS_CHAVES& chave = inseriuNaPaginaFilha ?
-                paginaFilha->chaves.back() : paginaIrma->chaves[0];
+                paginaFilha()->chaves.back() : paginaIrma()->chaves[0];
 
-            infoPai = dividir(paginaPai, paginaIrmaPai, chave);
+            infoPai = dividir(paginaPai(), paginaIrmaPai(), chave);
             // Pega a página que receberá o elemento promovido
             paginaDestino = infoPai.first;
             // Obtém o índice no qual o par deve ser promovido
@@ -654,13 +3026,31 @@ protected:
 
         paginaDeInsercao->promoverElementoPara(
             paginaDestino, indice, // Promove para o índice
-            paginaFilha,  // Página que estava cheia
-            paginaIrma,   // Página criada
             // Ajuda a saber qual é a posição do elemento que será promovido
             // da paginaDeInsercao.
-            inseriuNaPaginaFilha,
-            arquivo // Arquivo onde as páginas serão colocadas
+            inseriuNaPaginaFilha
         );
+
+        // atualiza as páginas no arquivo
+        salvar(paginaFilha()); // Página que estava cheia
+        salvar(paginaIrma()); // Página criada
+
+        // Quando um elemento é promovido, o ponteiro da esquerda dele deve apontar
+        // para a página que estava cheia (a que provocou a divisão).
+        // Já o ponteiro da direita deve apontar para a nova página (gerada pela
+        // divisão).
+        paginaDestino->ponteiros[indice] = paginaFilha()->obterEndereco();
+        paginaDestino->ponteiros[indice + 1] = paginaIrma()->obterEndereco();
+
+        // O primeiro ponteiro da irmã da pai é uma cópia do último da pai, que
+        // passa a ser o da nova página caso o par tenha entrado no fim da pai. Ele
+        // é o ponteiro à direita do par que a pai promoverá no nível de cima.
+        if (paginaDestino == paginaPai() && infoPai.first != nullptr)
+        {
+            paginaIrmaPai()->ponteiros[0] = paginaPai()->ponteiros.back();
+        }
+
+        salvar(paginaDestino);
     }
 
     /**
@@ -683,7 +3073,7 @@ protected:
         TIPO_DAS_CHAVES &chave, TIPO_DOS_DADOS &dado,
         int indiceDePromocao, pair<Pagina *, bool> &infoPai)
     {
-        auto info = dividir(paginaFilha, paginaIrma, chave);
+        auto info = dividir(paginaFilha(), paginaIrma(), chave);
         Pagina *paginaDeInsercao = info.first;
         bool inserirNaPaginaFilha = info.second;
 
@@ -710,11 +3100,11 @@ protected:
     {
         // Após a função obterCaminhoDeDescida(), paginaFilha aponta para a última
         // página carregada na descida da árvore (alguma folha).
-        int indiceDeInsercao = paginaFilha->obterIndiceDeDescida(chave);
+        int indiceDeInsercao = paginaFilha()->obterIndiceDeDescida(chave);
 
         // Checa se a inserção teve sucesso
-        if (paginaFilha->inserir(chave, dado, indiceDeInsercao))
-            paginaFilha->colocarNoArquivo(arquivo); // Encerra salvando a página
+        if (paginaFilha()->inserir(chave, dado, indiceDeInsercao))
+            salvar(paginaFilha()); // Encerra salvando a página
 
         else // Inserção na página falhou, acontece quando ela está cheia.
         {
@@ -723,9 +3113,19 @@ protected:
             int indiceDePromocao = pilhaDeIndices.back();
 
             pair<Pagina *, bool> infoPai(nullptr, false);
+
+            // A folha é a raiz, então a nova raiz é criada acima dela. A
+            // paginaPai ainda pode ter uma página de outra operação, como a raiz
+            // antiga que uma exclusão esvaziou.
+            if (voltouParaARaiz)
+            {
+                paginaPai()->limpar();
+                paginaPai()->ponteiros.push_back(constantes::ptrNuloPagina);
+            }
+
             tratarPaginaCheia(chave, dado, indiceDePromocao, infoPai);
 
-            if (voltouParaARaiz) trocarRaizPor(paginaPai);
+            if (voltouParaARaiz) trocarRaizPor(paginaPai());
 
             else // Inicia o processo de subida na árvore
             {
@@ -749,22 +3149,22 @@ protected:
                     inseriuNaPaginaAtual = infoPai.second;
 
                     // As páginas que eram pais, na subida da árvore, são filhas
-                    swap(paginaPai, paginaFilha);
-                    swap(paginaIrmaPai, paginaIrma);
+                    swap(paginaPai(), paginaFilha());
+                    swap(paginaIrmaPai(), paginaIrma());
 
                     if (voltouParaARaiz) // Já está na raiz e precisa-se promover
                     {
-                        paginaPai->limpar(); // Cria a nova raiz
-                        paginaPai->ponteiros.push_back(constantes::ptrNuloPagina);
+                        paginaPai()->limpar(); // Cria a nova raiz
+                        paginaPai()->ponteiros.push_back(constantes::ptrNuloPagina);
                     }
 
-                    else carregar(paginaPai, enderecoPaginaPai);
+                    else carregar(paginaPai(), enderecoPaginaPai);
 
                     promoverOParQueEstiverSobrando(
                         indiceDePromocao, paginaDeInsercao,
                         inseriuNaPaginaAtual, infoPai);
 
-                    if (voltouParaARaiz) trocarRaizPor(paginaPai);
+                    if (voltouParaARaiz) trocarRaizPor(paginaPai());
 
                     paginaDeInsercao = infoPai.first;
                 }
@@ -786,7 +3186,8 @@ protected:
      * @param chaveMaior Valor do limite superior.
      * @param dados Referência para um vetor onde os dados relacionados às chaves
      * serão guardados.
-     * @param enderecoPaginaAtual Endereço da página atual na recursividade.
+     * @param enderecoPaginaAtual Endereço da página atual na recursividade. Ela
+     * deve chegar com a trava de leitura de quem chamou, que é solta aqui.
      */
     void listarDadosComAChaveEntre(
         TIPO_DAS_CHAVES &chaveMenor,
@@ -794,29 +3195,34 @@ protected:
         vector<TIPO_DOS_DADOS> &dados,
         file_ptr_type enderecoPaginaAtual)
     {
-        if (carregar(paginaFilha, enderecoPaginaAtual))
+        // Cada nível da recursividade tem a sua página, então a página atual não
+        // precisa ser recarregada depois de cada filha
+        Pagina pagina(ordemDaArvore);
+
+        if (carregar(&pagina, enderecoPaginaAtual))
         {
-            int indiceDeDescida = paginaFilha->obterIndiceDeDescida(chaveMenor);
+            int indiceDeDescida = pagina.obterIndiceDeDescida(chaveMenor);
             int indiceFinal = 
-                upper_bound(paginaFilha->chaves.begin() + indiceDeDescida,
-                    paginaFilha->chaves.end(), chaveMaior)
-                    - paginaFilha->chaves.begin();
+                upper_bound(pagina.chaves.begin() + indiceDeDescida,
+                    pagina.chaves.end(), chaveMaior)
+                    - pagina.chaves.begin();
 
-            if (!paginaFilha->eUmaFolha())
+            if (!pagina.eUmaFolha())
             {
+                // Cada filha é travada enquanto a página atual ainda está travada
+                travarParaLeitura(pagina.ponteiros[indiceDeDescida]);
                 listarDadosComAChaveEntre(
                     chaveMenor, chaveMaior, dados,
-                    paginaFilha->ponteiros[indiceDeDescida]);
+                    pagina.ponteiros[indiceDeDescida]);
 
                 for (int i = indiceDeDescida; i < indiceFinal; i++)
                 {
-                    carregar(paginaFilha, enderecoPaginaAtual);
-
-                    dados.push_back(paginaFilha->dados[i]);
+                    dados.push_back(pagina.dados[i]);
                     
+                    travarParaLeitura(pagina.ponteiros[i + 1]);
                     listarDadosComAChaveEntre(
                         chaveMenor, chaveMaior, dados,
-                        paginaFilha->ponteiros[i + 1]);
+                        pagina.ponteiros[i + 1]);
                 }
             }
 
@@ -824,10 +3230,59 @@ protected:
             {
                 dados.insert(
                     dados.end(),
-                    paginaFilha->dados.begin() + indiceDeDescida,
-                    paginaFilha->dados.begin() + indiceFinal);
+                    pagina.dados.begin() + indiceDeDescida,
+                    pagina.dados.begin() + indiceFinal);
             }
         }
+
+        destravarParaLeitura(enderecoPaginaAtual);
+    }
+
+    /**
+     * @brief Como listarDadosComAChaveEntre(), mas lê as páginas da versão
+     * informada, que deve ter um leitor, e sem travas (veja carregarDaVersao()).
+     * Classes filhas cujas páginas guardam os dados de outra forma devem
+     * sobrescrever este método.
+     * 
+     * @param enderecoPaginaAtual Endereço da página atual na recursividade,
+     * começando pela raiz da versão.
+     */
+    virtual void listarNoInstantaneo(
+        TIPO_DAS_CHAVES &chaveMenor,
+        TIPO_DAS_CHAVES &chaveMaior,
+        vector<TIPO_DOS_DADOS> &dados,
+        file_ptr_type enderecoPaginaAtual,
+        uint64_t versao)
+    {
+        Pagina pagina(ordemDaArvore);
+
+        carregarDaVersao(&pagina, enderecoPaginaAtual, versao);
+
+        int indiceDeDescida = pagina.obterIndiceDeDescida(chaveMenor);
+        int indiceFinal = 
+            upper_bound(pagina.chaves.begin() + indiceDeDescida,
+                pagina.chaves.end(), chaveMaior)
+                - pagina.chaves.begin();
+
+        if (pagina.eUmaFolha())
+        {
+            dados.insert(
+                dados.end(),
+                pagina.dados.begin() + indiceDeDescida,
+                pagina.dados.begin() + indiceFinal);
+
+            return;
+        }
+
+        listarNoInstantaneo(chaveMenor, chaveMaior, dados,
+            pagina.ponteiros[indiceDeDescida], versao);
+
+        for (int i = indiceDeDescida; i < indiceFinal; i++)
+        {
+            dados.push_back(pagina.dados[i]);
+            listarNoInstantaneo(chaveMenor, chaveMaior, dados,
+                pagina.ponteiros[i + 1], versao);
+        }
     }
 
     /**
@@ -840,29 +3295,29 @@ protected:
      */
     void mostrar(file_ptr_type endereco, int altura)
     {
-        if (carregar(paginaFilha, endereco))
+        if (carregar(paginaFilha(), endereco))
         {
             string identacao(altura * 4, ' ');
 
-            if (paginaFilha->eUmaFolha())
+            if (paginaFilha()->eUmaFolha())
             {
                 cout << identacao;
-                paginaFilha->mostrar(cout, false, false, false, "", " ");
+                paginaFilha()->mostrar(cout, false, false, false, "", " ");
                 cout << endl;
             }
 
-            else if (!paginaFilha->ponteiros.empty())
+            else if (!paginaFilha()->ponteiros.empty())
             {
-                int i = paginaFilha->ponteiros.size() - 1;
-                mostrar(paginaFilha->ponteiros[i], altura + 1);
+                int i = paginaFilha()->ponteiros.size() - 1;
+                mostrar(paginaFilha()->ponteiros[i], altura + 1);
 
                 for (i--; i >= 0; i--)
                 {
-                    carregar(paginaFilha, endereco);
+                    carregar(paginaFilha(), endereco);
 
-                    cout << identacao << paginaFilha->chaves[i] << endl;
+                    cout << identacao << paginaFilha()->chaves[i] << endl;
 
-                    mostrar(paginaFilha->ponteiros[i], altura + 1);
+                    mostrar(paginaFilha()->ponteiros[i], altura + 1);
                 }
             }
         }
@@ -895,19 +3350,22 @@ protected:
         string delimitadorEntreODadoEOPonteiro = ") ",
         string delimitadorEntreAChaveEODado = ", ")
     {
-        if (carregar(paginaFilha, endereco))
+        if (carregar(paginaFilha(), endereco))
         {
             cout << endl;
-            paginaFilha->mostrar(
+            paginaFilha()->mostrar(
                 cout, mostrarOsDados, mostrarOsPonteiros, mostrarEndereco,
                 delimitadorEntreOPonteiroEAChave,
                 delimitadorEntreODadoEOPonteiro,
                 delimitadorEntreAChaveEODado);
             cout << endl;
 
-            if (!paginaFilha->eUmaFolha())
+            if (!paginaFilha()->eUmaFolha())
             {
-                auto ponteiros = paginaFilha->ponteiros;
+                // A recursão recarrega a página filha, então os ponteiros são
+                // copiados antes
+                vector<file_ptr_type> ponteiros(
+                    paginaFilha()->ponteiros.begin(), paginaFilha()->ponteiros.end());
 
                 for (auto &&i : ponteiros)
                 {
@@ -926,13 +3384,19 @@ protected:
 
     file_ptr_type lerEnderecoDaRaiz()
     {
-        // Pula as coisas do cabeçalho do arquivo que vierem antes do endereço da raiz
-        arquivo.seekg(tamanhoCabecalhoAntesDoEnderecoDaRaiz);
+        return enderecoDaRaiz;
+    }
 
+    file_ptr_type lerEnderecoDaRaizDoArquivo()
+    {
         file_ptr_type endereco;
-        arquivo >> endereco; // Carrega o endereço da raiz
 
-        if (arquivo.fail())
+        if (copiaNaEscrita) return lerVersaoDoCabecalho().raiz;
+
+        // Pula as coisas do cabeçalho do arquivo que vierem antes do endereço da raiz
+        // e carrega o endereço da raiz
+        if (!arquivo->ler(tamanhoCabecalhoAntesDoEnderecoDaRaiz,
+                (char *) &endereco, sizeof(file_ptr_type)))
         {
             // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
             cerr << "[ArvoreB] Não foi possível ler o endereço da raiz do arquivo."
@@ -947,36 +3411,372 @@ protected:
     }
 
 public:
+    // ------------------------- Tipos
+
+    /**
+     * @brief Versão da árvore que não muda com as inserções e exclusões feitas
+     * depois que ela foi obtida, então ele serve para leituras longas, como
+     * varreduras e cópias de segurança, sem parar as escritas. Ele deve ser
+     * destruído logo depois delas e antes da árvore. Veja obterInstantaneo().
+     * 
+     * <p>Na cópia na escrita, as páginas da versão não são reaproveitadas
+     * enquanto o instantâneo existir. Sem ela, as páginas escritas depois dele
+     * têm a imagem anterior guardada. Em ambos os casos, as operações que
+     * reconstroem a árvore, como compactar() e construirAPartirDe(), lançam uma
+     * exceção enquanto houver instantâneos.</p>
+     */
+    class Instantaneo
+    {
+        // ------------------------- Campos
+
+        ArvoreB *arvore;
+        uint64_t versao;
+        file_ptr_type raiz;
+
+    public:
+        // ------------------------- Construtores e destrutores
+
+        /**
+         * @brief Obtém a versão atual da árvore. Sem a cópia na escrita, espera
+         * as inserções e exclusões em andamento terminarem.
+         */
+        Instantaneo(ArvoreB *arvore) :
+            arvore(arvore),
+            versao(0),
+            raiz(constantes::ptrNuloPagina)
+        {
+            arvore->fixarVersao(versao, raiz);
+        }
+
+        Instantaneo(const Instantaneo &outro) :
+            arvore(outro.arvore),
+            versao(outro.versao),
+            raiz(outro.raiz)
+        {
+            arvore->fixarVersao(versao);
+        }
+
+        Instantaneo &operator=(const Instantaneo &) = delete;
+
+        ~Instantaneo()
+        {
+            arvore->soltarVersao(versao);
+        }
+
+        // ------------------------- Métodos
+
+        uint64_t obterVersao()
+        {
+            return versao;
+        }
+
+        /**
+         * @brief Procura, nesta versão, o primeiro registro com a chave informada,
+         * como ArvoreB::pesquisar().
+         */
+        TIPO_DOS_DADOS pesquisar(TIPO_DAS_CHAVES &chave)
+        {
+            vector<TIPO_DOS_DADOS> dados = listarDadosComAChaveEntre(chave, chave);
+
+            if (dados.empty())
+            {
+                arvore->atribuirErro("A chave não foi encontrada");
+
+                return TIPO_DOS_DADOS();
+            }
+
+            arvore->limparErro();
+
+            return dados.front();
+        }
+
+        TIPO_DOS_DADOS pesquisar(TIPO_DAS_CHAVES &&chave)
+        {
+            return pesquisar(chave);
+        }
+
+        /**
+         * @brief Procura, nesta versão, todos os registros com a chave no
+         * intervalo [chaveMenor, chaveMaior], como
+         * ArvoreB::listarDadosComAChaveEntre().
+         */
+        vector<TIPO_DOS_DADOS> listarDadosComAChaveEntre(
+            TIPO_DAS_CHAVES &chaveMenor,
+            TIPO_DAS_CHAVES &chaveMaior)
+        {
+            vector<TIPO_DOS_DADOS> dados;
+
+            if (chaveMenor <= chaveMaior)
+            {
+                arvore->listarNoInstantaneo(chaveMenor, chaveMaior, dados, raiz, versao);
+            }
+
+            return dados;
+        }
+
+        vector<TIPO_DOS_DADOS> listarDadosComAChaveEntre(
+            TIPO_DAS_CHAVES &&chaveMenor,
+            TIPO_DAS_CHAVES &&chaveMaior)
+        {
+            return listarDadosComAChaveEntre(chaveMenor, chaveMaior);
+        }
+    };
+
     // ------------------------- Construtores e destrutores
 
-    ArvoreB(string nomeDoArquivo, int ordemDaArvore) :
+    /**
+     * @brief Abre (ou cria) a árvore guardada no arquivo informado.
+     * 
+     * @param nomeDoArquivo Nome do arquivo da árvore.
+     * @param ordemDaArvore Ordem da árvore (quantidade máxima de filhos por página).
+     * @param capacidadeDoCache Quantidade máxima de páginas mantidas em memória.
+     * Com 0 (zero), todas as leituras e escritas vão direto ao arquivo.
+     * @param politicaDoCache Política que escolhe qual página sai do cache quando
+     * ele está cheio.
+     * @param tipoDeArmazenamento Forma de acesso ao arquivo: fstream, pread/pwrite,
+     * mmap ou apenas memória (neste caso, nada é escrito no arquivo).
+     * @param politicaDoDiario Quando as confirmações do diário (no arquivo com o
+     * nome da árvore seguido de ".diario") chegam ao disco. Com
+     * PoliticaDoDiario::NENHUM, não há diário. Uma árvore que usava o diário
+     * quando caiu deve ser aberta com ele.
+     * @param modoDeEscrita Como as páginas mudam no arquivo. O cabeçalho da cópia
+     * na escrita é diferente, então um arquivo deve ser sempre aberto no mesmo
+     * modo. Ela não pode ser usada junto com o diário.
+     *
+     * @throw runtime_error Caso o arquivo exista e tenha um formato diferente do
+     * desta árvore.
+     */
+    ArvoreB(string nomeDoArquivo, int ordemDaArvore,
+        int capacidadeDoCache = constantes::capacidadePadraoDoCache,
+        TipoDePolitica politicaDoCache = TipoDePolitica::LRU,
+        TipoDeArmazenamento tipoDeArmazenamento = TipoDeArmazenamento::FSTREAM,
+        PoliticaDoDiario politicaDoDiario = PoliticaDoDiario::NENHUM,
+        ModoDeEscrita modoDeEscrita = ModoDeEscrita::NO_LUGAR) :
+        copiaNaEscrita(modoDeEscrita == ModoDeEscrita::COPIA_NA_ESCRITA),
+        identificador( gerarIdentificador() ),
         nomeDoArquivo(nomeDoArquivo),
         numeroDeChavesPorPagina(ordemDaArvore - 1),
         ordemDaArvore(ordemDaArvore),
-        paginaPai( new Pagina(ordemDaArvore) ),
-        paginaIrmaPai( new Pagina(ordemDaArvore) ),
-        paginaFilha( new Pagina(ordemDaArvore) ),
-        paginaIrma( new Pagina(ordemDaArvore) )
+        capacidadeDoCache(capacidadeDoCache),
+        politicaDoCache(politicaDoCache),
+        tipoDeArmazenamento(tipoDeArmazenamento)
     {
-        abrirArquivo(nomeDoArquivo);
+        if (copiaNaEscrita && politicaDoDiario != PoliticaDoDiario::NENHUM)
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[ArvoreB] A cópia na escrita não pode ser usada com o diário."
+                 << endl << "Exceção lançada" << endl;
+
+            throw invalid_argument(
+                "[ArvoreB] A cópia na escrita não pode ser usada com o diário.");
+        }
+
+        abrirArquivo(nomeDoArquivo, tipoDeArmazenamento);
+        abrirDiario(politicaDoDiario);
 
         obterTamanhoEmBytesDaChaveEDoDado<TIPO_DAS_CHAVES, TIPO_DOS_DADOS>(
             maximoDeBytesParaAChave, maximoDeBytesParaODado
         );
 
         iniciarArquivoCasoNecessario();
+        criarCache();
     }
 
     ~ArvoreB()
     {
-        delete paginaPai;
-        delete paginaIrmaPai;
-        delete paginaFilha;
-        delete paginaIrma;
+        descarregar();
+
+        if (copiaNaEscrita) guardarPaginasLivres();
+
+        delete cache;
+        delete diario;
+        delete arquivo;
+
+        if (arquivoDeImagens != nullptr)
+        {
+            delete arquivoDeImagens;
+            remove((nomeDoArquivo + ".imagens").c_str());
+        }
+
+        for (auto &&par : estadosDasThreads)
+        {
+            EstadoDaThread &estado = par.second;
+
+            delete estado.pai;
+            delete estado.irmaPai;
+            delete estado.filha;
+            delete estado.irma;
+        }
     }
 
     // ------------------------- Métodos
 
+    /**
+     * @brief Escreve no arquivo todas as páginas que foram modificadas e ainda
+     * estão apenas no cache e sincroniza o arquivo com o disco. Com o diário,
+     * faz um ponto de verificação, que também o esvazia. Na cópia na escrita,
+     * grava a versão atual no cabeçalho, que é para onde a árvore volta caso
+     * caia. Também é feito automaticamente no destrutor.
+     */
+    void descarregar()
+    {
+        if (copiaNaEscrita)
+        {
+            lock_guard<mutex> travado(travaDoEscritor);
+
+            gravarVersao();
+        }
+
+        else if (diario != nullptr) fazerPontoDeVerificacao();
+
+        else cache->descarregar();
+    }
+
+    /**
+     * @brief Reescreve a árvore em um arquivo novo e troca o atual por ele. As
+     * páginas livres são descartadas, os níveis internos ficam em ordem de
+     * largura e as folhas ficam no fim, na ordem das chaves. Depois disso, uma
+     * varredura pelas folhas lê o arquivo sequencialmente.
+     * 
+     * O cache de páginas começa vazio (e com as estatísticas zeradas) após a
+     * compactação. Lança uma exceção caso haja instantâneos.
+     */
+    void compactar()
+    {
+        exigirQueNaoHajaInstantaneos();
+        descarregar();
+
+        string nomeTemporario = nomeDoArquivo + ".compactando";
+        ArmazenamentoDePaginas *novoArquivo =
+            criarArmazenamento(tipoDeArmazenamento, nomeTemporario);
+
+        int tamanhoDaPagina = paginaFilha()->obterTamanhoMaximoEmBytes();
+        vector<char> buffer(tamanhoDaPagina);
+        list<file_ptr_type> fila;
+        file_ptr_type proximoEndereco = tamanhoCabecalho;
+        int paginasRestantesNoNivel = 1;
+        bool primeiraDoNivel = true;
+
+        novoArquivo->limpar();
+        escreverCabecalho(*novoArquivo, tamanhoCabecalho);
+
+        // Percorre a árvore em largura. Como todas as folhas estão no mesmo nível,
+        // elas são as últimas a serem visitadas e aparecem na ordem das chaves.
+        fila.push_back(lerEnderecoDaRaiz());
+
+        while (!fila.empty())
+        {
+            cache->lerDoArquivo(paginaFilha(), fila.front());
+            fila.pop_front();
+            paginasRestantesNoNivel--;
+
+            file_ptr_type endereco = paginaFilha()->setEndereco(proximoEndereco);
+            proximoEndereco += tamanhoDaPagina;
+
+            // Cada filha vai para o fim da fila, então o endereço novo dela é o
+            // da posição que ela ocupará no arquivo compactado
+            for (auto &&ponteiro : paginaFilha()->ponteiros)
+            {
+                if (ponteiro != constantes::ptrNuloPagina)
+                {
+                    fila.push_back(ponteiro);
+                    ponteiro = proximoEndereco + (fila.size() - 1) * tamanhoDaPagina;
+                }
+            }
+
+            prepararPaginaCompactada(paginaFilha(),
+                primeiraDoNivel ? constantes::ptrNuloPagina : endereco - tamanhoDaPagina,
+                paginasRestantesNoNivel == 0 ? constantes::ptrNuloPagina : proximoEndereco);
+
+            paginaFilha()->colocarNoArquivo(*novoArquivo, buffer.data());
+
+            // Quando um nível acaba, a fila tem exatamente as páginas do próximo
+            primeiraDoNivel = paginasRestantesNoNivel == 0;
+
+            if (primeiraDoNivel) paginasRestantesNoNivel = fila.size();
+        }
+
+        novoArquivo->sincronizar();
+
+        trocarArquivoPor(novoArquivo, nomeTemporario);
+    }
+
+    /**
+     * @brief Substitui todo o conteúdo da árvore pelos pares (chave, dado) do
+     * intervalo, que podem estar em qualquer ordem e não precisam caber na memória.
+     * Os pares passam antes por uma OrdenacaoExterna, que também os conta, e o
+     * resultado dela preenche as páginas de baixo para cima (veja
+     * construirPorNiveis()), escrevendo cada página uma única vez.
+     * 
+     * @param inicio Iterador para o primeiro par. Os elementos devem ter os campos
+     * first (chave) e second (dado).
+     * @param fim Iterador para depois do último par.
+     * @param orcamentoDeMemoria Quantidade de bytes que a ordenação pode usar. Os
+     * arquivos temporários dela ficam ao lado do arquivo da árvore.
+     * @param fatorDePreenchimento Fração, entre 0 (exclusivo) e 1, do espaço de
+     * cada página que deve ser ocupada. Deixar espaço livre faz com que as
+     * próximas inserções demorem mais para dividir páginas.
+     */
+    template <typename Iterador>
+    void construirAPartirDe(Iterador inicio, Iterador fim,
+        size_t orcamentoDeMemoria = constantes::orcamentoPadraoDaOrdenacao,
+        double fatorDePreenchimento = 1.0)
+    {
+        if (fatorDePreenchimento <= 0 || fatorDePreenchimento > 1)
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[ArvoreB] O fator de preenchimento deve estar entre 0 e 1."
+                 << endl << "Exceção lançada" << endl;
+
+            throw invalid_argument(
+                "[ArvoreB] O fator de preenchimento deve estar entre 0 e 1.");
+        }
+
+        OrdenacaoExterna<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> ordenacao(
+            nomeDoArquivo, orcamentoDeMemoria);
+
+        ordenacao.adicionar(inicio, fim);
+
+        esvaziarArquivo();
+
+        if (ordenacao.obterQuantidade() == 0) return;
+
+        int chavesPorFolha = max(1, (int) round(fatorDePreenchimento * numeroDeChavesPorPagina));
+        int filhasPorPagina = max(2, (int) round(fatorDePreenchimento * ordemDaArvore));
+        vector< vector<int> > niveis =
+            planejarNiveis(ordenacao.obterQuantidade(), chavesPorFolha, filhasPorPagina);
+
+        construirPorNiveis(ordenacao.begin(), ordenacao.end(), niveis);
+    }
+
+    /**
+     * @brief Obtém a versão atual da árvore, que pode ser lida enquanto outras
+     * threads inserem e excluem.
+     */
+    Instantaneo obterInstantaneo()
+    {
+        return Instantaneo(this);
+    }
+
+    /**
+     * @brief Obtém os contadores de acertos, falhas e remoções do cache de páginas.
+     * 
+     * @return EstatisticasDoCache Contadores desde a abertura da árvore ou desde
+     * a última chamada a zerarEstatisticasDoCache().
+     */
+    EstatisticasDoCache obterEstatisticasDoCache()
+    {
+        return cache->obterEstatisticas();
+    }
+
+    /**
+     * @brief Zera os contadores do cache de páginas.
+     */
+    void zerarEstatisticasDoCache()
+    {
+        cache->zerarEstatisticas();
+    }
+
     /**
      * @brief Procura o primeiro registro com a chave informada e pega o dado
      * correspondente a ela.
@@ -1008,6 +3808,31 @@ public:
         return pesquisar(chave);
     }
 
+    /**
+     * @brief Procura várias chaves de uma vez. As chaves são ordenadas e todas
+     * descem juntas pela árvore, então cada página do caminho delas é carregada
+     * uma única vez, não importa quantas chaves passem por ela.
+     * 
+     * @param chaves Chaves a serem procuradas, em qualquer ordem.
+     * @param encontradas Recebe, para cada chave, se ela foi encontrada.
+     * 
+     * @return vector<TIPO_DOS_DADOS> Dado de cada chave, na ordem das chaves
+     * recebidas. Para as chaves que não forem encontradas, o dado é
+     * TIPO_DOS_DADOS() e a flag de erro é ativada, como em pesquisar().
+     */
+    virtual vector<TIPO_DOS_DADOS> pesquisarVarios(
+        vector<TIPO_DAS_CHAVES> &chaves, vector<bool> &encontradas)
+    {
+        return pesquisarVarios(chaves, encontradas, false);
+    }
+
+    vector<TIPO_DOS_DADOS> pesquisarVarios(vector<TIPO_DAS_CHAVES> &chaves)
+    {
+        vector<bool> encontradas;
+
+        return pesquisarVarios(chaves, encontradas);
+    }
+
     /**
      * @brief Procura todos os registros que forem encontrados com a chave entre
      * as chaves informadas. Inclui as próprias chaves. O intervalo é
@@ -1031,8 +3856,13 @@ public:
 
         if (chaveMenor <= chaveMaior)
         {
-            listarDadosComAChaveEntre(
-                chaveMenor, chaveMaior, dados, lerEnderecoDaRaiz());
+            file_ptr_type raiz = constantes::ptrNuloPagina;
+            VersaoFixada versaoLida(this);
+
+            if (travarARaizParaLeitura(raiz))
+            {
+                listarDadosComAChaveEntre(chaveMenor, chaveMaior, dados, raiz);
+            }
         }
 
         return dados;
@@ -1068,16 +3898,19 @@ public:
      * @param chave Chave a ser inserida.
      * @param dado Dado a ser inserido.
      */
-    void inserir(TIPO_DAS_CHAVES& chave, TIPO_DOS_DADOS& dado)
+    virtual void inserir(TIPO_DAS_CHAVES& chave, TIPO_DOS_DADOS& dado)
     {
+        // A maioria das inserções não divide a folha e só precisa da trava dela
+        if (inserirSemDividir(chave, dado)) return;
+
         // Faz todo o percurso de descida na árvore
-        auto parDoCaminho =
-            obterCaminhoDeDescida(chave, 0, lerEnderecoDaRaiz(), true);
+        auto parDoCaminho = obterCaminhoDeDescida(chave, true, true);
 
         auto& pilhaDeEnderecos = parDoCaminho.first;
         auto& pilhaDeIndices = parDoCaminho.second;
 
         inserir(chave, dado, pilhaDeEnderecos, pilhaDeIndices);
+        destravarTudo();
     }
 
     /**
@@ -1091,6 +3924,74 @@ public:
         inserir(chave, dado);
     }
 
+    /**
+     * @brief Insere vários pares (chave, dado) de uma vez. Os pares são ordenados
+     * pela chave e cada descida serve a todas as chaves seguidas que chegariam na
+     * mesma folha: elas são inseridas juntas e a folha é salva uma única vez.
+     * Quando a folha enche, a próxima chave passa pela divisão normal e as
+     * seguintes recomeçam a partir de uma nova descida.
+     * 
+     * @param chaves Chaves dos pares, em qualquer ordem.
+     * @param dados Dados dos pares. dados[i] é o dado de chaves[i].
+     */
+    virtual void inserirVarios(vector<TIPO_DAS_CHAVES> &chaves, vector<TIPO_DOS_DADOS> &dados)
+    {
+        if (chaves.size() != dados.size())
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[ArvoreB] A quantidade de chaves e de dados deve ser a mesma."
+                 << endl << "Exceção lançada" << endl;
+
+            throw invalid_argument(
+                "[ArvoreB] A quantidade de chaves e de dados deve ser a mesma.");
+        }
+
+        int quantidade = chaves.size();
+        vector<int> ordem(quantidade);
+
+        for (int i = 0; i < quantidade; i++) ordem[i] = i;
+
+        // A ordenação estável mantém as chaves iguais na ordem em que chegaram
+        stable_sort(ordem.begin(), ordem.end(),
+            [&chaves](int a, int b) { return chaves[a] < chaves[b]; });
+
+        int i = 0;
+
+        while (i < quantidade)
+        {
+            pair<bool, TIPO_DAS_CHAVES> limiteSuperior(false, TIPO_DAS_CHAVES());
+            auto parDoCaminho = obterCaminhoDeDescida(
+                chaves[ordem[i]], true, true, &limiteSuperior);
+            int inseridas = 0;
+
+            // paginaFilha é a folha onde a primeira chave deve ser inserida
+            while (i < quantidade && !paginaFilha()->cheia() &&
+                (!limiteSuperior.first || !(limiteSuperior.second < chaves[ordem[i]])))
+            {
+                TIPO_DAS_CHAVES &chave = chaves[ordem[i]];
+
+                paginaFilha()->inserir(
+                    chave, dados[ordem[i]], paginaFilha()->obterIndiceDeDescida(chave));
+
+                i++;
+                inseridas++;
+            }
+
+            if (inseridas > 0) salvar(paginaFilha());
+
+            // A folha já estava cheia, então a chave é inserida com divisão
+            else
+            {
+                inserir(chaves[ordem[i]], dados[ordem[i]],
+                    parDoCaminho.first, parDoCaminho.second);
+
+                i++;
+            }
+
+            destravarTudo();
+        }
+    }
+
     /**
      * @brief Exclui o primeiro registro que for encontrado com a chave informada.
      * 
@@ -1113,12 +4014,21 @@ public:
      */
     virtual TIPO_DOS_DADOS excluir(TIPO_DAS_CHAVES& chave)
     {
+        TIPO_DOS_DADOS dadoExcluido = TIPO_DOS_DADOS();
+
+        // A maioria das exclusões não funde a folha e só precisa da trava dela
+        if (excluirSemFundir(chave, false, dadoExcluido)) return dadoExcluido;
+
         // Faz todo o percurso de descida na árvore
-        auto parDoCaminho = obterCaminhoDeDescida(chave, 0, lerEnderecoDaRaiz());
+        auto parDoCaminho = obterCaminhoDeDescida(chave, false);
         auto& pilhaDeEnderecos = parDoCaminho.first;
         auto& pilhaDeIndices = parDoCaminho.second;
 
-        return excluir(chave, pilhaDeEnderecos, pilhaDeIndices);
+        dadoExcluido = excluir(chave, pilhaDeEnderecos, pilhaDeIndices);
+
+        destravarTudo();
+
+        return dadoExcluido;
     }
 
     virtual TIPO_DOS_DADOS excluir(TIPO_DAS_CHAVES&& chave)
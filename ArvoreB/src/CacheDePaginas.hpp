@@ -0,0 +1,1121 @@
+/**
+ * @file CacheDePaginas.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo da classe CacheDePaginas.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include "templates/tipos.hpp"
+#include "helpersArvore.hpp"
+#include "PoliticasDeSubstituicao.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <tuple>
+#include <vector>
+#include <list>
+#include <functional>
+
+using namespace std;
+
+namespace constantes
+{
+    /** Quantidade de páginas que a árvore mantém em memória por padrão. */
+    static const int capacidadePadraoDoCache = 64;
+}
+
+/**
+ * @brief Contadores de uso do cache de páginas.
+ */
+struct EstatisticasDoCache
+{
+    /** Nome da política de substituição em uso. */
+    string politica;
+    /** Leituras atendidas pelo cache. */
+    unsigned long acertos = 0;
+    /** Leituras que precisaram ir ao arquivo. */
+    unsigned long falhas = 0;
+    /** Páginas que saíram do cache para dar lugar a outras. */
+    unsigned long remocoes = 0;
+    /** Páginas sujas escritas no arquivo ao sair do cache. */
+    unsigned long escritasAdiadas = 0;
+    /** Páginas avisadas ao armazenamento antes de serem lidas. */
+    unsigned long preCarregamentos = 0;
+
+    /**
+     * @brief Calcula a proporção de leituras atendidas pelo cache.
+     *
+     * @return double Valor entre 0 e 1.
+     */
+    double taxaDeAcertos()
+    {
+        unsigned long leituras = acertos + falhas;
+
+        return leituras == 0 ? 0 : (double) acertos / leituras;
+    }
+};
+
+ostream &operator<<(ostream &ostream, EstatisticasDoCache estatisticas)
+{
+    return ostream << "[" << estatisticas.politica << "] "
+        << estatisticas.acertos << " acertos, "
+        << estatisticas.falhas << " falhas ("
+        << estatisticas.taxaDeAcertos() * 100 << "%), "
+        << estatisticas.remocoes << " remoções, "
+        << estatisticas.escritasAdiadas << " escritas adiadas, "
+        << estatisticas.preCarregamentos << " pré-carregamentos";
+}
+
+/**
+ * @brief Cache limitado de páginas que fica entre a árvore e o arquivo.
+ *
+ * <p>As páginas são identificadas pelo seu endereço no arquivo. Uma página pode
+ * ser fixada (fixar()) para garantir que ela não seja removida do cache enquanto
+ * estiver em uso, e deve ser desafixada (desafixar()) logo depois. Quando o cache
+ * fica cheio, a política de substituição escolhe uma página não fixada para sair
+ * e, caso ela tenha sido modificada (suja), ela é escrita no arquivo antes.</p>
+ *
+ * <p>Páginas novas (sem endereço ou com endereço além do fim do arquivo) são
+ * escritas imediatamente para que o espaço delas seja reservado no arquivo. As
+ * atualizações das demais páginas só chegam ao arquivo quando elas são removidas
+ * do cache ou quando descarregar() é chamado.</p>
+ *
+ * <p>Com um DiarioDeEscritas, as páginas de uma operação ainda não confirmada
+ * ficam retidas (reter()): não contam na capacidade, não saem do cache e não vão
+ * para o arquivo até soltarRetidas(). Antes de escrever uma página suja, o
+ * cache chama a função de usarAntesDeEscrever(), que garante que a confirmação
+ * dela já está no diário.</p>
+ *
+ * <p>As páginas lidas sem travas pela árvore (copiarSemTravas()) também são
+ * copiadas, em bytes, para um quadro (veja Quadro) com um número de versão
+ * próprio, no estilo de um seqlock. As próximas leituras sem travas copiam o
+ * quadro sem a trava do cache e conferem depois se a versão dele mudou durante
+ * a cópia. Quando a página muda ou sai do cache, o quadro dela é esvaziado.</p>
+ *
+ * @tparam Pagina Tipo das páginas da árvore. <b>É necessário que esse tipo seja
+ * serializável, copiável e tenha um construtor que recebe a ordem da árvore.</b>
+ */
+template <typename Pagina>
+class CacheDePaginas
+{
+    /**
+     * @brief Página guardada no cache com as suas informações de controle.
+     */
+    struct Entrada
+    {
+        Pagina pagina;
+        int fixacoes;
+        bool suja;
+        bool retida;
+        /** Última confirmação do diário que mudou a página, ou 0 (zero). */
+        uint64_t confirmacao;
+
+        Entrada(int ordemDaArvore) :
+            pagina(ordemDaArvore), fixacoes(0), suja(false), retida(false),
+            confirmacao(0) {}
+    };
+
+    /**
+     * @brief Cópia em bytes de uma página do cache, que pode ser lida sem a trava
+     * do cache. A versão é ímpar enquanto o quadro está sendo escrito e muda a
+     * cada escrita, então quem lê confere se ela era par e continuou a mesma.
+     * Os bytes ficam em bytesDosQuadros.
+     */
+    struct alignas(64) Quadro
+    {
+        atomic<uint64_t> versao{0};
+        atomic<file_ptr_type> endereco{constantes::ptrNuloPagina};
+        /** Indica que a página foi lida sem a trava e a política ainda não sabe. */
+        atomic<bool> acessada{false};
+    };
+
+    /** Contador de uma parte das threads, numa linha de cache só dele. */
+    struct alignas(64) Contador
+    {
+        atomic<unsigned long> valor{0};
+    };
+
+    // ------------------------- Campos
+
+    ArmazenamentoDePaginas &arquivo;
+    int ordemDaArvore;
+    int capacidade;
+    file_ptr_type tamanhoDoArquivo;
+
+    /** Quantidade de bytes de cada página no arquivo. */
+    int tamanhoDaPagina;
+
+    /**
+     * Buffer reaproveitado em todas as escritas de páginas no arquivo. Cada página
+     * é montada nele e escrita de uma só vez.
+     */
+    vector<char> bufferDeEscrita;
+
+    unordered_map<file_ptr_type, Entrada> entradas;
+
+    /** Quantidade de entradas retidas, que ficam além da capacidade. */
+    int retidas = 0;
+
+    /**
+     * Quadros das páginas do cache. Cada endereço tem um único quadro possível,
+     * escolhido por indiceDoQuadro(), e é só nele que a página é procurada. A
+     * quantidade é uma potência de 2 maior ou igual à capacidade, ou 0 (zero)
+     * com o cache desabilitado.
+     */
+    vector<Quadro> quadros;
+
+    /**
+     * Bytes das páginas dos quadros, em palavras de 8 bytes. Elas são atômicas
+     * para que uma cópia feita durante uma escrita leia valores misturados em vez
+     * de ser uma disputa de dados; a versão do quadro descarta essas cópias.
+     */
+    vector< atomic<uint64_t> > bytesDosQuadros;
+
+    /** Quantidade de palavras de bytesDosQuadros ocupadas por uma página. */
+    int palavrasPorPagina;
+
+    /** Buffer onde as páginas são montadas antes de irem para o quadro delas. */
+    vector<char> bufferDoQuadro;
+
+    /**
+     * Quantidade de quadros marcados como acessados desde que a política foi
+     * avisada pela última vez (veja avisarAcessosSemTravas()). É só uma dica: o
+     * valor pode passar da quantidade real.
+     */
+    atomic<int> acessosPendentes{0};
+
+    /**
+     * Acertos das leituras sem travas, espalhados em vários contadores para que
+     * as threads não disputem a mesma linha de cache.
+     */
+    Contador acertosSemTravas[16];
+
+    /**
+     * Chamada antes de páginas sujas serem escritas no arquivo, com a maior
+     * confirmação delas.
+     */
+    function<void(uint64_t)> antesDeEscrever;
+
+    PoliticaDeSubstituicao *politica;
+    EstatisticasDoCache estatisticas;
+
+    /**
+     * Protege as entradas, a política e as estatísticas. Com ela, várias threads
+     * podem usar o cache ao mesmo tempo. Quem altera uma página deve ter a trava
+     * de escrita dela (veja TabelaDeTravas), e quem a lê, a de leitura.
+     */
+    mutex trava;
+
+    // ------------------------- Métodos
+
+    /**
+     * @brief Obtém a posição do quadro onde a página do endereço informado pode
+     * estar. Só deve ser chamado quando há quadros.
+     */
+    size_t indiceDoQuadro(file_ptr_type endereco)
+    {
+        // Os endereços são múltiplos do tamanho da página, então eles são
+        // espalhados por uma multiplicação antes de serem reduzidos
+        return ((uint64_t) endereco * 11400714819323198485ull >> 32) & (quadros.size() - 1);
+    }
+
+    /**
+     * @brief Copia a página de uma entrada para o quadro dela, tirando de lá a
+     * que estiver no mesmo quadro. Deve ser chamado com a trava do cache.
+     *
+     * @param pagina Página com endereço.
+     */
+    void publicar(Pagina &pagina)
+    {
+        if (quadros.empty()) return;
+
+        file_ptr_type endereco = pagina.obterEndereco();
+        size_t indice = indiceDoQuadro(endereco);
+        Quadro &quadro = quadros[indice];
+        atomic<uint64_t> *palavras = &bytesDosQuadros[indice * palavrasPorPagina];
+
+        pagina.escreverBytes(bufferDoQuadro.data(), bufferDoQuadro.size());
+
+        // Só a thread com a trava do cache escreve nos quadros
+        uint64_t versao = quadro.versao.load(memory_order_relaxed);
+        quadro.versao.store(versao + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        for (int i = 0; i < palavrasPorPagina; i++)
+        {
+            uint64_t palavra;
+
+            memcpy(&palavra, bufferDoQuadro.data() + i * sizeof(palavra), sizeof(palavra));
+            palavras[i].store(palavra, memory_order_relaxed);
+        }
+
+        quadro.endereco.store(endereco, memory_order_relaxed);
+        quadro.acessada.store(false, memory_order_relaxed);
+        quadro.versao.store(versao + 2, memory_order_release);
+    }
+
+    /**
+     * @brief Esvazia o quadro da página do endereço informado, caso ela esteja
+     * nele. Deve ser chamado com a trava do cache sempre que a página de uma
+     * entrada mudar ou a entrada sair, para que o quadro nunca tenha uma versão
+     * diferente da entrada.
+     *
+     * @param endereco Endereço da página.
+     */
+    void retirarDoQuadro(file_ptr_type endereco)
+    {
+        if (quadros.empty()) return;
+
+        Quadro &quadro = quadros[indiceDoQuadro(endereco)];
+
+        if (quadro.endereco.load(memory_order_relaxed) != endereco) return;
+
+        uint64_t versao = quadro.versao.load(memory_order_relaxed);
+        quadro.versao.store(versao + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        quadro.endereco.store(constantes::ptrNuloPagina, memory_order_relaxed);
+        quadro.acessada.store(false, memory_order_relaxed);
+        quadro.versao.store(versao + 2, memory_order_release);
+    }
+
+    /**
+     * @brief Copia a página do endereço informado do quadro dela, sem a trava do
+     * cache. O acesso fica marcado no quadro para que a política seja avisada
+     * depois (veja avisarAcessosSemTravas()).
+     *
+     * @return true Caso a página estivesse no quadro e não tenha mudado durante
+     * a cópia.
+     * @return false Caso contrário.
+     */
+    bool copiarDoQuadro(file_ptr_type endereco, Pagina *destino)
+    {
+        size_t indice = indiceDoQuadro(endereco);
+        Quadro &quadro = quadros[indice];
+        atomic<uint64_t> *palavras = &bytesDosQuadros[indice * palavrasPorPagina];
+
+        uint64_t versao = quadro.versao.load(memory_order_acquire);
+
+        if ((versao & 1) != 0 || quadro.endereco.load(memory_order_relaxed) != endereco)
+        {
+            return false;
+        }
+
+        static thread_local vector<uint64_t> copia;
+        copia.resize(palavrasPorPagina);
+
+        for (int i = 0; i < palavrasPorPagina; i++)
+        {
+            copia[i] = palavras[i].load(memory_order_relaxed);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+
+        if (quadro.versao.load(memory_order_relaxed) != versao) return false;
+
+        // A versão não mudou, então os bytes são de uma única escrita da página
+        destino->limpar();
+        destino->setEndereco(endereco);
+        destino->lerBytesDiretamente(reinterpret_cast<const tipo_byte *>(copia.data()));
+
+        if (!quadro.acessada.load(memory_order_relaxed) &&
+            !quadro.acessada.exchange(true, memory_order_relaxed))
+        {
+            acessosPendentes.fetch_add(1, memory_order_relaxed);
+        }
+
+        acertosSemTravas[indiceDaThread() % 16].valor.fetch_add(1, memory_order_relaxed);
+
+        return true;
+    }
+
+    /**
+     * @brief Obtém um número fixo para a thread atual, que escolhe o contador
+     * dela em acertosSemTravas.
+     */
+    static unsigned indiceDaThread()
+    {
+        static atomic<unsigned> proximo{0};
+        static thread_local unsigned indice = proximo.fetch_add(1, memory_order_relaxed);
+
+        return indice;
+    }
+
+    /**
+     * @brief Avisa a política de substituição dos acessos feitos pelas leituras
+     * sem travas desde o último aviso. Eles só importam para a escolha de uma
+     * vítima, então o aviso é adiado até lá. Deve ser chamado com a trava do
+     * cache.
+     */
+    void avisarAcessosSemTravas()
+    {
+        if (acessosPendentes.exchange(0, memory_order_relaxed) == 0) return;
+
+        for (Quadro &quadro : quadros)
+        {
+            if (!quadro.acessada.load(memory_order_relaxed) ||
+                !quadro.acessada.exchange(false, memory_order_relaxed))
+            {
+                continue;
+            }
+
+            file_ptr_type endereco = quadro.endereco.load(memory_order_relaxed);
+
+            if (entradas.count(endereco) > 0) politica->registrarAcesso(endereco, false);
+        }
+    }
+
+    /**
+     * @brief Escreve a página no arquivo e atualiza o tamanho conhecido do arquivo.
+     *
+     * @param pagina Página a ser escrita.
+     */
+    void escreverNoArquivo(Pagina *pagina)
+    {
+        file_ptr_type endereco =
+            pagina->colocarNoArquivo(arquivo, bufferDeEscrita.data());
+        file_ptr_type fimDaPagina = endereco + pagina->obterTamanhoMaximoEmBytes();
+
+        if (fimDaPagina > tamanhoDoArquivo) tamanhoDoArquivo = fimDaPagina;
+    }
+
+    /**
+     * @brief Remove do cache a página não fixada nem retida escolhida pela
+     * política de substituição. Caso ela esteja suja, ela é escrita no arquivo
+     * antes.
+     */
+    void removerVitima()
+    {
+        avisarAcessosSemTravas();
+
+        file_ptr_type endereco = politica->escolherVitima(
+            [this](file_ptr_type endereco) {
+                Entrada &entrada = entradas.at(endereco);
+
+                return entrada.fixacoes == 0 && !entrada.retida;
+            });
+
+        if (endereco != constantes::ptrNuloPagina)
+        {
+            Entrada &entrada = entradas.at(endereco);
+
+            if (entrada.suja)
+            {
+                if (antesDeEscrever && entrada.confirmacao != 0)
+                {
+                    antesDeEscrever(entrada.confirmacao);
+                }
+
+                escreverNoArquivo(&entrada.pagina);
+                estatisticas.escritasAdiadas++;
+            }
+
+            entradas.erase(endereco);
+            retirarDoQuadro(endereco);
+            estatisticas.remocoes++;
+
+            return;
+        }
+
+        // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+        cerr << "[CacheDePaginas] Todas as páginas do cache estão fixadas."
+             << endl << "Exceção lançada" << endl;
+
+        throw overflow_error("[CacheDePaginas] Todas as páginas do cache estão fixadas.");
+    }
+
+    /**
+     * @brief Obtém a entrada da página no endereço informado, criando-a caso ela
+     * não esteja no cache. O acesso é registrado na política de substituição.
+     *
+     * @param endereco Endereço da página.
+     * @param sequencial Indica se o acesso faz parte de uma varredura.
+     * @param criada Recebe true caso a entrada tenha sido criada agora.
+     *
+     * @return Entrada& Entrada da página.
+     */
+    Entrada &obterEntrada(file_ptr_type endereco, bool sequencial, bool &criada)
+    {
+        auto iterador = entradas.find(endereco);
+        criada = iterador == entradas.end();
+
+        if (criada)
+        {
+            if ((int) entradas.size() - retidas >= capacidade) removerVitima();
+
+            iterador = entradas.emplace(
+                piecewise_construct,
+                forward_as_tuple(endereco),
+                forward_as_tuple(ordemDaArvore)).first;
+
+            politica->registrarInsercao(endereco, sequencial);
+        }
+
+        else politica->registrarAcesso(endereco, sequencial);
+
+        return iterador->second;
+    }
+
+public:
+    // ------------------------- Construtores
+
+    /**
+     * @brief Constrói um novo cache de páginas.
+     *
+     * @param arquivo Armazenamento de onde as páginas são lidas e onde são escritas.
+     * @param ordemDaArvore Ordem da árvore dona das páginas.
+     * @param capacidade Quantidade máxima de páginas em memória. Com 0 (zero), o
+     * cache fica desabilitado e todas as leituras e escritas vão direto ao arquivo.
+     * @param tipoDaPolitica Política que escolhe qual página sai quando o cache
+     * está cheio.
+     */
+    CacheDePaginas(ArmazenamentoDePaginas &arquivo, int ordemDaArvore, int capacidade,
+        TipoDePolitica tipoDaPolitica = TipoDePolitica::LRU) :
+        arquivo(arquivo),
+        ordemDaArvore(ordemDaArvore),
+        capacidade(capacidade > 0 ? capacidade : 0),
+        tamanhoDoArquivo(arquivo.tamanho()),
+        politica( criarPolitica(tipoDaPolitica, capacidade) )
+    {
+        entradas.reserve(this->capacidade);
+        estatisticas.politica = politica->nome();
+
+        tamanhoDaPagina = Pagina(ordemDaArvore).obterTamanhoMaximoEmBytes();
+        bufferDeEscrita.resize(tamanhoDaPagina);
+
+        palavrasPorPagina = (tamanhoDaPagina + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        bufferDoQuadro.resize(palavrasPorPagina * sizeof(uint64_t));
+
+        if (habilitado())
+        {
+            size_t quantidadeDeQuadros = 1;
+
+            while (quantidadeDeQuadros < (size_t) this->capacidade) quantidadeDeQuadros *= 2;
+
+            quadros = vector<Quadro>(quantidadeDeQuadros);
+            bytesDosQuadros = vector< atomic<uint64_t> >(quantidadeDeQuadros * palavrasPorPagina);
+        }
+    }
+
+    ~CacheDePaginas()
+    {
+        delete politica;
+    }
+
+    // ------------------------- Métodos
+
+    /**
+     * @brief Checa se o cache guarda páginas.
+     *
+     * @return true Caso a capacidade do cache seja maior que zero.
+     * @return false Caso o cache esteja desabilitado.
+     */
+    bool habilitado()
+    {
+        return capacidade > 0;
+    }
+
+    /**
+     * @brief Obtém os contadores de uso do cache.
+     *
+     * @return EstatisticasDoCache Cópia dos contadores atuais.
+     */
+    EstatisticasDoCache obterEstatisticas()
+    {
+        lock_guard<mutex> travado(trava);
+
+        EstatisticasDoCache copia = estatisticas;
+
+        for (Contador &contador : acertosSemTravas)
+        {
+            copia.acertos += contador.valor.load(memory_order_relaxed);
+        }
+
+        return copia;
+    }
+
+    /**
+     * @brief Zera os contadores de uso do cache.
+     */
+    void zerarEstatisticas()
+    {
+        lock_guard<mutex> travado(trava);
+
+        estatisticas = EstatisticasDoCache();
+        estatisticas.politica = politica->nome();
+
+        for (Contador &contador : acertosSemTravas)
+        {
+            contador.valor.store(0, memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Obtém os bytes da página no endereço informado direto do arquivo.
+     *
+     * @return const char* Bytes da página, ou nullptr caso ela não possa ser
+     * lida. Com mmap, eles ficam no arquivo mapeado; nos outros casos, num
+     * buffer da thread, que é reaproveitado na próxima leitura dela.
+     */
+    const char *obterBytesDoArquivo(file_ptr_type endereco)
+    {
+        int tamanho = tamanhoDaPagina;
+
+        // Cada thread reaproveita o seu buffer em todas as leituras, então leituras
+        // simultâneas não se misturam
+        static thread_local vector<char> bufferDeLeitura;
+        bufferDeLeitura.resize(tamanho);
+
+        // Com mmap, a página é decodificada direto do arquivo mapeado
+        const char *bytes = arquivo.acessarParaLeitura(endereco, tamanho);
+
+        if (bytes == nullptr && arquivo.ler(endereco, bufferDeLeitura.data(), tamanho))
+        {
+            bytes = bufferDeLeitura.data();
+        }
+
+        return bytes;
+    }
+
+    /**
+     * @brief Vai para o endereço informado e lê a página do arquivo sem passar
+     * pelo cache.
+     *
+     * @param pagina Página destino.
+     * @param endereco Endereço da página no arquivo.
+     */
+    void lerDoArquivo(Pagina *pagina, file_ptr_type endereco)
+    {
+        pagina->limpar();
+        pagina->setEndereco(endereco);
+
+        const char *bytes = obterBytesDoArquivo(endereco);
+
+        if (bytes == nullptr)
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[ArvoreB] Não foi possível ler a página do arquivo."
+                 << endl << "Exceção lançada" << endl;
+
+            throw length_error("[ArvoreB] Não foi possível ler a página do arquivo.");
+        }
+
+        // Interpreta os bytes e restaura a página sem cópias intermediárias
+        pagina->lerBytesDiretamente(reinterpret_cast<const tipo_byte *>(bytes));
+    }
+
+    /**
+     * @brief Fixa a página do endereço informado no cache, lendo-a do arquivo caso
+     * ela ainda não esteja lá. Enquanto estiver fixada, a página não é removida e
+     * o ponteiro retornado continua válido.
+     *
+     * <p>Cada chamada a fixar() deve ser acompanhada de uma chamada a
+     * desafixar().</p>
+     *
+     * @param endereco Endereço da página no arquivo.
+     * @param sequencial Indica se o acesso faz parte de uma varredura, para que
+     * a política de substituição não dê prioridade à página por causa dele.
+     *
+     * @return Pagina* Ponteiro para a página dentro do cache.
+     */
+    Pagina *fixar(file_ptr_type endereco, bool sequencial = false)
+    {
+        lock_guard<mutex> travado(trava);
+
+        bool criada;
+        Entrada &entrada = obterEntrada(endereco, sequencial, criada);
+
+        if (criada)
+        {
+            estatisticas.falhas++;
+
+            try
+            {
+                lerDoArquivo(&entrada.pagina, endereco);
+            }
+
+            catch (...)
+            {
+                // Não deixa uma página incompleta no cache
+                politica->registrarRemocao(endereco);
+                entradas.erase(endereco);
+
+                throw;
+            }
+        }
+
+        else estatisticas.acertos++;
+
+        entrada.fixacoes++;
+
+        return &entrada.pagina;
+    }
+
+    /**
+     * @brief Copia a página do endereço informado para o destino, lendo-a do
+     * arquivo caso ela ainda não esteja no cache. Pode ser chamado por várias
+     * threads ao mesmo tempo, desde que a página esteja com a trava de leitura
+     * ou de escrita de quem chama (veja TabelaDeTravas).
+     *
+     * <p>Quando o armazenamento permite (veja
+     * ArmazenamentoDePaginas::permiteLerDuranteEscritas()), a leitura do arquivo é
+     * feita sem a trava do cache, para que as outras threads continuem sendo
+     * atendidas enquanto ela acontece.</p>
+     *
+     * @param endereco Endereço da página no arquivo.
+     * @param destino Página que recebe a cópia.
+     * @param sequencial Indica se o acesso faz parte de uma varredura.
+     */
+    void copiarPagina(file_ptr_type endereco, Pagina *destino, bool sequencial = false)
+    {
+        unique_lock<mutex> travado(trava);
+
+        // Mesmo desabilitado, o cache guarda as páginas retidas
+        if (habilitado() || retidas > 0)
+        {
+            auto iterador = entradas.find(endereco);
+
+            if (iterador != entradas.end())
+            {
+                if (habilitado()) politica->registrarAcesso(endereco, sequencial);
+                estatisticas.acertos++;
+                *destino = iterador->second.pagina;
+
+                return;
+            }
+        }
+
+        if (arquivo.permiteLerDuranteEscritas()) travado.unlock();
+
+        lerDoArquivo(destino, endereco);
+
+        if (!habilitado()) return;
+
+        if (!travado.owns_lock()) travado.lock();
+
+        bool criada;
+        Entrada &entrada = obterEntrada(endereco, sequencial, criada);
+
+        // Outra thread pode ter trazido a mesma página enquanto ela era lida
+        if (criada) entrada.pagina = *destino;
+
+        estatisticas.falhas++;
+    }
+
+    /**
+     * @brief Copia a página do endereço informado para uma leitura sem travas da
+     * árvore, que confere depois se a página mudou durante a cópia. Como quem
+     * chama não tem a trava da página, ela pode ter sido liberada, e os bytes
+     * lidos podem nem ser de uma página. A cópia não muda o cache.
+     *
+     * <p>A página é procurada primeiro no quadro dela, sem a trava do cache.
+     * Fora dos quadros, ela é copiada com a trava, da entrada dela ou do arquivo.
+     * Como o cache só escreve páginas no arquivo com a trava, a leitura não
+     * mistura duas versões de uma página do cache.</p>
+     *
+     * @param endereco Endereço da página no arquivo.
+     * @param destino Página que recebe a cópia.
+     *
+     * @return true Caso a cópia tenha sido feita.
+     * @return false Caso a página não possa ser copiada sem a trava dela. A
+     * leitura deve ser refeita com as travas.
+     */
+    bool copiarSemTravas(file_ptr_type endereco, Pagina *destino)
+    {
+        if (!quadros.empty() && endereco >= 0 && copiarDoQuadro(endereco, destino))
+        {
+            return true;
+        }
+
+        lock_guard<mutex> travado(trava);
+
+        if (habilitado() || retidas > 0)
+        {
+            auto iterador = entradas.find(endereco);
+
+            if (iterador != entradas.end())
+            {
+                estatisticas.acertos++;
+                *destino = iterador->second.pagina;
+
+                // As próximas cópias da página podem ser feitas sem a trava
+                publicar(iterador->second.pagina);
+
+                return true;
+            }
+        }
+
+        if (endereco < 0) return false;
+
+        const char *bytes = obterBytesDoArquivo(endereco);
+
+        destino->limpar();
+        destino->setEndereco(endereco);
+
+        return bytes != nullptr && destino->lerBytesDaCopiaSemTravas(
+            reinterpret_cast<const tipo_byte *>(bytes));
+    }
+
+    /**
+     * @brief Traz para o cache, num único lote de leituras, as páginas dos
+     * endereços informados que ainda não estão nele. Com um armazenamento
+     * assíncrono, as leituras ficam em andamento ao mesmo tempo.
+     *
+     * <p>Para que as páginas do lote não tirem umas às outras do cache, no máximo
+     * um quarto da capacidade é lido; o resto é lido normalmente quando for
+     * usado. Páginas que não puderem ser lidas são ignoradas.</p>
+     *
+     * @param enderecos Endereços das páginas no arquivo.
+     * @param sequencial Indica se o acesso faz parte de uma varredura.
+     */
+    void carregarVarias(vector<file_ptr_type> enderecos, bool sequencial = false)
+    {
+        int tamanho = tamanhoDaPagina;
+        size_t maximo = capacidade / 4;
+        vector<OperacaoDeES> operacoes;
+
+        sort(enderecos.begin(), enderecos.end());
+        enderecos.erase(unique(enderecos.begin(), enderecos.end()), enderecos.end());
+
+        unique_lock<mutex> travado(trava);
+
+        for (file_ptr_type endereco : enderecos)
+        {
+            if (operacoes.size() == maximo) break;
+
+            if (endereco >= 0 && entradas.count(endereco) == 0)
+            {
+                operacoes.push_back( OperacaoDeES{ false, -1, endereco, nullptr, tamanho, false } );
+            }
+        }
+
+        // Os buffers só são apontados depois que o vetor de operações parou de crescer
+        vector<char> bytes(operacoes.size() * tamanho);
+
+        for (size_t i = 0; i < operacoes.size(); i++)
+        {
+            operacoes[i].buffer = bytes.data() + i * tamanho;
+        }
+
+        // As leituras são feitas sem a trava quando possível, como em copiarPagina()
+        if (arquivo.permiteLerDuranteEscritas()) travado.unlock();
+
+        arquivo.executarEmLote(operacoes);
+
+        if (!travado.owns_lock()) travado.lock();
+
+        for (OperacaoDeES &operacao : operacoes)
+        {
+            if (!operacao.sucesso) continue;
+
+            bool criada;
+            Entrada &entrada = obterEntrada(operacao.endereco, sequencial, criada);
+
+            if (criada)
+            {
+                entrada.pagina.limpar();
+                entrada.pagina.setEndereco(operacao.endereco);
+                entrada.pagina.lerBytesDiretamente(
+                    reinterpret_cast<const tipo_byte *>(operacao.buffer));
+
+                estatisticas.falhas++;
+            }
+        }
+    }
+
+    /**
+     * @brief Avisa o armazenamento que as páginas dos endereços informados serão
+     * lidas em breve, para que a leitura delas aconteça em segundo plano. As que
+     * já estão no cache são ignoradas e as que ficam lado a lado no arquivo são
+     * avisadas juntas, com um único aviso. As páginas não entram no cache.
+     *
+     * @param enderecos Endereços das páginas no arquivo.
+     */
+    void preCarregar(vector<file_ptr_type> enderecos)
+    {
+        lock_guard<mutex> travado(trava);
+
+        int tamanho = tamanhoDaPagina;
+        file_ptr_type inicio = constantes::ptrNuloPagina;
+        file_ptr_type fim = constantes::ptrNuloPagina;
+
+        sort(enderecos.begin(), enderecos.end());
+
+        for (file_ptr_type endereco : enderecos)
+        {
+            if (endereco < 0 || entradas.count(endereco) > 0) continue;
+
+            // Uma página que não continua o intervalo atual começa outro
+            if (endereco > fim)
+            {
+                if (inicio != constantes::ptrNuloPagina) arquivo.preCarregar(inicio, fim - inicio);
+
+                inicio = endereco;
+            }
+
+            fim = max(fim, endereco + tamanho);
+            estatisticas.preCarregamentos++;
+        }
+
+        if (inicio != constantes::ptrNuloPagina) arquivo.preCarregar(inicio, fim - inicio);
+    }
+
+    /**
+     * @brief Libera uma fixação da página. Caso ela tenha sido modificada pelo
+     * ponteiro obtido em fixar(), informe com o parâmetro @p suja.
+     *
+     * @param endereco Endereço da página no arquivo.
+     * @param suja Indica se a página foi modificada enquanto estava fixada.
+     */
+    void desafixar(file_ptr_type endereco, bool suja = false)
+    {
+        lock_guard<mutex> travado(trava);
+
+        auto iterador = entradas.find(endereco);
+
+        if (iterador != entradas.end())
+        {
+            Entrada &entrada = iterador->second;
+
+            if (entrada.fixacoes > 0) entrada.fixacoes--;
+
+            entrada.suja = entrada.suja || suja;
+
+            if (suja) retirarDoQuadro(endereco);
+        }
+    }
+
+    /**
+     * @brief Tira a página do cache sem escrevê-la no arquivo. Usado quando a
+     * página deixa de fazer parte da árvore.
+     *
+     * @param endereco Endereço da página.
+     */
+    void descartar(file_ptr_type endereco)
+    {
+        lock_guard<mutex> travado(trava);
+
+        auto iterador = entradas.find(endereco);
+
+        if (iterador != entradas.end())
+        {
+            if (iterador->second.retida) retidas--;
+
+            entradas.erase(iterador);
+            retirarDoQuadro(endereco);
+
+            if (habilitado()) politica->registrarRemocao(endereco);
+        }
+    }
+
+    /**
+     * @brief Define a função chamada, com a trava do cache, antes de páginas
+     * sujas serem escritas no arquivo. Ela recebe a maior confirmação
+     * (soltarRetidas()) entre as das páginas.
+     */
+    void usarAntesDeEscrever(function<void(uint64_t)> funcao)
+    {
+        lock_guard<mutex> travado(trava);
+
+        antesDeEscrever = funcao;
+    }
+
+    /**
+     * @brief Guarda uma cópia da página no cache até soltarRetidas(), mesmo com o
+     * cache desabilitado. Páginas sem endereço recebem um, mas também não são
+     * escritas.
+     *
+     * @param pagina Página a ser guardada.
+     *
+     * @return file_ptr_type Endereço da página.
+     */
+    file_ptr_type reter(Pagina *pagina)
+    {
+        lock_guard<mutex> travado(trava);
+
+        if (pagina->obterEndereco() == constantes::ptrNuloPagina)
+        {
+            pagina->setEndereco( arquivo.alocarPagina(tamanhoDaPagina) );
+        }
+
+        file_ptr_type endereco = pagina->obterEndereco();
+        auto iterador = entradas.find(endereco);
+
+        if (iterador == entradas.end())
+        {
+            iterador = entradas.emplace(
+                piecewise_construct,
+                forward_as_tuple(endereco),
+                forward_as_tuple(ordemDaArvore)).first;
+
+            if (habilitado()) politica->registrarInsercao(endereco, false);
+        }
+
+        else if (habilitado()) politica->registrarAcesso(endereco, false);
+
+        Entrada &entrada = iterador->second;
+
+        if (!entrada.retida) retidas++;
+
+        entrada.pagina = *pagina;
+        entrada.suja = true;
+        entrada.retida = true;
+
+        retirarDoQuadro(endereco);
+
+        return endereco;
+    }
+
+    /**
+     * @brief Obtém os bytes de uma página retida, como ficariam no arquivo.
+     *
+     * @param endereco Endereço da página.
+     */
+    vector<char> obterBytesDaRetida(file_ptr_type endereco)
+    {
+        lock_guard<mutex> travado(trava);
+
+        vector<char> bytes(tamanhoDaPagina);
+        entradas.at(endereco).pagina.escreverBytes(bytes.data(), tamanhoDaPagina);
+
+        return bytes;
+    }
+
+    /**
+     * @brief Deixa de reter as páginas informadas, que passam a ser páginas sujas
+     * comuns. Com o cache desabilitado, elas são escritas no arquivo agora. Caso
+     * contrário, as que passarem da capacidade saem do cache.
+     *
+     * @param enderecos Endereços das páginas retidas.
+     * @param confirmacao Confirmação do diário que tem as páginas.
+     */
+    void soltarRetidas(list<file_ptr_type> &enderecos, uint64_t confirmacao)
+    {
+        lock_guard<mutex> travado(trava);
+
+        if (!habilitado() && !enderecos.empty() && antesDeEscrever)
+        {
+            antesDeEscrever(confirmacao);
+        }
+
+        for (file_ptr_type endereco : enderecos)
+        {
+            auto iterador = entradas.find(endereco);
+
+            if (iterador == entradas.end() || !iterador->second.retida) continue;
+
+            iterador->second.retida = false;
+            iterador->second.confirmacao = confirmacao;
+            retidas--;
+
+            if (!habilitado())
+            {
+                escreverNoArquivo(&iterador->second.pagina);
+                entradas.erase(iterador);
+            }
+        }
+
+        while (habilitado() && (int) entradas.size() - retidas > capacidade) removerVitima();
+    }
+
+    /**
+     * @brief Guarda uma cópia da página no cache. Páginas novas são escritas no
+     * arquivo imediatamente para que recebam um endereço. As demais ficam sujas no
+     * cache até serem removidas ou até descarregar() ser chamado.
+     *
+     * @param pagina Página a ser guardada.
+     *
+     * @return file_ptr_type Endereço da página no arquivo.
+     */
+    file_ptr_type colocar(Pagina *pagina)
+    {
+        lock_guard<mutex> travado(trava);
+
+        file_ptr_type endereco = pagina->obterEndereco();
+        bool paginaNova = endereco == constantes::ptrNuloPagina ||
+            endereco >= tamanhoDoArquivo;
+
+        if (!habilitado()) escreverNoArquivo(pagina);
+
+        else
+        {
+            if (paginaNova)
+            {
+                escreverNoArquivo(pagina);
+                endereco = pagina->obterEndereco();
+            }
+
+            bool criada;
+            Entrada &entrada = obterEntrada(endereco, false, criada);
+
+            entrada.pagina = *pagina;
+            entrada.suja = !paginaNova;
+
+            retirarDoQuadro(endereco);
+        }
+
+        return pagina->obterEndereco();
+    }
+
+    /**
+     * @brief Escreve no arquivo todas as páginas sujas do cache, menos as retidas,
+     * e sincroniza o armazenamento (com mmap, é aqui que acontece o msync).
+     */
+    void descarregar()
+    {
+        lock_guard<mutex> travado(trava);
+
+        int tamanho = bufferDeEscrita.size();
+        uint64_t confirmacao = 0;
+        vector<Entrada *> sujas;
+
+        for (auto &&par : entradas)
+        {
+            if (par.second.suja && !par.second.retida)
+            {
+                sujas.push_back(&par.second);
+                confirmacao = max(confirmacao, par.second.confirmacao);
+            }
+        }
+
+        if (confirmacao != 0 && antesDeEscrever) antesDeEscrever(confirmacao);
+
+        // Todas as páginas sujas são escritas num único lote, que os
+        // armazenamentos assíncronos executam com várias escritas em andamento
+        vector<char> bytes(sujas.size() * tamanho);
+        vector<OperacaoDeES> operacoes(sujas.size());
+
+        for (size_t i = 0; i < sujas.size(); i++)
+        {
+            Pagina &pagina = sujas[i]->pagina;
+            char *buffer = bytes.data() + i * tamanho;
+
+            pagina.escreverBytes(buffer, tamanho);
+            operacoes[i] = OperacaoDeES{ true, -1, pagina.obterEndereco(), buffer, tamanho, false };
+        }
+
+        arquivo.executarEmLote(operacoes);
+
+        for (size_t i = 0; i < sujas.size(); i++)
+        {
+            file_ptr_type fimDaPagina = operacoes[i].endereco + tamanho;
+
+            // Uma página que não foi escrita continua suja
+            sujas[i]->suja = !operacoes[i].sucesso;
+
+            if (operacoes[i].sucesso && fimDaPagina > tamanhoDoArquivo)
+            {
+                tamanhoDoArquivo = fimDaPagina;
+            }
+        }
+
+        arquivo.sincronizar();
+    }
+};
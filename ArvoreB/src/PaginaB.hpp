@@ -11,17 +11,20 @@
 #include "templates/tipos.hpp"
 #include "templates/serializavel.hpp"
 #include "helpersArvore.hpp"
+#include "ArmazenamentoDePaginas.hpp"
+#include "PesquisaNasChaves.hpp"
+#include "VetorDaPagina.hpp"
 
 #include <iostream>
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 
 using namespace std;
 
-namespace constantes
-{
-    static const file_ptr_type ptrNuloPagina = -1;
-}
-
 /**
  * @brief Classe com as características da página da árvore B.
  * 
@@ -31,6 +34,19 @@ namespace constantes
  * 
  * @see [Sobrecarregando o operador <<](https://docs.microsoft.com/pt-br/cpp/standard-library/overloading-the-output-operator-for-your-own-classes?view=vs-2019)
  * 
+ * <p>Quando a chave e o dado podem ser copiados byte a byte (veja
+ * elementosContiguos), as chaves, os dados e os ponteiros ficam em vetores de
+ * capacidade fixa (VetorDaPagina), um depois do outro numa única alocação feita
+ * pela página. Copiar a página, como o cache faz a cada leitura, é então uma
+ * única cópia de memória. Os outros tipos ficam em vectors.</p>
+ * 
+ * <p>Compilando com ARVORE_COM_ORDEM_EYTZINGER definido, as páginas internas
+ * guardam também uma cópia das chaves na ordem de Eytzinger (veja
+ * OrdemEytzinger), que é a usada para descer na árvore. Ela é montada quando a
+ * página é lida do arquivo e quando a árvore salva a página, e é descartada a
+ * cada mudança nas chaves, então convém a índices lidos bem mais do que
+ * escritos.</p>
+ * 
  * @tparam TIPO_DAS_CHAVES Tipo da chave dos registros. <b>É necessário que a chave
  * seja um tipo primitivo ou então que a sua classe/struct herde de Serializavel e
  * tenha um construtor sem parâmetros.</b>
@@ -41,6 +57,30 @@ namespace constantes
 template <typename TIPO_DAS_CHAVES, typename TIPO_DOS_DADOS>
 class PaginaB : public Serializavel
 {
+public:
+    // ------------------------- Typedefs
+
+    /**
+     * @brief Padroniza o tipo da página da árvore. Typedefs dentro de classes ou
+     * structs são considerados como boa prática em C++.
+     */
+    typedef PaginaB<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> Pagina;
+
+    /**
+     * Indica se as chaves, os dados e os ponteiros ficam na alocação da página.
+     * Vale para chaves e dados que podem ser copiados byte a byte e cujo
+     * alinhamento o new de bytes garante.
+     */
+    static const bool elementosContiguos =
+        is_trivially_copyable<TIPO_DAS_CHAVES>::value &&
+        is_trivially_copyable<TIPO_DOS_DADOS>::value &&
+        alignof(TIPO_DAS_CHAVES) <= alignof(max_align_t) &&
+        alignof(TIPO_DOS_DADOS) <= alignof(max_align_t);
+
+    template <typename TIPO>
+    using Vetor = typename conditional<
+        elementosContiguos, VetorDaPagina<TIPO>, vector<TIPO> >::type;
+
 protected:
     // ------------------------- Campos
 
@@ -51,24 +91,129 @@ protected:
     int ordemDaArvore;
     file_ptr_type endereco;
 
-public:
-    // ------------------------- Typedefs
+    // Espaço das chaves, dos dados e dos ponteiros, nessa ordem, quando
+    // elementosContiguos
+    unique_ptr<char[]> espacoDosElementos;
+
+#ifdef ARVORE_COM_ORDEM_EYTZINGER
+    // Chaves das páginas internas na ordem de Eytzinger, a partir do índice 1
+    vector<TIPO_DAS_CHAVES> chavesEytzinger;
+    bool ordemEytzingerValida = false;
+#endif
+
+    // ------------------------- Métodos
+
+    static size_t alinhar(size_t posicao, size_t alinhamento)
+    {
+        return (posicao + alinhamento - 1) / alinhamento * alinhamento;
+    }
+
+    // As divisões inserem antes de dividir, então a página chega a ter, só na
+    // memória, um elemento a mais do que cabe nela
+    size_t capacidadeDasChaves() { return numeroDeChavesPorPagina + 1; }
+    size_t capacidadeDosPonteiros() { return ordemDaArvore + 1; }
+
+    size_t posicaoDosDados()
+    {
+        return alinhar(capacidadeDasChaves() * sizeof(TIPO_DAS_CHAVES),
+            alignof(TIPO_DOS_DADOS));
+    }
+
+    size_t posicaoDosPonteiros()
+    {
+        return alinhar(posicaoDosDados() + capacidadeDasChaves() * sizeof(TIPO_DOS_DADOS),
+            alignof(file_ptr_type));
+    }
+
+    size_t tamanhoDoEspaco()
+    {
+        return posicaoDosPonteiros() + capacidadeDosPonteiros() * sizeof(file_ptr_type);
+    }
 
     /**
-     * @brief Padroniza o tipo da página da árvore. Typedefs dentro de classes ou
-     * structs são considerados como boa prática em C++.
+     * @brief Reserva o espaço de todos os elementos que cabem na página, conforme
+     * a ordem. Os vetores ficam vazios.
      */
-    typedef PaginaB<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> Pagina;
+    void reservarEspaco()
+    {
+        if constexpr (elementosContiguos)
+        {
+            // Com zeros, a cópia do espaço inteiro nunca lê memória sem valor
+            espacoDosElementos.reset(new char[tamanhoDoEspaco()]());
+            char *espaco = espacoDosElementos.get();
+
+            chaves.apontarPara(
+                reinterpret_cast<TIPO_DAS_CHAVES *>(espaco), capacidadeDasChaves());
+            dados.apontarPara(
+                reinterpret_cast<TIPO_DOS_DADOS *>(espaco + posicaoDosDados()),
+                capacidadeDasChaves());
+            ponteiros.apontarPara(
+                reinterpret_cast<file_ptr_type *>(espaco + posicaoDosPonteiros()),
+                capacidadeDosPonteiros());
+        }
+
+        else
+        {
+            chaves.reserve(numeroDeChavesPorPagina);
+            dados.reserve(numeroDeChavesPorPagina);
+            ponteiros.reserve(ordemDaArvore);
+        }
+    }
 
+    /**
+     * @brief Copia os elementos de outra página com a mesma ordem.
+     */
+    void copiarElementosDe(const PaginaB &outra)
+    {
+        if constexpr (elementosContiguos)
+        {
+            memcpy(espacoDosElementos.get(), outra.espacoDosElementos.get(),
+                tamanhoDoEspaco());
+
+            chaves.resize(outra.chaves.size());
+            dados.resize(outra.dados.size());
+            ponteiros.resize(outra.ponteiros.size());
+        }
+
+        else
+        {
+            chaves.assign(outra.chaves.begin(), outra.chaves.end());
+            dados.assign(outra.dados.begin(), outra.dados.end());
+            ponteiros.assign(outra.ponteiros.begin(), outra.ponteiros.end());
+        }
+
+#ifdef ARVORE_COM_ORDEM_EYTZINGER
+        ordemEytzingerValida = outra.ordemEytzingerValida;
+
+        if (ordemEytzingerValida) chavesEytzinger = outra.chavesEytzinger;
+#endif
+    }
+
+    /**
+     * @brief Deve ser chamado a cada mudança nas chaves, que deixa a ordem de
+     * Eytzinger desatualizada.
+     */
+    void descartarOrdemEytzinger()
+    {
+#ifdef ARVORE_COM_ORDEM_EYTZINGER
+        ordemEytzingerValida = false;
+#endif
+    }
+
+public:
     // ------------------------- Campos
 
-    vector<TIPO_DAS_CHAVES> chaves;
-    vector<TIPO_DOS_DADOS> dados;
-    vector<file_ptr_type> ponteiros;
+    Vetor<TIPO_DAS_CHAVES> chaves;
+    Vetor<TIPO_DOS_DADOS> dados;
+    Vetor<file_ptr_type> ponteiros;
 
     // ------------------------- Construtores
 
-    PaginaB() : _tamanho(0), endereco(constantes::ptrNuloPagina) {}
+    PaginaB() :
+        _tamanho(0),
+        numeroDeChavesPorPagina(0),
+        ordemDaArvore(0),
+        endereco(constantes::ptrNuloPagina) {}
 
     /**
      * @brief Constrói uma nova página com a ordem informada.
@@ -90,9 +235,7 @@ public:
             ordemDaArvore(ordemDaArvore),
             endereco(constantes::ptrNuloPagina)
     {
-        chaves.reserve(numeroDeChavesPorPagina);
-        dados.reserve(numeroDeChavesPorPagina);
-        ponteiros.reserve(ordemDaArvore);
+        reservarEspaco();
 
         ponteiros.push_back(constantes::ptrNuloPagina);
     }
@@ -125,6 +268,44 @@ public:
         lerBytes(bytes);
     }
 
+    PaginaB(const PaginaB &outra) :
+        _tamanho(outra._tamanho),
+        maximoDeBytesParaAChave(outra.maximoDeBytesParaAChave),
+        maximoDeBytesParaODado(outra.maximoDeBytesParaODado),
+        numeroDeChavesPorPagina(outra.numeroDeChavesPorPagina),
+        ordemDaArvore(outra.ordemDaArvore),
+        endereco(outra.endereco)
+    {
+        reservarEspaco();
+        copiarElementosDe(outra);
+    }
+
+    // ------------------------- Operadores
+
+    PaginaB &operator=(const PaginaB &outra)
+    {
+        if (this == &outra) return *this;
+
+        _tamanho = outra._tamanho;
+        maximoDeBytesParaAChave = outra.maximoDeBytesParaAChave;
+        maximoDeBytesParaODado = outra.maximoDeBytesParaODado;
+        endereco = outra.endereco;
+
+        // As páginas de uma mesma árvore têm a mesma ordem, então o espaço quase
+        // sempre é reaproveitado
+        if (ordemDaArvore != outra.ordemDaArvore ||
+            (elementosContiguos && espacoDosElementos == nullptr))
+        {
+            numeroDeChavesPorPagina = outra.numeroDeChavesPorPagina;
+            ordemDaArvore = outra.ordemDaArvore;
+            reservarEspaco();
+        }
+
+        copiarElementosDe(outra);
+
+        return *this;
+    }
+
     // ------------------------- Métodos herdados de Serializavel
 
     virtual int obterTamanhoMaximoEmBytes() override
@@ -179,16 +360,162 @@ public:
             dados.push_back(dado);
             ponteiros.push_back(ponteiro);
         }
+
+        organizarOrdemEytzinger();
+    }
+
+    /**
+     * @brief Restaura a página diretamente do buffer lido do arquivo, sem criar um
+     * DataInputStream com uma cópia dele. Chaves e dados primitivos são copiados
+     * do buffer direto para os vetores da página, que já têm a capacidade máxima
+     * reservada.
+     * 
+     * @param buffer Bytes da página.
+     * @param tamanho Quantidade de bytes no buffer. Deve comportar a página
+     * inteira, senão a leitura passaria do fim do buffer.
+     */
+    virtual void lerBytes(char *buffer, int tamanho) override
+    {
+        // Os campos são lidos sem conferir o fim do buffer, então um buffer
+        // truncado é recusado antes de qualquer leitura
+        if (tamanho < obterTamanhoMaximoEmBytes())
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[PaginaB] O buffer é menor do que a página."
+                 << endl << "Exceção lançada" << endl;
+
+            throw length_error("[PaginaB] O buffer é menor do que a página.");
+        }
+
+        lerBytesDiretamente(reinterpret_cast<const tipo_byte *>(buffer));
+    }
+
+    /**
+     * @brief Escreve a página diretamente no buffer, sem alocar DataOutputStreams,
+     * e completa o resto dele com zeros.
+     * 
+     * @param buffer Buffer destino com pelo menos @p tamanho bytes.
+     * @param tamanho Quantidade de bytes do buffer.
+     */
+    virtual void escreverBytes(char *buffer, int tamanho) override
+    {
+        tipo_byte *inicio = reinterpret_cast<tipo_byte *>(buffer);
+        tipo_byte *cursor = escreverBytesDiretamente(inicio);
+
+        fill(cursor, inicio + tamanho, 0);
     }
 
     // ------------------------- Métodos
 
+    /**
+     * @brief Lê os campos da página a partir da posição informada do buffer. O
+     * formato é o mesmo gerado por gerarDataOutputStream().
+     * 
+     * @param cursor Posição do primeiro byte da página no buffer.
+     * 
+     * @return const tipo_byte* Posição logo após o último campo lido.
+     */
+    virtual const tipo_byte *lerBytesDiretamente(const tipo_byte *cursor)
+    {
+        file_ptr_type ponteiro;
+
+        cursor = CopiadorDeBytes<decltype(_tamanho)>::ler(cursor, _tamanho);
+        cursor = CopiadorDeBytes<file_ptr_type>::ler(cursor, ponteiro);
+
+        if (_tamanho < 0 || _tamanho > numeroDeChavesPorPagina)
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[PaginaB] A página tem mais elementos do que cabem no seu espaço."
+                 << endl << "Exceção lançada" << endl;
+
+            throw length_error("[PaginaB] A página tem mais elementos do que cabem no seu espaço.");
+        }
+
+        // A página sempre é limpa antes de ser lida, então os vetores estão
+        // vazios e o resize() não realoca nada
+        chaves.resize(_tamanho);
+        dados.resize(_tamanho);
+        ponteiros.resize(_tamanho + 1);
+        ponteiros[0] = ponteiro;
+
+        for (int i = 0; i < _tamanho; i++)
+        {
+            cursor = CopiadorDeBytes<TIPO_DAS_CHAVES>::ler(cursor, chaves[i]);
+            cursor = CopiadorDeBytes<TIPO_DOS_DADOS>::ler(cursor, dados[i]);
+            cursor = CopiadorDeBytes<file_ptr_type>::ler(cursor, ponteiros[i + 1]);
+        }
+
+        organizarOrdemEytzinger();
+
+        return cursor;
+    }
+
+    /**
+     * @brief Como lerBytesDiretamente(), mas para as cópias feitas sem travas. Elas
+     * podem ser de uma página livre, que começa com o endereço da próxima e tem
+     * um tamanho impossível, pois a árvore só descobre depois da cópia que a
+     * página mudou.
+     * 
+     * @param cursor Posição do primeiro byte da página no buffer.
+     * 
+     * @return true Caso os bytes sejam de uma página e tenham sido lidos.
+     * @return false Caso o tamanho seja impossível. A página não é alterada.
+     */
+    bool lerBytesDaCopiaSemTravas(const tipo_byte *cursor)
+    {
+        decltype(_tamanho) tamanho;
+
+        CopiadorDeBytes<decltype(_tamanho)>::ler(cursor, tamanho);
+
+        if (tamanho < 0 || tamanho > numeroDeChavesPorPagina) return false;
+
+        lerBytesDiretamente(cursor);
+
+        return true;
+    }
+
+    /**
+     * @brief Escreve os campos da página a partir da posição informada do buffer.
+     * O formato é o mesmo gerado por gerarDataOutputStream().
+     * 
+     * @param cursor Posição do buffer onde a página deve começar.
+     * 
+     * @return tipo_byte* Posição logo após o último campo escrito.
+     */
+    virtual tipo_byte *escreverBytesDiretamente(tipo_byte *cursor)
+    {
+        // O espaço da página no arquivo é fixo. Escrever mais elementos do que
+        // cabem nela sobrescreveria a página vizinha.
+        if (_tamanho > numeroDeChavesPorPagina)
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[PaginaB] A página tem mais elementos do que cabem no seu espaço."
+                 << endl << "Exceção lançada" << endl;
+
+            throw length_error("[PaginaB] A página tem mais elementos do que cabem no seu espaço.");
+        }
+
+        cursor = CopiadorDeBytes<decltype(_tamanho)>::escrever(cursor, _tamanho);
+        cursor = CopiadorDeBytes<file_ptr_type>::escrever(cursor, ponteiros[0]);
+
+        for (int i = 0; i < _tamanho; i++)
+        {
+            cursor = CopiadorDeBytes<TIPO_DAS_CHAVES>::escrever(cursor, chaves[i]);
+            cursor = CopiadorDeBytes<TIPO_DOS_DADOS>::escrever(cursor, dados[i]);
+            cursor = CopiadorDeBytes<file_ptr_type>::escrever(cursor, ponteiros[i + 1]);
+        }
+
+        return cursor;
+    }
+
     file_ptr_type setEndereco(file_ptr_type endereco)
     {
         if (endereco > (file_ptr_type) -1)
         {
             this->endereco = endereco;
         }
+
+        return this->endereco;
     }
 
     /**
@@ -257,6 +584,28 @@ public:
         chaves.clear();
         dados.clear();
         ponteiros.clear();
+
+        descartarOrdemEytzinger();
+    }
+
+    /**
+     * @brief Monta a cópia das chaves na ordem de Eytzinger caso a página seja
+     * interna e a árvore tenha sido compilada com ARVORE_COM_ORDEM_EYTZINGER.
+     * Caso contrário, não faz nada.
+     */
+    void organizarOrdemEytzinger()
+    {
+#ifdef ARVORE_COM_ORDEM_EYTZINGER
+        ordemEytzingerValida = !eUmaFolha();
+
+        if (ordemEytzingerValida)
+        {
+            chavesEytzinger.resize(chaves.size() + 1);
+
+            OrdemEytzinger<TIPO_DAS_CHAVES>::organizar(
+                chaves.data(), chaves.size(), chavesEytzinger.data());
+        }
+#endif
     }
 
     /**
@@ -270,11 +619,37 @@ public:
      */
     int obterIndiceDeDescida(TIPO_DAS_CHAVES& chave)
     {
-        // lower_bound (pesquisa binária) -> http://www.cplusplus.com/reference/algorithm/lower_bound/
-        auto iteradorDeInsercao =
-            lower_bound(chaves.begin(), chaves.end(), chave);
+        return obterIndiceDeDescida(chave, 0);
+    }
+
+    /**
+     * @brief Igual a obterIndiceDeDescida(chave), mas sabendo que todas as chaves
+     * antes de @p inicio são menores que a procurada. Permite que a pesquisa de
+     * chaves ordenadas continue de onde a da anterior parou.
+     * 
+     * @param chave Chave de pesquisa.
+     * @param inicio Índice a partir do qual a chave é procurada.
+     * 
+     * @return int Índice em que a chave deve ser inserida ou então
+     * o índice do ponteiro para descer na árvore.
+     */
+    int obterIndiceDeDescida(TIPO_DAS_CHAVES& chave, int inicio)
+    {
+#ifdef ARVORE_COM_ORDEM_EYTZINGER
+        if (ordemEytzingerValida)
+        {
+            int indice = OrdemEytzinger<TIPO_DAS_CHAVES>::limiteInferior(
+                chavesEytzinger.data(), chaves.size(), chave);
+
+            // As chaves antes de inicio são todas menores que a procurada
+            return max(indice, inicio);
+        }
+#endif
 
-        return iteradorDeInsercao - chaves.begin();
+        // Chaves primitivas são pesquisadas com instruções vetoriais (veja
+        // PesquisaNasChaves)
+        return inicio + PesquisaNasChaves<TIPO_DAS_CHAVES>::limiteInferior(
+            chaves.data() + inicio, chaves.size() - inicio, chave);
     }
 
     /**
@@ -307,6 +682,7 @@ public:
             }
             
             _tamanho++;
+            descartarOrdemEytzinger();
         }
 
         return sucesso;
@@ -367,36 +743,22 @@ public:
      * inserção tenha acontecido na página que estava cheia, o último elemento dela
      * deve ser promovido (o mais à direita).
      * 
+     * <p>As páginas envolvidas não são escritas no arquivo aqui. Isso fica a cargo
+     * da árvore, que também liga os ponteiros do elemento promovido.</p>
+     * 
      * @param paginaDestino Página destino.
      * @param indice Índice de inserção na página destino.
-     * @param exPaginaCheia Ponteiro para a página que estava cheia e provocou a
-     * divisão.
-     * @param novaPagina Ponteiro para a nova página que foi criada na divisão.
      * @param promoverElementoDoFim Caso seja true, promove o último elemento
      * desta página. Caso contrário, promove o primeiro.
-     * @param arquivo Arquivo onde as páginas serão colocadas.
      */
     void promoverElementoPara(
-        Pagina *paginaDestino, int indice, Pagina *exPaginaCheia,
-        Pagina *novaPagina, bool promoverElementoDoFim, fstream &arquivo)
+        Pagina *paginaDestino, int indice, bool promoverElementoDoFim)
     {
         int indiceLocal = promoverElementoDoFim ? _tamanho - 1 : 0;
 
         transferirElementoPara(
             paginaDestino, indice, indiceLocal,
             !promoverElementoDoFim, promoverElementoDoFim);
-
-        // atualiza as páginas no arquivo
-        exPaginaCheia->colocarNoArquivo(arquivo);
-        novaPagina->colocarNoArquivo(arquivo);
-
-        // Quando um elemento é promovido, o ponteiro da esquerda dele deve apontar
-        // para a página que estava cheia (a que provocou a divisão).
-        // Já o ponteiro da direita deve apontar para a nova página (gerada pela
-        // divisão).
-        paginaDestino->ponteiros[indice] = exPaginaCheia->endereco;
-        paginaDestino->ponteiros[indice + 1] = novaPagina->endereco;
-        paginaDestino->colocarNoArquivo(arquivo);
     }
 
     /**
@@ -445,6 +807,9 @@ public:
 
         paginaDestino->_tamanho += _tamanho;
         _tamanho = 0;
+
+        descartarOrdemEytzinger();
+        paginaDestino->descartarOrdemEytzinger();
     }
 
     /**
@@ -470,6 +835,9 @@ public:
 
         paginaDestino->_tamanho += quantidadeRemovida;
         _tamanho -= quantidadeRemovida;
+
+        descartarOrdemEytzinger();
+        paginaDestino->descartarOrdemEytzinger();
     }
 
     /**
@@ -486,6 +854,9 @@ public:
 
         iter_swap(dados.begin() + indiceLocal,
             paginaDestino->dados.begin() + indiceDestino);
+
+        descartarOrdemEytzinger();
+        paginaDestino->descartarOrdemEytzinger();
     }
 
     /**
@@ -518,6 +889,44 @@ public:
         return endereco;
     }
 
+    /**
+     * @brief Atualiza a página no arquivo caso ela já tenha um endereço. Caso
+     * contrário, pede um endereço novo ao armazenamento. Caso o armazenamento permita
+     * acesso direto (mmap), a página é montada no próprio lugar dela. Caso
+     * contrário, ela é montada no buffer recebido, que pode ser reaproveitado
+     * entre as escritas, e vai para o arquivo com uma única escrita.
+     * 
+     * @param arquivo Armazenamento onde a página deve ser colocada.
+     * @param buffer Buffer com pelo menos obterTamanhoMaximoEmBytes() bytes.
+     * 
+     * @return file_ptr_type constantes::ptrNuloPagina caso haja algum erro.
+     * Caso contrário, retorna o endereço no qual a página foi colocada.
+     */
+    file_ptr_type colocarNoArquivo(ArmazenamentoDePaginas &arquivo, char *buffer)
+    {
+        int tamanho = obterTamanhoMaximoEmBytes();
+        file_ptr_type destino = endereco != constantes::ptrNuloPagina ?
+            endereco : arquivo.alocarPagina(tamanho);
+        char *bytes = arquivo.acessarParaEscrita(destino, tamanho);
+
+        if (bytes != nullptr)
+        {
+            escreverBytes(bytes, tamanho);
+        }
+
+        else
+        {
+            escreverBytes(buffer, tamanho);
+
+            if (!arquivo.escrever(destino, buffer, tamanho))
+            {
+                return constantes::ptrNuloPagina;
+            }
+        }
+
+        return endereco = destino;
+    }
+
     /**
      * @brief Exclui o par (chave, dado) da página no índice informado. É possível
      * excluir também o ponteiro à direita do par.
@@ -553,6 +962,7 @@ public:
             }
 
             _tamanho--;
+            descartarOrdemEytzinger();
         }
 
         return sucesso;
@@ -642,5 +1052,5 @@ fstream &operator>>(fstream &fstream, PaginaB<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> *
 template <typename TIPO_DAS_CHAVES, typename TIPO_DOS_DADOS>
 fstream &operator>>(fstream &fstream, PaginaB<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> &pagina)
 {
-    fstream >> &pagina;
+    return fstream >> &pagina;
 }
@@ -0,0 +1,498 @@
+/**
+ * @file PoliticasDeSubstituicao.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo com as políticas de substituição do cache de páginas.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include "templates/tipos.hpp"
+#include "PaginaB.hpp"
+
+#include <iostream>
+#include <functional>
+#include <list>
+#include <set>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @brief Políticas de substituição disponíveis para o cache de páginas.
+ */
+enum class TipoDePolitica
+{
+    /** Remove a página usada há mais tempo. */
+    LRU,
+    /** Aproximação do LRU com um bit de referência e um ponteiro circular. */
+    CLOCK,
+    /** Páginas vistas uma única vez ficam numa fila de experiência separada. */
+    DOIS_Q,
+    /** Remove a página cujo penúltimo acesso é o mais antigo (K = 2). */
+    LRU_K
+};
+
+/**
+ * @brief Interface das políticas que decidem qual página sai do cache quando
+ * ele está cheio.
+ *
+ * <p>Todos os métodos recebem o parâmetro @p sequencial, que indica que o acesso
+ * faz parte de uma varredura (ex.: a cadeia de folhas da árvore B+). As
+ * políticas tratam esses acessos de forma que eles não expulsem as páginas
+ * realmente quentes, como os níveis internos da árvore.</p>
+ */
+class PoliticaDeSubstituicao
+{
+public:
+    virtual ~PoliticaDeSubstituicao() {}
+
+    /**
+     * @brief Obtém o nome da política.
+     *
+     * @return string Nome da política.
+     */
+    virtual string nome() = 0;
+
+    /**
+     * @brief Registra que a página acabou de entrar no cache.
+     *
+     * @param endereco Endereço da página.
+     * @param sequencial Indica se o acesso faz parte de uma varredura.
+     */
+    virtual void registrarInsercao(file_ptr_type endereco, bool sequencial) = 0;
+
+    /**
+     * @brief Registra um acesso a uma página que já estava no cache.
+     *
+     * @param endereco Endereço da página.
+     * @param sequencial Indica se o acesso faz parte de uma varredura.
+     */
+    virtual void registrarAcesso(file_ptr_type endereco, bool sequencial) = 0;
+
+    /**
+     * @brief Esquece a página, que saiu do cache por um motivo externo à política.
+     *
+     * @param endereco Endereço da página.
+     */
+    virtual void registrarRemocao(file_ptr_type endereco) = 0;
+
+    /**
+     * @brief Escolhe a página que deve sair do cache e a esquece.
+     *
+     * @param podeSair Função que informa se a página de um endereço pode sair do
+     * cache (ex.: páginas fixadas não podem).
+     *
+     * @return file_ptr_type Endereço da página escolhida ou constantes::ptrNuloPagina
+     * caso nenhuma possa sair.
+     */
+    virtual file_ptr_type escolherVitima(function<bool(file_ptr_type)> podeSair) = 0;
+};
+
+/**
+ * @brief Política LRU (Least Recently Used). Acessos sequenciais colocam a página
+ * no fim da fila, de forma que ela seja a próxima a sair.
+ */
+class PoliticaLRU : public PoliticaDeSubstituicao
+{
+    /** Endereços das páginas. O mais recente fica no início. */
+    list<file_ptr_type> listaDeUso;
+    unordered_map<file_ptr_type, list<file_ptr_type>::iterator> posicoes;
+
+public:
+    string nome() override
+    {
+        return "LRU";
+    }
+
+    void registrarInsercao(file_ptr_type endereco, bool sequencial) override
+    {
+        auto posicao = sequencial ?
+            listaDeUso.insert(listaDeUso.end(), endereco) :
+            listaDeUso.insert(listaDeUso.begin(), endereco);
+
+        posicoes[endereco] = posicao;
+    }
+
+    void registrarAcesso(file_ptr_type endereco, bool sequencial) override
+    {
+        auto iterador = posicoes.find(endereco);
+
+        // Move o endereço para o início da lista sem realocar o nó
+        if (iterador != posicoes.end() && !sequencial)
+            listaDeUso.splice(listaDeUso.begin(), listaDeUso, iterador->second);
+    }
+
+    void registrarRemocao(file_ptr_type endereco) override
+    {
+        auto iterador = posicoes.find(endereco);
+
+        if (iterador != posicoes.end())
+        {
+            listaDeUso.erase(iterador->second);
+            posicoes.erase(iterador);
+        }
+    }
+
+    file_ptr_type escolherVitima(function<bool(file_ptr_type)> podeSair) override
+    {
+        // Procura, do fim para o início, a primeira página que pode sair
+        for (auto posicao = listaDeUso.rbegin(); posicao != listaDeUso.rend(); posicao++)
+        {
+            file_ptr_type endereco = *posicao;
+
+            if (podeSair(endereco))
+            {
+                registrarRemocao(endereco);
+
+                return endereco;
+            }
+        }
+
+        return constantes::ptrNuloPagina;
+    }
+};
+
+/**
+ * @brief Política CLOCK (segunda chance). Cada página tem um bit de referência
+ * que é ligado a cada acesso e desligado quando o ponteiro do relógio passa por
+ * ela. Acessos sequenciais não ligam o bit.
+ */
+class PoliticaCLOCK : public PoliticaDeSubstituicao
+{
+    struct Quadro
+    {
+        file_ptr_type endereco;
+        bool referenciado;
+    };
+
+    list<Quadro> relogio;
+    list<Quadro>::iterator ponteiro;
+    unordered_map<file_ptr_type, list<Quadro>::iterator> posicoes;
+
+    void avancarPonteiro()
+    {
+        if (++ponteiro == relogio.end()) ponteiro = relogio.begin();
+    }
+
+public:
+    PoliticaCLOCK() : ponteiro(relogio.end()) {}
+
+    string nome() override
+    {
+        return "CLOCK";
+    }
+
+    void registrarInsercao(file_ptr_type endereco, bool sequencial) override
+    {
+        // A página nova entra logo atrás do ponteiro, ou seja, é a última que
+        // ele vai visitar
+        auto posicao = relogio.insert(ponteiro, Quadro { endereco, !sequencial });
+
+        if (ponteiro == relogio.end()) ponteiro = relogio.begin();
+
+        posicoes[endereco] = posicao;
+    }
+
+    void registrarAcesso(file_ptr_type endereco, bool sequencial) override
+    {
+        auto iterador = posicoes.find(endereco);
+
+        if (iterador != posicoes.end() && !sequencial)
+            iterador->second->referenciado = true;
+    }
+
+    void registrarRemocao(file_ptr_type endereco) override
+    {
+        auto iterador = posicoes.find(endereco);
+
+        if (iterador != posicoes.end())
+        {
+            if (ponteiro == iterador->second) avancarPonteiro();
+
+            relogio.erase(iterador->second);
+            posicoes.erase(iterador);
+
+            if (relogio.empty()) ponteiro = relogio.end();
+        }
+    }
+
+    file_ptr_type escolherVitima(function<bool(file_ptr_type)> podeSair) override
+    {
+        // Duas voltas bastam: na primeira todos os bits são desligados
+        size_t passos = 2 * relogio.size();
+
+        for (size_t i = 0; i < passos; i++)
+        {
+            Quadro &quadro = *ponteiro;
+
+            if (quadro.referenciado) quadro.referenciado = false;
+
+            else if (podeSair(quadro.endereco))
+            {
+                file_ptr_type endereco = quadro.endereco;
+                registrarRemocao(endereco);
+
+                return endereco;
+            }
+
+            avancarPonteiro();
+        }
+
+        return constantes::ptrNuloPagina;
+    }
+};
+
+/**
+ * @brief Política 2Q (Johnson e Shasha). Páginas novas entram na fila A1in (FIFO).
+ * Quando saem dela, seus endereços ficam lembrados na fila fantasma A1out. Só a
+ * página que é acessada de novo enquanto está na A1out entra na fila principal Am
+ * (LRU). Assim, uma varredura passa apenas pela A1in sem expulsar as páginas da Am.
+ *
+ * <p>Acessos sequenciais nunca promovem uma página para a Am.</p>
+ */
+class Politica2Q : public PoliticaDeSubstituicao
+{
+    enum Fila { A1IN, AM };
+
+    struct Posicao
+    {
+        Fila fila;
+        list<file_ptr_type>::iterator iterador;
+    };
+
+    size_t tamanhoMaximoDaA1in;
+    size_t tamanhoMaximoDaA1out;
+
+    /** O mais recente fica no início de cada fila. */
+    list<file_ptr_type> a1in;
+    list<file_ptr_type> a1out;
+    list<file_ptr_type> am;
+
+    unordered_map<file_ptr_type, Posicao> posicoes;
+    unordered_map<file_ptr_type, list<file_ptr_type>::iterator> fantasmas;
+
+    list<file_ptr_type> &obterFila(Fila fila)
+    {
+        return fila == A1IN ? a1in : am;
+    }
+
+    void lembrar(file_ptr_type endereco)
+    {
+        a1out.push_front(endereco);
+        fantasmas[endereco] = a1out.begin();
+
+        if (a1out.size() > tamanhoMaximoDaA1out)
+        {
+            fantasmas.erase(a1out.back());
+            a1out.pop_back();
+        }
+    }
+
+    file_ptr_type escolherVitimaDa(Fila fila, function<bool(file_ptr_type)> &podeSair)
+    {
+        list<file_ptr_type> &lista = obterFila(fila);
+
+        for (auto posicao = lista.rbegin(); posicao != lista.rend(); posicao++)
+        {
+            file_ptr_type endereco = *posicao;
+
+            if (podeSair(endereco))
+            {
+                registrarRemocao(endereco);
+
+                return endereco;
+            }
+        }
+
+        return constantes::ptrNuloPagina;
+    }
+
+public:
+    /**
+     * @brief Constrói a política 2Q.
+     *
+     * @param capacidade Capacidade do cache. A A1in fica com 25% dela e a A1out
+     * lembra 50% dela em endereços, como sugerido no artigo original.
+     */
+    Politica2Q(int capacidade) :
+        tamanhoMaximoDaA1in(capacidade / 4 > 0 ? capacidade / 4 : 1),
+        tamanhoMaximoDaA1out(capacidade / 2 > 0 ? capacidade / 2 : 1) {}
+
+    string nome() override
+    {
+        return "2Q";
+    }
+
+    void registrarInsercao(file_ptr_type endereco, bool sequencial) override
+    {
+        auto fantasma = fantasmas.find(endereco);
+        Fila fila = A1IN;
+
+        if (fantasma != fantasmas.end())
+        {
+            a1out.erase(fantasma->second);
+            fantasmas.erase(fantasma);
+
+            if (!sequencial) fila = AM;
+        }
+
+        list<file_ptr_type> &lista = obterFila(fila);
+
+        lista.push_front(endereco);
+        posicoes[endereco] = Posicao { fila, lista.begin() };
+    }
+
+    void registrarAcesso(file_ptr_type endereco, bool /* sequencial */) override
+    {
+        auto iterador = posicoes.find(endereco);
+
+        // Acessos na A1in não mudam nada, ela é uma fila FIFO
+        if (iterador != posicoes.end() && iterador->second.fila == AM)
+            am.splice(am.begin(), am, iterador->second.iterador);
+    }
+
+    void registrarRemocao(file_ptr_type endereco) override
+    {
+        auto iterador = posicoes.find(endereco);
+
+        if (iterador != posicoes.end())
+        {
+            obterFila(iterador->second.fila).erase(iterador->second.iterador);
+            posicoes.erase(iterador);
+        }
+    }
+
+    file_ptr_type escolherVitima(function<bool(file_ptr_type)> podeSair) override
+    {
+        bool a1inGrande = a1in.size() >= tamanhoMaximoDaA1in || am.empty();
+        Fila primeira = a1inGrande ? A1IN : AM;
+        Fila segunda = a1inGrande ? AM : A1IN;
+
+        file_ptr_type endereco = escolherVitimaDa(primeira, podeSair);
+        bool saiuDaA1in = endereco != constantes::ptrNuloPagina && a1inGrande;
+
+        if (endereco == constantes::ptrNuloPagina)
+        {
+            endereco = escolherVitimaDa(segunda, podeSair);
+            saiuDaA1in = endereco != constantes::ptrNuloPagina && !a1inGrande;
+        }
+
+        if (saiuDaA1in) lembrar(endereco);
+
+        return endereco;
+    }
+};
+
+/**
+ * @brief Política LRU-K (O'Neil, O'Neil e Weikum) com K = 2. A página que sai é
+ * aquela cujo penúltimo acesso é o mais antigo. Páginas com um único acesso
+ * registrado saem antes de todas as outras, da menos recente para a mais recente.
+ *
+ * <p>Acessos sequenciais não entram no histórico, pois são correlacionados.</p>
+ */
+class PoliticaLRUK : public PoliticaDeSubstituicao
+{
+    struct Historico
+    {
+        /** Instante do último acesso. */
+        unsigned long ultimo;
+        /** Instante do penúltimo acesso (0 caso não haja). */
+        unsigned long penultimo;
+    };
+
+    unsigned long relogio = 0;
+    unordered_map<file_ptr_type, Historico> historicos;
+
+    /** Páginas ordenadas por (penúltimo acesso, último acesso). */
+    set< pair< pair<unsigned long, unsigned long>, file_ptr_type > > ordem;
+
+    pair< pair<unsigned long, unsigned long>, file_ptr_type > chaveDe(
+        file_ptr_type endereco, Historico &historico)
+    {
+        return make_pair(make_pair(historico.penultimo, historico.ultimo), endereco);
+    }
+
+public:
+    string nome() override
+    {
+        return "LRU-K";
+    }
+
+    void registrarInsercao(file_ptr_type endereco, bool /* sequencial */) override
+    {
+        Historico historico { ++relogio, 0 };
+
+        historicos[endereco] = historico;
+        ordem.insert(chaveDe(endereco, historico));
+    }
+
+    void registrarAcesso(file_ptr_type endereco, bool sequencial) override
+    {
+        auto iterador = historicos.find(endereco);
+
+        if (iterador != historicos.end() && !sequencial)
+        {
+            Historico &historico = iterador->second;
+
+            ordem.erase(chaveDe(endereco, historico));
+
+            historico.penultimo = historico.ultimo;
+            historico.ultimo = ++relogio;
+
+            ordem.insert(chaveDe(endereco, historico));
+        }
+    }
+
+    void registrarRemocao(file_ptr_type endereco) override
+    {
+        auto iterador = historicos.find(endereco);
+
+        if (iterador != historicos.end())
+        {
+            ordem.erase(chaveDe(endereco, iterador->second));
+            historicos.erase(iterador);
+        }
+    }
+
+    file_ptr_type escolherVitima(function<bool(file_ptr_type)> podeSair) override
+    {
+        for (auto &&item : ordem)
+        {
+            file_ptr_type endereco = item.second;
+
+            if (podeSair(endereco))
+            {
+                registrarRemocao(endereco);
+
+                return endereco;
+            }
+        }
+
+        return constantes::ptrNuloPagina;
+    }
+};
+
+/**
+ * @brief Cria a política de substituição do tipo informado.
+ *
+ * @param tipo Tipo da política.
+ * @param capacidade Capacidade do cache que usará a política.
+ *
+ * @return PoliticaDeSubstituicao* Política alocada com new.
+ */
+PoliticaDeSubstituicao *criarPolitica(TipoDePolitica tipo, int capacidade)
+{
+    PoliticaDeSubstituicao *politica;
+
+    switch (tipo)
+    {
+        case TipoDePolitica::CLOCK: politica = new PoliticaCLOCK(); break;
+        case TipoDePolitica::DOIS_Q: politica = new Politica2Q(capacidade); break;
+        case TipoDePolitica::LRU_K: politica = new PoliticaLRUK(); break;
+        default: politica = new PoliticaLRU(); break;
+    }
+
+    return politica;
+}
@@ -0,0 +1,316 @@
+/**
+ * @file TravasDePaginas.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo da classe TabelaDeTravas.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include "templates/tipos.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+namespace constantes
+{
+    /**
+     * Quantidade de partes da tabela de travas. O endereço de cada página
+     * escolhe uma parte, e as páginas de partes diferentes nunca disputam nada
+     * para achar as suas travas.
+     */
+    static const int partesDaTabelaDeTravas = 128;
+
+    /**
+     * Quantidade de travas já alocadas em cada parte da tabela. Só quando mais
+     * páginas do que isso de uma mesma parte estão em uso ao mesmo tempo é que
+     * a trava de alguma delas precisa ser alocada.
+     */
+    static const int travasPorParte = 8;
+
+    /**
+     * Quantidade de versões da tabela de travas. Páginas diferentes podem cair
+     * na mesma versão, o que só faz algumas leituras otimistas serem refeitas.
+     */
+    static const int versoesDaTabelaDeTravas = 512;
+
+    /**
+     * Quantidade de vezes que uma leitura otimista é refeita, depois de cruzar
+     * com escritas, antes de a árvore desistir dela e usar as travas.
+     */
+    static const int tentativasOtimistas = 4;
+}
+
+/**
+ * @brief Travas de leitura e escrita das páginas, identificadas pelo endereço
+ * delas. Várias threads podem ter a trava de leitura de uma página ao mesmo
+ * tempo, mas a de escrita é exclusiva.
+ *
+ * <p>As travas ficam num vetor fixo, dividido em partes, e uma trava só pertence
+ * a uma página enquanto alguém a usa. Cada página tem a sua própria trava, ao
+ * contrário das versões, porque uma thread pode segurar várias páginas ao mesmo
+ * tempo e duas delas numa mesma trava fariam a thread esperar por si mesma.
+ * Cada parte é protegida só por uma indicação de ocupada, que é pega e solta
+ * com uma operação atômica.</p>
+ *
+ * <p>Para não haver impasses, as travas devem ser pegas de cima para baixo na
+ * árvore e, num mesmo nível, da esquerda para a direita. Uma página à esquerda
+ * de outra que já esteja travada só pode ser pega com tentarTravar().</p>
+ *
+ * <p>A tabela também tem versões para as leituras otimistas, que não pegam trava
+ * nenhuma e, por isso, não escrevem na memória compartilhada: a versão da página
+ * é lida antes dela (lerVersao()) e conferida depois (validarVersao()). Quem tem
+ * a trava de escrita de uma página está contado na versão dela, que muda quando
+ * a trava é solta, então uma leitura que cruzou com uma escrita é descoberta e
+ * refeita.</p>
+ */
+class TabelaDeTravas
+{
+    struct Trava
+    {
+        shared_mutex trava;
+
+        /** Endereço da página dona da trava. Só vale enquanto houver usos. */
+        file_ptr_type endereco = 0;
+
+        /** Threads que têm a trava ou estão esperando por ela. */
+        int usos = 0;
+
+        /** Indica se a trava foi alocada por não caber no vetor da parte. */
+        bool excedente = false;
+    };
+
+    /**
+     * Cada parte ocupa as suas próprias linhas de cache, para que as threads
+     * numa não atrapalhem as que estão nas vizinhas.
+     */
+    struct alignas(64) Parte
+    {
+        atomic<bool> ocupada{false};
+        Trava travas[constantes::travasPorParte];
+
+        /**
+         * Travas das páginas que não couberam no vetor. Um mesmo endereço nunca
+         * está nos dois lugares, pois ele só vem para cá com o vetor cheio.
+         */
+        unordered_map<file_ptr_type, Trava> excedentes;
+
+        void ocupar()
+        {
+            while (ocupada.exchange(true, memory_order_acquire)) this_thread::yield();
+        }
+
+        void liberar()
+        {
+            ocupada.store(false, memory_order_release);
+        }
+
+        /** Procura a trava da página. Deve ser chamado com a parte ocupada. */
+        Trava *procurar(file_ptr_type endereco)
+        {
+            for (Trava &trava : travas)
+            {
+                if (trava.usos > 0 && trava.endereco == endereco) return &trava;
+            }
+
+            auto iterador = excedentes.find(endereco);
+
+            return iterador == excedentes.end() ? nullptr : &iterador->second;
+        }
+    };
+
+    /**
+     * Os 16 bits mais baixos contam as threads com a trava de escrita de alguma
+     * página da versão, e o resto conta quantas vezes essas travas foram soltas.
+     * Cada versão ocupa uma linha de cache inteira, para que as escritas numa
+     * não atrapalhem as leituras das vizinhas.
+     */
+    struct alignas(64) Versao
+    {
+        atomic<uint64_t> valor{0};
+    };
+
+    static const uint64_t umaEscrita = 1ull << 16;
+    static const uint64_t mascaraDosEscritores = umaEscrita - 1;
+
+    Parte partes[constantes::partesDaTabelaDeTravas];
+    Versao versoes[constantes::versoesDaTabelaDeTravas];
+
+    uint64_t misturar(file_ptr_type endereco)
+    {
+        // Os endereços são múltiplos do tamanho das páginas, então são misturados
+        // antes para que se espalhem por todas as partes
+        return (uint64_t) endereco * 11400714819323198485ull;
+    }
+
+    Parte &obterParte(file_ptr_type endereco)
+    {
+        return partes[(misturar(endereco) >> 32) % constantes::partesDaTabelaDeTravas];
+    }
+
+    atomic<uint64_t> &obterVersao(file_ptr_type endereco)
+    {
+        return versoes[(misturar(endereco) >> 32) % constantes::versoesDaTabelaDeTravas].valor;
+    }
+
+    /**
+     * @brief Obtém a trava da página, dando a ela uma trava livre caso ninguém a
+     * esteja usando, e conta mais um uso dela. Enquanto houver usos, a trava
+     * continua sendo da página.
+     */
+    Trava &reservar(file_ptr_type endereco)
+    {
+        Parte &parte = obterParte(endereco);
+        parte.ocupar();
+
+        Trava *trava = parte.procurar(endereco);
+
+        for (int i = 0; trava == nullptr && i < constantes::travasPorParte; i++)
+        {
+            if (parte.travas[i].usos == 0) trava = &parte.travas[i];
+        }
+
+        if (trava == nullptr)
+        {
+            trava = &parte.excedentes[endereco];
+            trava->excedente = true;
+        }
+
+        // A página só muda de trava quando ninguém está usando a antiga
+        if (trava->usos++ == 0) trava->endereco = endereco;
+
+        parte.liberar();
+
+        return *trava;
+    }
+
+    /**
+     * @brief Desconta um uso da trava da página, que fica livre para outras
+     * páginas caso não tenha mais usos.
+     */
+    void devolver(file_ptr_type endereco, Trava &trava)
+    {
+        Parte &parte = obterParte(endereco);
+        parte.ocupar();
+
+        if (--trava.usos == 0 && trava.excedente) parte.excedentes.erase(endereco);
+
+        parte.liberar();
+    }
+
+public:
+    // ------------------------- Métodos
+
+    /**
+     * @brief Pega a trava da página, esperando caso alguém tenha uma trava que
+     * não possa ser compartilhada com ela.
+     *
+     * @param endereco Endereço da página.
+     * @param exclusiva Indica se a trava é de escrita (exclusiva) ou de leitura.
+     */
+    void travar(file_ptr_type endereco, bool exclusiva)
+    {
+        Trava &trava = reservar(endereco);
+
+        if (exclusiva)
+        {
+            trava.trava.lock();
+            obterVersao(endereco) += 1;
+        }
+
+        else trava.trava.lock_shared();
+    }
+
+    /**
+     * @brief Pega a trava da página apenas caso isso possa ser feito sem esperar.
+     *
+     * @param endereco Endereço da página.
+     * @param exclusiva Indica se a trava é de escrita (exclusiva) ou de leitura.
+     *
+     * @return true Caso a trava tenha sido pega.
+     * @return false Caso alguém tenha uma trava que não possa ser compartilhada.
+     */
+    bool tentarTravar(file_ptr_type endereco, bool exclusiva)
+    {
+        Trava &trava = reservar(endereco);
+        bool travou = exclusiva ? trava.trava.try_lock() : trava.trava.try_lock_shared();
+
+        if (!travou) devolver(endereco, trava);
+
+        else if (exclusiva) obterVersao(endereco) += 1;
+
+        return travou;
+    }
+
+    /**
+     * @brief Solta a trava da página, pega antes com travar() ou tentarTravar().
+     *
+     * @param endereco Endereço da página.
+     * @param exclusiva Deve ser o mesmo valor usado ao pegar a trava.
+     */
+    void destravar(file_ptr_type endereco, bool exclusiva)
+    {
+        Parte &parte = obterParte(endereco);
+        parte.ocupar();
+
+        // Quem solta a trava ainda conta como um uso, então ela não muda de dona
+        Trava *trava = parte.procurar(endereco);
+
+        parte.liberar();
+
+        if (exclusiva)
+        {
+            // Conta a escrita na versão e desconta a thread dos escritores
+            obterVersao(endereco) += umaEscrita - 1;
+            trava->trava.unlock();
+        }
+
+        else trava->trava.unlock_shared();
+
+        devolver(endereco, *trava);
+    }
+
+    /**
+     * @brief Lê a versão da página antes de uma leitura otimista dela.
+     *
+     * @param endereco Endereço da página.
+     * @param versao Recebe a versão, a ser passada para validarVersao().
+     *
+     * @return true Caso ninguém tenha a trava de escrita da página. Caso
+     * contrário, a leitura deve ser refeita mais tarde ou com travas.
+     */
+    bool lerVersao(file_ptr_type endereco, uint64_t &versao)
+    {
+        versao = obterVersao(endereco).load();
+
+        return (versao & mascaraDosEscritores) == 0;
+    }
+
+    /**
+     * @brief Checa se ninguém pegou a trava de escrita da página desde
+     * lerVersao(). Nesse caso, o que foi lido dela antes desta chamada é válido.
+     */
+    bool validarVersao(file_ptr_type endereco, uint64_t versao)
+    {
+        // As leituras da página não podem ser feitas depois desta
+        atomic_thread_fence(memory_order_acquire);
+
+        return obterVersao(endereco).load(memory_order_relaxed) == versao;
+    }
+
+    /**
+     * @brief Como validarVersao(), mas para quem acabou de pegar a trava de
+     * escrita da página. Os escritores atuais são ignorados, pois a própria
+     * thread é um deles, e só as escritas já terminadas contam.
+     */
+    bool validarVersaoTravada(file_ptr_type endereco, uint64_t versao)
+    {
+        return (obterVersao(endereco).load() & ~mascaraDosEscritores) == versao;
+    }
+};
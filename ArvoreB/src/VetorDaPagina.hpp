@@ -0,0 +1,197 @@
+/**
+ * @file VetorDaPagina.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo da classe VetorDaPagina.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Vetor de capacidade fixa cujos elementos ficam num espaço que não é
+ * dele, como o da página (veja PaginaB). Tem a parte da interface de vector que
+ * as páginas usam e os iteradores são ponteiros, então as pesquisas binárias e
+ * os deslocamentos de inserir() e excluir() andam só por memória contígua.
+ *
+ * <p>Só serve para tipos que podem ser copiados byte a byte. O dono do espaço
+ * deve chamar apontarPara() antes do primeiro uso e depois de cada vez que o
+ * espaço mudar de lugar, e copiar o vetor é responsabilidade dele.</p>
+ *
+ * @tparam TIPO Tipo dos elementos.
+ */
+template <typename TIPO>
+class VetorDaPagina
+{
+public:
+    // ------------------------- Typedefs
+
+    typedef TIPO value_type;
+    typedef TIPO *iterator;
+    typedef const TIPO *const_iterator;
+    typedef TIPO &reference;
+    typedef const TIPO &const_reference;
+    typedef size_t size_type;
+
+private:
+    // ------------------------- Campos
+
+    TIPO *elementos;
+    size_t quantidade;
+    size_t capacidade;
+
+    // ------------------------- Métodos
+
+    /**
+     * @brief Garante que o vetor comporta mais @p quantidadeNova elementos. Passar
+     * da capacidade escreveria no vetor seguinte do espaço.
+     */
+    void garantirEspaco(size_t quantidadeNova)
+    {
+        if (quantidade + quantidadeNova > capacidade)
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[PaginaB] A página tem mais elementos do que cabem no seu espaço."
+                 << endl << "Exceção lançada" << endl;
+
+            throw length_error("[PaginaB] A página tem mais elementos do que cabem no seu espaço.");
+        }
+    }
+
+public:
+    // ------------------------- Construtores
+
+    VetorDaPagina() : elementos(nullptr), quantidade(0), capacidade(0) {}
+
+    VetorDaPagina(const VetorDaPagina &) = delete;
+    VetorDaPagina &operator=(const VetorDaPagina &) = delete;
+
+    // ------------------------- Métodos
+
+    /**
+     * @brief Passa a usar o espaço informado, que deve comportar @p capacidade
+     * elementos. O vetor fica vazio.
+     */
+    void apontarPara(TIPO *elementos, size_t capacidade)
+    {
+        this->elementos = elementos;
+        this->capacidade = capacidade;
+        quantidade = 0;
+    }
+
+    iterator begin() { return elementos; }
+    iterator end() { return elementos + quantidade; }
+    const_iterator begin() const { return elementos; }
+    const_iterator end() const { return elementos + quantidade; }
+
+    TIPO *data() { return elementos; }
+    const TIPO *data() const { return elementos; }
+
+    size_t size() const { return quantidade; }
+    bool empty() const { return quantidade == 0; }
+
+    TIPO &operator[](size_t indice) { return elementos[indice]; }
+    const TIPO &operator[](size_t indice) const { return elementos[indice]; }
+
+    TIPO &front() { return elementos[0]; }
+    TIPO &back() { return elementos[quantidade - 1]; }
+
+    /**
+     * @brief Não faz nada além de conferir a capacidade, que é fixa.
+     */
+    void reserve(size_t quantidadeReservada)
+    {
+        if (quantidadeReservada > capacidade)
+        {
+            garantirEspaco(quantidadeReservada - quantidade);
+        }
+    }
+
+    /**
+     * @brief Muda a quantidade de elementos. Os elementos acrescentados ficam
+     * com o valor que já estava no espaço, já que a página sempre os preenche
+     * em seguida.
+     */
+    void resize(size_t quantidadeNova)
+    {
+        if (quantidadeNova > quantidade) garantirEspaco(quantidadeNova - quantidade);
+
+        quantidade = quantidadeNova;
+    }
+
+    void clear()
+    {
+        quantidade = 0;
+    }
+
+    void push_back(const TIPO &elemento)
+    {
+        garantirEspaco(1);
+
+        elementos[quantidade++] = elemento;
+    }
+
+    void pop_back()
+    {
+        quantidade--;
+    }
+
+    iterator insert(iterator posicao, const TIPO &elemento)
+    {
+        // O elemento pode estar no próprio vetor, então é copiado antes do
+        // deslocamento
+        TIPO copia = elemento;
+
+        garantirEspaco(1);
+        copy_backward(posicao, end(), end() + 1);
+        *posicao = copia;
+        quantidade++;
+
+        return posicao;
+    }
+
+    /**
+     * @brief Insere os elementos do intervalo [inicio, fim), que não pode ser
+     * parte deste vetor.
+     */
+    template <typename Iterador>
+    iterator insert(iterator posicao, Iterador inicio, Iterador fim)
+    {
+        size_t quantidadeNova = distance(inicio, fim);
+
+        garantirEspaco(quantidadeNova);
+        copy_backward(posicao, end(), end() + quantidadeNova);
+        copy(inicio, fim, posicao);
+        quantidade += quantidadeNova;
+
+        return posicao;
+    }
+
+    iterator erase(iterator posicao)
+    {
+        return erase(posicao, posicao + 1);
+    }
+
+    iterator erase(iterator inicio, iterator fim)
+    {
+        copy(fim, end(), inicio);
+        quantidade -= fim - inicio;
+
+        return inicio;
+    }
+
+    template <typename Iterador>
+    void assign(Iterador inicio, Iterador fim)
+    {
+        clear();
+        insert(begin(), inicio, fim);
+    }
+};
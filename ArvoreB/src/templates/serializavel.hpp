@@ -13,6 +13,7 @@
 #include "../streams/DataInputStream.hpp"
 
 #include <fstream>
+#include <algorithm>
 
 namespace constantes
 {
@@ -62,18 +63,39 @@ public:
     virtual void lerBytes(DataInputStream& input) = 0; // = 0 declara esta função como pura
 
     /**
-     * @brief Lê e interpreta o buffer restaurando o objeto da entidade.
+     * @brief Lê e interpreta o buffer restaurando o objeto da entidade. Por padrão,
+     * copia o buffer para um DataInputStream. Entidades que conseguem se restaurar
+     * diretamente do buffer podem sobrescrever este método.
      * 
      * @param buffer Vetor de bytes da entidade.
      * @param tamanho Quantidade de bytes no buffer.
      */
-    void lerBytes(char *buffer, int tamanho)
+    virtual void lerBytes(char *buffer, int tamanho)
     {
         DataInputStream input(buffer, tamanho);
         
         lerBytes(input);
     }
 
+    /**
+     * @brief Escreve os dados da entidade no buffer recebido, completando com zeros
+     * até o fim dele. Por padrão, gera um DataOutputStream e o copia para o buffer.
+     * Entidades que conseguem se escrever diretamente no buffer podem sobrescrever
+     * este método e evitar a alocação do DataOutputStream.
+     * 
+     * @param buffer Buffer destino com pelo menos @p tamanho bytes.
+     * @param tamanho Quantidade de bytes do buffer (normalmente
+     * obterTamanhoMaximoEmBytes()).
+     */
+    virtual void escreverBytes(char *buffer, int tamanho)
+    {
+        DataOutputStream out = gerarDataOutputStream();
+        size_t quantidade = min((size_t) tamanho, out.size());
+
+        copy(out.begin(), out.begin() + quantidade, buffer);
+        fill(buffer + quantidade, buffer + tamanho, 0);
+    }
+
     /**
      * @brief Cria o DataOutputStream alocando obterTamanhoMaximoEmBytes() para o seu vetor.
      * 
@@ -125,9 +147,14 @@ public:
 
 DataOutputStream& operator<<(DataOutputStream& dataOutputStream, Serializavel* variavel)
 {
-    auto out = variavel->gerarDataOutputStream();
+    auto tamanhoAntes = dataOutputStream.size();
+
+    // A entidade escreve direto no fluxo de fora, sem um DataOutputStream
+    // intermediário. Depois, o espaço dela é completado com zeros (ou cortado)
+    // até o tamanho máximo.
+    variavel->gerarDataOutputStream(dataOutputStream);
 
-    return dataOutputStream << out;
+    return dataOutputStream.resize(tamanhoAntes + variavel->obterTamanhoMaximoEmBytes());
 }
 
 DataOutputStream& operator<<(DataOutputStream& dataOutputStream, Serializavel& variavel)
@@ -0,0 +1,619 @@
+/**
+ * @file ArvoreBLink.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo da classe ArvoreBLink.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include "templates/tipos.hpp"
+#include "helpersArvore.hpp"
+#include "ArvoreBMais.hpp"
+#include "PaginaBLink.hpp"
+
+#include <iostream>
+#include <list>
+#include <vector>
+#include <tuple>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Variante da árvore B+ de Lehman e Yao, a árvore B-link. Toda página tem
+ * uma chave alta e aponta para a irmã da direita (veja PaginaBLink), então uma
+ * divisão fica visível pela irmã da esquerda antes de o separador chegar ao pai.
+ * Uma descida que chega a uma página que já foi dividida só precisa andar para a
+ * direita, e nenhuma operação precisa travar as páginas de cima enquanto mexe
+ * nas de baixo.
+ *
+ * <p>As pesquisas e varreduras descem sem manter travas: cada página é travada
+ * para leitura apenas enquanto é copiada. As inserções descem da mesma forma e
+ * travam para escrita uma página por vez. Cada divisão escreve a irmã nova antes
+ * da página dividida, solta a trava dela e só então sobe com o separador. A
+ * única trava pega junto com outra é a da irmã da direita, ao andar para a
+ * direita, o que segue a ordem das travas (veja TabelaDeTravas).</p>
+ *
+ * <p>As exclusões tiram o registro da folha sem emprestar nem fundir páginas,
+ * como em Lehman e Yao, pois uma fusão teria que travar a pai e as duas irmãs ao
+ * mesmo tempo. Folhas podem ficar com poucos registros ou vazias; compactar()
+ * reconstrói a árvore sem elas.</p>
+ *
+ * @tparam TIPO_DAS_CHAVES Tipo da chave dos registros. <b>É necessário que a chave
+ * seja um tipo primitivo ou então que a sua classe/struct herde de Serializavel e
+ * tenha um construtor sem parâmetros.</b>
+ * @tparam TIPO_DOS_DADOS Tipo do dado dos registros. <b>É necessário que o dado
+ * seja um tipo primitivo ou então que a sua classe/struct herde de Serializavel e
+ * tenha um construtor sem parâmetros.</b>
+ * @tparam Pagina Tipo das páginas da árvore B-link. <b>É necessário que esse tipo
+ * seja serializável.</b>
+ */
+template<
+    typename TIPO_DAS_CHAVES,
+    typename TIPO_DOS_DADOS,
+    typename Pagina = PaginaBLink<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> >
+class ArvoreBLink : public ArvoreBMais< TIPO_DAS_CHAVES, TIPO_DOS_DADOS, Pagina >
+{
+public:
+    // ------------------------- Typedefs
+
+    typedef ArvoreBMais< TIPO_DAS_CHAVES, TIPO_DOS_DADOS, Pagina > ArvoreBMaisHerdada;
+
+protected:
+    // ------------------------- Campos e métodos herdados
+    // Com o using, esses campos da árvore B+ herdada ficam diretamente
+    // acessíveis nesta classe
+
+    using ArvoreBMaisHerdada::alocarPagina;
+    using ArvoreBMaisHerdada::atribuirErro;
+    using ArvoreBMaisHerdada::cache;
+    using ArvoreBMaisHerdada::carregar;
+    using ArvoreBMaisHerdada::destravarParaLeitura;
+    using ArvoreBMaisHerdada::destravarTudo;
+    using ArvoreBMaisHerdada::enderecoDaTravaDaRaiz;
+    using ArvoreBMaisHerdada::lerEnderecoDaRaiz;
+    using ArvoreBMaisHerdada::limparErro;
+    using ArvoreBMaisHerdada::ordemDaArvore;
+    using ArvoreBMaisHerdada::salvar;
+    using ArvoreBMaisHerdada::soltarTrava;
+    using ArvoreBMaisHerdada::travarARaizParaLeitura;
+    using ArvoreBMaisHerdada::travarParaEscrita;
+    using ArvoreBMaisHerdada::travarParaLeitura;
+    using ArvoreBMaisHerdada::trocarPaginaAnterior;
+    using ArvoreBMaisHerdada::trocarRaizPor;
+
+    // ------------------------- Métodos
+
+    /**
+     * @brief A árvore fica válida a cada trava solta (a irmã nova é escrita antes
+     * de ficar alcançável), então, com o diário, cada página mudada é confirmada
+     * ao ter a trava solta, em vez de a trava ficar até o fim da inserção.
+     */
+    bool confirmarAoSoltarCadaTrava() override
+    {
+        return true;
+    }
+
+    /**
+     * @brief Desce da raiz até a página onde a chave está ou deveria estar. Cada
+     * página é travada para leitura só enquanto é copiada e a trava é solta antes
+     * de a próxima ser pega. Quando a chave passa da chave alta de uma página, a
+     * descida anda para a irmã da direita dela.
+     *
+     * @param chave Chave a ser procurada.
+     * @param pagina Recebe a última página do percurso.
+     * @param irAteUmaFolha Indica se a descida não deve parar caso a chave seja
+     * encontrada em páginas que não sejam folhas.
+     * @param pai Caso não seja nullptr, recebe a penúltima página do percurso.
+     * @param indiceNoPai Caso não seja nullptr, recebe o índice do ponteiro do pai
+     * que levou à última página, ou -1 caso o percurso tenha só a raiz.
+     * @param pilhaDeEnderecos Caso não seja nullptr, recebe o endereço da página
+     * de cada nível pela qual a descida desceu, da raiz até o pai da última.
+     * @param manterTravada Caso seja true, a trava de leitura da última página
+     * fica com quem chamou.
+     * @param semEsperar Caso seja true, a descida desiste em vez de esperar por
+     * uma trava.
+     *
+     * @return true Caso a descida tenha chegado ao fim.
+     * @return false Caso a descida tenha desistido. Nenhuma trava fica pega.
+     */
+    bool descer(TIPO_DAS_CHAVES &chave, Pagina &pagina, bool irAteUmaFolha,
+        Pagina *pai, int *indiceNoPai, list<file_ptr_type> *pilhaDeEnderecos,
+        bool manterTravada, bool semEsperar)
+    {
+        file_ptr_type endereco;
+
+        if (indiceNoPai != nullptr) *indiceNoPai = -1;
+
+        if (!travarARaizParaLeitura(endereco, semEsperar)) return false;
+
+        while (true)
+        {
+            carregar(&pagina, endereco);
+
+            file_ptr_type proximoEndereco;
+            bool desceu = !pagina.estaAlemDaPagina(chave);
+
+            if (!desceu)
+            {
+                // A página foi dividida depois que o ponteiro para ela foi lido e a
+                // chave foi para a irmã da direita
+                proximoEndereco = pagina.ptrProximaPagina;
+            }
+
+            else
+            {
+                int indiceDeDescida = pagina.obterIndiceDeDescida(chave);
+                bool estaNaPagina = indiceDeDescida < pagina.tamanho() &&
+                    pagina.chaves[indiceDeDescida] == chave;
+
+                proximoEndereco = pagina.ponteiros[indiceDeDescida];
+
+                // Mesmas condições de parada da descida da árvore B
+                if (proximoEndereco == constantes::ptrNuloPagina ||
+                    (!irAteUmaFolha && estaNaPagina))
+                {
+                    if (!manterTravada) destravarParaLeitura(endereco);
+
+                    return true;
+                }
+
+                if (pai != nullptr) *pai = pagina;
+                if (indiceNoPai != nullptr) *indiceNoPai = indiceDeDescida;
+                if (pilhaDeEnderecos != nullptr) pilhaDeEnderecos->push_back(endereco);
+            }
+
+            // Nenhuma página some da árvore, então a próxima pode ser travada
+            // depois que a atual é solta
+            destravarParaLeitura(endereco);
+
+            if (!travarParaLeitura(proximoEndereco, semEsperar)) return false;
+
+            endereco = proximoEndereco;
+        }
+    }
+
+    bool localizar(TIPO_DAS_CHAVES &chave, Pagina &pagina, bool irAteUmaFolha,
+        Pagina *pai = nullptr, int *indiceNoPai = nullptr,
+        bool manterTravada = false, bool semEsperar = false) override
+    {
+        return descer(
+            chave, pagina, irAteUmaFolha, pai, indiceNoPai, nullptr, manterTravada, semEsperar);
+    }
+
+    void pesquisarVarios(
+        file_ptr_type endereco,
+        vector<TIPO_DAS_CHAVES> &chaves,
+        vector<int> &ordem, int inicio, int fim,
+        vector<TIPO_DOS_DADOS> &dados,
+        vector<bool> &encontradas,
+        bool irAteUmaFolha) override
+    {
+        vector< tuple<file_ptr_type, int, int> > descidas;
+        vector<file_ptr_type> filhas;
+        int indiceDeDescida = 0;
+        int inicioAlemDaPagina = fim;
+        Pagina pagina(ordemDaArvore);
+
+        // A página chega travada por quem chamou, mas só fica assim durante a cópia
+        carregar(&pagina, endereco);
+        destravarParaLeitura(endereco);
+
+        for (int i = inicio; i < fim; i++)
+        {
+            TIPO_DAS_CHAVES &chave = chaves[ordem[i]];
+
+            // As chaves estão ordenadas, então esta e as seguintes foram para a
+            // irmã da direita numa divisão
+            if (pagina.estaAlemDaPagina(chave))
+            {
+                inicioAlemDaPagina = i;
+                break;
+            }
+
+            indiceDeDescida = pagina.obterIndiceDeDescida(chave, indiceDeDescida);
+
+            file_ptr_type ponteiroDeDescida = pagina.ponteiros[indiceDeDescida];
+            bool estaNaPagina = indiceDeDescida < pagina.tamanho() &&
+                pagina.chaves[indiceDeDescida] == chave;
+
+            if (estaNaPagina &&
+                (!irAteUmaFolha || ponteiroDeDescida == constantes::ptrNuloPagina))
+            {
+                dados[ordem[i]] = pagina.dados[indiceDeDescida];
+                encontradas[ordem[i]] = true;
+            }
+
+            else if (ponteiroDeDescida != constantes::ptrNuloPagina)
+            {
+                if (!descidas.empty() && get<0>(descidas.back()) == ponteiroDeDescida)
+                {
+                    get<2>(descidas.back()) = i + 1;
+                }
+
+                else
+                {
+                    descidas.push_back( make_tuple(ponteiroDeDescida, i, i + 1) );
+                    filhas.push_back(ponteiroDeDescida);
+                }
+            }
+        }
+
+        // Trazer as filhas para o cache agora exigiria as travas de todas elas,
+        // então elas só são avisadas ao armazenamento
+        if (filhas.size() > 1) cache->preCarregar(filhas);
+
+        for (auto &&descida : descidas)
+        {
+            travarParaLeitura(get<0>(descida));
+            pesquisarVarios(
+                get<0>(descida), chaves, ordem, get<1>(descida), get<2>(descida),
+                dados, encontradas, irAteUmaFolha);
+        }
+
+        if (inicioAlemDaPagina < fim)
+        {
+            travarParaLeitura(pagina.ptrProximaPagina);
+            pesquisarVarios(
+                pagina.ptrProximaPagina, chaves, ordem, inicioAlemDaPagina, fim,
+                dados, encontradas, irAteUmaFolha);
+        }
+    }
+
+    /**
+     * @brief Pega a trava de escrita da página do endereço e a carrega na
+     * paginaFilha. Caso a chave passe da chave alta dela, anda para a direita,
+     * travando cada irmã antes de soltar a anterior, até a página onde a chave
+     * deve entrar.
+     *
+     * @return file_ptr_type Endereço da página carregada. A trava dela fica com a
+     * thread.
+     */
+    file_ptr_type travarPaginaDeInsercao(file_ptr_type endereco, TIPO_DAS_CHAVES &chave)
+    {
+        travarParaEscrita(endereco);
+        carregar(paginaFilha(), endereco);
+
+        while (paginaFilha()->estaAlemDaPagina(chave))
+        {
+            file_ptr_type proximoEndereco = paginaFilha()->ptrProximaPagina;
+
+            travarParaEscrita(proximoEndereco);
+            soltarTrava(endereco);
+
+            endereco = proximoEndereco;
+            carregar(paginaFilha(), endereco);
+        }
+
+        return endereco;
+    }
+
+    /**
+     * @brief Desce até a folha onde a chave deve entrar, como descer(), e a deixa
+     * travada para escrita na paginaFilha.
+     *
+     * @param chave Chave a ser inserida ou excluída.
+     * @param pilhaDeEnderecos Recebe o endereço da página de cada nível pela qual
+     * a descida desceu.
+     *
+     * @return file_ptr_type Endereço da folha.
+     */
+    file_ptr_type descerParaEscrever(
+        TIPO_DAS_CHAVES &chave, list<file_ptr_type> &pilhaDeEnderecos)
+    {
+        descer(chave, *paginaFilha(), true, nullptr, nullptr, &pilhaDeEnderecos, false, false);
+
+        return travarPaginaDeInsercao(paginaFilha()->obterEndereco(), chave);
+    }
+
+    /**
+     * @brief Divide a paginaFilha, que está cheia, inserindo nela ou na nova irmã
+     * a tripla (chave, dado, ponteiro). A irmã é escrita antes da paginaFilha,
+     * então ela já existe quando passa a ser alcançável pela paginaFilha.
+     *
+     * @return pair<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> Par que separa a paginaFilha
+     * da paginaIrma, a ser inserido no nível de cima.
+     */
+    pair<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> dividirPagina(
+        TIPO_DAS_CHAVES &chave, TIPO_DOS_DADOS &dado,
+        int indiceDeInsercao, file_ptr_type ponteiro)
+    {
+        paginaIrma()->limpar();
+        paginaIrma()->setEndereco( alocarPagina() );
+
+        auto separador = paginaFilha()->dividirCom(
+            paginaIrma(), chave, dado, indiceDeInsercao, ponteiro);
+
+        salvar(paginaIrma());
+        salvar(paginaFilha());
+
+        // Só a lista das folhas é percorrida nos dois sentidos
+        if (paginaIrma()->eUmaFolha() &&
+            paginaIrma()->ptrProximaPagina != constantes::ptrNuloPagina)
+        {
+            trocarPaginaAnterior(
+                paginaIrma()->ptrProximaPagina, paginaIrma()->obterEndereco());
+        }
+
+        return separador;
+    }
+
+    /**
+     * @brief Obtém a página do nível informado onde o separador de uma divisão
+     * deve ser inserido: a última página pela qual a descida passou nesse nível.
+     * Caso a página dividida seja a raiz, cria uma raiz nova com o separador.
+     *
+     * <p>Quando a descida começou por uma página que era a raiz e outra thread
+     * criou uma raiz nova depois disso, o caminho é refeito a partir dela. Caso
+     * ela ainda não tenha chegado ao nível, a thread espera a raiz ser criada pela
+     * thread que dividiu a antiga.</p>
+     *
+     * @param pilhaDeEnderecos Páginas da descida que ainda não foram usadas.
+     * @param nivel Nível da página procurada, sendo 0 (zero) o das folhas.
+     * @param chave Chave do separador.
+     * @param dado Dado do separador.
+     * @param esquerda Endereço da página que foi dividida.
+     * @param direita Endereço da irmã nova.
+     *
+     * @return file_ptr_type Endereço da página ou constantes::ptrNuloPagina caso
+     * uma raiz nova tenha sido criada.
+     */
+    file_ptr_type obterPaginaDoNivel(list<file_ptr_type> &pilhaDeEnderecos, int nivel,
+        TIPO_DAS_CHAVES &chave, TIPO_DOS_DADOS &dado,
+        file_ptr_type esquerda, file_ptr_type direita)
+    {
+        while (pilhaDeEnderecos.empty())
+        {
+            travarParaEscrita(enderecoDaTravaDaRaiz);
+
+            if (lerEnderecoDaRaiz() == esquerda)
+            {
+                paginaPai()->limpar();
+                paginaPai()->ponteiros.push_back(esquerda);
+                paginaPai()->inserir(chave, dado, 0, direita);
+                paginaPai()->setEndereco( alocarPagina() );
+
+                salvar(paginaPai());
+                trocarRaizPor(paginaPai());
+                soltarTrava(enderecoDaTravaDaRaiz);
+
+                return constantes::ptrNuloPagina;
+            }
+
+            soltarTrava(enderecoDaTravaDaRaiz);
+
+            Pagina folha(ordemDaArvore);
+
+            descer(chave, folha, true, nullptr, nullptr, &pilhaDeEnderecos, false, false);
+
+            // A pilha tem uma página de cada nível acima das folhas, a partir da
+            // raiz, e as dos níveis abaixo do procurado não interessam
+            if ((int) pilhaDeEnderecos.size() < nivel)
+            {
+                pilhaDeEnderecos.clear();
+                this_thread::yield();
+            }
+
+            else pilhaDeEnderecos.resize(pilhaDeEnderecos.size() - (nivel - 1));
+        }
+
+        file_ptr_type endereco = pilhaDeEnderecos.back();
+        pilhaDeEnderecos.pop_back();
+
+        return endereco;
+    }
+
+    /**
+     * @brief Insere o par (chave, dado) na paginaFilha, que deve ser a folha
+     * travada por descerParaEscrever(). Cada divisão sobe com o separador até uma
+     * página que não precise ser dividida, com a trava de uma página por vez.
+     */
+    void inserirNaFolha(file_ptr_type endereco, list<file_ptr_type> &pilhaDeEnderecos,
+        TIPO_DAS_CHAVES &chave, TIPO_DOS_DADOS &dado)
+    {
+        // A tripla que entra no nível atual. Acima das folhas, ela é o separador
+        // da divisão do nível de baixo e o endereço da irmã nova.
+        TIPO_DAS_CHAVES chaveAtual = chave;
+        TIPO_DOS_DADOS dadoAtual = dado;
+        file_ptr_type esquerda = constantes::ptrNuloPagina;
+        file_ptr_type direita = constantes::ptrNuloPagina;
+        int nivel = 0;
+
+        while (true)
+        {
+            int indiceDeInsercao = paginaFilha()->obterIndiceDeInsercao(chaveAtual, esquerda);
+
+            if (!paginaFilha()->cheia())
+            {
+                paginaFilha()->inserir(chaveAtual, dadoAtual, indiceDeInsercao, direita);
+                salvar(paginaFilha());
+                soltarTrava(endereco);
+
+                return;
+            }
+
+            auto separador = dividirPagina(chaveAtual, dadoAtual, indiceDeInsercao, direita);
+
+            chaveAtual = separador.first;
+            dadoAtual = separador.second;
+            esquerda = endereco;
+            direita = paginaIrma()->obterEndereco();
+
+            // A divisão já é visível pela página da esquerda, então a trava dela é
+            // solta antes de o separador subir
+            soltarTrava(endereco);
+
+            endereco = obterPaginaDoNivel(
+                pilhaDeEnderecos, ++nivel, chaveAtual, dadoAtual, esquerda, direita);
+
+            if (endereco == constantes::ptrNuloPagina) return;
+
+            endereco = travarPaginaDeInsercao(endereco, chaveAtual);
+        }
+    }
+
+    /**
+     * @brief Na compactação, todos os níveis mantêm as ligações entre as
+     * páginas vizinhas, não só o das folhas. As chaves altas não mudam.
+     */
+    void prepararPaginaCompactada(Pagina *pagina,
+        file_ptr_type paginaAnteriorNoNivel, file_ptr_type proximaPaginaNoNivel) override
+    {
+        pagina->ptrPaginaAnterior = paginaAnteriorNoNivel;
+        pagina->ptrProximaPagina = proximaPaginaNoNivel;
+    }
+
+    /**
+     * @brief Na carga em lote, o separador de cada página no nível de cima é a
+     * maior chave da subárvore dela, que passa a ser a chave alta dela.
+     */
+    void prepararPaginaDoLote(Pagina *pagina,
+        file_ptr_type paginaAnteriorNoNivel, file_ptr_type proximaPaginaNoNivel,
+        TIPO_DAS_CHAVES &maiorChave) override
+    {
+        pagina->ptrPaginaAnterior = paginaAnteriorNoNivel;
+        pagina->ptrProximaPagina = proximaPaginaNoNivel;
+        pagina->temChaveAlta = proximaPaginaNoNivel != constantes::ptrNuloPagina;
+        pagina->chaveAlta = pagina->temChaveAlta ? maiorChave : TIPO_DAS_CHAVES();
+    }
+
+public:
+    // ------------------------- Campos e métodos herdados
+    // Com o using, esses campos da árvore B+ herdada ficam diretamente
+    // acessíveis nesta classe
+
+    using ArvoreBMaisHerdada::excluir;
+    using ArvoreBMaisHerdada::inserir;
+    using ArvoreBMaisHerdada::paginaFilha;
+    using ArvoreBMaisHerdada::paginaIrma;
+    using ArvoreBMaisHerdada::paginaPai;
+    using ArvoreBMaisHerdada::pesquisarVarios;
+
+    // ------------------------- Construtores e destrutores
+
+    ArvoreBLink(string nomeDoArquivo, int ordemDaArvore,
+        int capacidadeDoCache = constantes::capacidadePadraoDoCache,
+        TipoDePolitica politicaDoCache = TipoDePolitica::LRU,
+        TipoDeArmazenamento tipoDeArmazenamento = TipoDeArmazenamento::FSTREAM,
+        PoliticaDoDiario politicaDoDiario = PoliticaDoDiario::NENHUM) :
+        ArvoreBMaisHerdada(nomeDoArquivo, ordemDaArvore, capacidadeDoCache,
+            politicaDoCache, tipoDeArmazenamento, politicaDoDiario) {}
+
+    // ------------------------- Métodos
+
+    void inserir(TIPO_DAS_CHAVES &chave, TIPO_DOS_DADOS &dado) override
+    {
+        list<file_ptr_type> pilhaDeEnderecos;
+        file_ptr_type folha = descerParaEscrever(chave, pilhaDeEnderecos);
+
+        inserirNaFolha(folha, pilhaDeEnderecos, chave, dado);
+        destravarTudo();
+    }
+
+    /**
+     * @brief Insere vários pares (chave, dado) de uma vez. Como na árvore B, os
+     * pares são ordenados e cada descida serve a todas as chaves seguidas que
+     * cabem na mesma folha, que é salva uma única vez.
+     *
+     * @param chaves Chaves dos pares, em qualquer ordem.
+     * @param dados Dados dos pares. dados[i] é o dado de chaves[i].
+     */
+    void inserirVarios(
+        vector<TIPO_DAS_CHAVES> &chaves, vector<TIPO_DOS_DADOS> &dados) override
+    {
+        if (chaves.size() != dados.size())
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[ArvoreBLink] A quantidade de chaves e de dados deve ser a mesma."
+                 << endl << "Exceção lançada" << endl;
+
+            throw invalid_argument(
+                "[ArvoreBLink] A quantidade de chaves e de dados deve ser a mesma.");
+        }
+
+        int quantidade = chaves.size();
+        vector<int> ordem(quantidade);
+
+        for (int i = 0; i < quantidade; i++) ordem[i] = i;
+
+        // A ordenação estável mantém as chaves iguais na ordem em que chegaram
+        stable_sort(ordem.begin(), ordem.end(),
+            [&chaves](int a, int b) { return chaves[a] < chaves[b]; });
+
+        int i = 0;
+
+        while (i < quantidade)
+        {
+            list<file_ptr_type> pilhaDeEnderecos;
+            file_ptr_type folha = descerParaEscrever(chaves[ordem[i]], pilhaDeEnderecos);
+            int inseridas = 0;
+
+            // As chaves seguintes entram na mesma folha enquanto couberem nela e não
+            // passarem da chave alta dela
+            while (i < quantidade && !paginaFilha()->cheia() &&
+                !paginaFilha()->estaAlemDaPagina(chaves[ordem[i]]))
+            {
+                TIPO_DAS_CHAVES &chave = chaves[ordem[i]];
+
+                paginaFilha()->inserir(
+                    chave, dados[ordem[i]], paginaFilha()->obterIndiceDeDescida(chave));
+
+                i++;
+                inseridas++;
+            }
+
+            if (inseridas > 0)
+            {
+                salvar(paginaFilha());
+                soltarTrava(folha);
+            }
+
+            // A folha já estava cheia, então a chave é inserida com divisão
+            else
+            {
+                inserirNaFolha(folha, pilhaDeEnderecos, chaves[ordem[i]], dados[ordem[i]]);
+
+                i++;
+            }
+
+            destravarTudo();
+        }
+    }
+
+    /**
+     * @brief Exclui o primeiro registro que for encontrado com a chave informada.
+     * Só a folha dele é travada e alterada (veja ArvoreBLink).
+     *
+     * @param chave Chave a ser procurada.
+     *
+     * @return TIPO_DOS_DADOS O dado correspondente à chave ou TIPO_DOS_DADOS() caso
+     * ela não seja encontrada. Nesse caso, a flag de erro é ativada.
+     */
+    TIPO_DOS_DADOS excluir(TIPO_DAS_CHAVES &chave) override
+    {
+        TIPO_DOS_DADOS dadoExcluido = TIPO_DOS_DADOS();
+        list<file_ptr_type> pilhaDeEnderecos;
+        file_ptr_type folha = descerParaEscrever(chave, pilhaDeEnderecos);
+        int indiceDaChave = paginaFilha()->obterIndiceDeDescida(chave);
+
+        if (indiceDaChave < paginaFilha()->tamanho() &&
+            paginaFilha()->chaves[indiceDaChave] == chave)
+        {
+            dadoExcluido = paginaFilha()->dados[indiceDaChave];
+            paginaFilha()->excluir(indiceDaChave, false, true);
+            salvar(paginaFilha());
+            limparErro();
+        }
+
+        else atribuirErro("A chave não foi encontrada");
+
+        soltarTrava(folha);
+        destravarTudo();
+
+        return dadoExcluido;
+    }
+};
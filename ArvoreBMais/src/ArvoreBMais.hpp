@@ -34,9 +34,20 @@
 #include <iostream>
 #include <fstream>
 #include <list>
+#include <deque>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <iterator>
 
 using namespace std;
 
+namespace constantes
+{
+    /** Quantidade máxima de folhas que uma varredura avisa antes de lê-las. */
+    static const size_t maximoDeFolhasPreCarregadas = 64;
+}
+
 /**
  * @brief Classe da árvore B+, uma estrutura eficiente para indexamento de registros
  * em disco.
@@ -66,29 +77,256 @@ protected:
     // Com o using, esses campos da árvore B herdada ficam diretamente
     // acessíveis nesta classe
 
+    using ArvoreBHerdada::alocarPagina;
     using ArvoreBHerdada::arquivo;
     using ArvoreBHerdada::atribuirErro;
+    using ArvoreBHerdada::cache;
     using ArvoreBHerdada::carregar;
+    using ArvoreBHerdada::carregarDaVersao;
+    using ArvoreBHerdada::destravarParaLeitura;
+    using ArvoreBHerdada::destravarTudo;
+    using ArvoreBHerdada::esvaziarArquivo;
+    using ArvoreBHerdada::excluirSemFundir;
     using ArvoreBHerdada::lerEnderecoDaRaiz;
+    using ArvoreBHerdada::liberarPagina;
     using ArvoreBHerdada::limparErro;
+    using ArvoreBHerdada::localizar;
+    using ArvoreBHerdada::nomeDoArquivo;
+    using ArvoreBHerdada::numeroDeChavesPorPagina;
     using ArvoreBHerdada::obterCaminhoDeDescida;
     using ArvoreBHerdada::obterPaginaDeInsercao;
     using ArvoreBHerdada::ordemDaArvore;
+    using ArvoreBHerdada::recomecarPagina;
+    using ArvoreBHerdada::salvar;
+    using ArvoreBHerdada::soltarTrava;
+    using ArvoreBHerdada::travarARaizParaLeitura;
+    using ArvoreBHerdada::travarIrma;
+    using ArvoreBHerdada::travarParaEscrita;
+    using ArvoreBHerdada::travarParaLeitura;
+    using ArvoreBHerdada::trocarRaizPor;
+
+    // ------------------------- Tipos
+
+    /**
+     * @brief Resumo de uma página já escrita pela carga em lote: o endereço dela
+     * e o maior par (chave, dado) da sua subárvore, que vira o separador dela no
+     * nível de cima.
+     */
+    struct ResumoDaPagina
+    {
+        TIPO_DAS_CHAVES maiorChave;
+        TIPO_DOS_DADOS dadoDaMaiorChave;
+        file_ptr_type endereco;
+    };
+
+    /**
+     * @brief Próximas folhas de uma varredura. Elas são avisadas ao armazenamento
+     * antes de serem lidas, para que a leitura delas aconteça enquanto a folha
+     * atual é processada.
+     * 
+     * <p>A janela começa com uma folha e dobra a cada folha lida, então uma
+     * varredura curta avisa poucas folhas e uma longa chega a avisar
+     * constantes::maximoDeFolhasPreCarregadas.</p>
+     */
+    struct JanelaDePreCarregamento
+    {
+        /** Próximas folhas conhecidas, na ordem da varredura. */
+        deque<file_ptr_type> folhas;
+
+        /** Quantas folhas do começo de folhas já foram avisadas. */
+        size_t avisadas = 0;
+
+        /** Quantas folhas devem estar avisadas à frente da varredura. */
+        size_t tamanho = 1;
+
+        /** Maior chave da varredura, caso ela tenha um fim. */
+        pair<bool, TIPO_DAS_CHAVES> limite;
+    };
 
     // ------------------------- Métodos
 
     /**
-     * @brief Faz com que a próxima página da irma seja a página para a qual
-     * a filha está apontando, depois, faz com que a filha aponte para a irma.
+     * @brief Coloca na janela as irmãs à direita da folha em que a última descida
+     * parou. Elas são as próximas folhas da varredura e os endereços delas estão
+     * no pai, então são conhecidos sem que as folhas sejam lidas.
+     * 
+     * @param janela Janela da varredura.
+     * @param pai Pai da folha, como localizar() o retorna.
+     * @param indiceNoPai Índice da folha no pai, ou -1 caso a folha seja a raiz.
+     */
+    void preencherJanela(JanelaDePreCarregamento &janela, Pagina &pai, int indiceNoPai)
+    {
+        janela.folhas.clear();
+        janela.avisadas = 0;
+
+        // Sem pai, a folha é a raiz e não tem irmãs
+        if (indiceNoPai < 0) return;
+
+        for (int i = indiceNoPai + 1; i <= pai.tamanho(); i++)
+        {
+            // As chaves da irmã são maiores que a chave à esquerda dela no pai, então
+            // as irmãs depois do fim da varredura não são lidas
+            if (janela.limite.first && janela.limite.second < pai.chaves[i - 1]) break;
+
+            janela.folhas.push_back(pai.ponteiros[i]);
+        }
+    }
+
+    /**
+     * @brief Atualiza a janela quando a varredura vai para a próxima folha e
+     * avisa as folhas que entraram nela.
+     * 
+     * @param janela Janela da varredura.
+     * @param folha Folha em que a varredura está. A próxima dela é a que a
+     * varredura vai ler agora.
+     */
+    void avancarJanela(JanelaDePreCarregamento &janela, Pagina &folha)
+    {
+        file_ptr_type proximaFolha = folha.ptrProximaPagina;
+
+        if (!janela.folhas.empty() && janela.folhas.front() == proximaFolha)
+        {
+            janela.folhas.pop_front();
+
+            if (janela.avisadas > 0) janela.avisadas--;
+        }
+
+        else
+        {
+            // A lista de folhas não bate com o pai, então a janela é descartada
+            janela.folhas.clear();
+            janela.avisadas = 0;
+        }
+
+        janela.tamanho = min(2 * janela.tamanho, constantes::maximoDeFolhasPreCarregadas);
+
+        // Os avisos são feitos em grupos, quando metade das folhas avisadas já foi
+        // lida, para que folhas vizinhas no arquivo sejam avisadas juntas
+        if (2 * janela.avisadas <= janela.tamanho)
+        {
+            size_t fim = min(janela.tamanho, janela.folhas.size());
+            file_ptr_type tamanhoDaPagina = folha.obterTamanhoMaximoEmBytes();
+            file_ptr_type anterior = janela.avisadas > 0 ?
+                janela.folhas[janela.avisadas - 1] : proximaFolha;
+            bool emSequencia = true;
+
+            for (size_t i = janela.avisadas; i < fim && emSequencia; i++)
+            {
+                emSequencia = janela.folhas[i] == anterior + tamanhoDaPagina;
+                anterior = janela.folhas[i];
+            }
+
+            // Folhas que vêm uma depois da outra no arquivo, como as da carga em
+            // lote e as da compactação, já são lidas adiantado pelo sistema
+            // operacional, e os avisos só atrapalhariam a leitura antecipada dele
+            if (!emSequencia)
+            {
+                cache->preCarregar(vector<file_ptr_type>(
+                    janela.folhas.begin() + janela.avisadas, janela.folhas.begin() + fim));
+            }
+
+            janela.avisadas = max(janela.avisadas, fim);
+        }
+    }
+
+    /**
+     * @brief Quando a janela acaba, a varredura passou para as folhas de outro
+     * pai. Uma nova descida, pela maior chave da folha atual, chega a esse pai e
+     * a janela passa a ter as irmãs da folha. As páginas internas normalmente
+     * estão no cache, então a descida não lê o arquivo.
+     * 
+     * <p>Quem chama pode ter a trava da folha, então a descida desiste em vez de
+     * esperar pelas travas das páginas de cima, e a janela continua vazia.</p>
+     * 
+     * @param janela Janela da varredura.
+     * @param folha Folha em que a varredura está.
+     */
+    void reabastecerJanela(JanelaDePreCarregamento &janela, Pagina &folha)
+    {
+        // Numa folha vazia não há chave para descer e, caso a maior chave já passe
+        // do fim, a varredura termina nesta folha
+        if (!janela.folhas.empty() || folha.vazia() ||
+            (janela.limite.first && janela.limite.second < folha.chaves.back()))
+        {
+            return;
+        }
+
+        Pagina folhaDaDescida(ordemDaArvore), pai(ordemDaArvore);
+        int indiceNoPai;
+
+        bool chegou = localizar(
+            folha.chaves.back(), folhaDaDescida, true, &pai, &indiceNoPai, false, true);
+
+        // A descida pode parar em outra folha quando há chaves repetidas
+        if (chegou && folhaDaDescida.obterEndereco() == folha.obterEndereco())
+        {
+            preencherJanela(janela, pai, indiceNoPai);
+        }
+    }
+
+    /**
+     * @brief Faz a página do endereço informado apontar para uma nova página
+     * anterior.
+     * 
+     * @param endereco Endereço da página a ser atualizada.
+     * @param novaPaginaAnterior Endereço da nova página anterior.
+     */
+    void trocarPaginaAnterior(file_ptr_type endereco, file_ptr_type novaPaginaAnterior)
+    {
+        // As páginas da árvore podem estar em uso por quem chamou, então a
+        // vizinha é carregada numa página à parte
+        Pagina vizinha(ordemDaArvore);
+
+        // A vizinha fica à direita, então pode ser esperada. A trava é solta logo,
+        // pois nada mais muda nela.
+        bool travouAgora = travarParaEscrita(endereco);
+
+        carregar(&vizinha, endereco);
+        vizinha.ptrPaginaAnterior = novaPaginaAnterior;
+        salvar(&vizinha);
+
+        if (travouAgora) soltarTrava(endereco);
+    }
+
+    /**
+     * @brief Coloca a irma entre a filha e a página para a qual a filha está
+     * apontando. Nas folhas, também ajusta os ponteiros para a página anterior.
      * 
      * @param filha Página à esquerda na divisão.
      * @param irma Página à direita na divisão.
      */
     void atualizarAposADivisao(Pagina *filha, Pagina *irma)
     {
-        irma->setEndereco( obterTamanhoEmBytes(arquivo) );
+        // O endereço é reservado agora para que a filha já possa apontar para a
+        // irmã. Reservá-lo evita que outra página nova receba o mesmo endereço.
+        irma->setEndereco( alocarPagina() );
         irma->ptrProximaPagina = filha->ptrProximaPagina;
         filha->ptrProximaPagina = irma->obterEndereco();
+
+        // Só a lista das folhas é percorrida, os ponteiros das páginas internas
+        // não são mantidos e podem estar desatualizados
+        if (filha->eUmaFolha())
+        {
+            irma->ptrPaginaAnterior = filha->obterEndereco();
+
+            if (irma->ptrProximaPagina != constantes::ptrNuloPagina)
+            {
+                trocarPaginaAnterior(irma->ptrProximaPagina, irma->obterEndereco());
+            }
+        }
+    }
+
+    /**
+     * @brief Na compactação, as folhas ficam em sequência no arquivo, então as
+     * vizinhas de cada uma são as páginas ao lado dela no arquivo compactado.
+     */
+    void prepararPaginaCompactada(Pagina *pagina,
+        file_ptr_type paginaAnteriorNoNivel, file_ptr_type proximaPaginaNoNivel) override
+    {
+        bool folha = pagina->eUmaFolha();
+
+        pagina->ptrPaginaAnterior = folha ? paginaAnteriorNoNivel : constantes::ptrNuloPagina;
+        pagina->ptrProximaPagina = folha ? proximaPaginaNoNivel : constantes::ptrNuloPagina;
     }
 
     pair<Pagina *, bool> dividir(Pagina *filha, Pagina *irma, TIPO_DAS_CHAVES &chave)
@@ -104,46 +342,135 @@ protected:
         int indiceDePromocao, Pagina *paginaDeInsercao,
         bool inseriuNaPaginaFilha, pair<Pagina *, bool> &infoPai)
     {
+        // O separador de duas folhas é sempre a maior chave da esquerda, como na
+        // carga em lote, pois a descida vai para a esquerda quando acha a chave
+        if (paginaDeInsercao->eUmaFolha())
+        {
+            paginaDeInsercao = paginaFilha();
+            inseriuNaPaginaFilha = true;
+        }
+
+        // Caso a paginaPai seja dividida, dividir() já reserva o endereço da
+        // irmã dela e a encadeia
         ArvoreBHerdada::promoverOParQueEstiverSobrando(
             indiceDePromocao, paginaDeInsercao,
             inseriuNaPaginaFilha, infoPai);
+    }
 
-        // Checa se a paginaPai teve que ser dividida antes da promoção
-        if (infoPai.first != nullptr)
+    /**
+     * @brief Nas folhas, o registro passa direto da irmã para a filha, já que a
+     * pai só tem cópias das chaves, e o separador entre elas é trocado pela nova
+     * maior chave da folha da esquerda. Nas páginas internas, o empréstimo passa
+     * pela pai como na árvore B.
+     */
+    bool pegarChaveDaPagina(
+        file_ptr_type enderecoDaPagina, int indiceDeDescida, bool pegarChaveDoFim) override
+    {
+        // Uma página interna pode ter ficado vazia na fusão do nível de baixo e
+        // eUmaFolha() considera folha toda página vazia
+        if (paginaFilha()->ponteiros[0] != constantes::ptrNuloPagina)
         {
-            atualizarAposADivisao(paginaPai, paginaIrmaPai);
+            return ArvoreBHerdada::pegarChaveDaPagina(
+                enderecoDaPagina, indiceDeDescida, pegarChaveDoFim);
+        }
+
+        bool sucesso = false;
+
+        // A chave do fim vem da irmã da esquerda
+        if (travarIrma(enderecoDaPagina, pegarChaveDoFim) &&
+            carregar(paginaIrma(), enderecoDaPagina) &&
+            paginaIrma()->tamanho() > numeroDeChavesPorPagina / 2)
+        {
+            int indiceDoSeparador =
+                pegarChaveDoFim ? indiceDeDescida - 1 : indiceDeDescida;
+
+            int indiceNaPaginaIrma = pegarChaveDoFim ? paginaIrma()->tamanho() - 1 : 0;
+            int indiceNaPaginaFilha = pegarChaveDoFim ? 0 : paginaFilha()->tamanho();
+
+            // Nas folhas, transferirElementoPara só copia o registro
+            paginaIrma()->transferirElementoPara(
+                paginaFilha(), indiceNaPaginaFilha, indiceNaPaginaIrma);
+            paginaIrma()->excluir(indiceNaPaginaIrma, false, true);
+
+            Pagina *esquerda = pegarChaveDoFim ? paginaIrma() : paginaFilha();
+            TIPO_DAS_CHAVES separador = esquerda->chaves.back();
+            TIPO_DOS_DADOS dadoDoSeparador = esquerda->dados.back();
+
+            paginaPai()->excluir(indiceDoSeparador);
+            paginaPai()->inserir(separador, dadoDoSeparador, indiceDoSeparador,
+                constantes::ptrNuloPagina, false);
+
+            salvar(paginaPai());
+            salvar(paginaIrma());
+
+            sucesso = true;
         }
+
+        return sucesso;
     }
 
+    /**
+     * @brief Nas folhas, o separador só sai da pai, junto com o ponteiro para a
+     * página da direita, porque o registro dele já está na folha da esquerda.
+     */
     bool fundirCom(
         file_ptr_type enderecoDaPagina, int indiceDeDescida, bool fundirDireita) override
     {
         bool sucesso = false;
 
-        if (carregar(paginaIrma, enderecoDaPagina))
+        if (travarIrma(enderecoDaPagina, !fundirDireita) &&
+            carregar(paginaIrma(), enderecoDaPagina))
         {
+            bool folha = paginaFilha()->ponteiros[0] == constantes::ptrNuloPagina;
+
             if (fundirDireita)
             {
-                paginaPai->transferirElementoPara(
-                    paginaFilha, paginaFilha->tamanho(), indiceDeDescida,
+                // Sem o separador, sobra um dos ponteiros nulos das duas folhas
+                if (folha)
+                {
+                    paginaPai()->excluir(indiceDeDescida, false, true);
+                    paginaFilha()->ponteiros.pop_back();
+                }
+
+                else paginaPai()->transferirElementoPara(
+                    paginaFilha(), paginaFilha()->tamanho(), indiceDeDescida,
                     false, true, false);
                     
-                paginaIrma->transferirTudoPara(paginaFilha);
-                paginaFilha->ptrProximaPagina = paginaIrma->ptrProximaPagina;
+                paginaIrma()->transferirTudoPara(paginaFilha());
+                paginaFilha()->ptrProximaPagina = paginaIrma()->ptrProximaPagina;
             }
 
             else
             {
-                paginaPai->transferirElementoPara(
-                    paginaIrma, paginaIrma->tamanho(), indiceDeDescida - 1,
+                if (folha)
+                {
+                    paginaPai()->excluir(indiceDeDescida - 1, false, true);
+                    paginaIrma()->ponteiros.pop_back();
+                }
+
+                else paginaPai()->transferirElementoPara(
+                    paginaIrma(), paginaIrma()->tamanho(), indiceDeDescida - 1,
                     false, true, false);
                     
-                paginaFilha->transferirTudoPara(paginaIrma);
-                paginaIrma->ptrProximaPagina = paginaFilha->ptrProximaPagina;
+                paginaFilha()->transferirTudoPara(paginaIrma());
+                paginaIrma()->ptrProximaPagina = paginaFilha()->ptrProximaPagina;
+
+                // A paginaFilha sempre fica com o resultado da fusão
+                swap(paginaFilha(), paginaIrma());
+            }
+
+            if (paginaFilha()->eUmaFolha() &&
+                paginaFilha()->ptrProximaPagina != constantes::ptrNuloPagina)
+            {
+                trocarPaginaAnterior(
+                    paginaFilha()->ptrProximaPagina, paginaFilha()->obterEndereco());
             }
 
-            paginaPai->colocarNoArquivo(arquivo);
-            paginaIrma->colocarNoArquivo(arquivo);
+            salvar(paginaPai());
+            salvar(paginaFilha());
+
+            // A página que ficou vazia volta para a lista de páginas livres
+            liberarPagina(paginaIrma());
 
             sucesso = true;
         }
@@ -151,27 +478,420 @@ protected:
         return sucesso;
     }
 
+    /**
+     * @brief Ajusta uma página da carga em lote antes de ela ser escrita. Classes
+     * filhas podem sobrescrever este método para ajustar os seus próprios campos.
+     * 
+     * @param pagina Página que será escrita no arquivo.
+     * @param paginaAnteriorNoNivel Endereço da página à esquerda desta no mesmo
+     * nível ou constantes::ptrNuloPagina caso esta seja a primeira do nível.
+     * @param proximaPaginaNoNivel Endereço da página à direita desta no mesmo
+     * nível ou constantes::ptrNuloPagina caso esta seja a última do nível.
+     * @param maiorChave Maior chave da subárvore da página.
+     */
+    virtual void prepararPaginaDoLote(Pagina * /* pagina */,
+        file_ptr_type /* paginaAnteriorNoNivel */, file_ptr_type /* proximaPaginaNoNivel */,
+        TIPO_DAS_CHAVES & /* maiorChave */) {}
+
+    /**
+     * @brief Escreve a folha diretamente no arquivo, sem passar pelo cache, e
+     * guarda o resumo dela para a construção do nível de cima.
+     */
+    void escreverFolhaDoLote(
+        Pagina *folha, vector<ResumoDaPagina> &folhas, char *buffer)
+    {
+        TIPO_DAS_CHAVES maiorChave =
+            folha->tamanho() > 0 ? folha->chaves.back() : TIPO_DAS_CHAVES();
+
+        prepararPaginaDoLote(
+            folha, folha->ptrPaginaAnterior, folha->ptrProximaPagina, maiorChave);
+
+        folha->colocarNoArquivo(*arquivo, buffer);
+
+        if (folha->tamanho() > 0)
+        {
+            folhas.push_back(
+                { folha->chaves.back(), folha->dados.back(), folha->obterEndereco() });
+        }
+    }
+
+    /**
+     * @brief Constrói e escreve as páginas internas que apontam para as páginas
+     * do nível de baixo. As filhas são distribuídas igualmente entre as páginas
+     * e cada página interna fica com pelo menos duas filhas.
+     * 
+     * @param filhas Resumos das páginas do nível de baixo, em ordem.
+     * @param filhasPorPagina Quantidade desejada de filhas em cada página.
+     * @param buffer Buffer com o tamanho de uma página.
+     * 
+     * @return vector<ResumoDaPagina> Resumos das páginas construídas.
+     */
+    vector<ResumoDaPagina> construirNivelInterno(
+        vector<ResumoDaPagina> &filhas, int filhasPorPagina, char *buffer)
+    {
+        int quantidadeDeFilhas = filhas.size();
+        int quantidadeDePaginas =
+            (quantidadeDeFilhas + filhasPorPagina - 1) / filhasPorPagina;
+
+        quantidadeDePaginas = max(1, min(quantidadeDePaginas, quantidadeDeFilhas / 2));
+
+        vector<ResumoDaPagina> nivel;
+        int indiceDaFilha = 0;
+        // O endereço de cada página é reservado antes de a anterior ser escrita,
+        // para que a anterior já saiba quem vem depois dela
+        file_ptr_type anterior = constantes::ptrNuloPagina;
+        file_ptr_type endereco = alocarPagina();
+
+        nivel.reserve(quantidadeDePaginas);
+
+        for (int i = 0; i < quantidadeDePaginas; i++)
+        {
+            int filhasNaPagina = quantidadeDeFilhas / quantidadeDePaginas +
+                (i < quantidadeDeFilhas % quantidadeDePaginas ? 1 : 0);
+            file_ptr_type proxima = i + 1 < quantidadeDePaginas ?
+                alocarPagina() : constantes::ptrNuloPagina;
+
+            recomecarPagina(paginaPai(), endereco);
+            paginaPai()->ponteiros[0] = filhas[indiceDaFilha].endereco;
+
+            // O separador entre duas filhas é a maior chave da filha da esquerda,
+            // pois a descida usa o lower_bound
+            for (int j = 1; j < filhasNaPagina; j++)
+            {
+                ResumoDaPagina &esquerda = filhas[indiceDaFilha + j - 1];
+
+                paginaPai()->inserir(
+                    esquerda.maiorChave, esquerda.dadoDaMaiorChave,
+                    j - 1, filhas[indiceDaFilha + j].endereco);
+            }
+
+            indiceDaFilha += filhasNaPagina;
+
+            ResumoDaPagina &ultima = filhas[indiceDaFilha - 1];
+
+            prepararPaginaDoLote(paginaPai(), anterior, proxima, ultima.maiorChave);
+            paginaPai()->colocarNoArquivo(*arquivo, buffer);
+
+            nivel.push_back(
+                { ultima.maiorChave, ultima.dadoDaMaiorChave, paginaPai()->obterEndereco() });
+
+            anterior = endereco;
+            endereco = proxima;
+        }
+
+        return nivel;
+    }
+
     int obterDadosComAChaveEntre(
+        Pagina &folha,
         TIPO_DAS_CHAVES &chaveMenor,
         TIPO_DAS_CHAVES &chaveMaior,
         vector<TIPO_DOS_DADOS> &dados)
     {
         // Obtém o índice onde a chave deveria estar na página.
-        int indiceDaChave = paginaFilha->obterIndiceDeDescida(chaveMenor);
+        int indiceDaChave = folha.obterIndiceDeDescida(chaveMenor);
         int indiceFinal = 
-            upper_bound(paginaFilha->chaves.begin() + indiceDaChave,
-                paginaFilha->chaves.end(), chaveMaior)
-                - paginaFilha->chaves.begin();
+            upper_bound(folha.chaves.begin() + indiceDaChave,
+                folha.chaves.end(), chaveMaior)
+                - folha.chaves.begin();
 
         for (size_t i = indiceDaChave; i < indiceFinal; i++)
         {
-            dados.push_back(paginaFilha->dados[i]);
+            dados.push_back(folha.dados[i]);
         }
 
         return indiceFinal;
     }
 
+    /**
+     * @brief Desce até a folha da chave menor e anda pela lista de folhas da
+     * versão. A versão não muda, então as páginas não precisam de travas.
+     */
+    void listarNoInstantaneo(
+        TIPO_DAS_CHAVES &chaveMenor,
+        TIPO_DAS_CHAVES &chaveMaior,
+        vector<TIPO_DOS_DADOS> &dados,
+        file_ptr_type enderecoPaginaAtual,
+        uint64_t versao) override
+    {
+        Pagina pagina(ordemDaArvore);
+
+        carregarDaVersao(&pagina, enderecoPaginaAtual, versao);
+
+        while (!pagina.eUmaFolha())
+        {
+            file_ptr_type filha =
+                pagina.ponteiros[pagina.obterIndiceDeDescida(chaveMenor)];
+
+            carregarDaVersao(&pagina, filha, versao);
+        }
+
+        while (obterDadosComAChaveEntre(pagina, chaveMenor, chaveMaior, dados) ==
+            pagina.tamanho() && pagina.ptrProximaPagina != constantes::ptrNuloPagina)
+        {
+            carregarDaVersao(&pagina, pagina.ptrProximaPagina, versao);
+        }
+    }
+
 public:
+    // ------------------------- Tipos
+
+    /**
+     * @brief Cursor sobre os registros da árvore, na ordem das chaves. Ele anda
+     * pela lista de folhas uma página de cada vez, nos dois sentidos, então uma
+     * varredura usa memória constante e pode parar a qualquer momento.
+     * 
+     * <p>O cursor também é um iterador bidirecional da STL, cujos elementos são
+     * pares (chave, dado). Veja begin(), end() e obterCursor(). Cada folha é lida
+     * com a trava de leitura dela, mas o cursor não fica com travas entre uma
+     * chamada e outra, então alterar a árvore invalida os cursores que
+     * existirem.</p>
+     */
+    class Cursor
+    {
+    public:
+        // ------------------------- Typedefs
+
+        typedef bidirectional_iterator_tag iterator_category;
+        typedef pair<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef const value_type &reference;
+
+    private:
+        // ------------------------- Campos
+
+        ArvoreBMais *arvore;
+        Pagina folha;
+        int indice;
+        bool posicionado;
+        value_type atual;
+        JanelaDePreCarregamento janela;
+
+        // ------------------------- Métodos
+
+        /**
+         * @brief Anda pela lista de folhas, no sentido informado, até uma folha
+         * que não esteja vazia.
+         * 
+         * @return true Caso encontre uma folha.
+         * @return false Caso a lista acabe antes.
+         */
+        bool irParaAFolhaVizinha(bool paraADireita)
+        {
+            do
+            {
+                file_ptr_type vizinha = paraADireita ?
+                    folha.ptrProximaPagina : folha.ptrPaginaAnterior;
+
+                if (vizinha == constantes::ptrNuloPagina) return false;
+
+                // Só a ida para a direita tem folhas pré-carregadas
+                if (paraADireita) arvore->avancarJanela(janela, folha);
+
+                // As folhas da varredura são marcadas como acesso sequencial para
+                // que não tirem os níveis internos da árvore do cache
+                arvore->travarParaLeitura(vizinha);
+                arvore->carregar(&folha, vizinha, true);
+                arvore->destravarParaLeitura(vizinha);
+            }
+            while (folha.vazia());
+
+            if (paraADireita) arvore->reabastecerJanela(janela, folha);
+
+            indice = paraADireita ? 0 : folha.tamanho() - 1;
+
+            return true;
+        }
+
+        /**
+         * @brief Desce da raiz até a folha mais à esquerda ou mais à direita.
+         */
+        void descerPelaBorda(bool pelaEsquerda)
+        {
+            file_ptr_type endereco;
+
+            arvore->travarARaizParaLeitura(endereco);
+            arvore->carregar(&folha, endereco);
+
+            while (!folha.eUmaFolha())
+            {
+                file_ptr_type filha =
+                    pelaEsquerda ? folha.ponteiros.front() : folha.ponteiros.back();
+
+                // A filha é travada antes que a página atual seja solta
+                arvore->travarParaLeitura(filha);
+                arvore->destravarParaLeitura(endereco);
+
+                endereco = filha;
+                arvore->carregar(&folha, endereco);
+            }
+
+            // A última folha é a que não tem próxima. Numa árvore que é dividida
+            // sem travar as páginas de cima (veja ArvoreBLink), ela pode ainda não
+            // ter chegado ao pai.
+            while (!pelaEsquerda && folha.ptrProximaPagina != constantes::ptrNuloPagina)
+            {
+                file_ptr_type proxima = folha.ptrProximaPagina;
+
+                arvore->travarParaLeitura(proxima);
+                arvore->destravarParaLeitura(endereco);
+
+                endereco = proxima;
+                arvore->carregar(&folha, endereco);
+            }
+
+            arvore->destravarParaLeitura(endereco);
+        }
+
+        bool atualizar(bool posicionado)
+        {
+            this->posicionado = posicionado;
+
+            if (posicionado)
+            {
+                atual = value_type(folha.chaves[indice], folha.dados[indice]);
+            }
+
+            return posicionado;
+        }
+
+    public:
+        // ------------------------- Construtores
+
+        /**
+         * @brief Constrói um cursor que ainda não está em nenhum registro, igual
+         * a ArvoreBMais::end().
+         */
+        Cursor(ArvoreBMais *arvore) :
+            arvore(arvore),
+            folha(arvore->ordemDaArvore),
+            indice(0),
+            posicionado(false) {}
+
+        // ------------------------- Métodos
+
+        /**
+         * @brief Posiciona o cursor no primeiro registro com a chave maior ou
+         * igual à informada.
+         * 
+         * @return true Caso exista esse registro.
+         */
+        bool posicionar(TIPO_DAS_CHAVES &chave)
+        {
+            Pagina pai(arvore->ordemDaArvore);
+            int indiceNoPai;
+
+            arvore->localizar(chave, folha, true, &pai, &indiceNoPai);
+            arvore->preencherJanela(janela, pai, indiceNoPai);
+            indice = folha.obterIndiceDeDescida(chave);
+
+            return atualizar(indice < folha.tamanho() || irParaAFolhaVizinha(true));
+        }
+
+        bool posicionarNoInicio()
+        {
+            descerPelaBorda(true);
+            indice = 0;
+
+            return atualizar(!folha.vazia() || irParaAFolhaVizinha(true));
+        }
+
+        bool posicionarNoFim()
+        {
+            descerPelaBorda(false);
+            indice = folha.tamanho() - 1;
+
+            return atualizar(!folha.vazia() || irParaAFolhaVizinha(false));
+        }
+
+        /**
+         * @brief Vai para o próximo registro.
+         * 
+         * @return false Caso não haja um próximo registro. Nesse caso, o cursor
+         * fica igual a ArvoreBMais::end().
+         */
+        bool avancar()
+        {
+            if (!posicionado) return false;
+
+            indice++;
+
+            return atualizar(indice < folha.tamanho() || irParaAFolhaVizinha(true));
+        }
+
+        /**
+         * @brief Vai para o registro anterior. Caso o cursor não esteja em nenhum
+         * registro, vai para o último.
+         * 
+         * @return false Caso não haja um registro anterior.
+         */
+        bool voltar()
+        {
+            if (!posicionado) return posicionarNoFim();
+
+            indice--;
+
+            return atualizar(indice >= 0 || irParaAFolhaVizinha(false));
+        }
+
+        bool valido() { return posicionado; }
+        TIPO_DAS_CHAVES chave() { return atual.first; }
+        TIPO_DOS_DADOS dado() { return atual.second; }
+
+        // ------------------------- Operadores
+
+        reference operator*() { return atual; }
+        pointer operator->() { return &atual; }
+
+        Cursor &operator++()
+        {
+            avancar();
+
+            return *this;
+        }
+
+        Cursor operator++(int)
+        {
+            Cursor copia = *this;
+            avancar();
+
+            return copia;
+        }
+
+        Cursor &operator--()
+        {
+            voltar();
+
+            return *this;
+        }
+
+        Cursor operator--(int)
+        {
+            Cursor copia = *this;
+            voltar();
+
+            return copia;
+        }
+
+        bool operator==(const Cursor &outro) const
+        {
+            if (!posicionado || !outro.posicionado)
+            {
+                return posicionado == outro.posicionado;
+            }
+
+            return indice == outro.indice &&
+                const_cast<Pagina &>(folha).obterEndereco() ==
+                const_cast<Pagina &>(outro.folha).obterEndereco();
+        }
+
+        bool operator!=(const Cursor &outro) const
+        {
+            return !(*this == outro);
+        }
+    };
+
     // ------------------------- Campos e métodos herdados
     // Com o using, esses campos da árvore B herdada ficam diretamente
     // acessíveis nesta classe
@@ -183,10 +903,17 @@ public:
     using ArvoreBHerdada::paginaIrmaPai;
     using ArvoreBHerdada::paginaPai;
     using ArvoreBHerdada::pesquisar;
+    using ArvoreBHerdada::pesquisarVarios;
 
     // ------------------------- Construtores e destrutores
 
-    ArvoreBMais(string nomeDoArquivo, int ordemDaArvore) : ArvoreBHerdada(nomeDoArquivo, ordemDaArvore) {}
+    ArvoreBMais(string nomeDoArquivo, int ordemDaArvore,
+        int capacidadeDoCache = constantes::capacidadePadraoDoCache,
+        TipoDePolitica politicaDoCache = TipoDePolitica::LRU,
+        TipoDeArmazenamento tipoDeArmazenamento = TipoDeArmazenamento::FSTREAM,
+        PoliticaDoDiario politicaDoDiario = PoliticaDoDiario::NENHUM) :
+        ArvoreBHerdada(nomeDoArquivo, ordemDaArvore, capacidadeDoCache,
+            politicaDoCache, tipoDeArmazenamento, politicaDoDiario) {}
 
     // ------------------------- Métodos
 
@@ -195,14 +922,209 @@ public:
         return pesquisar(chave, true);
     }
 
+    vector<TIPO_DOS_DADOS> pesquisarVarios(
+        vector<TIPO_DAS_CHAVES> &chaves, vector<bool> &encontradas) override
+    {
+        return pesquisarVarios(chaves, encontradas, true);
+    }
+
+    /**
+     * @brief Obtém um cursor no primeiro registro com a chave maior ou igual à
+     * informada, ou igual a end() caso não exista esse registro.
+     */
+    Cursor obterCursor(TIPO_DAS_CHAVES &chave)
+    {
+        Cursor cursor(this);
+
+        cursor.posicionar(chave);
+
+        return cursor;
+    }
+
+    Cursor obterCursor(TIPO_DAS_CHAVES &&chave)
+    {
+        return obterCursor(chave);
+    }
+
+    /**
+     * @brief Obtém um cursor no registro com a menor chave.
+     */
+    Cursor begin()
+    {
+        Cursor cursor(this);
+
+        cursor.posicionarNoInicio();
+
+        return cursor;
+    }
+
+    /**
+     * @brief Obtém um cursor que não está em nenhum registro, que é onde os
+     * cursores param depois do último registro.
+     */
+    Cursor end()
+    {
+        return Cursor(this);
+    }
+
     TIPO_DOS_DADOS excluir(TIPO_DAS_CHAVES &chave) override
     {
+        TIPO_DOS_DADOS dadoExcluido = TIPO_DOS_DADOS();
+
+        // A maioria das exclusões não funde a folha e só precisa da trava dela
+        if (excluirSemFundir(chave, true, dadoExcluido)) return dadoExcluido;
+
         // Faz todo o percurso de descida na árvore
-        auto parDoCaminho = obterCaminhoDeDescida(chave, 0, lerEnderecoDaRaiz(), true);
+        auto parDoCaminho = obterCaminhoDeDescida(chave, false, true);
         auto &pilhaDeEnderecos = parDoCaminho.first;
         auto &pilhaDeIndices = parDoCaminho.second;
 
-        return excluir(chave, pilhaDeEnderecos, pilhaDeIndices);
+        dadoExcluido = excluir(chave, pilhaDeEnderecos, pilhaDeIndices);
+
+        destravarTudo();
+
+        return dadoExcluido;
+    }
+
+    /**
+     * @brief Substitui todo o conteúdo da árvore pelos pares (chave, dado) do
+     * intervalo, que devem estar ordenados pela chave. As folhas são preenchidas
+     * da esquerda para a direita e os níveis internos são construídos de baixo
+     * para cima, escrevendo cada página uma única vez e sem passar pelo cache.
+     * 
+     * <p>Funciona com qualquer iterador cujos elementos tenham os campos first
+     * (chave) e second (dado), como os de vector< pair<chave, dado> >, os de map
+     * ou um istream_iterator, já que o intervalo é percorrido uma única vez.</p>
+     * 
+     * @param inicio Iterador para o primeiro par.
+     * @param fim Iterador para depois do último par.
+     * @param fatorDePreenchimento Fração, entre 0 (exclusivo) e 1, do espaço de
+     * cada página que deve ser ocupada. Deixar espaço livre faz com que as
+     * próximas inserções demorem mais para dividir páginas.
+     */
+    template <typename Iterador>
+    void carregarEmLote(Iterador inicio, Iterador fim, double fatorDePreenchimento = 1.0)
+    {
+        if (fatorDePreenchimento <= 0 || fatorDePreenchimento > 1)
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[ArvoreBMais] O fator de preenchimento deve estar entre 0 e 1."
+                 << endl << "Exceção lançada" << endl;
+
+            throw invalid_argument(
+                "[ArvoreBMais] O fator de preenchimento deve estar entre 0 e 1.");
+        }
+
+        int chavesPorFolha = max(1, (int) round(fatorDePreenchimento * numeroDeChavesPorPagina));
+        int filhasPorPagina = max(2, (int) round(fatorDePreenchimento * ordemDaArvore));
+
+        esvaziarArquivo();
+
+        vector<char> buffer( paginaFilha()->obterTamanhoMaximoEmBytes() );
+        vector<ResumoDaPagina> nivel;
+        bool haFolhaAnterior = false;
+
+        // paginaFilha é a folha sendo preenchida e paginaIrma é a anterior a ela.
+        // A primeira folha ocupa o lugar da raiz vazia.
+        recomecarPagina(paginaFilha(), lerEnderecoDaRaiz());
+
+        for (; inicio != fim; ++inicio)
+        {
+            TIPO_DAS_CHAVES chave = inicio->first;
+            TIPO_DOS_DADOS dado = inicio->second;
+
+            if (paginaFilha()->tamanho() > 0 && chave < paginaFilha()->chaves.back())
+            {
+                // Não deixa uma árvore pela metade no arquivo
+                esvaziarArquivo();
+
+                // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+                cerr << "[ArvoreBMais] As chaves da carga em lote não estão ordenadas."
+                     << endl << "Exceção lançada" << endl;
+
+                throw invalid_argument(
+                    "[ArvoreBMais] As chaves da carga em lote não estão ordenadas.");
+            }
+
+            if (paginaFilha()->tamanho() == chavesPorFolha)
+            {
+                // A folha anterior só é escrita quando já se sabe que ela não é a
+                // penúltima, que pode ter que ceder elementos para a última
+                if (haFolhaAnterior) escreverFolhaDoLote(paginaIrma(), nivel, buffer.data());
+
+                swap(paginaFilha(), paginaIrma());
+                recomecarPagina(paginaFilha(), alocarPagina());
+                paginaIrma()->ptrProximaPagina = paginaFilha()->obterEndereco();
+                paginaFilha()->ptrPaginaAnterior = paginaIrma()->obterEndereco();
+                haFolhaAnterior = true;
+            }
+
+            paginaFilha()->inserir(chave, dado, paginaFilha()->tamanho());
+        }
+
+        if (haFolhaAnterior)
+        {
+            // A última folha pode ter ficado quase vazia. Ela recebe elementos do
+            // fim da anterior até ter o mínimo que as exclusões esperam.
+            while (paginaFilha()->tamanho() < numeroDeChavesPorPagina / 2 &&
+                paginaFilha()->tamanho() + 1 < paginaIrma()->tamanho())
+            {
+                paginaFilha()->inserir(paginaIrma()->chaves.back(), paginaIrma()->dados.back(), 0);
+                paginaIrma()->excluir(paginaIrma()->tamanho() - 1, false, true);
+            }
+
+            escreverFolhaDoLote(paginaIrma(), nivel, buffer.data());
+        }
+
+        escreverFolhaDoLote(paginaFilha(), nivel, buffer.data());
+
+        while (nivel.size() > 1)
+        {
+            nivel = construirNivelInterno(nivel, filhasPorPagina, buffer.data());
+        }
+
+        // Com uma única folha, ela já está no lugar da raiz
+        if (!nivel.empty()) trocarRaizPor(nivel[0].endereco);
+
+        arquivo->sincronizar();
+    }
+
+    /**
+     * @brief Substitui todo o conteúdo da árvore pelos pares (chave, dado) do
+     * intervalo, que podem estar em qualquer ordem e não precisam caber na memória.
+     * Os pares passam antes por uma OrdenacaoExterna e o resultado dela vai direto
+     * para a carga em lote (carregarEmLote()).
+     * 
+     * @param inicio Iterador para o primeiro par. Os elementos devem ter os campos
+     * first (chave) e second (dado).
+     * @param fim Iterador para depois do último par.
+     * @param orcamentoDeMemoria Quantidade de bytes que a ordenação pode usar. Os
+     * arquivos temporários dela ficam ao lado do arquivo da árvore.
+     * @param fatorDePreenchimento Fração do espaço de cada página que deve ser
+     * ocupada, como em carregarEmLote().
+     */
+    template <typename Iterador>
+    void construirAPartirDe(Iterador inicio, Iterador fim,
+        size_t orcamentoDeMemoria = constantes::orcamentoPadraoDaOrdenacao,
+        double fatorDePreenchimento = 1.0)
+    {
+        // O fator é conferido antes de a ordenação escrever os arquivos temporários
+        if (fatorDePreenchimento <= 0 || fatorDePreenchimento > 1)
+        {
+            // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+            cerr << "[ArvoreBMais] O fator de preenchimento deve estar entre 0 e 1."
+                 << endl << "Exceção lançada" << endl;
+
+            throw invalid_argument(
+                "[ArvoreBMais] O fator de preenchimento deve estar entre 0 e 1.");
+        }
+
+        OrdenacaoExterna<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> ordenacao(
+            nomeDoArquivo, orcamentoDeMemoria);
+
+        ordenacao.adicionar(inicio, fim);
+
+        carregarEmLote(ordenacao.begin(), ordenacao.end(), fatorDePreenchimento);
     }
 
     vector<TIPO_DOS_DADOS> listarDadosComAChaveEntre(
@@ -213,15 +1135,42 @@ public:
 
         if (chaveMenor <= chaveMaior)
         {
-            obterCaminhoDeDescida(chaveMenor, 0, lerEnderecoDaRaiz(), true);
-            int indiceFinal = obterDadosComAChaveEntre(chaveMenor, chaveMaior, dados);
+            JanelaDePreCarregamento janela;
+            janela.limite = make_pair(true, chaveMaior);
+
+            // As páginas da varredura são locais, então várias varreduras podem
+            // acontecer ao mesmo tempo
+            Pagina folha(ordemDaArvore), pai(ordemDaArvore);
+            int indiceNoPai;
+
+            // A folha fica travada para que a próxima seja travada antes de ela
+            // ser solta, como na descida
+            localizar(chaveMenor, folha, true, &pai, &indiceNoPai, true);
+            preencherJanela(janela, pai, indiceNoPai);
+
+            int indiceFinal = obterDadosComAChaveEntre(folha, chaveMenor, chaveMaior, dados);
             
-            while (indiceFinal == paginaFilha->tamanho() &&
-                paginaFilha->ptrProximaPagina != constantes::ptrNuloPagina)
+            while (indiceFinal == folha.tamanho() &&
+                folha.ptrProximaPagina != constantes::ptrNuloPagina)
             {
-                carregar(paginaFilha, paginaFilha->ptrProximaPagina);
-                indiceFinal = obterDadosComAChaveEntre(chaveMenor, chaveMaior, dados);
+                file_ptr_type proximaFolha = folha.ptrProximaPagina;
+
+                // As próximas folhas são avisadas antes da leitura desta, para que
+                // a leitura delas aconteça enquanto esta é processada
+                avancarJanela(janela, folha);
+
+                travarParaLeitura(proximaFolha);
+                destravarParaLeitura(folha.obterEndereco());
+
+                // As folhas da varredura são marcadas como acesso sequencial para
+                // que não tirem os níveis internos da árvore do cache
+                carregar(&folha, proximaFolha, true);
+                reabastecerJanela(janela, folha);
+
+                indiceFinal = obterDadosComAChaveEntre(folha, chaveMenor, chaveMaior, dados);
             }
+
+            destravarParaLeitura(folha.obterEndereco());
         }
 
         return dados;
@@ -0,0 +1,532 @@
+/**
+ * @file DiarioDeEscritas.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo da classe DiarioDeEscritas, o registro prévio de escritas
+ * (write-ahead log) da árvore.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include "templates/tipos.hpp"
+#include "helpersArvore.hpp"
+#include "ArmazenamentoDePaginas.hpp"
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace constantes
+{
+    /**
+     * Tamanho, em bytes, a partir do qual a árvore faz um ponto de verificação:
+     * as páginas vão para o arquivo e o diário é esvaziado.
+     */
+    static const file_ptr_type tamanhoMaximoDoDiario = 16 << 20;
+
+    /** Intervalo entre as sincronizações do diário com PoliticaDoDiario::PERIODICA. */
+    static const chrono::milliseconds intervaloDeSincronizacaoDoDiario(50);
+}
+
+/**
+ * @brief Quando as confirmações do diário chegam ao disco.
+ */
+enum class PoliticaDoDiario
+{
+    /** Sem diário: as páginas vão para o arquivo como antes e uma queda no meio
+     * de uma divisão pode estragar a árvore. */
+    NENHUM,
+    /** Cada confirmação só termina depois que o diário for sincronizado. As
+     * confirmações que chegam durante uma sincronização esperam juntas pela
+     * próxima (group commit). */
+    A_CADA_CONFIRMACAO,
+    /** O diário é sincronizado pela primeira confirmação que chegar depois de
+     * constantes::intervaloDeSincronizacaoDoDiario desde a última sincronização.
+     * Uma queda perde as últimas confirmações, mas a árvore continua inteira. */
+    PERIODICA,
+    /** O diário vai para o sistema operacional a cada confirmação e nunca é
+     * sincronizado. Sobrevive a quedas do processo, mas não a quedas do
+     * sistema. */
+    SEM_SINCRONIZAR
+};
+
+/**
+ * @brief Escrita de um intervalo de bytes do armazenamento guardada no diário.
+ */
+struct EscritaDoDiario
+{
+    file_ptr_type endereco;
+    vector<char> bytes;
+};
+
+/**
+ * @brief Escrita de uma confirmação lida do arquivo do diário, cujos bytes
+ * começam em posicao.
+ */
+struct IntervaloDoDiario
+{
+    file_ptr_type endereco = constantes::ptrNuloPagina;
+    uint32_t tamanho = 0;
+    size_t posicao = 0;
+};
+
+/**
+ * @brief Registro prévio de escritas (write-ahead log). Cada operação da árvore
+ * confirma de uma vez todas as páginas que mudou, com os bytes novos delas, e as
+ * páginas só podem ir para o armazenamento depois que a confirmação estiver no
+ * diário (veja tornarDuravel()). Depois de uma queda, refazer() escreve de novo
+ * todas as confirmações completas, na ordem, e a árvore volta ao estado da
+ * última delas.
+ *
+ * <p>Formato de cada confirmação no arquivo: tamanho do corpo (uint32_t), soma de
+ * verificação do corpo (uint64_t) e o corpo, que tem a quantidade de escritas
+ * (uint32_t) e, para cada uma, o endereço (file_ptr_type), a quantidade de bytes
+ * (uint32_t) e os bytes. Uma confirmação cortada pela queda não passa na soma de
+ * verificação e é ignorada, junto com tudo o que vier depois dela.</p>
+ */
+class DiarioDeEscritas
+{
+    string nomeDoArquivo;
+    int descritor;
+    PoliticaDoDiario politica;
+
+    /** Bytes do arquivo do diário. Só muda com a trava e sem escritor. */
+    file_ptr_type tamanhoDoArquivo;
+
+    /** Confirmações que ainda não foram escritas no arquivo. */
+    vector<char> pendentes;
+
+    /** Número da última confirmação recebida. */
+    uint64_t ultimaConfirmacao = 0;
+    /** Número da última confirmação escrita no arquivo. */
+    uint64_t escritaAte = 0;
+    /** Número da última confirmação sincronizada com o disco. */
+    uint64_t duravelAte = 0;
+
+    /** Indica se alguma thread está escrevendo no arquivo do diário. */
+    bool escrevendo = false;
+
+    /**
+     * Mensagem da falha de sincronização que impede o diário de continuar, ou
+     * vazia. Depois dela, anotar(), esperar() e tornarDuravel() lançam exceções.
+     */
+    string falha;
+
+    chrono::steady_clock::time_point ultimaSincronizacao;
+
+    mutex trava;
+    condition_variable escritaTerminada;
+
+    /**
+     * @brief Mostra a mensagem no cerr, junto com a descrição do errno, e lança
+     * uma exceção com ela.
+     *
+     * @param definitiva Caso seja true, o diário deixa de aceitar confirmações
+     * (veja conferirFalha()).
+     */
+    void falhar(string mensagem, bool definitiva = false)
+    {
+        mensagem = "[DiarioDeEscritas] " + mensagem + " (" + strerror(errno) + ")";
+
+        if (definitiva) falha = mensagem;
+
+        // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+        cerr << mensagem << endl << "Exceção lançada" << endl;
+
+        throw runtime_error(mensagem);
+    }
+
+    /**
+     * @brief Lança de novo a exceção da falha definitiva do diário, caso ela
+     * tenha acontecido. Deve ser chamado com a trava.
+     */
+    void conferirFalha()
+    {
+        if (falha.empty()) return;
+
+        // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+        cerr << falha << endl << "Exceção lançada" << endl;
+
+        throw runtime_error(falha);
+    }
+
+    template <typename T>
+    static void anexar(vector<char> &destino, T valor)
+    {
+        const char *bytes = (const char *) &valor;
+
+        destino.insert(destino.end(), bytes, bytes + sizeof(T));
+    }
+
+    /**
+     * @brief Copia o valor que está na posição e avança a posição, caso ele
+     * termine antes de @p fim.
+     */
+    template <typename T>
+    static bool extrair(const vector<char> &origem, size_t &posicao, T &valor, size_t fim)
+    {
+        if (posicao + sizeof(T) > fim) return false;
+
+        memcpy(&valor, origem.data() + posicao, sizeof(T));
+        posicao += sizeof(T);
+
+        return true;
+    }
+
+    /**
+     * @brief Escreve os bytes no arquivo do diário a partir do endereço
+     * informado, repetindo até terminar.
+     */
+    bool escreverNoArquivo(const char *bytes, size_t tamanho, file_ptr_type endereco)
+    {
+        while (tamanho > 0)
+        {
+            ssize_t escritos = pwrite(descritor, bytes, tamanho, endereco);
+
+            if (escritos <= 0) return false;
+
+            bytes += escritos;
+            endereco += escritos;
+            tamanho -= escritos;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Espera até que a confirmação informada esteja escrita no arquivo e,
+     * caso sincronizar seja true, também no disco. Quem encontra o arquivo livre
+     * escreve de uma vez todas as confirmações pendentes, inclusive as das outras
+     * threads, e as que chegam enquanto isso esperam pela próxima escrita.
+     *
+     * <p>Caso a escrita falhe, o lote volta para o começo das pendentes e nada
+     * mais muda, então a próxima chamada tenta de novo. Caso a sincronização
+     * falhe, o diário para de vez (veja conferirFalha()).</p>
+     */
+    void escreverAte(uint64_t confirmacao, bool sincronizar)
+    {
+        unique_lock<mutex> travado(trava);
+
+        while ((sincronizar ? duravelAte : escritaAte) < confirmacao)
+        {
+            conferirFalha();
+
+            if (escrevendo)
+            {
+                escritaTerminada.wait(travado);
+                continue;
+            }
+
+            vector<char> lote;
+            lote.swap(pendentes);
+
+            uint64_t ate = ultimaConfirmacao;
+            file_ptr_type endereco = tamanhoDoArquivo;
+            escrevendo = true;
+
+            travado.unlock();
+
+            bool escreveu = escreverNoArquivo(lote.data(), lote.size(), endereco);
+            bool sincronizou = escreveu && (!sincronizar || fdatasync(descritor) == 0);
+            int erroDaEscrita = errno;
+
+            travado.lock();
+
+            escrevendo = false;
+            escritaTerminada.notify_all();
+            errno = erroDaEscrita;
+
+            if (!escreveu)
+            {
+                // Uma parte do lote pode ter sido escrita, mas a próxima escrita
+                // começa do mesmo endereço e passa por cima dela
+                lote.insert(lote.end(), pendentes.begin(), pendentes.end());
+                pendentes.swap(lote);
+
+                falhar("Não foi possível escrever no diário " + nomeDoArquivo + ".");
+            }
+
+            // Depois de uma sincronização que falhou, o sistema pode ter descartado
+            // as escritas do diário que não chegaram ao disco, e tentar de novo não
+            // diz quais foram
+            if (!sincronizou)
+            {
+                falhar("Não foi possível sincronizar o diário " + nomeDoArquivo + ".", true);
+            }
+
+            tamanhoDoArquivo += lote.size();
+            escritaAte = ate;
+
+            if (sincronizar)
+            {
+                duravelAte = ate;
+                ultimaSincronizacao = chrono::steady_clock::now();
+            }
+        }
+    }
+
+public:
+    // ------------------------- Construtores e destrutores
+
+    /**
+     * @brief Abre (ou cria) o diário guardado no arquivo informado.
+     *
+     * @param nomeDoArquivo Nome do arquivo do diário.
+     * @param politica Quando as confirmações chegam ao disco.
+     */
+    DiarioDeEscritas(string nomeDoArquivo, PoliticaDoDiario politica) :
+        nomeDoArquivo(nomeDoArquivo),
+        politica(politica),
+        ultimaSincronizacao(chrono::steady_clock::now())
+    {
+        descritor = open(nomeDoArquivo.c_str(), O_RDWR | O_CREAT, 0644);
+
+        if (descritor < 0) falhar("Não foi possível abrir o diário " + nomeDoArquivo + ".");
+
+        struct stat informacoes;
+
+        if (fstat(descritor, &informacoes) != 0)
+        {
+            falhar("Não foi possível obter o tamanho do diário " + nomeDoArquivo + ".");
+        }
+
+        tamanhoDoArquivo = informacoes.st_size;
+    }
+
+    ~DiarioDeEscritas()
+    {
+        // Destrutores não devem lançar exceções, então as confirmações pendentes
+        // são escritas aqui mesmo
+        if (falha.empty() && !pendentes.empty())
+        {
+            escreverNoArquivo(pendentes.data(), pendentes.size(), tamanhoDoArquivo);
+        }
+
+        fdatasync(descritor);
+        close(descritor);
+    }
+
+    // ------------------------- Métodos
+
+    /**
+     * @brief Obtém a quantidade de bytes do diário, contando as confirmações que
+     * ainda não foram escritas no arquivo.
+     */
+    file_ptr_type tamanho()
+    {
+        lock_guard<mutex> travado(trava);
+
+        return tamanhoDoArquivo + pendentes.size();
+    }
+
+    /**
+     * @brief Guarda no diário as escritas de uma operação, que passam a valer
+     * juntas. As confirmações ficam no diário na ordem das chamadas, então uma
+     * confirmação só sobrevive a uma queda caso as anteriores também sobrevivam.
+     * Nada é esperado aqui (veja esperar()).
+     *
+     * @param escritas Intervalos escritos pela operação, com os bytes novos.
+     *
+     * @return uint64_t Número da confirmação, a ser passado a esperar().
+     */
+    uint64_t anotar(vector<EscritaDoDiario> &escritas)
+    {
+        vector<char> corpo;
+
+        anexar<uint32_t>(corpo, escritas.size());
+
+        for (EscritaDoDiario &escrita : escritas)
+        {
+            anexar<file_ptr_type>(corpo, escrita.endereco);
+            anexar<uint32_t>(corpo, escrita.bytes.size());
+            corpo.insert(corpo.end(), escrita.bytes.begin(), escrita.bytes.end());
+        }
+
+        lock_guard<mutex> travado(trava);
+
+        conferirFalha();
+
+        anexar<uint32_t>(pendentes, corpo.size());
+        anexar<uint64_t>(pendentes, somarBytes(corpo.data(), corpo.size()));
+        pendentes.insert(pendentes.end(), corpo.begin(), corpo.end());
+
+        return ++ultimaConfirmacao;
+    }
+
+    /**
+     * @brief Espera o que a política exige da confirmação informada. Pode ser
+     * chamado depois que as travas das páginas forem soltas: quem usar as páginas
+     * a partir daí anota confirmações depois desta.
+     *
+     * @param confirmacao Número retornado por anotar().
+     */
+    void esperar(uint64_t confirmacao)
+    {
+        bool sincronizar;
+
+        {
+            lock_guard<mutex> travado(trava);
+
+            conferirFalha();
+
+            sincronizar = politica == PoliticaDoDiario::A_CADA_CONFIRMACAO ||
+                (politica == PoliticaDoDiario::PERIODICA &&
+                    chrono::steady_clock::now() - ultimaSincronizacao >=
+                        constantes::intervaloDeSincronizacaoDoDiario);
+        }
+
+        if (sincronizar || politica == PoliticaDoDiario::SEM_SINCRONIZAR)
+        {
+            escreverAte(confirmacao, sincronizar);
+        }
+    }
+
+    /**
+     * @brief Garante que as confirmações até a informada estão no disco (com
+     * PoliticaDoDiario::SEM_SINCRONIZAR, no sistema operacional). Deve ser
+     * chamado antes de uma página confirmada ir para o armazenamento, com o
+     * número da última confirmação que a mudou.
+     *
+     * @param confirmacao Número retornado por anotar() ou 0 (zero) para todas as
+     * confirmações recebidas.
+     */
+    void tornarDuravel(uint64_t confirmacao = 0)
+    {
+        bool sincronizar = politica != PoliticaDoDiario::SEM_SINCRONIZAR;
+
+        {
+            lock_guard<mutex> travado(trava);
+
+            conferirFalha();
+
+            if (confirmacao == 0) confirmacao = ultimaConfirmacao;
+
+            if ((sincronizar ? duravelAte : escritaAte) >= confirmacao) return;
+        }
+
+        escreverAte(confirmacao, sincronizar);
+    }
+
+    /**
+     * @brief Apaga todas as confirmações. Deve ser chamado só quando todas elas
+     * já estiverem no armazenamento, sincronizado, e nenhuma outra estiver
+     * chegando.
+     */
+    void esvaziar()
+    {
+        lock_guard<mutex> travado(trava);
+
+        if (ftruncate(descritor, 0) != 0 || fdatasync(descritor) != 0)
+        {
+            falhar("Não foi possível esvaziar o diário " + nomeDoArquivo + ".");
+        }
+
+        pendentes.clear();
+        tamanhoDoArquivo = 0;
+        escritaAte = duravelAte = ultimaConfirmacao;
+    }
+
+    /**
+     * @brief Escreve no armazenamento, na ordem, todas as confirmações completas
+     * do diário. Escrever uma confirmação duas vezes não muda nada, então uma
+     * queda durante refazer() é resolvida chamando-o de novo.
+     *
+     * @param arquivo Armazenamento da árvore.
+     *
+     * @return int Quantidade de confirmações refeitas. O armazenamento deve ser
+     * sincronizado antes de o diário ser esvaziado.
+     */
+    int refazer(ArmazenamentoDePaginas &arquivo)
+    {
+        lock_guard<mutex> travado(trava);
+
+        vector<char> conteudo(tamanhoDoArquivo);
+        size_t lidos = 0;
+
+        while (lidos < conteudo.size())
+        {
+            ssize_t resultado = pread(
+                descritor, conteudo.data() + lidos, conteudo.size() - lidos, lidos);
+
+            if (resultado <= 0) falhar("Não foi possível ler o diário " + nomeDoArquivo + ".");
+
+            lidos += resultado;
+        }
+
+        size_t posicao = 0;
+        int refeitas = 0;
+
+        while (true)
+        {
+            uint32_t tamanhoDoCorpo, quantidade;
+            uint64_t soma;
+
+            if (!extrair(conteudo, posicao, tamanhoDoCorpo, conteudo.size()) ||
+                !extrair(conteudo, posicao, soma, conteudo.size()) ||
+                posicao + tamanhoDoCorpo > conteudo.size() ||
+                somarBytes(conteudo.data() + posicao, tamanhoDoCorpo) != soma)
+            {
+                break;
+            }
+
+            size_t fimDoCorpo = posicao + tamanhoDoCorpo;
+            vector<IntervaloDoDiario> escritas;
+            bool corpoInteiro = extrair(conteudo, posicao, quantidade, fimDoCorpo);
+
+            for (uint32_t i = 0; corpoInteiro && i < quantidade; i++)
+            {
+                IntervaloDoDiario escrita;
+
+                corpoInteiro =
+                    extrair(conteudo, posicao, escrita.endereco, fimDoCorpo) &&
+                    extrair(conteudo, posicao, escrita.tamanho, fimDoCorpo) &&
+                    escrita.tamanho <= fimDoCorpo - posicao;
+
+                if (!corpoInteiro) break;
+
+                escrita.posicao = posicao;
+                posicao += escrita.tamanho;
+                escritas.push_back(escrita);
+            }
+
+            // A soma de verificação confere, então o corpo não foi cortado por uma
+            // queda. Caso as escritas não caibam exatamente nele, o diário está
+            // estragado e nenhuma escrita desta confirmação é refeita.
+            if (!corpoInteiro || posicao != fimDoCorpo)
+            {
+                errno = 0;
+                falhar("A confirmação " + to_string(refeitas + 1) + " do diário " +
+                    nomeDoArquivo + " está malformada.");
+            }
+
+            for (IntervaloDoDiario &escrita : escritas)
+            {
+                if (!arquivo.escrever(escrita.endereco,
+                        conteudo.data() + escrita.posicao, escrita.tamanho))
+                {
+                    falhar("Não foi possível refazer uma escrita do diário " +
+                        nomeDoArquivo + ".");
+                }
+            }
+
+            posicao = fimDoCorpo;
+            refeitas++;
+        }
+
+        return refeitas;
+    }
+};
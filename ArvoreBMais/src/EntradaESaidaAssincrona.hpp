@@ -0,0 +1,484 @@
+/**
+ * @file EntradaESaidaAssincrona.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo com os motores que executam lotes de leituras e escritas de
+ * páginas mantendo várias operações em andamento ao mesmo tempo.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include "templates/tipos.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Sem o cabeçalho do io_uring, só o motor com threads é compilado
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define ARVORE_COM_IO_URING
+#endif
+
+using namespace std;
+
+namespace constantes
+{
+    /** Quantidade máxima de operações em andamento em cada motor. */
+    static const unsigned profundidadeDaFilaDeES = 64;
+
+    /** Quantidade de threads do motor usado quando não há io_uring. */
+    static const unsigned threadsDeES = 8;
+}
+
+/**
+ * @brief Uma leitura ou escrita de um intervalo de um arquivo. Quem pede a
+ * operação preenche todos os campos, exceto sucesso, que é preenchido pelo motor.
+ */
+struct OperacaoDeES
+{
+    bool escrita;
+    int descritor;
+    file_ptr_type endereco;
+    char *buffer;
+    int tamanho;
+
+    /** Indica se todos os bytes foram lidos ou escritos. */
+    bool sucesso;
+};
+
+/**
+ * @brief Executa a operação com pread/pwrite, bloqueando até que ela termine.
+ *
+ * @param operacao Operação a ser executada.
+ */
+void executarOperacaoDeES(OperacaoDeES &operacao)
+{
+    file_ptr_type endereco = operacao.endereco;
+    char *buffer = operacao.buffer;
+    int tamanho = operacao.tamanho;
+
+    // pread e pwrite podem transferir menos bytes do que o pedido, então repete
+    // até terminar
+    while (tamanho > 0)
+    {
+        ssize_t transferidos = operacao.escrita ?
+            pwrite(operacao.descritor, buffer, tamanho, endereco) :
+            pread(operacao.descritor, buffer, tamanho, endereco);
+
+        if (transferidos <= 0) break;
+
+        buffer += transferidos;
+        endereco += transferidos;
+        tamanho -= transferidos;
+    }
+
+    operacao.sucesso = tamanho == 0;
+}
+
+/**
+ * @brief Interface dos motores de entrada e saída. Um motor recebe um lote de
+ * operações, coloca várias delas em andamento ao mesmo tempo e só retorna quando
+ * todas terminam.
+ */
+class MotorDeES
+{
+public:
+    virtual ~MotorDeES() {}
+
+    /**
+     * @brief Obtém um nome curto do motor, útil para relatórios.
+     */
+    virtual string nome() = 0;
+
+    /**
+     * @brief Executa todas as operações do lote, em qualquer ordem, e espera que
+     * elas terminem. Operações sobre o mesmo intervalo não devem estar no mesmo
+     * lote.
+     *
+     * @param operacoes Operações a serem executadas. Cada uma recebe em sucesso
+     * o seu resultado.
+     */
+    virtual void executar(vector<OperacaoDeES> &operacoes) = 0;
+};
+
+#ifdef ARVORE_COM_IO_URING
+
+/**
+ * @brief Motor que envia as operações ao kernel pelo io_uring: as operações do
+ * lote são colocadas no anel de submissão de uma vez, com uma única chamada de
+ * sistema, e as conclusões são colhidas do anel de conclusão conforme chegam.
+ *
+ * <p>As chamadas de sistema são feitas diretamente, então a liburing não é
+ * necessária. Caso o kernel não tenha o io_uring (ou ele esteja bloqueado),
+ * disponivel() retorna false.</p>
+ */
+class MotorIoUring : public MotorDeES
+{
+    int descritorDoAnel;
+    unsigned entradas;
+
+    void *anelDeSubmissao;
+    size_t tamanhoDoAnelDeSubmissao;
+    void *anelDeConclusao;
+    size_t tamanhoDoAnelDeConclusao;
+    io_uring_sqe *sqes;
+    size_t tamanhoDasSqes;
+
+    unsigned *cabecaDaSubmissao;
+    unsigned *caudaDaSubmissao;
+    unsigned *mascaraDaSubmissao;
+    unsigned *indicesDaSubmissao;
+
+    unsigned *cabecaDaConclusao;
+    unsigned *caudaDaConclusao;
+    unsigned *mascaraDaConclusao;
+    io_uring_cqe *cqes;
+
+    static unsigned *campo(void *anel, unsigned deslocamento)
+    {
+        return (unsigned *) ((char *) anel + deslocamento);
+    }
+
+    void *mapear(size_t tamanho, off_t deslocamento)
+    {
+        void *mapa = mmap(nullptr, tamanho, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, descritorDoAnel, deslocamento);
+
+        return mapa == MAP_FAILED ? nullptr : mapa;
+    }
+
+    /**
+     * @brief Checa se o kernel conhece as operações de leitura e escrita simples,
+     * que só existem a partir do Linux 5.6.
+     */
+    bool suportaLeituraEEscrita()
+    {
+        size_t tamanho = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        vector<char> bytes(tamanho, 0);
+        io_uring_probe *sonda = (io_uring_probe *) bytes.data();
+
+        if (syscall(__NR_io_uring_register, descritorDoAnel,
+            IORING_REGISTER_PROBE, sonda, 256) < 0)
+        {
+            return false;
+        }
+
+        return sonda->last_op >= IORING_OP_WRITE &&
+            (sonda->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+            (sonda->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    void liberar()
+    {
+        if (sqes != nullptr) munmap(sqes, tamanhoDasSqes);
+
+        if (anelDeConclusao != nullptr && anelDeConclusao != anelDeSubmissao)
+        {
+            munmap(anelDeConclusao, tamanhoDoAnelDeConclusao);
+        }
+
+        if (anelDeSubmissao != nullptr) munmap(anelDeSubmissao, tamanhoDoAnelDeSubmissao);
+        if (descritorDoAnel >= 0) close(descritorDoAnel);
+
+        sqes = nullptr;
+        anelDeSubmissao = anelDeConclusao = nullptr;
+        descritorDoAnel = -1;
+    }
+
+    /**
+     * @brief Coloca a parte que falta da operação no anel de submissão.
+     *
+     * @param operacao Operação a ser enviada.
+     * @param indice Índice da operação no lote, que volta na conclusão.
+     * @param feitos Quantos bytes da operação já foram transferidos.
+     */
+    void preparar(OperacaoDeES &operacao, size_t indice, int feitos)
+    {
+        unsigned cauda = *caudaDaSubmissao;
+        unsigned posicao = cauda & *mascaraDaSubmissao;
+        io_uring_sqe &sqe = sqes[posicao];
+
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = operacao.escrita ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe.fd = operacao.descritor;
+        sqe.off = operacao.endereco + feitos;
+        sqe.addr = (unsigned long) (operacao.buffer + feitos);
+        sqe.len = operacao.tamanho - feitos;
+        sqe.user_data = indice;
+
+        indicesDaSubmissao[posicao] = posicao;
+
+        // O kernel só pode ver a nova cauda depois da entrada pronta
+        __atomic_store_n(caudaDaSubmissao, cauda + 1, __ATOMIC_RELEASE);
+    }
+
+public:
+    MotorIoUring(unsigned entradas = constantes::profundidadeDaFilaDeES) :
+        descritorDoAnel(-1),
+        entradas(0),
+        anelDeSubmissao(nullptr),
+        tamanhoDoAnelDeSubmissao(0),
+        anelDeConclusao(nullptr),
+        tamanhoDoAnelDeConclusao(0),
+        sqes(nullptr),
+        tamanhoDasSqes(0)
+    {
+        io_uring_params parametros;
+        memset(&parametros, 0, sizeof(parametros));
+
+        descritorDoAnel = syscall(__NR_io_uring_setup, entradas, &parametros);
+
+        if (descritorDoAnel < 0) return;
+
+        tamanhoDoAnelDeSubmissao =
+            parametros.sq_off.array + parametros.sq_entries * sizeof(unsigned);
+        tamanhoDoAnelDeConclusao =
+            parametros.cq_off.cqes + parametros.cq_entries * sizeof(io_uring_cqe);
+
+        // Em kernels recentes, os dois anéis ficam num único mapeamento
+        bool mapeamentoUnico = parametros.features & IORING_FEAT_SINGLE_MMAP;
+
+        if (mapeamentoUnico)
+        {
+            tamanhoDoAnelDeSubmissao = tamanhoDoAnelDeConclusao =
+                max(tamanhoDoAnelDeSubmissao, tamanhoDoAnelDeConclusao);
+        }
+
+        anelDeSubmissao = mapear(tamanhoDoAnelDeSubmissao, IORING_OFF_SQ_RING);
+        anelDeConclusao = mapeamentoUnico ?
+            anelDeSubmissao : mapear(tamanhoDoAnelDeConclusao, IORING_OFF_CQ_RING);
+
+        tamanhoDasSqes = parametros.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe *) mapear(tamanhoDasSqes, IORING_OFF_SQES);
+
+        if (anelDeSubmissao == nullptr || anelDeConclusao == nullptr ||
+            sqes == nullptr || !suportaLeituraEEscrita())
+        {
+            liberar();
+            return;
+        }
+
+        cabecaDaSubmissao = campo(anelDeSubmissao, parametros.sq_off.head);
+        caudaDaSubmissao = campo(anelDeSubmissao, parametros.sq_off.tail);
+        mascaraDaSubmissao = campo(anelDeSubmissao, parametros.sq_off.ring_mask);
+        indicesDaSubmissao = campo(anelDeSubmissao, parametros.sq_off.array);
+
+        cabecaDaConclusao = campo(anelDeConclusao, parametros.cq_off.head);
+        caudaDaConclusao = campo(anelDeConclusao, parametros.cq_off.tail);
+        mascaraDaConclusao = campo(anelDeConclusao, parametros.cq_off.ring_mask);
+        cqes = (io_uring_cqe *) ((char *) anelDeConclusao + parametros.cq_off.cqes);
+
+        this->entradas = parametros.sq_entries;
+    }
+
+    ~MotorIoUring()
+    {
+        liberar();
+    }
+
+    /**
+     * @brief Checa se o anel foi criado e pode ser usado.
+     */
+    bool disponivel()
+    {
+        return descritorDoAnel >= 0;
+    }
+
+    string nome() override
+    {
+        return "io_uring";
+    }
+
+    void executar(vector<OperacaoDeES> &operacoes) override
+    {
+        // Operações que ainda precisam ir para o anel: as do lote e as que
+        // voltaram incompletas
+        deque<size_t> aEnviar;
+        vector<int> feitos(operacoes.size(), 0);
+        unsigned emAndamento = 0;
+
+        for (size_t i = 0; i < operacoes.size(); i++)
+        {
+            operacoes[i].sucesso = false;
+            aEnviar.push_back(i);
+        }
+
+        while (!aEnviar.empty() || emAndamento > 0)
+        {
+            unsigned enviadas = 0;
+
+            // O anel de conclusão tem espaço para todas as operações em andamento
+            // porque elas nunca passam do tamanho do anel de submissão
+            while (!aEnviar.empty() && emAndamento + enviadas < entradas)
+            {
+                size_t indice = aEnviar.front();
+                aEnviar.pop_front();
+
+                preparar(operacoes[indice], indice, feitos[indice]);
+                enviadas++;
+            }
+
+            // Envia tudo o que está no anel, inclusive o que o kernel não tenha
+            // aceitado antes, e espera por pelo menos uma conclusão na mesma
+            // chamada de sistema
+            unsigned naFila = *caudaDaSubmissao -
+                __atomic_load_n(cabecaDaSubmissao, __ATOMIC_ACQUIRE);
+
+            if (syscall(__NR_io_uring_enter, descritorDoAnel, naFila, 1,
+                IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+            {
+                // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+                cerr << "[MotorIoUring] Não foi possível enviar as operações ao kernel."
+                     << endl << "Exceção lançada" << endl;
+
+                throw runtime_error("[MotorIoUring] Não foi possível enviar as operações ao kernel.");
+            }
+
+            emAndamento += enviadas;
+
+            unsigned cabeca = *cabecaDaConclusao;
+            unsigned cauda = __atomic_load_n(caudaDaConclusao, __ATOMIC_ACQUIRE);
+
+            for (; cabeca != cauda; cabeca++)
+            {
+                io_uring_cqe &cqe = cqes[cabeca & *mascaraDaConclusao];
+                size_t indice = cqe.user_data;
+                OperacaoDeES &operacao = operacoes[indice];
+
+                emAndamento--;
+
+                // Erros e fins de arquivo deixam a operação sem sucesso
+                if (cqe.res <= 0) continue;
+
+                feitos[indice] += cqe.res;
+
+                if (feitos[indice] < operacao.tamanho) aEnviar.push_back(indice);
+                else operacao.sucesso = true;
+            }
+
+            __atomic_store_n(cabecaDaConclusao, cabeca, __ATOMIC_RELEASE);
+        }
+    }
+};
+
+#endif
+
+/**
+ * @brief Motor que distribui as operações entre threads que fazem chamadas
+ * pread/pwrite bloqueantes. É usado quando o io_uring não está disponível.
+ */
+class MotorComThreads : public MotorDeES
+{
+    vector<thread> threads;
+    mutex trava;
+    condition_variable haTrabalho;
+    condition_variable loteTerminado;
+
+    vector<OperacaoDeES> *lote;
+    size_t proxima;
+    size_t concluidas;
+    bool encerrar;
+
+    void trabalhar()
+    {
+        unique_lock<mutex> travado(trava);
+
+        while (true)
+        {
+            haTrabalho.wait(travado, [this] {
+                return encerrar || (lote != nullptr && proxima < lote->size());
+            });
+
+            if (encerrar) return;
+
+            OperacaoDeES &operacao = (*lote)[proxima++];
+
+            // A operação é feita sem a trava, para que as outras threads também
+            // peguem as suas
+            travado.unlock();
+            executarOperacaoDeES(operacao);
+            travado.lock();
+
+            if (++concluidas == lote->size()) loteTerminado.notify_all();
+        }
+    }
+
+public:
+    MotorComThreads(unsigned quantidadeDeThreads = constantes::threadsDeES) :
+        lote(nullptr),
+        proxima(0),
+        concluidas(0),
+        encerrar(false)
+    {
+        for (unsigned i = 0; i < quantidadeDeThreads; i++)
+        {
+            threads.emplace_back(&MotorComThreads::trabalhar, this);
+        }
+    }
+
+    ~MotorComThreads()
+    {
+        {
+            lock_guard<mutex> travado(trava);
+            encerrar = true;
+        }
+
+        haTrabalho.notify_all();
+
+        for (thread &t : threads) t.join();
+    }
+
+    string nome() override
+    {
+        return "threads";
+    }
+
+    void executar(vector<OperacaoDeES> &operacoes) override
+    {
+        if (operacoes.empty()) return;
+
+        unique_lock<mutex> travado(trava);
+
+        lote = &operacoes;
+        proxima = 0;
+        concluidas = 0;
+
+        haTrabalho.notify_all();
+        loteTerminado.wait(travado, [&] { return concluidas == operacoes.size(); });
+
+        lote = nullptr;
+    }
+};
+
+/**
+ * @brief Cria o melhor motor disponível: o de io_uring, caso o kernel permita, ou
+ * então o de threads.
+ *
+ * @return MotorDeES* Motor alocado com new.
+ */
+MotorDeES *criarMotorDeES()
+{
+#ifdef ARVORE_COM_IO_URING
+    MotorIoUring *motor = new MotorIoUring();
+
+    if (motor->disponivel()) return motor;
+
+    delete motor;
+#endif
+
+    return new MotorComThreads();
+}
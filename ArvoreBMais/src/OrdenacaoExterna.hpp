@@ -0,0 +1,544 @@
+/**
+ * @file OrdenacaoExterna.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo da classe OrdenacaoExterna.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include "templates/tipos.hpp"
+#include "helpersArvore.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace constantes
+{
+    /** Memória, em bytes, que a ordenação externa usa por padrão. */
+    static const size_t orcamentoPadraoDaOrdenacao = 64 << 20;
+
+    /** Menor bloco, em bytes, que cada sequência lê de uma vez na intercalação. */
+    static const size_t tamanhoMinimoDoBlocoDaOrdenacao = 64 << 10;
+}
+
+/**
+ * @brief Ordena pares (chave, dado) que não cabem na memória.
+ *
+ * <p>Os pares recebidos por adicionar() são guardados na memória até ocupar o
+ * orçamento. Nesse momento, eles são ordenados e escritos num arquivo temporário,
+ * formando uma sequência ordenada. Ao percorrer o resultado (begin() e end()), as
+ * sequências são intercaladas, lendo cada arquivo em blocos grandes e sempre do
+ * início para o fim. Caso haja sequências demais para intercalar de uma vez com
+ * o orçamento, elas são intercaladas em grupos antes.</p>
+ *
+ * <p>Os pares com chaves iguais saem na mesma ordem em que foram adicionados.
+ * Caso tudo caiba no orçamento, nenhum arquivo é criado.</p>
+ *
+ * <p>Os pares são gravados com o mesmo formato de tamanho fixo usado nas páginas
+ * das árvores (CopiadorDeBytes), então a chave e o dado precisam ser tipos
+ * primitivos ou herdar de Serializavel.</p>
+ *
+ * @tparam TIPO_DAS_CHAVES Tipo das chaves. Precisa do operador <.
+ * @tparam TIPO_DOS_DADOS Tipo dos dados.
+ */
+template <typename TIPO_DAS_CHAVES, typename TIPO_DOS_DADOS>
+class OrdenacaoExterna
+{
+public:
+    // ------------------------- Typedefs
+
+    typedef pair<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> Registro;
+
+    /**
+     * @brief Iterador de entrada sobre os pares ordenados. Só é possível percorrer
+     * o resultado uma vez.
+     */
+    class Iterador
+    {
+        OrdenacaoExterna *ordenacao;
+
+    public:
+        Iterador(OrdenacaoExterna *ordenacao) : ordenacao(ordenacao) {}
+
+        const Registro &operator*() { return ordenacao->atual; }
+        const Registro *operator->() { return &ordenacao->atual; }
+
+        Iterador &operator++()
+        {
+            ordenacao->avancar();
+
+            return *this;
+        }
+
+        bool operator==(const Iterador &outro) const
+        {
+            return terminou() == outro.terminou();
+        }
+
+        bool operator!=(const Iterador &outro) const
+        {
+            return !(*this == outro);
+        }
+
+    private:
+        bool terminou() const
+        {
+            return ordenacao == nullptr || ordenacao->terminou;
+        }
+    };
+
+private:
+    // ------------------------- Tipos
+
+    /**
+     * @brief Lê os pares de uma sequência ordenada, um bloco de cada vez.
+     */
+    struct LeitorDeSequencia
+    {
+        fstream arquivo;
+        vector<char> bloco;
+        size_t posicao = 0;
+        size_t tamanhoLido = 0;
+    };
+
+    // ------------------------- Campos
+
+    string prefixoDosArquivos;
+    size_t orcamentoDeMemoria;
+    int tamanhoDaChave;
+    int tamanhoDoDado;
+    int tamanhoDoRegistro;
+    size_t registrosNaMemoria;
+
+    vector<Registro> memoria;
+    vector<string> sequencias;
+    int sequenciasCriadas = 0;
+    size_t quantidade = 0;
+
+    // Estado da intercalação final
+    vector<LeitorDeSequencia *> leitores;
+    // Cada par fica junto do índice do seu leitor, que desempata as chaves
+    // iguais para que a ordem de chegada seja mantida
+    vector< pair<Registro, int> > heap;
+    size_t indiceNaMemoria = 0;
+    Registro atual;
+    bool terminou = true;
+    bool iniciou = false;
+
+    // ------------------------- Métodos
+
+    /**
+     * @brief Comparação do heap de mínimo da intercalação.
+     */
+    static bool vemDepois(const pair<Registro, int> &a, const pair<Registro, int> &b)
+    {
+        if (b.first.first < a.first.first) return true;
+        if (a.first.first < b.first.first) return false;
+
+        return a.second > b.second;
+    }
+
+    static bool chaveMenor(const Registro &a, const Registro &b)
+    {
+        return a.first < b.first;
+    }
+
+    void falhar(string mensagem)
+    {
+        mensagem = "[OrdenacaoExterna] " + mensagem;
+
+        // cerr é a saída padrão de erros. Em alguns caso pode ser igual a cout.
+        cerr << mensagem << endl << "Exceção lançada" << endl;
+
+        throw runtime_error(mensagem);
+    }
+
+    string criarNomeDeSequencia()
+    {
+        return prefixoDosArquivos + ".sequencia" + to_string(sequenciasCriadas++);
+    }
+
+    /**
+     * @brief Abre uma sequência para leitura. O primeiro bloco só é lido no
+     * primeiro lerRegistro().
+     */
+    LeitorDeSequencia *abrirSequencia(string nome, size_t tamanhoDoBloco)
+    {
+        LeitorDeSequencia *leitor = new LeitorDeSequencia();
+
+        leitor->arquivo.open(nome, fstream::in | fstream::binary);
+
+        if (!leitor->arquivo.is_open())
+        {
+            delete leitor;
+            falhar("Não foi possível abrir a sequência " + nome + ".");
+        }
+
+        leitor->bloco.resize(tamanhoDoBloco);
+
+        return leitor;
+    }
+
+    /**
+     * @brief Lê o próximo par da sequência, buscando outro bloco quando o atual
+     * acaba.
+     *
+     * @return true Caso haja um par.
+     * @return false Caso a sequência tenha acabado.
+     */
+    bool lerRegistro(LeitorDeSequencia *leitor, Registro &registro)
+    {
+        if (leitor->posicao == leitor->tamanhoLido)
+        {
+            leitor->arquivo.read(leitor->bloco.data(), leitor->bloco.size());
+            leitor->tamanhoLido = leitor->arquivo.gcount();
+            leitor->posicao = 0;
+
+            if (leitor->tamanhoLido == 0) return false;
+        }
+
+        const tipo_byte *cursor =
+            reinterpret_cast<const tipo_byte *>(leitor->bloco.data() + leitor->posicao);
+
+        cursor = CopiadorDeBytes<TIPO_DAS_CHAVES>::ler(cursor, registro.first);
+        CopiadorDeBytes<TIPO_DOS_DADOS>::ler(cursor, registro.second);
+
+        leitor->posicao += tamanhoDoRegistro;
+
+        return true;
+    }
+
+    /**
+     * @brief Escreve o par no bloco e, quando ele enche, escreve o bloco no arquivo.
+     */
+    void escreverRegistro(fstream &arquivo, vector<char> &bloco, size_t &posicao,
+        Registro &registro)
+    {
+        if (posicao + tamanhoDoRegistro > bloco.size())
+        {
+            arquivo.write(bloco.data(), posicao);
+            posicao = 0;
+        }
+
+        tipo_byte *cursor = reinterpret_cast<tipo_byte *>(bloco.data() + posicao);
+
+        cursor = CopiadorDeBytes<TIPO_DAS_CHAVES>::escrever(cursor, registro.first);
+        CopiadorDeBytes<TIPO_DOS_DADOS>::escrever(cursor, registro.second);
+
+        posicao += tamanhoDoRegistro;
+    }
+
+    fstream criarSequencia(string nome)
+    {
+        fstream arquivo(nome, fstream::out | fstream::trunc | fstream::binary);
+
+        if (!arquivo.is_open()) falhar("Não foi possível criar a sequência " + nome + ".");
+
+        return arquivo;
+    }
+
+    /**
+     * @brief Ordena os pares da memória e os escreve numa sequência nova.
+     */
+    void escreverSequencia()
+    {
+        string nome = criarNomeDeSequencia();
+        fstream arquivo = criarSequencia(nome);
+        vector<char> bloco( max(
+            (size_t) tamanhoDoRegistro, constantes::tamanhoMinimoDoBlocoDaOrdenacao) );
+        size_t posicao = 0;
+
+        stable_sort(memoria.begin(), memoria.end(), chaveMenor);
+
+        for (auto &&registro : memoria)
+        {
+            escreverRegistro(arquivo, bloco, posicao, registro);
+        }
+
+        arquivo.write(bloco.data(), posicao);
+
+        if (arquivo.fail()) falhar("Não foi possível escrever a sequência " + nome + ".");
+
+        sequencias.push_back(nome);
+        memoria.clear();
+    }
+
+    /**
+     * @brief Quantas sequências podem ser intercaladas de uma vez dando a cada uma
+     * um bloco de pelo menos tamanhoMinimoDoBlocoDaOrdenacao bytes. Um bloco a
+     * mais é reservado para a escrita.
+     */
+    size_t obterQuantidadeDeVias()
+    {
+        size_t tamanhoMinimo = max(
+            (size_t) tamanhoDoRegistro, constantes::tamanhoMinimoDoBlocoDaOrdenacao);
+
+        size_t blocos = orcamentoDeMemoria / tamanhoMinimo;
+
+        return blocos > 3 ? blocos - 1 : 2;
+    }
+
+    /**
+     * @brief Calcula o tamanho do bloco de cada leitor, múltiplo do tamanho de um
+     * par, para que o orçamento seja dividido entre as vias.
+     */
+    size_t obterTamanhoDoBloco(size_t vias)
+    {
+        size_t registrosPorBloco = max(
+            (size_t) 1, orcamentoDeMemoria / (vias + 1) / tamanhoDoRegistro);
+
+        return registrosPorBloco * tamanhoDoRegistro;
+    }
+
+    /**
+     * @brief Prepara o heap da intercalação com o primeiro par de cada leitor.
+     */
+    void iniciarHeap()
+    {
+        Registro registro;
+
+        heap.clear();
+
+        for (size_t i = 0; i < leitores.size(); i++)
+        {
+            if (lerRegistro(leitores[i], registro))
+            {
+                heap.push_back( { registro, (int) i } );
+            }
+        }
+
+        make_heap(heap.begin(), heap.end(), vemDepois);
+    }
+
+    /**
+     * @brief Tira o menor par do heap e coloca no lugar dele o próximo par do
+     * mesmo leitor.
+     *
+     * @return false Caso o heap esteja vazio.
+     */
+    bool retirarMenor(Registro &registro)
+    {
+        if (heap.empty()) return false;
+
+        pop_heap(heap.begin(), heap.end(), vemDepois);
+
+        registro = heap.back().first;
+        int indiceDoLeitor = heap.back().second;
+
+        if (lerRegistro(leitores[indiceDoLeitor], heap.back().first))
+        {
+            push_heap(heap.begin(), heap.end(), vemDepois);
+        }
+
+        else heap.pop_back();
+
+        return true;
+    }
+
+    void abrirLeitores(vector<string>::iterator inicio, vector<string>::iterator fim)
+    {
+        size_t tamanhoDoBloco = obterTamanhoDoBloco(fim - inicio);
+
+        for (auto iterador = inicio; iterador != fim; iterador++)
+        {
+            leitores.push_back( abrirSequencia(*iterador, tamanhoDoBloco) );
+        }
+
+        iniciarHeap();
+    }
+
+    void fecharLeitores(vector<string>::iterator inicio, vector<string>::iterator fim)
+    {
+        for (auto &&leitor : leitores) delete leitor;
+
+        leitores.clear();
+
+        for (auto iterador = inicio; iterador != fim; iterador++)
+        {
+            remove(iterador->c_str());
+        }
+    }
+
+    /**
+     * @brief Enquanto houver mais sequências do que vias, intercala grupos de
+     * sequências em sequências maiores.
+     */
+    void reduzirSequencias()
+    {
+        size_t vias = obterQuantidadeDeVias();
+
+        while (sequencias.size() > vias)
+        {
+            vector<string> novasSequencias;
+
+            for (size_t i = 0; i < sequencias.size(); i += vias)
+            {
+                auto inicio = sequencias.begin() + i;
+                auto fim = sequencias.begin() + min(i + vias, sequencias.size());
+
+                if (fim - inicio == 1)
+                {
+                    novasSequencias.push_back(*inicio);
+                    continue;
+                }
+
+                string nome = criarNomeDeSequencia();
+                fstream arquivo = criarSequencia(nome);
+                vector<char> bloco( obterTamanhoDoBloco(fim - inicio) );
+                size_t posicao = 0;
+                Registro registro;
+
+                abrirLeitores(inicio, fim);
+
+                while (retirarMenor(registro))
+                {
+                    escreverRegistro(arquivo, bloco, posicao, registro);
+                }
+
+                arquivo.write(bloco.data(), posicao);
+
+                if (arquivo.fail()) falhar("Não foi possível escrever a sequência " + nome + ".");
+
+                fecharLeitores(inicio, fim);
+                novasSequencias.push_back(nome);
+            }
+
+            sequencias = novasSequencias;
+        }
+    }
+
+    /**
+     * @brief Passa para o próximo par do resultado.
+     */
+    void avancar()
+    {
+        if (sequencias.empty())
+        {
+            terminou = indiceNaMemoria == memoria.size();
+
+            if (!terminou) atual = memoria[indiceNaMemoria++];
+        }
+
+        else terminou = !retirarMenor(atual);
+    }
+
+public:
+    // ------------------------- Construtores e destrutores
+
+    /**
+     * @brief Constrói uma nova ordenação externa.
+     *
+     * @param prefixoDosArquivos Início do nome dos arquivos temporários, que
+     * terminam com ".sequencia" seguido de um número.
+     * @param orcamentoDeMemoria Quantidade de bytes que a ordenação pode usar para
+     * guardar pares e blocos de leitura e escrita.
+     */
+    OrdenacaoExterna(string prefixoDosArquivos,
+        size_t orcamentoDeMemoria = constantes::orcamentoPadraoDaOrdenacao) :
+        prefixoDosArquivos(prefixoDosArquivos),
+        orcamentoDeMemoria(orcamentoDeMemoria)
+    {
+        obterTamanhoEmBytesDaChaveEDoDado<TIPO_DAS_CHAVES, TIPO_DOS_DADOS>(
+            tamanhoDaChave, tamanhoDoDado
+        );
+
+        tamanhoDoRegistro = tamanhoDaChave + tamanhoDoDado;
+        registrosNaMemoria = max((size_t) 1, orcamentoDeMemoria / sizeof(Registro));
+    }
+
+    ~OrdenacaoExterna()
+    {
+        fecharLeitores(sequencias.begin(), sequencias.end());
+    }
+
+    // ------------------------- Métodos
+
+    /**
+     * @brief Adiciona um par à ordenação. Deve ser chamado antes de begin().
+     */
+    void adicionar(TIPO_DAS_CHAVES &chave, TIPO_DOS_DADOS &dado)
+    {
+        if (iniciou) falhar("Não é possível adicionar pares depois de percorrer o resultado.");
+
+        // A memória só é reservada quando o primeiro par chega
+        if (memoria.capacity() == 0)
+        {
+            memoria.reserve( min(registrosNaMemoria, (size_t) 1 << 16) );
+        }
+
+        memoria.push_back( Registro(chave, dado) );
+        quantidade++;
+
+        if (memoria.size() >= registrosNaMemoria) escreverSequencia();
+    }
+
+    /**
+     * @brief Adiciona à ordenação todos os pares do intervalo, cujos elementos
+     * devem ter os campos first (chave) e second (dado).
+     */
+    template <typename IteradorDeEntrada>
+    void adicionar(IteradorDeEntrada inicio, IteradorDeEntrada fim)
+    {
+        for (; inicio != fim; ++inicio)
+        {
+            TIPO_DAS_CHAVES chave = inicio->first;
+            TIPO_DOS_DADOS dado = inicio->second;
+
+            adicionar(chave, dado);
+        }
+    }
+
+    /**
+     * @brief Obtém a quantidade de pares adicionados à ordenação.
+     */
+    size_t obterQuantidade()
+    {
+        return quantidade;
+    }
+
+    /**
+     * @brief Termina de formar as sequências e começa a intercalação. Só pode
+     * ser chamado uma vez.
+     *
+     * @return Iterador Iterador sobre o menor par.
+     */
+    Iterador begin()
+    {
+        if (iniciou) falhar("O resultado da ordenação só pode ser percorrido uma vez.");
+
+        iniciou = true;
+
+        if (sequencias.empty())
+        {
+            stable_sort(memoria.begin(), memoria.end(), chaveMenor);
+        }
+
+        else
+        {
+            if (!memoria.empty()) escreverSequencia();
+
+            // Libera a memória dos pares para os blocos da intercalação
+            vector<Registro>().swap(memoria);
+
+            reduzirSequencias();
+            abrirLeitores(sequencias.begin(), sequencias.end());
+        }
+
+        avancar();
+
+        return Iterador(this);
+    }
+
+    Iterador end()
+    {
+        return Iterador(nullptr);
+    }
+};
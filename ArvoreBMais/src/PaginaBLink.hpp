@@ -0,0 +1,259 @@
+/**
+ * @file PaginaBLink.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo da classe PaginaBLink.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include "templates/tipos.hpp"
+#include "templates/serializavel.hpp"
+#include "PaginaBMais.hpp"
+#include "helpersArvore.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief Classe com as características da página da árvore B-link (veja
+ * ArvoreBLink). Além dos campos da página da árvore B+, ela tem a chave alta:
+ * nenhuma chave da subárvore da página é maior que ela. Em todos os níveis, o
+ * ponteiro para a próxima página leva à irmã da direita.
+ *
+ * <p>Quando uma chave procurada é maior que a chave alta, a página foi dividida
+ * depois que o ponteiro para ela foi lido e a chave está em alguma página à
+ * direita dela no mesmo nível.</p>
+ *
+ * @tparam TIPO_DAS_CHAVES Tipo da chave dos registros. <b>É necessário que a chave
+ * seja um tipo primitivo ou então que a sua classe/struct herde de Serializavel e
+ * tenha um construtor sem parâmetros.</b>
+ * @tparam TIPO_DOS_DADOS Tipo do dado dos registros. <b>É necessário que o dado
+ * seja um tipo primitivo ou então que a sua classe/struct herde de Serializavel e
+ * tenha um construtor sem parâmetros.</b>
+ */
+template <typename TIPO_DAS_CHAVES, typename TIPO_DOS_DADOS>
+class PaginaBLink : public PaginaBMais<TIPO_DAS_CHAVES, TIPO_DOS_DADOS>
+{
+public:
+    // ------------------------- Typedefs
+
+    typedef PaginaBLink<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> Pagina;
+    typedef PaginaBMais<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> PaginaHerdada;
+
+    // ------------------------- Campos
+
+    using PaginaHerdada::chaves;
+    using PaginaHerdada::dados;
+    using PaginaHerdada::ponteiros;
+    using PaginaHerdada::ptrProximaPagina;
+    using PaginaHerdada::ptrPaginaAnterior;
+
+    /** Indica se a página tem chave alta. A última página de cada nível não tem. */
+    bool temChaveAlta = false;
+    TIPO_DAS_CHAVES chaveAlta = TIPO_DAS_CHAVES();
+
+    // ------------------------- Construtores
+
+    // Importa os construtores da classe PaginaBMais
+    using PaginaHerdada::PaginaBMais;
+
+    // ------------------------- Métodos herdados de Serializavel
+
+    int obterTamanhoMaximoEmBytes() override
+    {
+        // adiciona o tamanho da chave alta e do indicador de que ela existe
+        return PaginaHerdada::obterTamanhoMaximoEmBytes() +
+            sizeof(temChaveAlta) + this->maximoDeBytesParaAChave;
+    }
+
+    DataOutputStream &gerarDataOutputStream(DataOutputStream &out) override
+    {
+        TIPO_DAS_CHAVES *chave = &chaveAlta;
+
+        PaginaHerdada::gerarDataOutputStream(out);
+
+        out << temChaveAlta;
+        out << chave;
+
+        return out;
+    }
+
+    using PaginaHerdada::lerBytes;
+
+    void lerBytes(DataInputStream &input) override
+    {
+        PaginaHerdada::lerBytes(input);
+
+        input >> temChaveAlta;
+        input >> chaveAlta;
+    }
+
+    const tipo_byte *lerBytesDiretamente(const tipo_byte *cursor) override
+    {
+        // A chave alta vem logo após os campos da PaginaBMais
+        cursor = PaginaHerdada::lerBytesDiretamente(cursor);
+        cursor = CopiadorDeBytes<bool>::ler(cursor, temChaveAlta);
+
+        return CopiadorDeBytes<TIPO_DAS_CHAVES>::ler(cursor, chaveAlta);
+    }
+
+    tipo_byte *escreverBytesDiretamente(tipo_byte *cursor) override
+    {
+        cursor = PaginaHerdada::escreverBytesDiretamente(cursor);
+        cursor = CopiadorDeBytes<bool>::escrever(cursor, temChaveAlta);
+
+        return CopiadorDeBytes<TIPO_DAS_CHAVES>::escrever(cursor, chaveAlta);
+    }
+
+    // ------------------------- Métodos
+
+    using PaginaHerdada::eUmaFolha;
+    using PaginaHerdada::excluir;
+    using PaginaHerdada::obterEndereco;
+    using PaginaHerdada::tamanho;
+    using PaginaHerdada::transferirPara;
+
+    void limpar() override
+    {
+        PaginaHerdada::limpar();
+        temChaveAlta = false;
+        chaveAlta = TIPO_DAS_CHAVES();
+    }
+
+    /**
+     * @brief Checa se a chave é maior que todas as da subárvore da página. Nesse
+     * caso, ela deve ser procurada nas páginas à direita desta.
+     */
+    bool estaAlemDaPagina(TIPO_DAS_CHAVES &chave)
+    {
+        return temChaveAlta && chaveAlta < chave;
+    }
+
+    /**
+     * @brief Obtém o índice onde o par que separa a página da esquerda de uma nova
+     * irmã dela deve ser inserido nesta página, que é a pai delas.
+     *
+     * @param chave Chave do par. Também é usada nas folhas, onde não há filhas.
+     * @param esquerda Endereço da página que foi dividida ou
+     * constantes::ptrNuloPagina caso esta página seja uma folha.
+     *
+     * @return int Índice logo após o ponteiro para a esquerda e os separadores
+     * menores que a chave que estejam depois dele, caso ele esteja na página.
+     * Caso contrário, a posição da chave entre as da página, pois a esquerda pode
+     * ter sido criada por uma divisão cujo par ainda não chegou aqui.
+     */
+    int obterIndiceDeInsercao(TIPO_DAS_CHAVES &chave, file_ptr_type esquerda)
+    {
+        if (esquerda != constantes::ptrNuloPagina)
+        {
+            auto iterador = find(ponteiros.begin(), ponteiros.end(), esquerda);
+
+            if (iterador != ponteiros.end())
+            {
+                int indice = iterador - ponteiros.begin();
+
+                // A esquerda pode ter sido dividida de novo por outra thread, que
+                // subiu primeiro com um separador menor. A irmã nova dessa divisão
+                // fica entre a esquerda e a irmã desta, então o par vem depois.
+                while (indice < tamanho() && chaves[indice] < chave) indice++;
+
+                return indice;
+            }
+        }
+
+        return this->obterIndiceDeDescida(chave);
+    }
+
+    /**
+     * @brief Divide esta página, que está cheia, com a irmã, que deve estar vazia
+     * e já ter um endereço, e insere a tripla (chave, dado, ponteiro) na metade
+     * em que ela cair. A irmã fica à direita desta, entre ela e a próxima página,
+     * e herda a chave alta desta.
+     *
+     * <p>Nas folhas, o separador é uma cópia da maior chave que fica nesta página.
+     * Nas páginas internas, o separador sai desta página e o ponteiro à direita
+     * dele vira o primeiro da irmã.</p>
+     *
+     * @param irma Página que receberá a metade da direita.
+     * @param chave Chave a ser inserida.
+     * @param dado Dado a ser inserido.
+     * @param indiceDeInsercao Índice da chave nesta página, como se ela coubesse.
+     * @param ponteiro Ponteiro à direita da chave.
+     *
+     * @return pair<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> Par que separa esta página da
+     * irmã, a ser inserido na página pai. Ele passa a ser a chave alta desta.
+     */
+    pair<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> dividirCom(Pagina *irma,
+        TIPO_DAS_CHAVES &chave, TIPO_DOS_DADOS &dado,
+        int indiceDeInsercao, file_ptr_type ponteiro)
+    {
+        bool folha = eUmaFolha();
+
+        // A página passa, só na memória, a ter um elemento a mais do que cabe nela
+        chaves.insert(chaves.begin() + indiceDeInsercao, chave);
+        dados.insert(dados.begin() + indiceDeInsercao, dado);
+        ponteiros.insert(ponteiros.begin() + indiceDeInsercao + 1, ponteiro);
+        this->_tamanho++;
+
+        // Nas páginas internas o separador não fica em nenhuma das duas, então a
+        // irmã fica com um elemento a menos
+        int quantidadeNaIrma = folha ? this->_tamanho / 2 : (this->_tamanho - 1) / 2;
+
+        irma->ponteiros.clear();
+        transferirPara(irma->chaves, chaves, quantidadeNaIrma);
+        transferirPara(irma->dados, dados, quantidadeNaIrma);
+
+        // A irmã fica também com o ponteiro à direita do separador. Nas folhas,
+        // todos os ponteiros são nulos e só a quantidade deles importa.
+        transferirPara(irma->ponteiros, ponteiros, quantidadeNaIrma + (folha ? 0 : 1));
+
+        if (folha) irma->ponteiros.push_back(constantes::ptrNuloPagina);
+
+        irma->_tamanho = quantidadeNaIrma;
+        this->_tamanho -= quantidadeNaIrma;
+
+        pair<TIPO_DAS_CHAVES, TIPO_DOS_DADOS> separador(chaves.back(), dados.back());
+
+        if (!folha)
+        {
+            chaves.pop_back();
+            dados.pop_back();
+            this->_tamanho--;
+        }
+
+        irma->temChaveAlta = temChaveAlta;
+        irma->chaveAlta = chaveAlta;
+        temChaveAlta = true;
+        chaveAlta = separador.first;
+
+        irma->ptrProximaPagina = ptrProximaPagina;
+        irma->ptrPaginaAnterior = obterEndereco();
+        ptrProximaPagina = irma->obterEndereco();
+
+        this->descartarOrdemEytzinger();
+        irma->descartarOrdemEytzinger();
+
+        return separador;
+    }
+
+    void mostrar(ostream &ostream = cout,
+               bool mostrarOsDados = false,
+               bool mostrarOsPonteiros = true,
+               bool mostrarEndereco = true,
+               string delimitadorEntreOPonteiroEAChave = " (",
+               string delimitadorEntreODadoEOPonteiro = ") ",
+               string delimitadorEntreAChaveEODado = ", ") override
+    {
+        PaginaHerdada::mostrar(
+            ostream, mostrarOsDados, mostrarOsPonteiros, mostrarEndereco,
+            delimitadorEntreOPonteiroEAChave,
+            delimitadorEntreODadoEOPonteiro,
+            delimitadorEntreAChaveEODado);
+
+        if (temChaveAlta) ostream << " [" << chaveAlta << "]";
+    }
+};
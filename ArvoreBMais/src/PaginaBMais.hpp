@@ -6,6 +6,8 @@
  * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
  */
 
+#pragma once
+
 #include "templates/tipos.hpp"
 #include "templates/serializavel.hpp"
 #include "PaginaB.hpp"
@@ -52,6 +54,7 @@ public:
     using PaginaHerdada::ponteiros;
 
     file_ptr_type ptrProximaPagina = constantes::ptrNuloPagina;
+    file_ptr_type ptrPaginaAnterior = constantes::ptrNuloPagina;
 
     // ------------------------- Construtores
 
@@ -65,8 +68,8 @@ public:
     {
         // Chamar uma função da herdada da ArvoreB:
         // https://stackoverflow.com/questions/672373/can-i-call-a-base-classs-virtual-function-if-im-overriding-it
-        // adiciona o tamanho do ponteiro para a próxima página
-        return PaginaHerdada::obterTamanhoMaximoEmBytes() + sizeof(file_ptr_type);
+        // adiciona o tamanho dos ponteiros para a próxima página e para a anterior
+        return PaginaHerdada::obterTamanhoMaximoEmBytes() + 2 * sizeof(file_ptr_type);
     }
 
     DataOutputStream &gerarDataOutputStream(DataOutputStream &out) override
@@ -75,18 +78,38 @@ public:
         // https://stackoverflow.com/questions/672373/can-i-call-a-base-classs-virtual-function-if-im-overriding-it
         PaginaHerdada::gerarDataOutputStream(out);
 
-        out << ptrProximaPagina;
+        out << ptrProximaPagina << ptrPaginaAnterior;
 
         return out;
     }
 
+    using PaginaHerdada::lerBytes;
+
     void lerBytes(DataInputStream &input) override
     {
         // Chamar uma função da herdada da ArvoreB:
         // https://stackoverflow.com/questions/672373/can-i-call-a-base-classs-virtual-function-if-im-overriding-it
         PaginaHerdada::lerBytes(input);
 
-        input >> ptrProximaPagina;
+        input >> ptrProximaPagina >> ptrPaginaAnterior;
+    }
+
+    const tipo_byte *lerBytesDiretamente(const tipo_byte *cursor) override
+    {
+        // Os ponteiros para a próxima página e para a anterior vêm logo após os
+        // campos da PaginaB
+        cursor = PaginaHerdada::lerBytesDiretamente(cursor);
+        cursor = CopiadorDeBytes<file_ptr_type>::ler(cursor, ptrProximaPagina);
+
+        return CopiadorDeBytes<file_ptr_type>::ler(cursor, ptrPaginaAnterior);
+    }
+
+    tipo_byte *escreverBytesDiretamente(tipo_byte *cursor) override
+    {
+        cursor = PaginaHerdada::escreverBytesDiretamente(cursor);
+        cursor = CopiadorDeBytes<file_ptr_type>::escrever(cursor, ptrProximaPagina);
+
+        return CopiadorDeBytes<file_ptr_type>::escrever(cursor, ptrPaginaAnterior);
     }
 
     // ------------------------- Métodos
@@ -98,6 +121,7 @@ public:
     {
         PaginaHerdada::limpar();
         ptrProximaPagina = constantes::ptrNuloPagina;
+        ptrPaginaAnterior = constantes::ptrNuloPagina;
     }
 
     void transferirElementoPara(
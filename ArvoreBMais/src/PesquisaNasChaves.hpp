@@ -0,0 +1,429 @@
+/**
+ * @file PesquisaNasChaves.hpp
+ * @author Axell Brendow ( https://github.com/axell-brendow )
+ * @brief Arquivo da pesquisa das chaves de uma página.
+ *
+ * @copyright Copyright (c) 2019 Axell Brendow Batista Moreira
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+// As instruções vetoriais são escolhidas em tempo de execução, conforme o
+// processador, então só dependem do compilador aceitar o atributo target
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define ARVORE_COM_PESQUISA_VETORIAL
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace constantes
+{
+    // A pesquisa binária para quando restam chaves que cabem em duas linhas de
+    // cache, que são comparadas de uma vez com instruções vetoriais
+    const size_t bytesDoBlocoDePesquisa = 128;
+}
+
+/**
+ * @brief Tipos de chave que têm uma pesquisa vetorial.
+ */
+enum class TipoVetorial
+{
+    NENHUM,
+    INTEIRO_32,
+    INTEIRO_64,
+    REAL_32,
+    REAL_64
+};
+
+template <typename TIPO>
+struct ClassificadorVetorial
+{
+    static const bool inteiro = is_integral<TIPO>::value && is_signed<TIPO>::value;
+
+    static const TipoVetorial tipo =
+        is_same<TIPO, float>::value ? TipoVetorial::REAL_32 :
+        is_same<TIPO, double>::value ? TipoVetorial::REAL_64 :
+        inteiro && sizeof(TIPO) == 4 ? TipoVetorial::INTEIRO_32 :
+        inteiro && sizeof(TIPO) == 8 ? TipoVetorial::INTEIRO_64 :
+        TipoVetorial::NENHUM;
+};
+
+/**
+ * @brief Conta, sem desvios, as chaves menores que a procurada. Serve para
+ * qualquer tipo com operador < e é o que sobra quando não há instruções
+ * vetoriais.
+ */
+template <typename TIPO>
+size_t contarMenoresEscalar(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+{
+    size_t menores = 0;
+
+    for (size_t i = 0; i < quantidade; i++)
+    {
+        menores += chaves[i] < chave;
+    }
+
+    return menores;
+}
+
+#ifdef ARVORE_COM_PESQUISA_VETORIAL
+
+/**
+ * @brief Núcleos que comparam vários elementos por instrução. Cada
+ * especialização conta as chaves menores que a procurada com AVX2 e com SSE, e
+ * as chaves que sobram no fim são contadas uma a uma.
+ */
+template <typename TIPO, TipoVetorial = ClassificadorVetorial<TIPO>::tipo>
+struct NucleoVetorial;
+
+template <typename TIPO>
+struct NucleoVetorial<TIPO, TipoVetorial::INTEIRO_32>
+{
+    static const bool sseExigeSse42 = false;
+
+    __attribute__((target("avx2")))
+    static size_t contarMenoresAvx2(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        __m256i procurada = _mm256_set1_epi32(chave);
+        size_t menores = 0, i = 0;
+
+        for (; i + 8 <= quantidade; i += 8)
+        {
+            __m256i bloco = _mm256_loadu_si256((const __m256i *) (chaves + i));
+            __m256i menor = _mm256_cmpgt_epi32(procurada, bloco);
+
+            menores += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(menor)));
+        }
+
+        return menores + contarMenoresEscalar(chaves + i, quantidade - i, chave);
+    }
+
+    __attribute__((target("sse2")))
+    static size_t contarMenoresSse(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        __m128i procurada = _mm_set1_epi32(chave);
+        size_t menores = 0, i = 0;
+
+        for (; i + 4 <= quantidade; i += 4)
+        {
+            __m128i bloco = _mm_loadu_si128((const __m128i *) (chaves + i));
+            __m128i menor = _mm_cmplt_epi32(bloco, procurada);
+
+            menores += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(menor)));
+        }
+
+        return menores + contarMenoresEscalar(chaves + i, quantidade - i, chave);
+    }
+};
+
+template <typename TIPO>
+struct NucleoVetorial<TIPO, TipoVetorial::INTEIRO_64>
+{
+    // A comparação de inteiros de 64 bits só chegou no SSE 4.2
+    static const bool sseExigeSse42 = true;
+
+    __attribute__((target("avx2")))
+    static size_t contarMenoresAvx2(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        __m256i procurada = _mm256_set1_epi64x(chave);
+        size_t menores = 0, i = 0;
+
+        for (; i + 4 <= quantidade; i += 4)
+        {
+            __m256i bloco = _mm256_loadu_si256((const __m256i *) (chaves + i));
+            __m256i menor = _mm256_cmpgt_epi64(procurada, bloco);
+
+            menores += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(menor)));
+        }
+
+        return menores + contarMenoresEscalar(chaves + i, quantidade - i, chave);
+    }
+
+    __attribute__((target("sse4.2")))
+    static size_t contarMenoresSse(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        __m128i procurada = _mm_set1_epi64x(chave);
+        size_t menores = 0, i = 0;
+
+        for (; i + 2 <= quantidade; i += 2)
+        {
+            __m128i bloco = _mm_loadu_si128((const __m128i *) (chaves + i));
+            __m128i menor = _mm_cmpgt_epi64(procurada, bloco);
+
+            menores += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(menor)));
+        }
+
+        return menores + contarMenoresEscalar(chaves + i, quantidade - i, chave);
+    }
+};
+
+template <typename TIPO>
+struct NucleoVetorial<TIPO, TipoVetorial::REAL_32>
+{
+    static const bool sseExigeSse42 = false;
+
+    __attribute__((target("avx2")))
+    static size_t contarMenoresAvx2(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        __m256 procurada = _mm256_set1_ps(chave);
+        size_t menores = 0, i = 0;
+
+        for (; i + 8 <= quantidade; i += 8)
+        {
+            __m256 menor = _mm256_cmp_ps(_mm256_loadu_ps(chaves + i), procurada, _CMP_LT_OQ);
+
+            menores += __builtin_popcount(_mm256_movemask_ps(menor));
+        }
+
+        return menores + contarMenoresEscalar(chaves + i, quantidade - i, chave);
+    }
+
+    __attribute__((target("sse2")))
+    static size_t contarMenoresSse(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        __m128 procurada = _mm_set1_ps(chave);
+        size_t menores = 0, i = 0;
+
+        for (; i + 4 <= quantidade; i += 4)
+        {
+            __m128 menor = _mm_cmplt_ps(_mm_loadu_ps(chaves + i), procurada);
+
+            menores += __builtin_popcount(_mm_movemask_ps(menor));
+        }
+
+        return menores + contarMenoresEscalar(chaves + i, quantidade - i, chave);
+    }
+};
+
+template <typename TIPO>
+struct NucleoVetorial<TIPO, TipoVetorial::REAL_64>
+{
+    static const bool sseExigeSse42 = false;
+
+    __attribute__((target("avx2")))
+    static size_t contarMenoresAvx2(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        __m256d procurada = _mm256_set1_pd(chave);
+        size_t menores = 0, i = 0;
+
+        for (; i + 4 <= quantidade; i += 4)
+        {
+            __m256d menor = _mm256_cmp_pd(_mm256_loadu_pd(chaves + i), procurada, _CMP_LT_OQ);
+
+            menores += __builtin_popcount(_mm256_movemask_pd(menor));
+        }
+
+        return menores + contarMenoresEscalar(chaves + i, quantidade - i, chave);
+    }
+
+    __attribute__((target("sse2")))
+    static size_t contarMenoresSse(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        __m128d procurada = _mm_set1_pd(chave);
+        size_t menores = 0, i = 0;
+
+        for (; i + 2 <= quantidade; i += 2)
+        {
+            __m128d menor = _mm_cmplt_pd(_mm_loadu_pd(chaves + i), procurada);
+
+            menores += __builtin_popcount(_mm_movemask_pd(menor));
+        }
+
+        return menores + contarMenoresEscalar(chaves + i, quantidade - i, chave);
+    }
+};
+
+#endif
+
+/**
+ * @brief Pesquisa das chaves inteiras com sinal de 32 ou 64 bits, float e double.
+ *
+ * <p>A pesquisa binária é feita sem desvios, com a comparação virando uma
+ * escolha entre dois ponteiros, e para quando as chaves restantes cabem num
+ * bloco de constantes::bytesDoBlocoDePesquisa bytes. As chaves menores que a
+ * procurada nesse bloco são então contadas de uma vez com AVX2 ou SSE, conforme
+ * o processador em que o programa roda, ou uma a uma caso ele não tenha nenhum
+ * dos dois.</p>
+ *
+ * <p>Com as chaves ordenadas, a quantidade de chaves menores que a procurada é
+ * o próprio índice que o lower_bound retornaria.</p>
+ *
+ * @tparam TIPO Tipo das chaves.
+ */
+template <typename TIPO, TipoVetorial = ClassificadorVetorial<TIPO>::tipo>
+struct PesquisaNasChaves
+{
+    typedef size_t (*ContadorDeMenores)(const TIPO *, size_t, const TIPO &);
+
+    static ContadorDeMenores escolherContador()
+    {
+#ifdef ARVORE_COM_PESQUISA_VETORIAL
+        typedef NucleoVetorial<TIPO> Nucleo;
+
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2")) return Nucleo::contarMenoresAvx2;
+
+        bool temSse = Nucleo::sseExigeSse42 ?
+            __builtin_cpu_supports("sse4.2") : __builtin_cpu_supports("sse2");
+
+        if (temSse) return Nucleo::contarMenoresSse;
+#endif
+
+        return contarMenoresEscalar<TIPO>;
+    }
+
+    static size_t limiteInferior(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        static const ContadorDeMenores contarMenores = escolherContador();
+        const size_t chavesPorBloco = constantes::bytesDoBlocoDePesquisa / sizeof(TIPO);
+        const TIPO *inicio = chaves;
+
+        // Todas as chaves antes de inicio são menores que a procurada e todas a
+        // partir de inicio + quantidade não são
+        while (quantidade > chavesPorBloco)
+        {
+            size_t metade = quantidade / 2;
+
+            inicio = inicio[metade] < chave ? inicio + metade : inicio;
+            quantidade -= metade;
+        }
+
+        return (inicio - chaves) + contarMenores(inicio, quantidade, chave);
+    }
+};
+
+/**
+ * @brief Pesquisa das chaves dos outros tipos, que é o lower_bound da
+ * biblioteca padrão.
+ *
+ * @tparam TIPO Tipo das chaves.
+ */
+template <typename TIPO>
+struct PesquisaNasChaves<TIPO, TipoVetorial::NENHUM>
+{
+    /**
+     * @brief Obtém o índice da primeira chave que não é menor que a procurada,
+     * ou @p quantidade se todas forem.
+     */
+    static size_t limiteInferior(const TIPO *chaves, size_t quantidade, const TIPO &chave)
+    {
+        // lower_bound (pesquisa binária) -> http://www.cplusplus.com/reference/algorithm/lower_bound/
+        return lower_bound(chaves, chaves + quantidade, chave) - chaves;
+    }
+};
+
+/**
+ * @brief Ordem de Eytzinger das chaves: a da raiz de uma árvore binária de
+ * pesquisa, seguida dos seus filhos, dos seus netos e assim por diante, com a
+ * raiz no índice 1 e os filhos do índice k nos índices 2k e 2k + 1. Na pesquisa
+ * binária sobre as chaves ordenadas, cada comparação cai longe da anterior e
+ * costuma custar uma falta no cache. Nesta ordem, as comparações seguintes
+ * ficam perto umas das outras e os descendentes da chave comparada podem ser
+ * trazidos ao cache antes de serem necessários.
+ *
+ * @see [Array layouts for comparison-based searching](https://arxiv.org/abs/1509.05053)
+ *
+ * @tparam TIPO Tipo das chaves.
+ */
+template <typename TIPO>
+struct OrdemEytzinger
+{
+    /**
+     * @brief Obtém a posição do bit 1 mais significativo de @p valor, que não
+     * pode ser 0.
+     */
+    static int obterBitMaisAlto(size_t valor)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(valor);
+#else
+        int bit = 0;
+
+        while (valor >>= 1) bit++;
+
+        return bit;
+#endif
+    }
+
+    /**
+     * @brief Coloca as chaves ordenadas na ordem de Eytzinger. O índice 0 do
+     * destino não é usado, então ele deve ter @p quantidade + 1 posições.
+     *
+     * @param ordenadas Chaves ordenadas.
+     * @param quantidade Quantidade de chaves.
+     * @param eytzinger Destino das chaves.
+     * @param proxima Posição em @p ordenadas da próxima chave a ser colocada.
+     * @param indice Índice da subárvore sendo preenchida.
+     *
+     * @return size_t Posição da chave seguinte à última colocada.
+     */
+    static size_t organizar(const TIPO *ordenadas, size_t quantidade,
+        TIPO *eytzinger, size_t proxima = 0, size_t indice = 1)
+    {
+        // Percorre a árvore em ordem, que é a ordem das chaves ordenadas
+        if (indice <= quantidade)
+        {
+            proxima = organizar(ordenadas, quantidade, eytzinger, proxima, 2 * indice);
+            eytzinger[indice] = ordenadas[proxima++];
+            proxima = organizar(ordenadas, quantidade, eytzinger, proxima, 2 * indice + 1);
+        }
+
+        return proxima;
+    }
+
+    /**
+     * @brief Calcula a posição, nas chaves ordenadas, da chave no índice
+     * informado da ordem de Eytzinger. Ler essa posição de um vetor custaria
+     * mais uma falta no cache.
+     */
+    static size_t obterPosicaoOrdenada(size_t indice, size_t quantidade)
+    {
+        int ultimoNivel = obterBitMaisAlto(quantidade);
+        int nivel = obterBitMaisAlto(indice);
+
+        // Posição caso o último nível estivesse completo
+        size_t posicao = ((2 * (indice - ((size_t) 1 << nivel)) + 1) << (ultimoNivel - nivel)) - 1;
+
+        // No último nível, a i-ésima chave fica na posição 2i da árvore completa,
+        // então as que faltam lá e estariam antes desta são descontadas
+        size_t noUltimoNivel = quantidade + 1 - ((size_t) 1 << ultimoNivel);
+        size_t antesDesta = (posicao + 1) / 2;
+
+        return posicao - (antesDesta > noUltimoNivel ? antesDesta - noUltimoNivel : 0);
+    }
+
+    /**
+     * @brief Obtém a posição, nas chaves ordenadas, da primeira que não é menor
+     * que a procurada, ou @p quantidade se todas forem.
+     */
+    static size_t limiteInferior(const TIPO *eytzinger, size_t quantidade, const TIPO &chave)
+    {
+        // Os descendentes de uma chave 4 níveis abaixo (ou 3, para chaves de 8
+        // bytes) ficam juntos, numa linha de cache
+        const size_t chavesPorLinha = max<size_t>(64 / sizeof(TIPO), 1);
+        size_t indice = 1;
+
+        while (indice <= quantidade)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(eytzinger + indice * chavesPorLinha);
+#endif
+            indice = 2 * indice + (eytzinger[indice] < chave);
+        }
+
+        // Os bits 1 do fim são as descidas à direita depois da última descida à
+        // esquerda, que foi na chave procurada. Sem descida à esquerda, não
+        // sobra nada e todas as chaves são menores.
+        while (indice & 1) indice >>= 1;
+
+        indice >>= 1;
+
+        return indice == 0 ? quantidade : obterPosicaoOrdenada(indice, quantidade);
+    }
+};
@@ -4,6 +4,52 @@ g++ ./mytest.cpp -o ./mytest.exe
 # Executa o teste
 ./mytest.exe
 
+# Compila e executa o teste das inserções concorrentes na árvore B-link
+g++ ./testeConcorrente.cpp -pthread -o ./testeConcorrente.exe
+./testeConcorrente.exe
+
+# Compila e executa o teste das quedas com o diário (precisa de fork, só em
+# sistemas Unix)
+g++ ./testeDiario.cpp -pthread -o ./testeDiario.exe
+./testeDiario.exe
+
+# Compila e executa o teste do cache de páginas
+g++ ./testeCache.cpp -pthread -o ./testeCache.exe
+./testeCache.exe
+
+# Compila e executa o teste dos tipos de armazenamento
+g++ ./testeArmazenamento.cpp -pthread -o ./testeArmazenamento.exe
+./testeArmazenamento.exe
+
+# Compila e executa o teste da compactação
+g++ ./testeCompactacao.cpp -pthread -o ./testeCompactacao.exe
+./testeCompactacao.exe
+
+# Compila e executa o teste da carga em lote
+g++ ./testeCargaEmLote.cpp -pthread -o ./testeCargaEmLote.exe
+./testeCargaEmLote.exe
+
+# Compila e executa o teste do cursor
+g++ ./testeCursor.cpp -pthread -o ./testeCursor.exe
+./testeCursor.exe
+
+# Compila e executa o teste das quedas e reaberturas com a cópia na escrita
+# (precisa de fork, só em sistemas Unix)
+g++ ./testeCopiaNaEscrita.cpp -pthread -o ./testeCopiaNaEscrita.exe
+./testeCopiaNaEscrita.exe
+
+# Compila e executa o teste dos instantâneos
+g++ ./testeInstantaneos.cpp -pthread -o ./testeInstantaneos.exe
+./testeInstantaneos.exe
+
+# Compila e executa o teste da pesquisa nas chaves
+g++ ./testePesquisaNasChaves.cpp -pthread -o ./testePesquisaNasChaves.exe
+./testePesquisaNasChaves.exe
+
+# O mesmo teste, com as páginas internas na ordem de Eytzinger
+g++ ./testePesquisaNasChaves.cpp -DARVORE_COM_ORDEM_EYTZINGER -pthread -o ./testePesquisaNasChaves.exe
+./testePesquisaNasChaves.exe
+
 # Remove arquivos desnecessários
 rm *.exe
 rm ./TesteArvore.txt
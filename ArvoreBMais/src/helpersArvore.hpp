@@ -10,6 +10,9 @@
 
 #include "templates/serializavel.hpp"
 
+#include <cstdint>
+#include <cstring>
+
 using namespace std;
 
 /**
@@ -27,6 +30,28 @@ size_t obterTamanhoEmBytes(fstream& arquivo)
     return arquivo.tellg();
 }
 
+/**
+ * @brief Calcula a soma de verificação (FNV-1a de 64 bits) dos bytes, usada para
+ * reconhecer registros que ficaram pela metade numa queda.
+ * 
+ * @param bytes Primeiro byte.
+ * @param tamanho Quantidade de bytes.
+ * 
+ * @return uint64_t Soma dos bytes.
+ */
+uint64_t somarBytes(const char *bytes, size_t tamanho)
+{
+    uint64_t soma = 14695981039346656037ull;
+
+    for (size_t i = 0; i < tamanho; i++)
+    {
+        soma ^= (unsigned char) bytes[i];
+        soma *= 1099511628211ull;
+    }
+
+    return soma;
+}
+
 // Especialização para classes abstratas
 // https://stackoverflow.com/questions/24936862/c-template-specialization-for-subclasses-with-abstract-base-class
 template<typename TIPO, bool = is_base_of<Serializavel, TIPO>::value>
@@ -57,6 +82,78 @@ struct Medidor<TIPO, true> // true quando TIPO herdar de Serializavel
     }
 };
 
+/**
+ * @brief Lê e escreve valores diretamente num buffer de bytes, sem passar por
+ * DataInputStream ou DataOutputStream. Tipos primitivos são copiados com um
+ * único memcpy.
+ * 
+ * @tparam TIPO Tipo do valor.
+ */
+template<typename TIPO, bool = is_base_of<Serializavel, TIPO>::value>
+struct CopiadorDeBytes
+{
+    /**
+     * @brief Lê o valor que começa em @p origem.
+     * 
+     * @param origem Posição do primeiro byte do valor no buffer.
+     * @param destino Variável que receberá o valor.
+     * 
+     * @return const tipo_byte* Posição logo após o último byte do valor.
+     */
+    static const tipo_byte *ler(const tipo_byte *origem, TIPO &destino)
+    {
+        static_assert(
+            is_fundamental<TIPO>::value,
+            "Os tipos da árvore devem ser primitivos caso não herdem de Serializavel."
+        );
+
+        // memcpy não exige que a origem esteja alinhada para o TIPO
+        memcpy(&destino, origem, sizeof(TIPO));
+
+        return origem + sizeof(TIPO);
+    }
+
+    /**
+     * @brief Escreve o valor a partir de @p destino.
+     * 
+     * @param destino Posição do buffer onde o primeiro byte do valor ficará.
+     * @param origem Valor a ser escrito.
+     * 
+     * @return tipo_byte* Posição logo após o último byte escrito.
+     */
+    static tipo_byte *escrever(tipo_byte *destino, TIPO &origem)
+    {
+        memcpy(destino, &origem, sizeof(TIPO));
+
+        return destino + sizeof(TIPO);
+    }
+};
+
+template<typename TIPO>
+struct CopiadorDeBytes<TIPO, true> // true quando TIPO herdar de Serializavel
+{
+    static const tipo_byte *ler(const tipo_byte *origem, TIPO &destino)
+    {
+        // Cada serializável sempre ocupa o seu tamanho máximo
+        Serializavel &serializavel = destino;
+        int tamanho = serializavel.obterTamanhoMaximoEmBytes();
+
+        serializavel.lerBytes((char *) origem, tamanho);
+
+        return origem + tamanho;
+    }
+
+    static tipo_byte *escrever(tipo_byte *destino, TIPO &origem)
+    {
+        Serializavel &serializavel = origem;
+        int tamanho = serializavel.obterTamanhoMaximoEmBytes();
+
+        serializavel.escreverBytes((char *) destino, tamanho);
+
+        return destino + tamanho;
+    }
+};
+
 template<typename TIPO_DAS_CHAVES, typename TIPO_DOS_DADOS>
 void obterTamanhoEmBytesDaChaveEDoDado(
     int& maximoDeBytesParaAChave,
@@ -221,7 +221,9 @@ public:
     template<typename tipo>
     tipo ler(int tamanhoDoValor = sizeof(tipo))
     {
-        tipo valor;
+        // Nada é lido quando o stream já está no fim, então o valor começa
+        // zerado em vez de devolver lixo
+        tipo valor{};
 
         lerParaOPonteiro(&valor, tamanhoDoValor);
 
@@ -0,0 +1,269 @@
+#include "ArvoreBMais.hpp"
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <cstdio>
+
+using namespace std;
+
+/**
+ * Confere se a árvore tem exatamente os registros do map, tanto pela listagem
+ * de todas as chaves quanto pela pesquisa de cada uma.
+ */
+template<typename Arvore>
+bool conferir(Arvore &arvore, map<int, int> &esperado)
+{
+    vector<int> dados = arvore.listarDadosComAChaveEntre(0, 1 << 30);
+    size_t indice = 0;
+
+    if (dados.size() != esperado.size()) return false;
+
+    for (auto &&par : esperado)
+    {
+        if (dados[indice++] != par.second ||
+            arvore.pesquisar((int) par.first) != par.second)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Faz inserções e exclusões aleatórias no armazenamento informado, comparando
+ * a árvore com um map. Depois reabre o arquivo no mesmo armazenamento e com o
+ * fstream, já que todos eles devem gravar o mesmo formato. Na memória, nada
+ * vai para o arquivo, então a árvore reaberta está vazia.
+ */
+template<typename Arvore>
+bool testarArmazenamento(string nomeDoArquivo, TipoDeArmazenamento tipo, string nome)
+{
+    map<int, int> esperado;
+    mt19937 aleatorio(7);
+    bool sucesso = true;
+
+    remove(nomeDoArquivo.c_str());
+
+    {
+        Arvore arvore(nomeDoArquivo, 5, 8, TipoDePolitica::LRU, tipo);
+
+        for (int operacao = 0; operacao < 4000; operacao++)
+        {
+            int chave = aleatorio() % 2000;
+
+            if (esperado.count(chave) == 0)
+            {
+                int dado = chave * 3;
+
+                arvore.inserir(chave, dado);
+                esperado[chave] = dado;
+            }
+
+            else if (aleatorio() % 2 == 0)
+            {
+                if (arvore.excluir(chave) != esperado[chave]) sucesso = false;
+
+                esperado.erase(chave);
+            }
+        }
+
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    if (tipo == TipoDeArmazenamento::MEMORIA) esperado.clear();
+
+    for (TipoDeArmazenamento tipoAoReabrir : { tipo, TipoDeArmazenamento::FSTREAM })
+    {
+        Arvore arvore(nomeDoArquivo, 5, 8, TipoDePolitica::LRU, tipoAoReabrir);
+
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    if (!sucesso) cout << nome << ": a árvore não confere com o map" << endl;
+
+    return sucesso;
+}
+
+/**
+ * Confere a pesquisa de várias chaves de uma vez, que lê as páginas de cada
+ * nível num único lote, com chaves que estão e que não estão no map.
+ */
+template<typename Arvore>
+bool conferirLote(Arvore &arvore, map<int, int> &esperado, int maiorChave)
+{
+    vector<int> chaves;
+    vector<bool> encontradas;
+
+    for (int chave = maiorChave; chave >= 0; chave--) chaves.push_back(chave);
+
+    vector<int> dados = arvore.pesquisarVarios(chaves, encontradas);
+
+    for (size_t i = 0; i < chaves.size(); i++)
+    {
+        auto iterador = esperado.find(chaves[i]);
+
+        if (encontradas[i] != (iterador != esperado.end()) ||
+            (encontradas[i] && dados[i] != iterador->second))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Insere lotes de pares, pesquisa todas as chaves num lote e reabre o arquivo.
+ * O cache grande faz as páginas sujas irem para o arquivo num único lote de
+ * escritas no fechamento, então os lotes de leitura e de escrita do
+ * armazenamento são usados.
+ */
+template<typename Arvore>
+bool testarLotes(string nomeDoArquivo, TipoDeArmazenamento tipo, string nome)
+{
+    map<int, int> esperado;
+    vector<int> todas(3000);
+    bool sucesso = true;
+
+    // Só as chaves pares entram, então as ímpares são pesquisadas sem sucesso
+    for (size_t i = 0; i < todas.size(); i++) todas[i] = (int) i * 2;
+
+    shuffle(todas.begin(), todas.end(), mt19937(13));
+    remove(nomeDoArquivo.c_str());
+
+    {
+        Arvore arvore(nomeDoArquivo, 5, 1000, TipoDePolitica::LRU, tipo);
+
+        for (size_t inicio = 0; inicio < todas.size(); inicio += 500)
+        {
+            vector<int> chaves(todas.begin() + inicio, todas.begin() + inicio + 500);
+            vector<int> dados;
+
+            for (int chave : chaves)
+            {
+                dados.push_back(chave + 1);
+                esperado[chave] = chave + 1;
+            }
+
+            arvore.inserirVarios(chaves, dados);
+        }
+
+        sucesso = conferirLote(arvore, esperado, 6000) && conferir(arvore, esperado);
+    }
+
+    if (tipo != TipoDeArmazenamento::MEMORIA)
+    {
+        Arvore arvore(nomeDoArquivo, 5, 1000, TipoDePolitica::LRU, tipo);
+
+        sucesso = conferirLote(arvore, esperado, 6000) && sucesso;
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    if (!sucesso) cout << nome << ": a pesquisa em lote não confere com o map" << endl;
+
+    return sucesso;
+}
+
+/**
+ * Esvazia a árvore e insere de novo as mesmas chaves, na mesma ordem, algumas
+ * vezes. As páginas liberadas pelas exclusões devem ser reaproveitadas, então o
+ * arquivo não cresce depois da primeira rodada.
+ */
+template<typename Arvore>
+bool testarReaproveitamento(string nomeDoArquivo, TipoDeArmazenamento tipo, string nome)
+{
+    vector<int> chaves(3000);
+    vector<long> tamanhos;
+    bool sucesso = true;
+
+    for (size_t i = 0; i < chaves.size(); i++) chaves[i] = (int) i;
+
+    shuffle(chaves.begin(), chaves.end(), mt19937(11));
+    remove(nomeDoArquivo.c_str());
+
+    for (int rodada = 0; rodada < 3; rodada++)
+    {
+        {
+            Arvore arvore(nomeDoArquivo, 5, 8, TipoDePolitica::LRU, tipo);
+
+            for (int chave : chaves) arvore.excluir(chave);
+
+            for (int chave : chaves)
+            {
+                int dado = chave + rodada;
+
+                arvore.inserir(chave, dado);
+            }
+
+            for (int chave : chaves)
+            {
+                if (arvore.pesquisar(chave) != chave + rodada) sucesso = false;
+            }
+        }
+
+        ifstream arquivo(nomeDoArquivo, ios::binary | ios::ate);
+
+        tamanhos.push_back((long) arquivo.tellg());
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    if (tamanhos.back() != tamanhos.front())
+    {
+        sucesso = false;
+
+        cout << nome << ": o arquivo foi de " << tamanhos.front() << " para "
+             << tamanhos.back() << " bytes com as mesmas chaves" << endl;
+    }
+
+    else if (!sucesso) cout << nome << ": chaves reinseridas não foram encontradas" << endl;
+
+    return sucesso;
+}
+
+int main()
+{
+    string nomeDoArquivo("TesteArmazenamento.txt");
+    bool sucesso = true;
+
+    vector< pair<TipoDeArmazenamento, string> > tipos = {
+        { TipoDeArmazenamento::FSTREAM, "FSTREAM" },
+        { TipoDeArmazenamento::PREAD, "PREAD" },
+        { TipoDeArmazenamento::MMAP, "MMAP" },
+        { TipoDeArmazenamento::ASSINCRONO, "ASSINCRONO" },
+        { TipoDeArmazenamento::MEMORIA, "MEMORIA" }
+    };
+
+    for (auto &&tipo : tipos)
+    {
+        sucesso = testarArmazenamento< ArvoreB<int, int> >(
+            nomeDoArquivo, tipo.first, tipo.second) && sucesso;
+        sucesso = testarArmazenamento< ArvoreBMais<int, int> >(
+            nomeDoArquivo, tipo.first, tipo.second) && sucesso;
+        sucesso = testarLotes< ArvoreB<int, int> >(
+            nomeDoArquivo, tipo.first, tipo.second) && sucesso;
+        sucesso = testarLotes< ArvoreBMais<int, int> >(
+            nomeDoArquivo, tipo.first, tipo.second) && sucesso;
+
+        if (tipo.first == TipoDeArmazenamento::MEMORIA) continue;
+
+        sucesso = testarReaproveitamento< ArvoreB<int, int> >(
+            nomeDoArquivo, tipo.first, tipo.second) && sucesso;
+        sucesso = testarReaproveitamento< ArvoreBMais<int, int> >(
+            nomeDoArquivo, tipo.first, tipo.second) && sucesso;
+    }
+
+    cout << (sucesso ? "Todos os armazenamentos deram os mesmos resultados" :
+        "Alguns armazenamentos deram resultados diferentes") << endl;
+
+    return sucesso ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include "ArvoreBMais.hpp"
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <vector>
+#include <random>
+#include <cstdio>
+
+using namespace std;
+
+/**
+ * Confere se a árvore tem exatamente os registros do map, tanto pela listagem
+ * de todas as chaves quanto pela pesquisa de cada uma.
+ */
+template<typename Arvore>
+bool conferir(Arvore &arvore, map<int, int> &esperado)
+{
+    vector<int> dados = arvore.listarDadosComAChaveEntre(0, 1 << 30);
+    size_t indice = 0;
+
+    if (dados.size() != esperado.size()) return false;
+
+    for (auto &&par : esperado)
+    {
+        if (dados[indice++] != par.second ||
+            arvore.pesquisar((int) par.first) != par.second)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Faz inserções e exclusões aleatórias com o cache de páginas na capacidade e
+ * na política informadas, comparando a árvore com um map. Depois reabre o
+ * arquivo com outra capacidade e outra política, então as páginas sujas que
+ * estavam só no cache precisam ter ido para o arquivo no fechamento.
+ */
+template<typename Arvore>
+bool testarCache(string nomeDoArquivo, int capacidade,
+    TipoDePolitica politica, TipoDePolitica politicaAoReabrir)
+{
+    map<int, int> esperado;
+    mt19937 aleatorio(capacidade);
+    bool sucesso = true;
+    EstatisticasDoCache estatisticas;
+
+    remove(nomeDoArquivo.c_str());
+
+    {
+        Arvore arvore(nomeDoArquivo, 5, capacidade, politica);
+
+        for (int operacao = 0; operacao < 4000; operacao++)
+        {
+            int chave = aleatorio() % 2000;
+
+            if (esperado.count(chave) == 0)
+            {
+                int dado = chave * 3;
+
+                arvore.inserir(chave, dado);
+                esperado[chave] = dado;
+            }
+
+            else if (aleatorio() % 2 == 0)
+            {
+                if (arvore.excluir(chave) != esperado[chave]) sucesso = false;
+
+                esperado.erase(chave);
+            }
+        }
+
+        sucesso = conferir(arvore, esperado) && sucesso;
+        estatisticas = arvore.obterEstatisticasDoCache();
+    }
+
+    // Sem cache, nenhuma leitura é atendida por ele. Com um cache bem menor que
+    // a árvore, a política precisa ter escolhido páginas para sair.
+    if ((capacidade == 0) != (estatisticas.acertos == 0)) sucesso = false;
+    if (capacidade > 0 && capacidade < 100 && estatisticas.remocoes == 0) sucesso = false;
+
+    {
+        Arvore arvore(nomeDoArquivo, 5, capacidade == 0 ? 16 : 0, politicaAoReabrir);
+
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    if (!sucesso)
+    {
+        cout << "Capacidade " << capacidade << " com " << estatisticas.politica
+             << ": a árvore não confere com o map" << endl;
+    }
+
+    return sucesso;
+}
+
+int main()
+{
+    string nomeDoArquivo("TesteCache.txt");
+    bool sucesso = true;
+
+    vector<TipoDePolitica> politicas = { TipoDePolitica::LRU, TipoDePolitica::CLOCK,
+        TipoDePolitica::DOIS_Q, TipoDePolitica::LRU_K };
+
+    for (size_t i = 0; i < politicas.size(); i++)
+    {
+        TipoDePolitica politica = politicas[i];
+        TipoDePolitica outra = politicas[(i + 1) % politicas.size()];
+
+        for (int capacidade : { 0, 1, 3, 16, 1000 })
+        {
+            sucesso = testarCache< ArvoreB<int, int> >(
+                nomeDoArquivo, capacidade, politica, outra) && sucesso;
+            sucesso = testarCache< ArvoreBMais<int, int> >(
+                nomeDoArquivo, capacidade, politica, outra) && sucesso;
+        }
+    }
+
+    cout << (sucesso ? "O cache não mudou nenhum resultado" :
+        "O cache mudou alguns resultados") << endl;
+
+    return sucesso ? 0 : 1;
+}
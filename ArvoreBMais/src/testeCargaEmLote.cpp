@@ -0,0 +1,272 @@
+#include "ArvoreBMais.hpp"
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+
+using namespace std;
+
+/**
+ * Confere se a árvore tem exatamente os registros do map, tanto pela listagem
+ * de todas as chaves quanto pela pesquisa de cada uma.
+ */
+template<typename Arvore>
+bool conferir(Arvore &arvore, map<int, int> &esperado)
+{
+    vector<int> dados = arvore.listarDadosComAChaveEntre(0, 1 << 30);
+    size_t indice = 0;
+
+    if (dados.size() != esperado.size()) return false;
+
+    for (auto &&par : esperado)
+    {
+        if (dados[indice++] != par.second ||
+            arvore.pesquisar((int) par.first) != par.second)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Faz inserções e exclusões aleatórias, na mesma árvore e no map.
+ */
+template<typename Arvore>
+void misturarOperacoes(Arvore &arvore, map<int, int> &esperado, mt19937 &aleatorio,
+    int operacoes, int maiorChave)
+{
+    for (int operacao = 0; operacao < operacoes; operacao++)
+    {
+        int chave = aleatorio() % maiorChave;
+
+        if (esperado.count(chave) == 0)
+        {
+            int dado = -chave;
+
+            arvore.inserir(chave, dado);
+            esperado[chave] = dado;
+        }
+
+        else if (aleatorio() % 2 == 0)
+        {
+            arvore.excluir(chave);
+            esperado.erase(chave);
+        }
+    }
+}
+
+/**
+ * Carrega em lote as chaves pares de 0 até 2 * (quantidade - 1), confere a
+ * árvore, faz inserções e exclusões por cima da carga, que precisam dividir e
+ * fundir as páginas montadas por ela, e reabre o arquivo.
+ */
+bool testarCarga(string nomeDoArquivo, int ordem, int quantidade, double fator)
+{
+    map<int, int> esperado;
+    mt19937 aleatorio(quantidade);
+    bool sucesso = true;
+
+    for (int i = 0; i < quantidade; i++) esperado[2 * i] = i;
+
+    remove(nomeDoArquivo.c_str());
+
+    {
+        ArvoreBMais<int, int> arvore(nomeDoArquivo, ordem);
+
+        arvore.carregarEmLote(esperado.begin(), esperado.end(), fator);
+        sucesso = conferir(arvore, esperado);
+
+        misturarOperacoes(arvore, esperado, aleatorio, quantidade, 2 * quantidade + 2);
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    {
+        ArvoreBMais<int, int> arvore(nomeDoArquivo, ordem);
+
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    if (!sucesso)
+    {
+        cout << "Ordem " << ordem << ", " << quantidade << " registros e fator "
+             << fator << ": a árvore não confere com o map" << endl;
+    }
+
+    return sucesso;
+}
+
+/**
+ * Uma carga fora de ordem deve ser recusada sem deixar a árvore pela metade.
+ */
+bool testarCargaForaDeOrdem(string nomeDoArquivo)
+{
+    vector< pair<int, int> > pares = { { 1, 1 }, { 5, 5 }, { 3, 3 } };
+    map<int, int> esperado;
+    bool recusou = false;
+
+    remove(nomeDoArquivo.c_str());
+
+    ArvoreBMais<int, int> arvore(nomeDoArquivo, 4);
+
+    try
+    {
+        arvore.carregarEmLote(pares.begin(), pares.end());
+    }
+
+    catch (invalid_argument &)
+    {
+        recusou = true;
+    }
+
+    bool sucesso = recusou && conferir(arvore, esperado);
+
+    if (!sucesso) cout << "A carga fora de ordem não foi recusada" << endl;
+
+    return sucesso;
+}
+
+/**
+ * Constrói a árvore a partir de pares embaralhados. O orçamento de memória
+ * pequeno faz a ordenação externa gerar muitas sequências e intercalá-las em
+ * mais de uma rodada. Os arquivos temporários devem ser apagados no fim.
+ */
+template<typename Arvore>
+bool testarConstrucao(string nomeDoArquivo, string nome, int quantidade, size_t orcamento)
+{
+    vector< pair<int, int> > pares;
+    map<int, int> esperado;
+    mt19937 aleatorio(quantidade);
+    bool sucesso = true;
+
+    for (int i = 0; i < quantidade; i++)
+    {
+        pares.push_back(make_pair(3 * i, i));
+        esperado[3 * i] = i;
+    }
+
+    shuffle(pares.begin(), pares.end(), aleatorio);
+    remove(nomeDoArquivo.c_str());
+
+    {
+        Arvore arvore(nomeDoArquivo, 16);
+
+        arvore.construirAPartirDe(pares.begin(), pares.end(), orcamento, 0.8);
+        sucesso = conferir(arvore, esperado);
+
+        misturarOperacoes(arvore, esperado, aleatorio, quantidade, 3 * quantidade);
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    {
+        Arvore arvore(nomeDoArquivo, 16);
+
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    ifstream sequencia(nomeDoArquivo + ".sequencia0");
+
+    if (sequencia.is_open())
+    {
+        sucesso = false;
+
+        cout << nome << ": os arquivos temporários da ordenação ficaram no disco" << endl;
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    if (!sucesso)
+    {
+        cout << nome << " com " << quantidade << " registros e " << orcamento
+             << " bytes: a árvore não confere com o map" << endl;
+    }
+
+    return sucesso;
+}
+
+/**
+ * Um fator de preenchimento inválido deve ser recusado antes de a ordenação
+ * começar, sem mexer na árvore.
+ */
+template<typename Arvore>
+bool testarFatorInvalido(string nomeDoArquivo, string nome)
+{
+    vector< pair<int, int> > pares = { { 2, 2 }, { 1, 1 } };
+    map<int, int> esperado = { { 7, 7 } };
+    bool recusou = false;
+
+    remove(nomeDoArquivo.c_str());
+
+    Arvore arvore(nomeDoArquivo, 4);
+
+    arvore.inserir(7, 7);
+
+    try
+    {
+        arvore.construirAPartirDe(pares.begin(), pares.end(), 1 << 20, 1.5);
+    }
+
+    catch (invalid_argument &)
+    {
+        recusou = true;
+    }
+
+    bool sucesso = recusou && conferir(arvore, esperado);
+
+    if (!sucesso)
+    {
+        cout << nome << ": o fator de preenchimento inválido não foi recusado" << endl;
+    }
+
+    return sucesso;
+}
+
+int main()
+{
+    string nomeDoArquivo("TesteCargaEmLote.txt");
+    bool sucesso = true;
+
+    for (int ordem : { 3, 4, 5, 16 })
+    {
+        for (int quantidade : { 0, 1, 2, 7, 100, 5000 })
+        {
+            for (double fator : { 1.0, 0.7, 0.1 })
+            {
+                sucesso = testarCarga(nomeDoArquivo, ordem, quantidade, fator) && sucesso;
+            }
+        }
+    }
+
+    sucesso = testarCargaForaDeOrdem(nomeDoArquivo) && sucesso;
+
+    for (int quantidade : { 0, 1, 1000, 30000 })
+    {
+        for (size_t orcamento : { 256, 4096, 1 << 20 })
+        {
+            sucesso = testarConstrucao< ArvoreB<int, int> >(
+                nomeDoArquivo, "ArvoreB", quantidade, orcamento) && sucesso;
+            sucesso = testarConstrucao< ArvoreBMais<int, int> >(
+                nomeDoArquivo, "ArvoreBMais", quantidade, orcamento) && sucesso;
+        }
+    }
+
+    sucesso = testarFatorInvalido< ArvoreB<int, int> >(nomeDoArquivo, "ArvoreB") && sucesso;
+    sucesso = testarFatorInvalido< ArvoreBMais<int, int> >(
+        nomeDoArquivo, "ArvoreBMais") && sucesso;
+
+    remove(nomeDoArquivo.c_str());
+
+    cout << (sucesso ? "Todas as cargas em lote conferem com o map" :
+        "Algumas cargas em lote não conferem com o map") << endl;
+
+    return sucesso ? 0 : 1;
+}
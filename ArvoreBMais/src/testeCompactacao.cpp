@@ -0,0 +1,156 @@
+#include "ArvoreBMais.hpp"
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <map>
+#include <random>
+#include <cstdio>
+
+using namespace std;
+
+/**
+ * Confere se a árvore tem exatamente os registros do map, tanto pela listagem
+ * de todas as chaves quanto pela pesquisa de cada uma.
+ */
+template<typename Arvore>
+bool conferir(Arvore &arvore, map<int, int> &esperado)
+{
+    vector<int> dados = arvore.listarDadosComAChaveEntre(0, 1 << 30);
+    size_t indice = 0;
+
+    if (dados.size() != esperado.size()) return false;
+
+    for (auto &&par : esperado)
+    {
+        if (dados[indice++] != par.second ||
+            arvore.pesquisar((int) par.first) != par.second)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Faz inserções e exclusões aleatórias, na mesma árvore e no map.
+ */
+template<typename Arvore>
+void misturarOperacoes(Arvore &arvore, map<int, int> &esperado, mt19937 &aleatorio,
+    int operacoes)
+{
+    for (int operacao = 0; operacao < operacoes; operacao++)
+    {
+        int chave = aleatorio() % 3000;
+
+        if (esperado.count(chave) == 0)
+        {
+            int dado = chave * 7;
+
+            arvore.inserir(chave, dado);
+            esperado[chave] = dado;
+        }
+
+        else if (aleatorio() % 3 > 0)
+        {
+            arvore.excluir(chave);
+            esperado.erase(chave);
+        }
+    }
+}
+
+long tamanhoDoArquivo(string nomeDoArquivo)
+{
+    ifstream arquivo(nomeDoArquivo, ios::binary | ios::ate);
+
+    return (long) arquivo.tellg();
+}
+
+/**
+ * Enche a árvore, exclui boa parte dos registros e compacta o arquivo. Ele deve
+ * encolher e continuar igual ao map, inclusive depois de novas operações e de
+ * ser reaberto.
+ */
+template<typename Arvore, typename... Opcoes>
+bool testarCompactacao(string nomeDoArquivo, string nome, Opcoes... opcoes)
+{
+    map<int, int> esperado;
+    mt19937 aleatorio(5);
+    bool sucesso = true;
+    long antes, depois;
+
+    remove(nomeDoArquivo.c_str());
+
+    {
+        Arvore arvore(nomeDoArquivo, 5, opcoes...);
+
+        misturarOperacoes(arvore, esperado, aleatorio, 6000);
+
+        for (auto iterador = esperado.begin(); iterador != esperado.end(); )
+        {
+            if (iterador->first % 4 == 0) iterador++;
+
+            else
+            {
+                arvore.excluir((int) iterador->first);
+                iterador = esperado.erase(iterador);
+            }
+        }
+
+        arvore.descarregar();
+        antes = tamanhoDoArquivo(nomeDoArquivo);
+
+        arvore.compactar();
+        depois = tamanhoDoArquivo(nomeDoArquivo);
+
+        sucesso = conferir(arvore, esperado);
+
+        misturarOperacoes(arvore, esperado, aleatorio, 2000);
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    {
+        Arvore arvore(nomeDoArquivo, 5, opcoes...);
+
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    remove(nomeDoArquivo.c_str());
+    remove((nomeDoArquivo + ".diario").c_str());
+
+    if (!sucesso) cout << nome << ": a árvore compactada não confere com o map" << endl;
+
+    if (depois >= antes)
+    {
+        sucesso = false;
+
+        cout << nome << ": o arquivo foi de " << antes << " para " << depois
+             << " bytes na compactação" << endl;
+    }
+
+    return sucesso;
+}
+
+int main()
+{
+    string nomeDoArquivo("TesteCompactacao.txt");
+    bool sucesso = testarCompactacao< ArvoreB<int, int> >(nomeDoArquivo, "ArvoreB");
+
+    sucesso = testarCompactacao< ArvoreB<int, int> >(
+        nomeDoArquivo, "ArvoreB com a cópia na escrita", 16, TipoDePolitica::LRU,
+        TipoDeArmazenamento::PREAD, PoliticaDoDiario::NENHUM,
+        ModoDeEscrita::COPIA_NA_ESCRITA) && sucesso;
+
+    sucesso = testarCompactacao< ArvoreBMais<int, int> >(
+        nomeDoArquivo, "ArvoreBMais") && sucesso;
+
+    sucesso = testarCompactacao< ArvoreBMais<int, int> >(
+        nomeDoArquivo, "ArvoreBMais com o diário", 16, TipoDePolitica::LRU,
+        TipoDeArmazenamento::PREAD, PoliticaDoDiario::PERIODICA) && sucesso;
+
+    cout << (sucesso ? "A compactação manteve todos os registros" :
+        "A compactação mudou alguns registros") << endl;
+
+    return sucesso ? 0 : 1;
+}
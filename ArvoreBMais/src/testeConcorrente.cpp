@@ -0,0 +1,82 @@
+#include "ArvoreBLink.hpp"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+/**
+ * Várias threads inserem chaves distintas, embaralhadas, na mesma árvore B-link.
+ * Depois que todas terminam, cada chave é pesquisada a partir da raiz. Ordens
+ * pequenas fazem as divisões subirem por vários níveis ao mesmo tempo.
+ */
+int main()
+{
+    string nomeDoArquivo("TesteConcorrente.txt");
+    const int quantidadeDeThreads = 4;
+    const int chavesPorThread = 800;
+    const int rodadas = 20;
+    int rodadasComFalha = 0;
+
+    for (int ordem : { 3, 4, 5, 16 })
+    {
+        for (int rodada = 0; rodada < rodadas; rodada++)
+        {
+            remove(nomeDoArquivo.c_str());
+
+            ArvoreBLink<int, int> arvore(nomeDoArquivo, ordem);
+            vector<int> chaves(quantidadeDeThreads * chavesPorThread);
+
+            for (size_t i = 0; i < chaves.size(); i++) chaves[i] = (int) i * 2;
+
+            shuffle(chaves.begin(), chaves.end(), mt19937(rodada));
+
+            vector<thread> threads;
+
+            for (int t = 0; t < quantidadeDeThreads; t++)
+            {
+                threads.emplace_back([&arvore, &chaves, t]()
+                {
+                    for (size_t i = t; i < chaves.size(); i += quantidadeDeThreads)
+                    {
+                        int chave = chaves[i];
+                        int dado = chave + 1;
+
+                        arvore.inserir(chave, dado);
+                    }
+                });
+            }
+
+            for (auto &&insercao : threads) insercao.join();
+
+            int perdidas = 0;
+
+            for (auto &&chave : chaves)
+            {
+                if (arvore.pesquisar(chave) != chave + 1) perdidas++;
+            }
+
+            int listadas = arvore.listarDadosComAChaveEntre(0, 2 * (int) chaves.size()).size();
+
+            if (perdidas > 0 || listadas != (int) chaves.size())
+            {
+                rodadasComFalha++;
+
+                cout << "Ordem " << ordem << ", rodada " << rodada << ": " << perdidas
+                     << " chaves não foram encontradas e " << listadas << " de "
+                     << chaves.size() << " foram listadas" << endl;
+            }
+        }
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    cout << (rodadasComFalha == 0 ? "Todas as chaves foram encontradas" :
+        "Algumas chaves foram perdidas") << endl;
+
+    return rodadasComFalha == 0 ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#include "ArvoreB.hpp"
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <vector>
+#include <random>
+#include <cstdio>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+typedef ArvoreB<int, int> Arvore;
+
+/**
+ * Gera a mesma sequência de inserções e exclusões no filho e no pai. Cada
+ * operação insere a chave caso ela não esteja no map e a exclui caso esteja.
+ */
+class GeradorDeOperacoes
+{
+    mt19937 aleatorio;
+
+public:
+    map<int, int> registros;
+
+    GeradorDeOperacoes(int semente) : aleatorio(semente) {}
+
+    /**
+     * @brief Sorteia a próxima chave e aplica a operação no map.
+     *
+     * @return bool true caso a operação seja uma inserção.
+     */
+    bool proxima(int &chave)
+    {
+        chave = aleatorio() % 1500;
+
+        if (registros.count(chave) > 0)
+        {
+            registros.erase(chave);
+
+            return false;
+        }
+
+        registros[chave] = chave * 2;
+
+        return true;
+    }
+
+    /**
+     * @brief Gera a próxima operação e a faz na árvore.
+     */
+    void aplicar(Arvore &arvore)
+    {
+        int chave;
+
+        if (proxima(chave))
+        {
+            int dado = chave * 2;
+
+            arvore.inserir(chave, dado);
+        }
+
+        else arvore.excluir(chave);
+    }
+};
+
+Arvore *abrir(string nomeDoArquivo)
+{
+    return new Arvore(nomeDoArquivo, 5, 8, TipoDePolitica::LRU,
+        TipoDeArmazenamento::PREAD, PoliticaDoDiario::NENHUM,
+        ModoDeEscrita::COPIA_NA_ESCRITA);
+}
+
+vector<int> dadosDoMap(map<int, int> &registros)
+{
+    vector<int> dados;
+
+    for (auto &&par : registros) dados.push_back(par.second);
+
+    return dados;
+}
+
+/**
+ * Confere se a árvore tem exatamente os registros do map, tanto pela listagem
+ * de todas as chaves quanto pela pesquisa de cada uma.
+ */
+bool conferir(Arvore &arvore, map<int, int> &esperado)
+{
+    if (arvore.listarDadosComAChaveEntre(0, 1 << 30) != dadosDoMap(esperado)) return false;
+
+    for (auto &&par : esperado)
+    {
+        if (arvore.pesquisar((int) par.first) != par.second) return false;
+    }
+
+    return true;
+}
+
+/**
+ * Sem quedas, todas as operações devem estar no arquivo depois de fechá-lo,
+ * inclusive as que vieram depois da última versão gravada pelo caminho.
+ */
+bool testarReaberturas(string nomeDoArquivo)
+{
+    GeradorDeOperacoes gerador(1);
+    bool sucesso = true;
+
+    remove(nomeDoArquivo.c_str());
+
+    for (int abertura = 0; abertura < 5; abertura++)
+    {
+        Arvore *arvore = abrir(nomeDoArquivo);
+
+        sucesso = conferir(*arvore, gerador.registros) && sucesso;
+
+        for (int operacao = 0; operacao < 1000 + abertura * 37; operacao++)
+        {
+            gerador.aplicar(*arvore);
+        }
+
+        sucesso = conferir(*arvore, gerador.registros) && sucesso;
+
+        delete arvore;
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    if (!sucesso) cout << "A árvore reaberta não confere com o map" << endl;
+
+    return sucesso;
+}
+
+/**
+ * Um processo filho faz inserções e exclusões até ser morto com SIGKILL. A
+ * árvore reaberta deve ser igual ao map depois de algum prefixo das operações
+ * e ter pelo menos as operações até a última versão gravada no cabeçalho (veja
+ * constantes::operacoesPorVersaoGravada). Depois, ela deve continuar
+ * funcionando e sobreviver a mais uma reabertura.
+ */
+bool testarQuedas(string nomeDoArquivo, volatile int *feitas)
+{
+    bool sucesso = true;
+
+    for (int queda = 0; queda < 10; queda++)
+    {
+        remove(nomeDoArquivo.c_str());
+        *feitas = 0;
+
+        pid_t filho = fork();
+
+        if (filho == 0)
+        {
+            Arvore *arvore = abrir(nomeDoArquivo);
+            GeradorDeOperacoes gerador(queda);
+
+            for (int operacao = 0; ; operacao++)
+            {
+                gerador.aplicar(*arvore);
+                *feitas = operacao + 1;
+            }
+        }
+
+        usleep(30000 + queda * 10000);
+        kill(filho, SIGKILL);
+        waitpid(filho, nullptr, 0);
+
+        int confirmadas = *feitas;
+        int gravadas = confirmadas / constantes::operacoesPorVersaoGravada *
+            constantes::operacoesPorVersaoGravada;
+
+        Arvore *arvore = abrir(nomeDoArquivo);
+        vector<int> dados = arvore->listarDadosComAChaveEntre(0, 1 << 30);
+        GeradorDeOperacoes gerador(queda);
+        int chave, prefixo = -1;
+
+        // A operação em andamento na queda também pode ter sido gravada
+        for (int operacao = 0; operacao <= confirmadas + 1; operacao++)
+        {
+            if (operacao >= gravadas && dados == dadosDoMap(gerador.registros))
+            {
+                prefixo = operacao;
+
+                break;
+            }
+
+            gerador.proxima(chave);
+        }
+
+        if (prefixo < 0 || !conferir(*arvore, gerador.registros))
+        {
+            sucesso = false;
+
+            cout << "Queda " << queda << ": a árvore não é nenhuma versão entre a "
+                 << gravadas << "ª e a " << confirmadas + 1 << "ª operação" << endl;
+        }
+
+        else
+        {
+            for (int operacao = 0; operacao < 500; operacao++) gerador.aplicar(*arvore);
+
+            delete arvore;
+            arvore = abrir(nomeDoArquivo);
+
+            if (!conferir(*arvore, gerador.registros))
+            {
+                sucesso = false;
+
+                cout << "Queda " << queda << ": a árvore não confere depois de reaberta"
+                     << endl;
+            }
+        }
+
+        delete arvore;
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    return sucesso;
+}
+
+int main()
+{
+    // O contador fica numa página compartilhada, para o pai saber o que o filho
+    // concluiu antes de morrer
+    int *feitas = (int *) mmap(nullptr, sizeof(int), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    bool sucesso = testarReaberturas("TesteCopiaNaEscrita.txt");
+
+    sucesso = testarQuedas("TesteCopiaNaEscrita.txt", feitas) && sucesso;
+
+    munmap(feitas, sizeof(int));
+
+    cout << (sucesso ? "A árvore sempre voltou a uma versão gravada" :
+        "A árvore não voltou a uma versão gravada") << endl;
+
+    return sucesso ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+#include "ArvoreBMais.hpp"
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <vector>
+#include <random>
+#include <cstdio>
+
+using namespace std;
+
+typedef ArvoreBMais<int, int> Arvore;
+
+/**
+ * Confere as duas varreduras completas do cursor: do início ao fim pelo
+ * begin() e end() da árvore e do fim ao início pelo ponteiro para a folha
+ * anterior.
+ */
+bool conferirVarreduras(Arvore &arvore, map<int, int> &esperado)
+{
+    vector< pair<int, int> > ida, volta;
+    vector< pair<int, int> > esperadaIda(esperado.begin(), esperado.end());
+    vector< pair<int, int> > esperadaVolta(esperado.rbegin(), esperado.rend());
+
+    for (auto &&par : arvore) ida.push_back(par);
+
+    Arvore::Cursor cursor = arvore.end();
+
+    while (cursor.voltar()) volta.push_back(*cursor);
+
+    return ida == esperadaIda && volta == esperadaVolta;
+}
+
+/**
+ * Posiciona o cursor em chaves aleatórias, que podem ou não estar na árvore, e
+ * anda alguns registros para cada lado, comparando com o lower_bound do map.
+ */
+bool conferirPosicionamentos(Arvore &arvore, map<int, int> &esperado, mt19937 &aleatorio)
+{
+    for (int teste = 0; teste < 300; teste++)
+    {
+        int chave = aleatorio() % 2100 - 50;
+        Arvore::Cursor cursor = arvore.obterCursor(chave);
+        auto iterador = esperado.lower_bound(chave);
+
+        if (cursor.valido() != (iterador != esperado.end())) return false;
+        if (!cursor.valido()) continue;
+
+        // Para frente a partir do registro encontrado
+        Arvore::Cursor frente = cursor;
+        auto iteradorDaFrente = iterador;
+
+        for (int passo = 0; passo < 8 && iteradorDaFrente != esperado.end(); passo++)
+        {
+            if (!frente.valido() || *frente != pair<int, int>(*iteradorDaFrente)) return false;
+
+            ++frente;
+            ++iteradorDaFrente;
+        }
+
+        if (iteradorDaFrente == esperado.end() && frente != arvore.end()) return false;
+
+        // Para trás a partir do mesmo registro
+        for (int passo = 0; passo < 8; passo++)
+        {
+            if (!cursor.valido() || *cursor != pair<int, int>(*iterador)) return false;
+
+            if (iterador == esperado.begin())
+            {
+                // Antes do primeiro registro, o cursor sai da árvore
+                if (cursor.voltar()) return false;
+
+                break;
+            }
+
+            cursor.voltar();
+            --iterador;
+        }
+    }
+
+    return true;
+}
+
+bool conferir(Arvore &arvore, map<int, int> &esperado, mt19937 &aleatorio)
+{
+    return conferirVarreduras(arvore, esperado) &&
+        conferirPosicionamentos(arvore, esperado, aleatorio);
+}
+
+/**
+ * Faz inserções e exclusões aleatórias, na mesma árvore e no map. As exclusões
+ * esvaziam e fundem folhas, o que muda os ponteiros para as vizinhas.
+ */
+void misturarOperacoes(Arvore &arvore, map<int, int> &esperado, mt19937 &aleatorio,
+    int operacoes)
+{
+    for (int operacao = 0; operacao < operacoes; operacao++)
+    {
+        int chave = aleatorio() % 2000;
+
+        if (esperado.count(chave) == 0)
+        {
+            int dado = chave + 10;
+
+            arvore.inserir(chave, dado);
+            esperado[chave] = dado;
+        }
+
+        else if (aleatorio() % 2 == 0)
+        {
+            arvore.excluir(chave);
+            esperado.erase(chave);
+        }
+    }
+}
+
+/**
+ * Confere o cursor depois de inserções e exclusões, de reabrir o arquivo, de
+ * compactá-lo e de uma carga em lote, que montam as listas de folhas cada uma
+ * de um jeito.
+ */
+bool testarCursor(string nomeDoArquivo, int ordem)
+{
+    map<int, int> esperado;
+    mt19937 aleatorio(ordem);
+    bool sucesso = true;
+
+    remove(nomeDoArquivo.c_str());
+
+    {
+        Arvore arvore(nomeDoArquivo, ordem);
+
+        // A árvore vazia não tem nenhum registro para o cursor
+        sucesso = arvore.begin() == arvore.end() &&
+            conferir(arvore, esperado, aleatorio);
+
+        misturarOperacoes(arvore, esperado, aleatorio, 5000);
+        sucesso = conferir(arvore, esperado, aleatorio) && sucesso;
+    }
+
+    {
+        Arvore arvore(nomeDoArquivo, ordem);
+
+        sucesso = conferir(arvore, esperado, aleatorio) && sucesso;
+
+        arvore.compactar();
+        sucesso = conferir(arvore, esperado, aleatorio) && sucesso;
+
+        misturarOperacoes(arvore, esperado, aleatorio, 2000);
+        sucesso = conferir(arvore, esperado, aleatorio) && sucesso;
+
+        arvore.carregarEmLote(esperado.begin(), esperado.end(), 0.75);
+        sucesso = conferir(arvore, esperado, aleatorio) && sucesso;
+    }
+
+    {
+        Arvore arvore(nomeDoArquivo, ordem);
+
+        sucesso = conferir(arvore, esperado, aleatorio) && sucesso;
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    if (!sucesso) cout << "Ordem " << ordem << ": o cursor não confere com o map" << endl;
+
+    return sucesso;
+}
+
+int main()
+{
+    string nomeDoArquivo("TesteCursor.txt");
+    bool sucesso = true;
+
+    for (int ordem : { 3, 4, 5, 16, 64 })
+    {
+        sucesso = testarCursor(nomeDoArquivo, ordem) && sucesso;
+    }
+
+    cout << (sucesso ? "O cursor percorreu todos os registros nos dois sentidos" :
+        "O cursor não percorreu alguns registros") << endl;
+
+    return sucesso ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+#include "ArvoreBLink.hpp"
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <vector>
+#include <random>
+#include <cstdio>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+/**
+ * Um processo filho insere chaves em ordem na árvore, com o diário, até ser
+ * morto com SIGKILL no meio do trabalho. O pai reabre a árvore, o que refaz o
+ * diário, e confere se toda inserção que terminou antes da queda está lá. A
+ * inserção que estava em andamento pode ou não ter entrado.
+ */
+template<typename Arvore>
+bool testarQuedas(string nomeDoArquivo, int ordem, volatile int *inseridas)
+{
+    bool sucesso = true;
+
+    for (int queda = 0; queda < 10; queda++)
+    {
+        remove(nomeDoArquivo.c_str());
+        remove((nomeDoArquivo + ".diario").c_str());
+        *inseridas = 0;
+
+        pid_t filho = fork();
+
+        if (filho == 0)
+        {
+            Arvore arvore(nomeDoArquivo, ordem, 8, TipoDePolitica::LRU,
+                TipoDeArmazenamento::FSTREAM, PoliticaDoDiario::A_CADA_CONFIRMACAO);
+
+            for (int chave = 0; ; chave++)
+            {
+                int dado = chave + 1;
+
+                arvore.inserir(chave, dado);
+                *inseridas = chave + 1;
+            }
+        }
+
+        usleep(20000 + queda * 10000);
+        kill(filho, SIGKILL);
+        waitpid(filho, nullptr, 0);
+
+        int confirmadas = *inseridas;
+        Arvore arvore(nomeDoArquivo, ordem, 8, TipoDePolitica::LRU,
+            TipoDeArmazenamento::FSTREAM, PoliticaDoDiario::A_CADA_CONFIRMACAO);
+        auto dados = arvore.listarDadosComAChaveEntre(0, confirmadas + 1);
+        int perdidas = 0;
+
+        // A listagem percorre as folhas, então confere todas as chaves de uma vez
+        for (int chave = 0; chave < confirmadas; chave++)
+        {
+            if (chave >= (int) dados.size() || dados[chave] != chave + 1) perdidas++;
+        }
+
+        if (perdidas > 0 || (int) dados.size() < confirmadas ||
+            (int) dados.size() > confirmadas + 1)
+        {
+            sucesso = false;
+
+            cout << "Queda " << queda << ": " << confirmadas << " inserções confirmadas, "
+                 << perdidas << " perdidas e " << dados.size() << " registros" << endl;
+        }
+    }
+
+    remove(nomeDoArquivo.c_str());
+    remove((nomeDoArquivo + ".diario").c_str());
+
+    return sucesso;
+}
+
+/**
+ * Gera a sequência de inserções e exclusões de uma queda, igual no filho e no
+ * pai. Cada operação insere a chave caso ela não esteja no map e a exclui caso
+ * esteja.
+ */
+class GeradorDeOperacoes
+{
+    mt19937 aleatorio;
+
+public:
+    map<int, int> registros;
+
+    GeradorDeOperacoes(int semente) : aleatorio(semente) {}
+
+    /**
+     * @brief Sorteia a próxima chave e aplica a operação no map.
+     *
+     * @return bool true caso a operação seja uma inserção.
+     */
+    bool proxima(int &chave)
+    {
+        chave = aleatorio() % 1500;
+
+        if (registros.count(chave) > 0)
+        {
+            registros.erase(chave);
+
+            return false;
+        }
+
+        registros[chave] = chave * 2;
+
+        return true;
+    }
+};
+
+template<typename Arvore>
+bool conferir(Arvore &arvore, map<int, int> &esperado)
+{
+    vector<int> dados = arvore.listarDadosComAChaveEntre(0, 1 << 30);
+    vector<int> dadosEsperados;
+
+    for (auto &&par : esperado) dadosEsperados.push_back(par.second);
+
+    return dados == dadosEsperados;
+}
+
+/**
+ * Como testarQuedas(), mas com exclusões, que fundem páginas, e com um cache
+ * pequeno, que leva páginas ao arquivo no meio do trabalho. O pai refaz as
+ * operações confirmadas num map e confere a árvore reaberta com ele. Depois,
+ * faz mais operações nela e a reabre de novo.
+ */
+template<typename Arvore>
+bool testarQuedasComExclusoes(string nomeDoArquivo, int ordem, volatile int *feitas)
+{
+    bool sucesso = true;
+
+    for (int queda = 0; queda < 10; queda++)
+    {
+        remove(nomeDoArquivo.c_str());
+        remove((nomeDoArquivo + ".diario").c_str());
+        *feitas = 0;
+
+        pid_t filho = fork();
+
+        if (filho == 0)
+        {
+            Arvore arvore(nomeDoArquivo, ordem, 4, TipoDePolitica::LRU,
+                TipoDeArmazenamento::PREAD, PoliticaDoDiario::A_CADA_CONFIRMACAO);
+            GeradorDeOperacoes gerador(queda);
+
+            for (int operacao = 0; ; operacao++)
+            {
+                int chave;
+
+                if (gerador.proxima(chave))
+                {
+                    int dado = chave * 2;
+
+                    arvore.inserir(chave, dado);
+                }
+
+                else arvore.excluir(chave);
+
+                *feitas = operacao + 1;
+            }
+        }
+
+        usleep(30000 + queda * 10000);
+        kill(filho, SIGKILL);
+        waitpid(filho, nullptr, 0);
+
+        // A operação em andamento na queda pode ou não ter entrado
+        GeradorDeOperacoes gerador(queda);
+        int chave;
+
+        for (int operacao = 0; operacao < *feitas; operacao++) gerador.proxima(chave);
+
+        map<int, int> semAUltima = gerador.registros;
+
+        gerador.proxima(chave);
+
+        {
+            Arvore arvore(nomeDoArquivo, ordem, 4, TipoDePolitica::LRU,
+                TipoDeArmazenamento::PREAD, PoliticaDoDiario::A_CADA_CONFIRMACAO);
+
+            if (conferir(arvore, semAUltima)) gerador.registros = semAUltima;
+
+            else if (!conferir(arvore, gerador.registros))
+            {
+                sucesso = false;
+
+                cout << "Queda " << queda << ": a árvore não confere com as "
+                     << *feitas << " operações confirmadas" << endl;
+
+                continue;
+            }
+
+            for (int operacao = 0; operacao < 200; operacao++)
+            {
+                if (gerador.proxima(chave))
+                {
+                    int dado = chave * 2;
+
+                    arvore.inserir(chave, dado);
+                }
+
+                else arvore.excluir(chave);
+            }
+        }
+
+        Arvore arvore(nomeDoArquivo, ordem, 4, TipoDePolitica::LRU,
+            TipoDeArmazenamento::PREAD, PoliticaDoDiario::A_CADA_CONFIRMACAO);
+
+        if (!conferir(arvore, gerador.registros))
+        {
+            sucesso = false;
+
+            cout << "Queda " << queda << ": a árvore não confere depois de reaberta"
+                 << endl;
+        }
+    }
+
+    remove(nomeDoArquivo.c_str());
+    remove((nomeDoArquivo + ".diario").c_str());
+
+    return sucesso;
+}
+
+int main()
+{
+    // O contador fica numa página compartilhada, para o pai saber o que o filho
+    // concluiu antes de morrer
+    int *inseridas = (int *) mmap(nullptr, sizeof(int), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    bool sucesso = testarQuedas< ArvoreBMais<int, int> >("TesteDiario.txt", 4, inseridas);
+
+    sucesso = testarQuedas< ArvoreBLink<int, int> >("TesteDiario.txt", 4, inseridas) && sucesso;
+
+    sucesso = testarQuedasComExclusoes< ArvoreB<int, int> >(
+        "TesteDiario.txt", 5, inseridas) && sucesso;
+    sucesso = testarQuedasComExclusoes< ArvoreBMais<int, int> >(
+        "TesteDiario.txt", 5, inseridas) && sucesso;
+
+    munmap(inseridas, sizeof(int));
+
+    cout << (sucesso ? "Nenhuma operação confirmada foi perdida" :
+        "Algumas operações confirmadas foram perdidas") << endl;
+
+    return sucesso ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+#include "ArvoreBMais.hpp"
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <cstdio>
+
+using namespace std;
+
+vector<int> dadosDoMap(map<int, int> &registros)
+{
+    vector<int> dados;
+
+    for (auto &&par : registros) dados.push_back(par.second);
+
+    return dados;
+}
+
+/**
+ * Confere se a árvore, ou um instantâneo dela, tem exatamente os registros do
+ * map, tanto pela listagem de todas as chaves quanto pela pesquisa de cada uma.
+ * As chaves ímpares nunca são inseridas, então algumas delas são pesquisadas
+ * sem sucesso.
+ */
+template<typename Leitor>
+bool conferir(Leitor &leitor, map<int, int> &esperado)
+{
+    if (leitor.listarDadosComAChaveEntre(0, 1 << 30) != dadosDoMap(esperado)) return false;
+
+    for (auto &&par : esperado)
+    {
+        if (leitor.pesquisar((int) par.first) != par.second) return false;
+    }
+
+    for (int chave = 1; chave < 200; chave += 2)
+    {
+        if (leitor.pesquisar(chave) != 0) return false;
+    }
+
+    return true;
+}
+
+/**
+ * Faz inserções e exclusões aleatórias, na mesma árvore e no map. Os dados
+ * nunca são zero, o valor das pesquisas sem sucesso.
+ */
+template<typename Arvore>
+void misturarOperacoes(Arvore &arvore, map<int, int> &esperado, mt19937 &aleatorio,
+    int operacoes)
+{
+    for (int operacao = 0; operacao < operacoes; operacao++)
+    {
+        int chave = aleatorio() % 20000 * 2;
+
+        if (esperado.count(chave) == 0)
+        {
+            int dado = chave + 1;
+
+            arvore.inserir(chave, dado);
+            esperado[chave] = dado;
+        }
+
+        else if (aleatorio() % 2 == 0)
+        {
+            arvore.excluir(chave);
+            esperado.erase(chave);
+        }
+    }
+}
+
+bool existeOArquivo(string nomeDoArquivo)
+{
+    ifstream arquivo(nomeDoArquivo);
+
+    return arquivo.is_open();
+}
+
+/**
+ * Obtém um instantâneo e muda a árvore numa outra thread enquanto ele é lido,
+ * obtém outro e muda a árvore de novo. Cada instantâneo deve continuar igual à
+ * cópia do map feita quando ele foi obtido, e a árvore igual ao map. Enquanto
+ * eles existem, a compactação é recusada. Sem a cópia na escrita, há mais
+ * páginas mudadas que constantes::imagensAntigasNaMemoria, então parte das
+ * imagens vai para o arquivo de imagens, que é apagado junto com a árvore.
+ */
+template<typename Arvore, typename... Opcoes>
+bool testarInstantaneos(string nomeDoArquivo, string nome, bool imagensNoArquivo,
+    Opcoes... opcoes)
+{
+    map<int, int> esperado;
+    mt19937 aleatorio(3);
+    bool sucesso = true;
+
+    remove(nomeDoArquivo.c_str());
+
+    {
+        Arvore arvore(nomeDoArquivo, 4, opcoes...);
+
+        misturarOperacoes(arvore, esperado, aleatorio, 20000);
+
+        {
+            typename Arvore::Instantaneo primeiro = arvore.obterInstantaneo();
+            map<int, int> doPrimeiro = esperado;
+            atomic<bool> terminou(false);
+
+            thread escritora([&]()
+            {
+                misturarOperacoes(arvore, esperado, aleatorio, 8000);
+                terminou = true;
+            });
+
+            do
+            {
+                sucesso = conferir(primeiro, doPrimeiro) && sucesso;
+            }
+            while (!terminou);
+
+            escritora.join();
+
+            sucesso = conferir(primeiro, doPrimeiro) && conferir(arvore, esperado) && sucesso;
+
+            typename Arvore::Instantaneo segundo = arvore.obterInstantaneo();
+            map<int, int> doSegundo = esperado;
+
+            misturarOperacoes(arvore, esperado, aleatorio, 4000);
+
+            sucesso = conferir(primeiro, doPrimeiro) && conferir(segundo, doSegundo) &&
+                conferir(arvore, esperado) && segundo.obterVersao() > primeiro.obterVersao() &&
+                sucesso;
+
+            if (imagensNoArquivo && !existeOArquivo(nomeDoArquivo + ".imagens"))
+            {
+                sucesso = false;
+
+                cout << nome << ": nenhuma imagem antiga foi para o arquivo" << endl;
+            }
+
+            bool recusou = false;
+
+            try
+            {
+                arvore.compactar();
+            }
+
+            catch (logic_error &)
+            {
+                recusou = true;
+            }
+
+            if (!recusou)
+            {
+                sucesso = false;
+
+                cout << nome << ": a compactação não foi recusada com instantâneos" << endl;
+            }
+        }
+
+        arvore.compactar();
+        misturarOperacoes(arvore, esperado, aleatorio, 2000);
+
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    if (existeOArquivo(nomeDoArquivo + ".imagens"))
+    {
+        sucesso = false;
+
+        cout << nome << ": o arquivo de imagens ficou no disco" << endl;
+    }
+
+    {
+        Arvore arvore(nomeDoArquivo, 4, opcoes...);
+
+        sucesso = conferir(arvore, esperado) && sucesso;
+    }
+
+    remove(nomeDoArquivo.c_str());
+    remove((nomeDoArquivo + ".diario").c_str());
+
+    if (!sucesso) cout << nome << ": os instantâneos não conferem com o map" << endl;
+
+    return sucesso;
+}
+
+int main()
+{
+    string nomeDoArquivo("TesteInstantaneos.txt");
+    bool sucesso = testarInstantaneos< ArvoreB<int, int> >(
+        nomeDoArquivo, "ArvoreB", true);
+
+    sucesso = testarInstantaneos< ArvoreB<int, int> >(
+        nomeDoArquivo, "ArvoreB com a cópia na escrita", false, 16, TipoDePolitica::LRU,
+        TipoDeArmazenamento::PREAD, PoliticaDoDiario::NENHUM,
+        ModoDeEscrita::COPIA_NA_ESCRITA) && sucesso;
+
+    sucesso = testarInstantaneos< ArvoreBMais<int, int> >(
+        nomeDoArquivo, "ArvoreBMais", true) && sucesso;
+
+    sucesso = testarInstantaneos< ArvoreBMais<int, int> >(
+        nomeDoArquivo, "ArvoreBMais com o diário", true, 16, TipoDePolitica::LRU,
+        TipoDeArmazenamento::PREAD, PoliticaDoDiario::PERIODICA) && sucesso;
+
+    cout << (sucesso ? "Os instantâneos não mudaram com as escritas" :
+        "Alguns instantâneos mudaram com as escritas") << endl;
+
+    return sucesso ? 0 : 1;
+}
@@ -0,0 +1,268 @@
+#include "ArvoreBMais.hpp"
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <vector>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+/**
+ * Confere os contadores de chaves menores num bloco, que devem dar o mesmo
+ * índice que o lower_bound. Os vetoriais só são conferidos caso o processador
+ * tenha as instruções deles.
+ */
+template<typename TIPO>
+bool conferirContadores(const TIPO *chaves, size_t quantidade, const TIPO &chave, size_t esperado)
+{
+    bool sucesso = contarMenoresEscalar<TIPO>(chaves, quantidade, chave) == esperado;
+
+#ifdef ARVORE_COM_PESQUISA_VETORIAL
+    typedef NucleoVetorial<TIPO> Nucleo;
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        sucesso = Nucleo::contarMenoresAvx2(chaves, quantidade, chave) == esperado && sucesso;
+    }
+
+    if (Nucleo::sseExigeSse42 ? __builtin_cpu_supports("sse4.2") : __builtin_cpu_supports("sse2"))
+    {
+        sucesso = Nucleo::contarMenoresSse(chaves, quantidade, chave) == esperado && sucesso;
+    }
+#endif
+
+    return sucesso;
+}
+
+/**
+ * Compara a pesquisa nas chaves com o lower_bound em vetores ordenados de 0 a
+ * 300 chaves, com repetições e valores negativos, procurando chaves que estão
+ * e que não estão neles, menores e maiores que todas.
+ */
+template<typename TIPO>
+bool testarPesquisa(string nome, TIPO passo)
+{
+    const size_t chavesPorBloco = constantes::bytesDoBlocoDePesquisa / sizeof(TIPO);
+    mt19937 aleatorio(sizeof(TIPO));
+    bool sucesso = true;
+
+    for (size_t quantidade = 0; quantidade <= 300; quantidade++)
+    {
+        vector<TIPO> chaves(quantidade);
+
+        for (TIPO &chave : chaves) chave = (TIPO) ((int) (aleatorio() % 200) - 100) * passo;
+
+        sort(chaves.begin(), chaves.end());
+
+        for (int valor = -102; valor <= 102; valor++)
+        {
+            // Metade do passo cai entre duas chaves
+            TIPO chave = (TIPO) valor * passo + (valor % 2 == 0 ? 0 : passo / 2);
+            size_t esperado = lower_bound(chaves.begin(), chaves.end(), chave) - chaves.begin();
+
+            if (PesquisaNasChaves<TIPO>::limiteInferior(chaves.data(), quantidade, chave) != esperado ||
+                (quantidade <= chavesPorBloco &&
+                    !conferirContadores(chaves.data(), quantidade, chave, esperado)))
+            {
+                sucesso = false;
+            }
+        }
+    }
+
+    if (!sucesso) cout << nome << ": a pesquisa nas chaves não confere com o lower_bound" << endl;
+
+    return sucesso;
+}
+
+/**
+ * Coloca vetores ordenados de 0 a 300 chaves distintas na ordem de Eytzinger.
+ * Cada índice dela deve voltar à posição da sua chave nas ordenadas, e a
+ * pesquisa nela deve dar o mesmo índice que o lower_bound.
+ */
+template<typename TIPO>
+bool testarOrdemEytzinger(string nome, TIPO passo)
+{
+    typedef OrdemEytzinger<TIPO> Ordem;
+    mt19937 aleatorio(sizeof(TIPO) + 1);
+    bool sucesso = true;
+
+    for (size_t quantidade = 0; quantidade <= 300; quantidade++)
+    {
+        vector<TIPO> chaves, eytzinger(quantidade + 1);
+
+        // Sorteia quantidade valores distintos entre -400 e 399
+        for (int valor = -400; valor < 400; valor++)
+        {
+            if (aleatorio() % (400 - valor) < quantidade - chaves.size())
+            {
+                chaves.push_back((TIPO) valor * passo);
+            }
+        }
+
+        Ordem::organizar(chaves.data(), quantidade, eytzinger.data());
+
+        for (size_t indice = 1; indice <= quantidade; indice++)
+        {
+            if (eytzinger[indice] != chaves[Ordem::obterPosicaoOrdenada(indice, quantidade)])
+            {
+                sucesso = false;
+            }
+        }
+
+        for (int valor = -402; valor <= 402; valor++)
+        {
+            TIPO chave = (TIPO) valor * passo + (valor % 2 == 0 ? 0 : passo / 2);
+            size_t esperado = lower_bound(chaves.begin(), chaves.end(), chave) - chaves.begin();
+
+            if (Ordem::limiteInferior(eytzinger.data(), quantidade, chave) != esperado)
+            {
+                sucesso = false;
+            }
+        }
+    }
+
+    if (!sucesso) cout << nome << ": a ordem de Eytzinger não confere com o lower_bound" << endl;
+
+    return sucesso;
+}
+
+/**
+ * Confere se a árvore tem exatamente os registros do map, pela listagem de
+ * todas as chaves e pela pesquisa de cada uma. As chaves entre duas do map não
+ * devem ser encontradas.
+ */
+template<typename Arvore, typename TIPO>
+bool conferir(Arvore &arvore, map<TIPO, int> &esperado, TIPO passo)
+{
+    TIPO menor = numeric_limits<TIPO>::lowest();
+    TIPO maior = numeric_limits<TIPO>::max();
+    vector<int> dados = arvore.listarDadosComAChaveEntre(menor, maior);
+    size_t indice = 0;
+
+    if (dados.size() != esperado.size()) return false;
+
+    for (auto &&par : esperado)
+    {
+        TIPO ausente = par.first + passo / 2;
+
+        if (dados[indice++] != par.second ||
+            arvore.pesquisar((TIPO) par.first) != par.second ||
+            arvore.pesquisar(ausente) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Faz inserções e exclusões aleatórias numa árvore de ordem grande, cujas
+ * páginas têm chaves suficientes para a pesquisa binária sem desvios chegar a
+ * um bloco, compara com um map e reabre o arquivo. Depois reconstrói a árvore
+ * com as mesmas chaves, cujas páginas vão direto para o arquivo e só ganham a
+ * ordem de Eytzinger quando são lidas, e a reabre de novo.
+ */
+template<typename Arvore, typename TIPO>
+bool testarArvore(string nomeDoArquivo, string nome, int ordem, TIPO passo)
+{
+    map<TIPO, int> esperado;
+    mt19937 aleatorio(ordem);
+    bool sucesso = true;
+
+    remove(nomeDoArquivo.c_str());
+
+    {
+        Arvore arvore(nomeDoArquivo, ordem);
+
+        for (int operacao = 0; operacao < 20000; operacao++)
+        {
+            int valor = aleatorio() % 20000;
+            TIPO chave = (TIPO) (valor - 10000) * passo;
+
+            if (esperado.count(chave) == 0)
+            {
+                int dado = valor + 1;
+
+                arvore.inserir(chave, dado);
+                esperado[chave] = dado;
+            }
+
+            else if (aleatorio() % 2 == 0)
+            {
+                arvore.excluir(chave);
+                esperado.erase(chave);
+            }
+        }
+
+        sucesso = conferir(arvore, esperado, passo);
+    }
+
+    {
+        Arvore arvore(nomeDoArquivo, ordem);
+        vector< pair<TIPO, int> > pares(esperado.begin(), esperado.end());
+
+        sucesso = conferir(arvore, esperado, passo) && sucesso;
+
+        arvore.construirAPartirDe(pares.begin(), pares.end(), 1 << 20, 0.9);
+        sucesso = conferir(arvore, esperado, passo) && sucesso;
+    }
+
+    {
+        Arvore arvore(nomeDoArquivo, ordem);
+
+        sucesso = conferir(arvore, esperado, passo) && sucesso;
+    }
+
+    remove(nomeDoArquivo.c_str());
+
+    if (!sucesso)
+    {
+        cout << nome << " de ordem " << ordem << ": a árvore não confere com o map" << endl;
+    }
+
+    return sucesso;
+}
+
+template<typename TIPO>
+bool testarTipo(string nomeDoArquivo, string nome, TIPO passo)
+{
+    bool sucesso = testarPesquisa<TIPO>(nome, passo);
+
+    sucesso = testarOrdemEytzinger<TIPO>(nome, passo) && sucesso;
+
+    for (int ordem : { 64, 256 })
+    {
+        sucesso = testarArvore< ArvoreB<TIPO, int> >(
+            nomeDoArquivo, "ArvoreB com chaves " + nome, ordem, passo) && sucesso;
+        sucesso = testarArvore< ArvoreBMais<TIPO, int> >(
+            nomeDoArquivo, "ArvoreBMais com chaves " + nome, ordem, passo) && sucesso;
+    }
+
+    return sucesso;
+}
+
+int main()
+{
+    string nomeDoArquivo("TestePesquisaNasChaves.txt");
+
+    // Compilado com ARVORE_COM_ORDEM_EYTZINGER, as árvores descem pelas chaves
+    // na ordem de Eytzinger (veja PaginaB)
+    //
+    // Os passos das chaves de 64 bits não cabem em 32 bits, e os dos reais têm
+    // metades exatas
+    bool sucesso = testarTipo<int>(nomeDoArquivo, "int", 2);
+
+    sucesso = testarTipo<long long>(nomeDoArquivo, "long long", 1LL << 33) && sucesso;
+    sucesso = testarTipo<float>(nomeDoArquivo, "float", 0.5f) && sucesso;
+    sucesso = testarTipo<double>(nomeDoArquivo, "double", 0.5) && sucesso;
+
+    cout << (sucesso ? "Todas as pesquisas nas chaves conferem" :
+        "Algumas pesquisas nas chaves não conferem") << endl;
+
+    return sucesso ? 0 : 1;
+}